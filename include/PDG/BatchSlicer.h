@@ -0,0 +1,104 @@
+#pragma once
+
+#include "PDG/FrozenPDG.h"
+#include "PDG/PDGSlicer.h"
+
+#include "llvm/ADT/ArrayRef.h"
+#include "llvm/ADT/BitVector.h"
+
+#include <cassert>
+#include <cstdint>
+#include <vector>
+
+namespace pdg {
+
+/// Slices of one batch of criteria: the nodes reached by any of them and a
+/// mask per node with a bit for each criterion reaching it
+class BatchSlice
+{
+public:
+    BatchSlice(unsigned numCriteria, unsigned maskWords);
+
+    unsigned getNumCriteria() const
+    {
+        return m_numCriteria;
+    }
+
+    /// Nodes in the slice of at least one criterion, sorted by id
+    const std::vector<FrozenPDG::NodeId>& getReachedNodes() const
+    {
+        return m_nodes;
+    }
+
+    /// False for criteria beyond the number of criteria of the batch
+    bool contains(unsigned criterion, FrozenPDG::NodeId node) const;
+
+    /// Empty for criteria beyond the number of criteria of the batch
+    Slice getSlice(unsigned criterion) const;
+
+private:
+    friend class BatchSlicer;
+
+    bool hasBit(unsigned index, unsigned criterion) const
+    {
+        assert(criterion < m_numCriteria && index < m_nodes.size());
+        return (m_masks[index * m_maskWords + criterion / 64] >> (criterion % 64)) & 1;
+    }
+
+private:
+    unsigned m_numCriteria;
+    unsigned m_maskWords;
+    std::vector<FrozenPDG::NodeId> m_nodes;
+    std::vector<uint64_t> m_masks;
+}; // class BatchSlice
+
+/// Slices many criteria at once by propagating a bit per criterion instead
+/// of traversing the graph once per criterion. A node is revisited only when
+/// it receives bits it did not have, so edges shared by the slices of a
+/// batch are followed once per change rather than once per criterion. Masks
+/// are maskWords 64 bit words wide, which is the batch size over 64.
+class BatchSlicer
+{
+public:
+    explicit BatchSlicer(const FrozenPDG& pdg, unsigned maskWords = 4);
+
+    BatchSlicer(const BatchSlicer& ) = delete;
+    BatchSlicer(BatchSlicer&& ) = delete;
+    BatchSlicer& operator =(const BatchSlicer& ) = delete;
+    BatchSlicer& operator =(BatchSlicer&& ) = delete;
+
+public:
+    unsigned getBatchSize() const
+    {
+        return m_maskWords * 64;
+    }
+
+    /// Criteria beyond the batch size are ignored. The visitor of the
+    /// options is not supported.
+    BatchSlice sliceBatch(llvm::ArrayRef<FrozenPDG::NodeId> criteria, const SliceOptions& options);
+
+    /// One slice per criterion, computed batch by batch
+    std::vector<Slice> slice(llvm::ArrayRef<FrozenPDG::NodeId> criteria, const SliceOptions& options);
+
+private:
+    uint64_t* getMask(FrozenPDG::NodeId node)
+    {
+        return &m_masks[static_cast<uint64_t>(node) * m_maskWords];
+    }
+
+    uint64_t* getPending(FrozenPDG::NodeId node)
+    {
+        return &m_pending[static_cast<uint64_t>(node) * m_maskWords];
+    }
+
+private:
+    const FrozenPDG& m_pdg;
+    const unsigned m_maskWords;
+    /// Bits of each node, and bits not yet passed on to its neighbours
+    std::vector<uint64_t> m_masks;
+    std::vector<uint64_t> m_pending;
+    llvm::BitVector m_queued;
+}; // class BatchSlicer
+
+} // namespace pdg
+
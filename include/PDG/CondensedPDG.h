@@ -0,0 +1,153 @@
+#pragma once
+
+#include "PDG/FrozenPDG.h"
+#include "PDG/PDGSlicer.h"
+
+#include "llvm/ADT/ArrayRef.h"
+#include "llvm/ADT/BitVector.h"
+
+#include <cstdint>
+#include <vector>
+
+namespace pdg {
+
+/// Smaller view of a frozen PDG for reachability and whole slices. Strongly
+/// connected components of the followed edges are collapsed, and chains of
+/// components, where each has a single successor whose single predecessor
+/// it is, are contracted into one condensed node. Every member of a chain
+/// reaches the rest of the chain, only the first component is entered from
+/// outside and only the last is left, so reachability between nodes of
+/// different condensed nodes is reachability in the condensed graph. Within
+/// a condensed node the depth of a component, its distance from the end of
+/// the chain, decides it. Condensed nodes are numbered in reverse
+/// topological order.
+class CondensedPDG
+{
+public:
+    using NodeId = FrozenPDG::NodeId;
+    using CondensedId = uint32_t;
+
+public:
+    explicit CondensedPDG(const FrozenPDG& pdg, unsigned edges = AllEdges);
+
+    CondensedPDG(const CondensedPDG& ) = delete;
+    CondensedPDG(CondensedPDG&& ) = delete;
+    CondensedPDG& operator =(const CondensedPDG& ) = delete;
+    CondensedPDG& operator =(CondensedPDG&& ) = delete;
+
+public:
+    const FrozenPDG& getPDG() const
+    {
+        return m_pdg;
+    }
+
+    unsigned getEdges() const
+    {
+        return m_edges;
+    }
+
+    unsigned getNumNodes() const
+    {
+        return m_memberOffsets.size() - 1;
+    }
+
+    uint64_t getNumEdges() const
+    {
+        return m_successors.size();
+    }
+
+    unsigned getNumComponents() const
+    {
+        return m_numComponents;
+    }
+
+    CondensedId getCondensedNode(NodeId node) const
+    {
+        return m_condensed[node];
+    }
+
+    /// Distance of the component of the node from the end of its chain
+    uint32_t getDepth(NodeId node) const
+    {
+        return m_depths[node];
+    }
+
+    /// Original nodes, by ascending depth and id
+    llvm::ArrayRef<NodeId> getMembers(CondensedId node) const
+    {
+        return llvm::makeArrayRef(m_members).slice(m_memberOffsets[node],
+                                                   m_memberOffsets[node + 1] - m_memberOffsets[node]);
+    }
+
+    llvm::ArrayRef<CondensedId> getSuccessors(CondensedId node) const
+    {
+        return llvm::makeArrayRef(m_successors).slice(m_successorOffsets[node],
+                                                      m_successorOffsets[node + 1] - m_successorOffsets[node]);
+    }
+
+    llvm::ArrayRef<CondensedId> getPredecessors(CondensedId node) const
+    {
+        return llvm::makeArrayRef(m_predecessors).slice(m_predecessorOffsets[node],
+                                                        m_predecessorOffsets[node + 1] - m_predecessorOffsets[node]);
+    }
+
+    /// Bytes held by the view
+    uint64_t getMemoryUsage() const;
+
+private:
+    const FrozenPDG& m_pdg;
+    const unsigned m_edges;
+    unsigned m_numComponents;
+    std::vector<CondensedId> m_condensed;
+    std::vector<uint32_t> m_depths;
+    std::vector<uint64_t> m_memberOffsets;
+    std::vector<NodeId> m_members;
+    std::vector<uint64_t> m_successorOffsets;
+    std::vector<CondensedId> m_successors;
+    std::vector<uint64_t> m_predecessorOffsets;
+    std::vector<CondensedId> m_predecessors;
+}; // class CondensedPDG
+
+/// Reachability and slices along the edges of a condensed PDG, answered by
+/// traversing condensed nodes and expanding them to their members. The
+/// visited set is reused by all queries of one slicer, so a slicer must not
+/// be shared between threads.
+class CondensedSlicer
+{
+public:
+    explicit CondensedSlicer(const CondensedPDG& graph);
+
+    CondensedSlicer(const CondensedSlicer& ) = delete;
+    CondensedSlicer(CondensedSlicer&& ) = delete;
+    CondensedSlicer& operator =(const CondensedSlicer& ) = delete;
+    CondensedSlicer& operator =(CondensedSlicer&& ) = delete;
+
+public:
+    /// Whether a path of the condensed edges leads from source to dest
+    bool reaches(FrozenPDG::NodeId source, FrozenPDG::NodeId dest);
+
+    /// Slice over the edges the graph was condensed for, the same as the
+    /// interprocedural slice of PDGSlicer
+    Slice slice(llvm::ArrayRef<FrozenPDG::NodeId> criteria, SliceDirection direction);
+
+    Slice backwardSlice(llvm::ArrayRef<FrozenPDG::NodeId> criteria)
+    {
+        return slice(criteria, SliceDirection::Backward);
+    }
+
+    Slice forwardSlice(llvm::ArrayRef<FrozenPDG::NodeId> criteria)
+    {
+        return slice(criteria, SliceDirection::Forward);
+    }
+
+private:
+    void clear();
+
+private:
+    const CondensedPDG& m_graph;
+    llvm::BitVector m_visited;
+    std::vector<CondensedPDG::CondensedId> m_reached;
+}; // class CondensedSlicer
+
+} // namespace pdg
+
@@ -0,0 +1,93 @@
+#pragma once
+
+#include "PDG/FrozenPDG.h"
+#include "PDG/PDGSlicer.h"
+
+#include "llvm/ADT/ArrayRef.h"
+#include "llvm/ADT/BitVector.h"
+
+#include <cstdint>
+#include <unordered_map>
+#include <vector>
+
+namespace pdg {
+
+/// Context sensitive slicing over a frozen PDG after Horwitz, Reps and
+/// Binkley. Calls are entered through call edges, from actual to formal
+/// arguments and from call sites to function nodes, and left through return
+/// edges from function nodes to call sites. A slice runs in two phases: the
+/// first does not descend into callees and crosses calls through summary
+/// edges instead, the second descends but does not ascend to callers, so a
+/// slice never enters a function through one call site and leaves it through
+/// another. Other edges between functions, such as through globals, are
+/// followed in both phases.
+///
+/// A summary edge leads from an actual argument to its call site if the
+/// formal argument reaches a return of the callee. Summaries are tabulated
+/// per function on first use of an edge filter and cached by the slicer,
+/// which must not be shared between threads.
+class ContextSensitiveSlicer
+{
+public:
+    using NodeId = FrozenPDG::NodeId;
+    using FunctionId = FrozenPDG::FunctionId;
+
+public:
+    explicit ContextSensitiveSlicer(const FrozenPDG& pdg);
+
+    ContextSensitiveSlicer(const ContextSensitiveSlicer& ) = delete;
+    ContextSensitiveSlicer(ContextSensitiveSlicer&& ) = delete;
+    ContextSensitiveSlicer& operator =(const ContextSensitiveSlicer& ) = delete;
+    ContextSensitiveSlicer& operator =(ContextSensitiveSlicer&& ) = delete;
+
+public:
+    Slice slice(llvm::ArrayRef<NodeId> criteria, SliceDirection direction, unsigned edges = AllEdges);
+
+    Slice backwardSlice(llvm::ArrayRef<NodeId> criteria, unsigned edges = AllEdges);
+    Slice forwardSlice(llvm::ArrayRef<NodeId> criteria, unsigned edges = AllEdges);
+
+    /// Whether the value of a formal argument may reach the result of a call
+    /// of its function. Always true for functions without returns in the
+    /// graph, such as declarations.
+    bool reachesResult(NodeId formal, unsigned edges = AllEdges);
+
+    /// Functions evaluated by the tabulations so far
+    uint64_t getNumEvaluations() const
+    {
+        return m_numEvaluations;
+    }
+
+private:
+    enum class EdgeClass
+    {
+        Local,
+        /// Actual to formal argument or call site to function node
+        Call,
+        /// Function node to call site
+        Return
+    };
+
+    EdgeClass classify(NodeId source, NodeId dest, const FrozenPDG::Edge& edge) const;
+    /// False for an edge from an actual argument to its call site without a
+    /// summary, true for all other edges
+    bool isSummarized(NodeId source, NodeId dest, const FrozenPDG::Edge& edge, const llvm::BitVector& summaries) const;
+
+    const llvm::BitVector& getSummaries(unsigned edges);
+    void tabulate(unsigned edges, llvm::BitVector& summaries);
+    /// Marks formal arguments of function reaching its returns, returns
+    /// whether any new one was marked
+    bool evaluate(FunctionId function,
+                  const std::vector<NodeId>& returns,
+                  unsigned edges,
+                  llvm::BitVector& summaries);
+
+private:
+    const FrozenPDG& m_pdg;
+    /// Formal arguments reaching the result of a call, per edge filter
+    std::unordered_map<unsigned, llvm::BitVector> m_summaries;
+    llvm::BitVector m_visited;
+    uint64_t m_numEvaluations;
+}; // class ContextSensitiveSlicer
+
+} // namespace pdg
+
@@ -0,0 +1,310 @@
+#pragma once
+
+#include "PDG/SerializedPDG.h"
+
+#include "llvm/ADT/ArrayRef.h"
+#include "llvm/ADT/StringRef.h"
+
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace pdg {
+
+class PDG;
+class PDGNode;
+
+/// Immutable PDG with dense node ids and edges in compressed sparse rows, for
+/// graphs too large to be held as PDGNode objects. The arrays are files in a
+/// directory written by FrozenPDGWriter and are memory mapped, so only the
+/// pages touched by a traversal need to be resident.
+class FrozenPDG
+{
+public:
+    using NodeId = uint32_t;
+    using FunctionId = uint32_t;
+
+    static constexpr NodeId InvalidNode = ~0u;
+    static constexpr FunctionId NoFunction = ~0u;
+
+    /// On disk layout of a node, strings are offsets into the string pool
+    struct NodeRecord
+    {
+        /// PDGLLVMNode::NodeType
+        uint32_t type;
+        FunctionId function;
+        uint32_t module;
+        /// SerializedPDG::Linkage
+        uint32_t linkage;
+        int32_t argIdx;
+        uint32_t opcode;
+        uint64_t symbol;
+        uint64_t label;
+        uint64_t metadataLabel;
+    };
+
+    struct FunctionRecord
+    {
+        uint64_t name;
+        uint32_t module;
+        uint32_t padding;
+    };
+
+    struct Edge
+    {
+        /// Destination of out edges, source of in edges
+        NodeId node;
+        /// SerializedPDG::EdgeKind
+        uint32_t kind;
+
+        SerializedPDG::EdgeKind getKind() const
+        {
+            return static_cast<SerializedPDG::EdgeKind>(kind);
+        }
+    };
+
+    using edge_iterator = const Edge*;
+    using node_iterator = const NodeId*;
+
+public:
+    ~FrozenPDG();
+    FrozenPDG(const FrozenPDG& ) = delete;
+    FrozenPDG(FrozenPDG&& ) = delete;
+    FrozenPDG& operator =(const FrozenPDG& ) = delete;
+    FrozenPDG& operator =(FrozenPDG&& ) = delete;
+
+public:
+    /// Maps the graph written into the given directory. Fails unless all
+    /// string offsets, node ids and row offsets are within bounds.
+    static std::unique_ptr<FrozenPDG> open(const std::string& directory);
+
+    /// Writes the PDG of the given module into the directory and maps it.
+    /// Nodes keep a link to the PDG nodes they were made from, so the PDG
+    /// must outlive the frozen graph.
+    static std::unique_ptr<FrozenPDG> freeze(const PDG& pdg,
+                                             const std::string& moduleName,
+                                             const std::string& directory);
+
+public:
+    unsigned getNumNodes() const
+    {
+        return m_nodes.size();
+    }
+
+    uint64_t getNumEdges() const
+    {
+        return m_outEdges.size();
+    }
+
+    unsigned getNumFunctions() const
+    {
+        return m_functions.size();
+    }
+
+    const SerializedPDG::Modules& getModules() const
+    {
+        return m_modules;
+    }
+
+    unsigned getNodeType(NodeId node) const
+    {
+        return m_nodes[node].type;
+    }
+
+    /// NoFunction for globals and constants
+    FunctionId getFunction(NodeId node) const
+    {
+        return m_nodes[node].function;
+    }
+
+    unsigned getModule(NodeId node) const
+    {
+        return m_nodes[node].module;
+    }
+
+    SerializedPDG::Linkage getLinkage(NodeId node) const
+    {
+        return static_cast<SerializedPDG::Linkage>(m_nodes[node].linkage);
+    }
+
+    int getArgIdx(NodeId node) const
+    {
+        return m_nodes[node].argIdx;
+    }
+
+    llvm::StringRef getSymbol(NodeId node) const
+    {
+        return getString(m_nodes[node].symbol);
+    }
+
+    llvm::StringRef getLabel(NodeId node) const
+    {
+        return getString(m_nodes[node].label);
+    }
+
+    /// llvm::Instruction opcode of instruction nodes, 0 for other nodes
+    unsigned getOpcode(NodeId node) const
+    {
+        return m_nodes[node].opcode;
+    }
+
+    llvm::StringRef getMetadataLabel(NodeId node) const
+    {
+        return getString(m_nodes[node].metadataLabel);
+    }
+
+    llvm::ArrayRef<Edge> getOutEdges(NodeId node) const
+    {
+        return m_outEdges.slice(m_outOffsets[node], m_outOffsets[node + 1] - m_outOffsets[node]);
+    }
+
+    llvm::ArrayRef<Edge> getInEdges(NodeId node) const
+    {
+        return m_inEdges.slice(m_inOffsets[node], m_inOffsets[node + 1] - m_inOffsets[node]);
+    }
+
+    edge_iterator outEdgesBegin(NodeId node) const
+    {
+        return getOutEdges(node).begin();
+    }
+
+    edge_iterator outEdgesEnd(NodeId node) const
+    {
+        return getOutEdges(node).end();
+    }
+
+    edge_iterator inEdgesBegin(NodeId node) const
+    {
+        return getInEdges(node).begin();
+    }
+
+    edge_iterator inEdgesEnd(NodeId node) const
+    {
+        return getInEdges(node).end();
+    }
+
+    llvm::StringRef getFunctionName(FunctionId function) const
+    {
+        return getString(m_functions[function].name);
+    }
+
+    unsigned getFunctionModule(FunctionId function) const
+    {
+        return m_functions[function].module;
+    }
+
+    /// First function with the given name, NoFunction if there is none
+    FunctionId findFunction(llvm::StringRef name) const;
+
+    /// Nodes whose parent is the function, in ascending id order
+    llvm::ArrayRef<NodeId> getFunctionNodes(FunctionId function) const
+    {
+        return m_functionNodes.slice(m_functionOffsets[function],
+                                     m_functionOffsets[function + 1] - m_functionOffsets[function]);
+    }
+
+    node_iterator nodesBegin(FunctionId function) const
+    {
+        return getFunctionNodes(function).begin();
+    }
+
+    node_iterator nodesEnd(FunctionId function) const
+    {
+        return getFunctionNodes(function).end();
+    }
+
+    /// Nodes of the PDGLLVMNode::NodeType, in ascending id order
+    llvm::ArrayRef<NodeId> getNodesOfType(unsigned type) const
+    {
+        return getIndexNodes(m_typeIndex, type);
+    }
+
+    /// Instruction nodes with the llvm::Instruction opcode, in ascending id order
+    llvm::ArrayRef<NodeId> getNodesWithOpcode(unsigned opcode) const
+    {
+        return getIndexNodes(m_opcodeIndex, opcode);
+    }
+
+    /// Call sites of the functions with the given name, i.e. the nodes with a
+    /// control edge to their function nodes, in ascending id order
+    llvm::ArrayRef<NodeId> getCallSites(llvm::StringRef callee) const;
+
+    /// Instruction nodes with the labeling metadata, in ascending id order
+    llvm::ArrayRef<NodeId> getNodesWithLabel(llvm::StringRef label) const;
+
+    /// Whether the graph was frozen from a PDG in this process
+    bool hasPDGNodes() const
+    {
+        return !m_pdgNodes.empty();
+    }
+
+    PDGNode* getPDGNode(NodeId node) const
+    {
+        return m_pdgNodes[node];
+    }
+
+    /// InvalidNode for nodes not in the frozen graph
+    NodeId getNodeId(PDGNode* node) const;
+
+private:
+    class MappedFile;
+
+    /// Sorted node lists of dense keys in compressed sparse rows
+    struct NodeIndex
+    {
+        llvm::ArrayRef<uint64_t> offsets;
+        llvm::ArrayRef<NodeId> nodes;
+    };
+
+    FrozenPDG();
+
+    bool map(const std::string& directory);
+    bool validateRecords() const;
+
+    template <typename T>
+    bool mapArray(const std::string& directory, const std::string& name, llvm::ArrayRef<T>& array);
+
+    llvm::StringRef getString(uint64_t offset) const
+    {
+        return llvm::StringRef(m_strings.data() + offset);
+    }
+
+    llvm::ArrayRef<NodeId> getIndexNodes(const NodeIndex& index, uint64_t key) const
+    {
+        if (key + 1 >= index.offsets.size()) {
+            return llvm::ArrayRef<NodeId>();
+        }
+        return index.nodes.slice(index.offsets[key], index.offsets[key + 1] - index.offsets[key]);
+    }
+
+    bool mapIndex(const std::string& directory, const std::string& name, NodeIndex& index);
+    bool mapKeyedIndex(const std::string& directory, const std::string& name, NodeIndex& index,
+                       std::unordered_map<std::string, uint32_t>& keys);
+
+private:
+    std::vector<std::unique_ptr<MappedFile>> m_files;
+    SerializedPDG::Modules m_modules;
+    llvm::ArrayRef<NodeRecord> m_nodes;
+    llvm::ArrayRef<char> m_strings;
+    llvm::ArrayRef<uint64_t> m_outOffsets;
+    llvm::ArrayRef<Edge> m_outEdges;
+    llvm::ArrayRef<uint64_t> m_inOffsets;
+    llvm::ArrayRef<Edge> m_inEdges;
+    llvm::ArrayRef<FunctionRecord> m_functions;
+    llvm::ArrayRef<uint64_t> m_functionOffsets;
+    llvm::ArrayRef<NodeId> m_functionNodes;
+    std::unordered_map<std::string, FunctionId> m_functionIds;
+    NodeIndex m_typeIndex;
+    NodeIndex m_opcodeIndex;
+    NodeIndex m_calleeIndex;
+    NodeIndex m_labelIndex;
+    std::unordered_map<std::string, uint32_t> m_calleeKeys;
+    std::unordered_map<std::string, uint32_t> m_labelKeys;
+    std::vector<PDGNode*> m_pdgNodes;
+    std::unordered_map<PDGNode*, NodeId> m_pdgNodeIds;
+}; // class FrozenPDG
+
+} // namespace pdg
+
@@ -0,0 +1,104 @@
+#pragma once
+
+#include "PDG/FrozenPDG.h"
+#include "PDG/SerializedPDG.h"
+
+#include <fstream>
+#include <map>
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace pdg {
+
+/// Writes the files of a FrozenPDG with bounded memory. Nodes and strings are
+/// written through as they are added. Edges are buffered, and a full buffer
+/// is sorted and spilled into a run file; finish merges the runs into the
+/// adjacency arrays. Node lists of the secondary indexes, by node type,
+/// opcode, callee and metadata label, are sorted the same way. Memory use is
+/// the budget plus one read block per run, independent of the number of
+/// edges. The files are written into a temporary directory that replaces the
+/// target once finished, so readers that still map an older graph there keep
+/// their files intact.
+class FrozenPDGWriter : public SerializedPDG::Visitor
+{
+public:
+    using NodeId = FrozenPDG::NodeId;
+
+    FrozenPDGWriter(const std::string& directory, uint64_t memoryBudget);
+    ~FrozenPDGWriter();
+
+    FrozenPDGWriter(const FrozenPDGWriter& ) = delete;
+    FrozenPDGWriter(FrozenPDGWriter&& ) = delete;
+    FrozenPDGWriter& operator =(const FrozenPDGWriter& ) = delete;
+    FrozenPDGWriter& operator =(FrozenPDGWriter&& ) = delete;
+
+public:
+    unsigned addModule(const std::string& moduleName);
+    NodeId addNode(const SerializedPDG::Node& node);
+    void addEdge(NodeId source, NodeId dest, SerializedPDG::EdgeKind kind);
+
+    /// Merges the edge runs, writes the remaining files and moves them into
+    /// the target directory. Fails on I/O errors and on edges between
+    /// unknown nodes.
+    bool finish();
+
+    void visitModule(const std::string& moduleName) override
+    {
+        addModule(moduleName);
+    }
+
+    void visitNode(const SerializedPDG::Node& node) override
+    {
+        addNode(node);
+    }
+
+    void visitEdge(const SerializedPDG::Edge& edge) override
+    {
+        addEdge(edge.source, edge.dest, edge.kind);
+    }
+
+private:
+    class RunSorter;
+
+    uint64_t addString(const std::string& str);
+    /// Dense key of the name, whose string is at offset in the string pool
+    uint32_t getKey(std::map<std::string, uint32_t>& ids, std::vector<uint64_t>& keys,
+                    const std::string& name, uint64_t offset);
+    bool indexCallSites();
+    bool writeKeys(const std::string& name, const std::vector<uint64_t>& keys);
+    FrozenPDG::FunctionId getFunctionId(unsigned module, const std::string& name);
+    bool publish();
+    std::string getPath(const std::string& name) const;
+
+private:
+    std::string m_directory;
+    std::string m_workDirectory;
+    bool m_failed;
+    SerializedPDG::Modules m_modules;
+    std::ofstream m_nodesFile;
+    std::ofstream m_stringsFile;
+    std::ofstream m_functionsFile;
+    uint64_t m_stringsSize;
+    unsigned m_numNodes;
+    std::map<std::pair<unsigned, std::string>, FrozenPDG::FunctionId> m_functionIds;
+    std::unique_ptr<RunSorter> m_outEdges;
+    std::unique_ptr<RunSorter> m_inEdges;
+    std::unique_ptr<RunSorter> m_functionNodes;
+    std::unique_ptr<RunSorter> m_typeNodes;
+    std::unique_ptr<RunSorter> m_opcodeNodes;
+    std::unique_ptr<RunSorter> m_calleeNodes;
+    std::unique_ptr<RunSorter> m_labelNodes;
+    uint32_t m_numTypes;
+    uint32_t m_numOpcodes;
+    std::map<std::string, uint32_t> m_calleeIds;
+    std::vector<uint64_t> m_calleeKeys;
+    std::map<std::string, uint32_t> m_labelIds;
+    std::vector<uint64_t> m_labelKeys;
+    /// Function nodes and the callee keys of their symbols
+    std::vector<std::pair<NodeId, uint32_t>> m_functionNodeCallees;
+}; // class FrozenPDGWriter
+
+} // namespace pdg
+
@@ -26,6 +26,7 @@ public:
     explicit FunctionPDG(llvm::Function* F)
         : m_function(F)
         , m_functionDefinitionBuilt(false)
+        , m_bodyReleased(false)
     {
         if (F->isVarArg()) {
             m_vaArgNode.reset(new PDGLLVMVaArgNode(F));
@@ -60,6 +61,24 @@ public:
         return m_functionDefinitionBuilt;
     }
 
+    /// Drops all nodes but the formal argument and va arg ones, which call
+    /// sites of other functions connect to. Edges of the dropped nodes must
+    /// have been removed, otherwise the nodes are kept alive by them.
+    void releaseBody()
+    {
+        m_functionLLVMNodes.clear();
+        m_functionNodes.clear();
+        for (auto& entry : m_formalArgNodes) {
+            m_functionNodes.push_back(entry.second.get());
+        }
+        m_bodyReleased = true;
+    }
+
+    bool isBodyReleased() const
+    {
+        return m_bodyReleased;
+    }
+
     bool isVarArg() const
     {
         return m_function->isVarArg();
@@ -232,6 +251,7 @@ public:
 private:
     llvm::Function* m_function;
     bool m_functionDefinitionBuilt;
+    bool m_bodyReleased;
     PDGLLVMArgumentNodes m_formalArgNodes;
     PDGNodeTy m_vaArgNode;
     // TODO: formal ins, formal outs? formal vaargs?
@@ -0,0 +1,91 @@
+#pragma once
+
+#include <memory>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+namespace llvm {
+
+class Function;
+} // namespace llvm
+
+namespace pdg {
+
+class PDG;
+class PDGNode;
+class FunctionPDG;
+
+/// Formal-in to formal-out dependencies of a single function.
+/// Arguments are indexed by position, variadic arguments share the last slot.
+struct FunctionSummary
+{
+    std::vector<bool> argFlowsToReturn;
+    /// Writes into the function's own allocas do not count
+    std::vector<bool> argFlowsToMemory;
+
+    bool operator ==(const FunctionSummary& other) const
+    {
+        return argFlowsToReturn == other.argFlowsToReturn
+            && argFlowsToMemory == other.argFlowsToMemory;
+    }
+
+    bool operator !=(const FunctionSummary& other) const
+    {
+        return !(*this == other);
+    }
+}; // struct FunctionSummary
+
+/// Computes per-function dependence summaries over a built PDG and
+/// attaches them as summary edges at call sites
+class FunctionSummaryAnalysis
+{
+public:
+    using PDGType = std::shared_ptr<PDG>;
+    using FunctionSet = std::unordered_set<llvm::Function*>;
+    using Summaries = std::unordered_map<llvm::Function*, FunctionSummary>;
+
+public:
+    explicit FunctionSummaryAnalysis(PDGType pdg);
+
+    FunctionSummaryAnalysis(const FunctionSummaryAnalysis& ) = delete;
+    FunctionSummaryAnalysis(FunctionSummaryAnalysis&& ) = delete;
+    FunctionSummaryAnalysis& operator =(const FunctionSummaryAnalysis& ) = delete;
+    FunctionSummaryAnalysis& operator =(FunctionSummaryAnalysis&& ) = delete;
+
+public:
+    void run();
+    void attachSummaryEdges();
+
+    bool hasSummary(llvm::Function* F) const
+    {
+        return m_summaries.find(F) != m_summaries.end();
+    }
+
+    const FunctionSummary& getSummary(llvm::Function* F) const;
+
+    const Summaries& getSummaries() const
+    {
+        return m_summaries;
+    }
+
+private:
+    FunctionSummary computeSummary(llvm::Function* F, FunctionPDG* functionPDG);
+    void computeArgumentFlows(llvm::Function* F,
+                              FunctionPDG* functionPDG,
+                              PDGNode* formalArgNode,
+                              bool& flowsToReturn,
+                              bool& flowsToMemory);
+    FunctionSet getCallees(PDGNode* actualArgNode) const;
+    bool calleesFlowToReturn(const FunctionSet& callees, unsigned argIdx) const;
+    bool calleesFlowToMemory(const FunctionSet& callees, unsigned argIdx) const;
+    FunctionSummary getConservativeSummary(llvm::Function* F) const;
+    static unsigned getSummaryIndex(llvm::Function* F, unsigned argIdx);
+
+private:
+    PDGType m_pdg;
+    Summaries m_summaries;
+}; // class FunctionSummaryAnalysis
+
+} // namespace pdg
+
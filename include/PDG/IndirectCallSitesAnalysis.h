@@ -11,6 +11,7 @@ namespace llvm {
 class FunctionType;
 class Function;
 class CallSite;
+class Module;
 }
 
 namespace pdg {
@@ -37,6 +38,23 @@ private:
     std::unordered_map<llvm::FunctionType*, FunctionSet> m_indirectCallTargets;
 }; // class IndirectCallSiteAnalysisResult
 
+/// Type based callees of indirect call sites. Only needs function signatures,
+/// so it works without pointer analysis and on lazily loaded modules.
+class TypeBasedIndirectCallSiteResults : public IndirectCallSiteResults
+{
+public:
+    using FunctionSet = IndirectCallSiteResults::FunctionSet;
+
+public:
+    explicit TypeBasedIndirectCallSiteResults(llvm::Module& M);
+
+    virtual bool hasIndCSCallees(const llvm::CallSite& callSite) const override;
+    virtual FunctionSet getIndCSCallees(const llvm::CallSite& callSite) override;
+
+private:
+    IndirectCallSiteAnalysisResult m_candidates;
+}; // class TypeBasedIndirectCallSiteResults
+
 class IndirectCallSitesAnalysis : public llvm::ModulePass
 {
 public:
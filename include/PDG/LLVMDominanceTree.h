@@ -33,8 +33,8 @@ public:
     virtual bool posdominates(llvm::BasicBlock* blockA, llvm::BasicBlock* blockB) override;
 
 private:
-    const DominatorTreeGetter& m_domTreeGetter;
-    const PostDominatorTreeGetter& m_posdomTreeGetter;
+    const DominatorTreeGetter m_domTreeGetter;
+    const PostDominatorTreeGetter m_posdomTreeGetter;
 }; // class LLVMDominanceTree
 
 } // namespace pdg
@@ -57,8 +57,8 @@ private:
                     std::unordered_set<llvm::MemoryAccess*>& processedAccesses);
 
 private:
-    const MemorySSAGetter& m_memorySSAGetter;
-    const AARGetter& m_aarGetter;
+    const MemorySSAGetter m_memorySSAGetter;
+    const AARGetter m_aarGetter;
     std::unordered_map<llvm::Value*, DefSite> m_valueDefSite;
 }; // class LLVMMemorySSADefUseAnalysisResults
 
@@ -2,6 +2,7 @@
 
 #include <memory>
 #include <unordered_map>
+#include <unordered_set>
 
 #include "PDGLLVMNode.h"
 
@@ -10,6 +11,7 @@ namespace llvm {
 class Module;
 class Function;
 class GlobalVariable;
+class Instruction;
 } // namespace llvm
 
 namespace pdg {
@@ -29,6 +31,8 @@ public:
     using FunctionNodes = std::unordered_map<llvm::Function*, PDGFunctionNodeTy>;
     using FunctionPDGTy = std::shared_ptr<FunctionPDG>;
     using FunctionPDGs = std::unordered_map<llvm::Function*, FunctionPDGTy>;
+    using FunctionSet = std::unordered_set<llvm::Function*>;
+    using UnknownCalleeCandidates = std::unordered_map<llvm::Instruction*, FunctionSet>;
 
 public:
     explicit PDG(llvm::Module* M)
@@ -125,11 +129,28 @@ public:
         return m_functionPDGs.insert(std::make_pair(F, functionPDG)).second;
     }
 
+    /// Candidate callees of call sites routed through an unknown callee node
+    const UnknownCalleeCandidates& getUnknownCalleeCandidates() const
+    {
+        return m_unknownCalleeCandidates;
+    }
+
+    bool hasUnknownCalleeCandidates(llvm::Instruction* callInstr) const
+    {
+        return m_unknownCalleeCandidates.find(callInstr) != m_unknownCalleeCandidates.end();
+    }
+
+    void addUnknownCalleeCandidates(llvm::Instruction* callInstr, const FunctionSet& callees)
+    {
+        m_unknownCalleeCandidates[callInstr] = callees;
+    }
+
 private:
     llvm::Module* m_module;
     GlobalVariableNodes m_globalVariableNodes;
     FunctionNodes m_functionNodes;
     FunctionPDGs m_functionPDGs;
+    UnknownCalleeCandidates m_unknownCalleeCandidates;
 };
 
 } // namespace pdg
@@ -1,14 +1,15 @@
 #pragma once
 
+#include "llvm/IR/CallSite.h"
 #include "llvm/IR/InstVisitor.h"
 
 #include <memory>
 #include <unordered_set>
 #include <functional>
+#include <vector>
 
 namespace llvm {
 
-class CallSite;
 class MemorySSA;
 class Module;
 class Function;
@@ -36,6 +37,8 @@ public:
     using DominanceResultsTy = std::shared_ptr<DominanceResults>;
     using PDGNodeTy = std::shared_ptr<PDGNode>;
     using FunctionSet = std::unordered_set<llvm::Function*>;
+    using FunctionMaterializer = std::function<bool (llvm::Function*)>;
+    using FunctionPDGConsumer = std::function<void (llvm::Function*, FunctionPDGTy)>;
 
 public:
     explicit PDGBuilder(llvm::Module* M);
@@ -48,10 +51,30 @@ public:
  
     void build();
 
+    /// Two-stage build. The skeleton holds the intraprocedural nodes, SSA
+    /// operand and control edges and only needs dominance results. Def-use
+    /// edges and callees are stitched in by connectSkeleton once def-use and
+    /// indirect call site results are set.
+    void buildSkeleton();
+    void connectSkeleton();
+
+    /// Builds PDGs only for the given functions and their transitive callees.
+    /// Bodies of lazily loaded functions are materialized when first reached.
+    void buildFromEntries(const std::vector<llvm::Function*>& entries);
+
 public:
     void setDesUseResults(DefUseResultsTy defUse);
     void setIndirectCallSitesResults(IndCSResultsTy indCSResults);
     void setDominanceResults(DominanceResultsTy domResults);
+    /// Call sites with more candidate callees than maxFanOut are connected to a
+    /// single unknown callee node. 0 means no limit.
+    void setMaxCallSiteFanOut(unsigned maxFanOut);
+    /// Called for functions with unread bodies. Defaults to Function::materialize.
+    void setFunctionMaterializer(const FunctionMaterializer& materializer);
+    /// Streaming build. Each function PDG is handed to the consumer once its
+    /// edges are complete and its body is released afterwards, so only one
+    /// function body is resident at a time. Not used by the two-stage build.
+    void setFunctionPDGConsumer(const FunctionPDGConsumer& consumer);
 
     PDGType getPDG()
     {
@@ -87,8 +110,27 @@ protected:
     virtual PDGNodeTy createFormalArgNodeFor(llvm::Argument* arg);
     virtual PDGNodeTy createNullNode();
     virtual PDGNodeTy createConstantNodeFor(llvm::Constant* constant);
+    virtual PDGNodeTy createUnknownCalleeNodeFor(llvm::CallSite& callSite, unsigned numCandidates);
+
+private:
+    struct DeferredDefSite
+    {
+        FunctionPDGTy functionPDG;
+        llvm::Value* value;
+        PDGNodeTy node;
+    };
+
+    struct DeferredCallSite
+    {
+        FunctionPDGTy functionPDG;
+        llvm::CallSite callSite;
+        PDGNodeTy callNode;
+        std::vector<PDGNodeTy> actualArgNodes;
+    };
 
 private:
+    void buildFunction(llvm::Function& F);
+    bool materializeFunction(llvm::Function& F);
     void buildFunctionPDG(llvm::Function* F);
     void buildFunctionDefinition(llvm::Function* F);
     void visitGlobals();
@@ -100,6 +142,10 @@ private:
     PDGNodeTy getNodeFor(llvm::BasicBlock* block);
     void addControlEdgesForBlock(llvm::BasicBlock& B);
     void visitCallSite(llvm::CallSite& callSite);
+    void connectCallSite(DeferredCallSite& deferredCallSite);
+    void connectDeferredDependencies();
+    void emitFunctionPDG(llvm::Function& F);
+    void releaseFunctionBody(FunctionPDG* functionPDG);
     void addDataEdge(PDGNodeTy source, PDGNodeTy dest);
     void addControlEdge(PDGNodeTy source, PDGNodeTy dest);
     void connectToDefSite(llvm::Value* value, PDGNodeTy valueNode);
@@ -118,6 +164,12 @@ private:
     DefUseResultsTy m_defUse;
     IndCSResultsTy m_indCSResults;
     DominanceResultsTy m_domResults;
+    unsigned m_maxCallSiteFanOut;
+    std::vector<DeferredDefSite> m_deferredDefSites;
+    std::vector<DeferredCallSite> m_deferredCallSites;
+    FunctionMaterializer m_materializer;
+    FunctionPDGConsumer m_consumer;
+    std::vector<llvm::Function*> m_reachedCallees;
 }; // class PDGBuilder
 
 } // namespace pdg
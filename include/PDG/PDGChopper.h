@@ -0,0 +1,86 @@
+#pragma once
+
+#include "PDG/FrozenPDG.h"
+#include "PDG/PDGSlicer.h"
+
+#include "llvm/ADT/ArrayRef.h"
+
+#include <cstdint>
+#include <vector>
+
+namespace pdg {
+
+/// Dependence path from a source to a sink, empty if there is none
+struct DependencePath
+{
+    std::vector<FrozenPDG::NodeId> nodes;
+    /// Kind of the edge from nodes[i] to nodes[i + 1]
+    std::vector<SerializedPDG::EdgeKind> edges;
+
+    bool empty() const
+    {
+        return nodes.empty();
+    }
+};
+
+/// How sources influence sinks over a frozen PDG: the chop, i.e. the nodes
+/// on any path from a source to a sink, and one shortest such path. The chop
+/// is the backward slice of the sinks restricted to the forward slice of the
+/// sources, the path is found by breadth first search from both ends. The
+/// search state is per node and reused by all queries of one chopper, so a
+/// chopper must not be shared between threads.
+class PDGChopper
+{
+public:
+    explicit PDGChopper(const FrozenPDG& pdg);
+
+    PDGChopper(const PDGChopper& ) = delete;
+    PDGChopper(PDGChopper&& ) = delete;
+    PDGChopper& operator =(const PDGChopper& ) = delete;
+    PDGChopper& operator =(PDGChopper&& ) = delete;
+
+public:
+    Slice chop(llvm::ArrayRef<FrozenPDG::NodeId> sources,
+               llvm::ArrayRef<FrozenPDG::NodeId> sinks,
+               unsigned edges = AllEdges);
+
+    /// A path with the fewest edges from any of the sources to any of the sinks
+    DependencePath shortestPath(llvm::ArrayRef<FrozenPDG::NodeId> sources,
+                                llvm::ArrayRef<FrozenPDG::NodeId> sinks,
+                                unsigned edges = AllEdges);
+
+private:
+    /// Breadth first search tree of one direction. Roots are their own
+    /// parent, kinds are of the edge between a node and its parent.
+    struct Search
+    {
+        std::vector<FrozenPDG::NodeId> parents;
+        std::vector<uint32_t> distances;
+        std::vector<uint8_t> kinds;
+        /// Reached nodes in breadth first order
+        std::vector<FrozenPDG::NodeId> reached;
+
+        explicit Search(unsigned numNodes);
+
+        bool isReached(FrozenPDG::NodeId node) const
+        {
+            return parents[node] != FrozenPDG::InvalidNode;
+        }
+
+        void reach(FrozenPDG::NodeId node, FrozenPDG::NodeId parent, uint32_t kind, uint32_t distance);
+        void clear();
+    };
+
+    void seed(Search& search, llvm::ArrayRef<FrozenPDG::NodeId> roots);
+    /// Reaches the unreached neighbours of the nodes from begin on, returns
+    /// the new end
+    size_t expand(Search& search, bool forward, size_t begin, unsigned edges, const Search* restriction = nullptr);
+
+private:
+    const FrozenPDG& m_pdg;
+    Search m_forward;
+    Search m_backward;
+}; // class PDGChopper
+
+} // namespace pdg
+
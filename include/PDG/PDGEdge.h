@@ -27,6 +27,11 @@ public:
     virtual const bool isDataEdge() const = 0;
     virtual const bool isControlEdge() const = 0;
 
+    virtual const bool isSummaryEdge() const
+    {
+        return false;
+    }
+
     const PDGNodeTy getSource() const
     {
         return m_source;
@@ -104,6 +109,30 @@ public:
 
 }; // class PDGControlEdge
 
+/// Data edge from an actual argument to its call site or to a reader of
+/// memory the call defines, summarizing a flow from the corresponding formal
+/// argument to the callee's return value or to memory the callee writes
+class PDGSummaryEdge : public PDGDataEdge
+{
+public:
+    PDGSummaryEdge(PDGNodeTy sourceNode, PDGNodeTy destNode)
+        : PDGDataEdge(sourceNode, destNode)
+    {
+    }
+
+    const bool isSummaryEdge() const override
+    {
+        return true;
+    }
+
+public:
+    static bool classof(const PDGEdge* node)
+    {
+        return node->isSummaryEdge();
+    }
+
+}; // class PDGSummaryEdge
+
 
 } // namespace pdg
 
@@ -124,6 +124,8 @@ struct DOTGraphTraits<FunctionPDG*> : public DefaultDOTGraphTraits
             return "color=black,shape=oval";
         } else if (llvm::isa<PDGLLVMActualArgumentNode>(node)) {
             return "color=black,style=dotted";
+        } else if (llvm::isa<PDGLLVMUnknownCalleeNode>(node)) {
+            return "color=red,shape=box";
         } else if (llvm::isa<PDGLLVMNode>(node)) {
             return "color=black";
         }
@@ -134,7 +136,9 @@ struct DOTGraphTraits<FunctionPDG*> : public DefaultDOTGraphTraits
     static std::string getEdgeAttributes(NodeRef node, ChildIteratorType edge_iter, FunctionPDG* graph)
     {
         EdgeType edge = *(edge_iter.getCurrent());
-        if (llvm::isa<PDGDataEdge>(edge.get())) {
+        if (llvm::isa<PDGSummaryEdge>(edge.get())) {
+            return "color=red,style=dashed";
+        } else if (llvm::isa<PDGDataEdge>(edge.get())) {
             if (llvm::isa<pdg::PDGLLVMFormalArgumentNode>(edge->getDestination().get())) {
                 return "color=green";
             } else {
@@ -27,7 +27,9 @@ public:
         FunctionNode,
         NullNode,
         PhiNode,
-        UnknownNode
+        UnknownNode,
+        // appended, node types are serialized by value
+        UnknownCalleeNode
     };
 
 public:
@@ -56,8 +58,7 @@ public:
 public:
     static bool isLLVMNodeType(NodeType nodeType)
     {
-        return nodeType == NodeType::UnknownNode
-            || (nodeType >= NodeType::InstructionNode && nodeType <= NodeType::PhiNode);
+        return nodeType >= NodeType::InstructionNode && nodeType <= NodeType::UnknownCalleeNode;
     }
 
     static bool classof(const PDGNode* node)
@@ -70,6 +71,9 @@ protected:
     NodeType m_type;
 }; // class PDGLLVMNode
 
+/// Name of the node type, e.g. InstructionNode
+std::string getNodeTypeAsString(PDGLLVMNode::NodeType type);
+
 class PDGLLVMInstructionNode : public PDGLLVMNode
 {
 public:
@@ -524,5 +528,56 @@ private:
     Blocks m_blocks;
 }; // class PDGPhiNode
 
+/// Single node standing for all candidate callees of a call site
+/// whose fan-out exceeds the builder threshold
+class PDGLLVMUnknownCalleeNode : public PDGLLVMNode
+{
+public:
+    PDGLLVMUnknownCalleeNode(llvm::CallSite& callSite, unsigned numCandidates)
+        : PDGLLVMNode(callSite.getInstruction(), NodeType::UnknownCalleeNode)
+        , m_callSite(callSite)
+        , m_numCandidates(numCandidates)
+    {
+    }
+
+public:
+    virtual std::string getNodeAsString() const override;
+
+    const llvm::CallSite& getCallSite() const
+    {
+        return m_callSite;
+    }
+
+    unsigned getNumCandidates() const
+    {
+        return m_numCandidates;
+    }
+
+    bool hasParent() const override
+    {
+        return true;
+    }
+
+    llvm::Function* getParent() const override
+    {
+        return m_callSite.getCaller();
+    }
+
+public:
+    static bool classof(const PDGLLVMNode* node)
+    {
+        return node->getNodeType() == NodeType::UnknownCalleeNode;
+    }
+
+    static bool classof(const PDGNode* node)
+    {
+        return llvm::isa<PDGLLVMNode>(node) && classof(llvm::cast<PDGLLVMNode>(node));
+    }
+
+private:
+    llvm::CallSite m_callSite;
+    unsigned m_numCandidates;
+}; // class PDGLLVMUnknownCalleeNode
+
 } // namespace pdg
 
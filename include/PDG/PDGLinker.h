@@ -0,0 +1,150 @@
+#pragma once
+
+#include "PDG/SerializedPDG.h"
+
+#include <set>
+#include <string>
+#include <tuple>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+namespace pdg {
+
+class FrozenPDGWriter;
+
+/// Links serialized PDGs of separately analyzed modules into one whole
+/// program graph. Function, formal argument, va arg and global variable nodes
+/// of declarations are replaced by the nodes of the definitions with the same
+/// linkage name, which wires call sites to callees defined in other modules.
+/// Of a function defined in several modules only the body of the winning
+/// definition is kept.
+/// Local symbols are only resolved within one input, or across the shards of
+/// a sharded build of one module.
+/// Graphs larger than memory are added as files instead: only their symbol
+/// nodes are kept, and the linked graph is streamed into a FrozenPDGWriter.
+class PDGLinker
+{
+public:
+    PDGLinker() = default;
+    PDGLinker(const PDGLinker& ) = delete;
+    PDGLinker(PDGLinker&& ) = delete;
+    PDGLinker& operator =(const PDGLinker& ) = delete;
+    PDGLinker& operator =(PDGLinker&& ) = delete;
+
+public:
+    /// Adds the graph of separately analyzed modules, whose local symbols are
+    /// distinct from those of all other inputs
+    void addModule(const SerializedPDG& pdg);
+
+    /// Adds a partial graph of a module built in shards. Shards of the module
+    /// with the same name share its local symbols.
+    void addShard(const SerializedPDG& pdg);
+
+    /// Resolves declarations and returns the linked graph
+    SerializedPDG link();
+
+    /// Reads the symbol nodes of the serialized PDG of separately analyzed
+    /// modules at path, to be linked by link(FrozenPDGWriter&)
+    bool addModuleFile(const std::string& path);
+
+    /// Reads the symbol nodes of the serialized partial graph of a module
+    /// built in shards at path
+    bool addShardFile(const std::string& path);
+
+    /// Resolves declarations of the graphs added as files and writes the
+    /// linked graph into writer, reading each file a second time. Winning
+    /// symbol nodes come first, followed by the other nodes in file order.
+    /// Memory use is the symbol nodes plus one id per node of the largest
+    /// file. Graphs added in memory are not part of this link.
+    bool link(FrozenPDGWriter& writer);
+
+    /// Number of declaration and duplicate definition nodes merged in the last link
+    unsigned getNumResolved() const
+    {
+        return m_numResolved;
+    }
+
+    /// Number of body nodes of weak or duplicate definitions dropped in the
+    /// last link
+    unsigned getNumDiscarded() const
+    {
+        return m_numDiscarded;
+    }
+
+    /// Linkage names of declarations without a definition in any module
+    const std::vector<std::string>& getUnresolvedSymbols() const
+    {
+        return m_unresolvedSymbols;
+    }
+
+    /// Linkage names of functions and globals with a strong definition in
+    /// more than one module. All but the first definition are dropped.
+    const std::vector<std::string>& getMultipleDefinitions() const
+    {
+        return m_multipleDefinitions;
+    }
+
+private:
+    /// Module of local symbols or -1, linkage name and argument index
+    using SymbolKey = std::tuple<int, std::string, int>;
+
+    struct SymbolKeyHash
+    {
+        size_t operator()(const SymbolKey& key) const
+        {
+            return std::hash<std::string>()(std::get<1>(key))
+                ^ (std::hash<int>()(std::get<2>(key)) << 1)
+                ^ (std::hash<int>()(std::get<0>(key)) << 2);
+        }
+    };
+
+    using Definitions = std::unordered_map<SymbolKey, unsigned, SymbolKeyHash>;
+    /// Module ids of the shards added so far by module name
+    using ShardModuleIds = std::unordered_map<std::string, unsigned>;
+    /// Module and name of functions whose bodies are dropped
+    using DiscardedBodies = std::set<std::pair<unsigned, std::string>>;
+
+    /// Serialized PDG added by path
+    struct InputFile
+    {
+        std::string path;
+        /// Linked module id of each module of the file
+        std::vector<unsigned> moduleIds;
+        /// Index of the first symbol node of the file in m_symbols
+        unsigned firstSymbol;
+        unsigned numSymbols;
+    };
+
+    class SymbolReader;
+    class NodeStreamer;
+
+private:
+    void add(const SerializedPDG& pdg, bool shard);
+    bool addFile(const std::string& path, bool shard);
+    static unsigned getModuleId(SerializedPDG& pdg, ShardModuleIds& shardModuleIds,
+                                const std::string& moduleName, bool shard);
+    /// Picks the representative of every symbol node of nodes and the
+    /// bodies that lose to another module's definition
+    void resolve(const SerializedPDG::Nodes& nodes,
+                 std::vector<unsigned>& representatives,
+                 DiscardedBodies& discardedBodies);
+    static bool isSymbolNode(const SerializedPDG::Node& node);
+    static bool isDefinition(const SerializedPDG::Node& node);
+    static SymbolKey getSymbolKey(const SerializedPDG::Node& node);
+
+private:
+    SerializedPDG m_merged;
+    /// Modules and symbol nodes of the graphs added as files
+    SerializedPDG m_symbols;
+    std::vector<InputFile> m_files;
+    ShardModuleIds m_shardModuleIds;
+    ShardModuleIds m_fileShardModuleIds;
+    unsigned m_numResolved = 0;
+    unsigned m_numDiscarded = 0;
+    std::vector<std::string> m_unresolvedSymbols;
+    std::vector<std::string> m_multipleDefinitions;
+}; // class PDGLinker
+
+} // namespace pdg
+
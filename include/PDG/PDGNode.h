@@ -13,7 +13,7 @@ namespace pdg {
 
 class PDGEdge;
 
-class PDGNode
+class PDGNode : public std::enable_shared_from_this<PDGNode>
 {
 public:
     using PDGEdgeType = std::shared_ptr<PDGEdge>;
@@ -59,12 +59,12 @@ public:
 
     virtual bool removeInEdge(PDGEdgeType inEdge)
     {
-        m_inEdges.erase(inEdge);
+        return m_inEdges.erase(inEdge) != 0;
     }
 
     virtual bool removeOutEdge(PDGEdgeType outEdge)
     {
-        m_outEdges.erase(outEdge);
+        return m_outEdges.erase(outEdge) != 0;
     }
 
 public:
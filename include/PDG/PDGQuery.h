@@ -0,0 +1,161 @@
+#pragma once
+
+#include "PDG/FrozenPDG.h"
+
+#include "llvm/ADT/ArrayRef.h"
+#include "llvm/ADT/StringRef.h"
+
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace pdg {
+
+/// Pattern query over a frozen PDG. A query is a list of patterns separated
+/// by ';', each a chain of node patterns joined by edge patterns:
+///     (call: opcode=call, callee=getenv) -[data*]-> (s: opcode=store);
+///     (b: opcode=br) -[control]-> (s)
+/// A node pattern has an optional variable and predicates on the node type
+/// (type=ActualArgumentNode), opcode (opcode=load), callee of call sites
+/// (callee=malloc), metadata label (label=oh_hash) and parent function
+/// (function=main). Values with characters other than letters, digits,
+/// '_', '.' and '$' are double quoted (function="cold-path helper"), with a
+/// backslash escaping the next character. Node patterns with the same
+/// variable match the same node. An edge pattern -[kinds]-> or <-[kinds]-
+/// matches an edge of one of the kinds (data, control, summary or any,
+/// joined by '|'), and a path of such edges if followed by + (one or more
+/// edges) or * (zero or more).
+class PDGQuery
+{
+public:
+    struct Predicate
+    {
+        enum Kind
+        {
+            Type,
+            Opcode,
+            Callee,
+            Label,
+            Function
+        };
+
+        Kind kind;
+        std::string value;
+        /// Node type or opcode
+        unsigned number;
+    };
+
+    struct Variable
+    {
+        /// Empty for anonymous node patterns
+        std::string name;
+        std::vector<Predicate> predicates;
+    };
+
+    /// A path of edges from variable from to variable to
+    struct Constraint
+    {
+        unsigned from;
+        unsigned to;
+        /// EdgeFilter mask
+        unsigned edges;
+        unsigned minLength;
+        /// Unbounded for + and *
+        bool transitive;
+    };
+
+public:
+    /// Reports syntax errors to errs() and returns null
+    static std::unique_ptr<PDGQuery> parse(llvm::StringRef text);
+
+    const std::vector<Variable>& getVariables() const
+    {
+        return m_variables;
+    }
+
+    const std::vector<Constraint>& getConstraints() const
+    {
+        return m_constraints;
+    }
+
+    /// Indices of the named variables, in the order they first appear
+    const std::vector<unsigned>& getOutputs() const
+    {
+        return m_outputs;
+    }
+
+private:
+    friend class QueryParser;
+
+    std::vector<Variable> m_variables;
+    std::vector<Constraint> m_constraints;
+    std::vector<unsigned> m_outputs;
+}; // class PDGQuery
+
+/// Nodes bound to the named variables of a query, in output order
+using QueryMatch = std::vector<FrozenPDG::NodeId>;
+
+/// Compiles queries into traversal plans and evaluates them on a frozen PDG.
+/// Every variable is first bound from the smallest candidate list its
+/// predicates select from the secondary indexes of the frozen PDG, by type,
+/// opcode, callee and metadata label, and the plan then joins the other
+/// variables by traversing from bound ones along the constraints, the
+/// smallest first. Constraints between bound variables become checks.
+/// Candidates of the first variable are grouped by function and the groups
+/// evaluated in parallel.
+class QueryEngine
+{
+public:
+    explicit QueryEngine(const FrozenPDG& pdg)
+        : m_pdg(pdg)
+    {
+    }
+
+    QueryEngine(const QueryEngine& ) = delete;
+    QueryEngine(QueryEngine&& ) = delete;
+    QueryEngine& operator =(const QueryEngine& ) = delete;
+    QueryEngine& operator =(QueryEngine&& ) = delete;
+
+public:
+    /// Distinct matches, sorted
+    std::vector<QueryMatch> run(const PDGQuery& query, unsigned numThreads = 1) const;
+
+    /// Steps of the plan of the query, one per line
+    std::string explain(const PDGQuery& query) const;
+
+private:
+    struct PlanStep
+    {
+        enum Kind
+        {
+            /// Binds variable from its candidate list
+            Scan,
+            /// Binds variable by traversing constraint from its bound end
+            Expand,
+            /// Checks constraint between bound variables
+            Check
+        };
+
+        Kind kind;
+        unsigned variable;
+        unsigned constraint;
+    };
+
+    class Evaluation;
+
+    using NodeList = std::vector<FrozenPDG::NodeId>;
+
+    /// Smallest index list selected by the predicates, false if none of them
+    /// is indexed
+    bool getCandidates(const PDGQuery::Variable& variable, llvm::ArrayRef<FrozenPDG::NodeId>& candidates) const;
+    uint64_t getNumCandidates(const PDGQuery::Variable& variable) const;
+    std::vector<PlanStep> compile(const PDGQuery& query) const;
+    bool matches(FrozenPDG::NodeId node, const PDGQuery::Variable& variable) const;
+    bool isCallOf(FrozenPDG::NodeId node, llvm::StringRef callee) const;
+
+private:
+    const FrozenPDG& m_pdg;
+}; // class QueryEngine
+
+} // namespace pdg
+
@@ -0,0 +1,106 @@
+#pragma once
+
+#include "PDG/FrozenPDG.h"
+
+#include "llvm/ADT/ArrayRef.h"
+#include "llvm/ADT/BitVector.h"
+
+#include <functional>
+#include <vector>
+
+namespace pdg {
+
+/// Edge kinds followed by a traversal, as a mask of SerializedPDG::EdgeKind bits
+enum EdgeFilter : unsigned
+{
+    DataEdges = 1u << static_cast<unsigned>(SerializedPDG::EdgeKind::Data),
+    ControlEdges = 1u << static_cast<unsigned>(SerializedPDG::EdgeKind::Control),
+    SummaryEdges = 1u << static_cast<unsigned>(SerializedPDG::EdgeKind::Summary),
+    AllEdges = DataEdges | ControlEdges | SummaryEdges
+};
+
+inline bool isFollowed(unsigned edgeFilter, const FrozenPDG::Edge& edge)
+{
+    return (edgeFilter & (1u << edge.kind)) != 0;
+}
+
+enum class SliceDirection
+{
+    /// Nodes the criteria depend on, along in edges
+    Backward,
+    /// Nodes depending on the criteria, along out edges
+    Forward
+};
+
+struct SliceOptions
+{
+    SliceDirection direction = SliceDirection::Backward;
+    unsigned edges = AllEdges;
+    /// Follow edges to nodes of other functions, such as from actual to
+    /// formal arguments, return values through function nodes and globals
+    bool interprocedural = true;
+};
+
+/// Nodes of a slice, sorted by id
+class Slice
+{
+public:
+    Slice() = default;
+    Slice(std::vector<FrozenPDG::NodeId> nodes, bool complete);
+
+    const std::vector<FrozenPDG::NodeId>& getNodes() const
+    {
+        return m_nodes;
+    }
+
+    unsigned size() const
+    {
+        return m_nodes.size();
+    }
+
+    bool contains(FrozenPDG::NodeId node) const;
+
+    /// False if the visitor stopped the traversal early
+    bool isComplete() const
+    {
+        return m_complete;
+    }
+
+private:
+    std::vector<FrozenPDG::NodeId> m_nodes;
+    bool m_complete = true;
+}; // class Slice
+
+/// Breadth first backward and forward slicing over a frozen PDG. The visited
+/// set is a bitset over node ids reused by all slices of one slicer, so a
+/// slicer must not be shared between threads.
+class PDGSlicer
+{
+public:
+    /// Called once per reached node, criteria included. Returning false
+    /// stops the traversal.
+    using Visitor = std::function<bool (FrozenPDG::NodeId node)>;
+
+public:
+    explicit PDGSlicer(const FrozenPDG& pdg);
+
+    PDGSlicer(const PDGSlicer& ) = delete;
+    PDGSlicer(PDGSlicer&& ) = delete;
+    PDGSlicer& operator =(const PDGSlicer& ) = delete;
+    PDGSlicer& operator =(PDGSlicer&& ) = delete;
+
+public:
+    Slice slice(llvm::ArrayRef<FrozenPDG::NodeId> criteria,
+                const SliceOptions& options,
+                const Visitor& visitor = Visitor());
+
+    Slice backwardSlice(llvm::ArrayRef<FrozenPDG::NodeId> criteria, unsigned edges = AllEdges);
+    Slice forwardSlice(llvm::ArrayRef<FrozenPDG::NodeId> criteria, unsigned edges = AllEdges);
+
+private:
+    const FrozenPDG& m_pdg;
+    llvm::BitVector m_visited;
+}; // class PDGSlicer
+
+} // namespace pdg
+
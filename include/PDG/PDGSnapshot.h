@@ -0,0 +1,98 @@
+#pragma once
+
+#include "PDG/FrozenPDG.h"
+#include "PDG/ReachabilityIndex.h"
+#include "PDG/SliceCache.h"
+
+#include <cstdint>
+#include <memory>
+#include <string>
+
+namespace pdg {
+
+/// Immutable graph state served to concurrent readers: a frozen PDG and
+/// optionally its reachability index and a slice cache. The cache only
+/// memoizes slices of the graph and is thread safe, so it is handed out
+/// mutable. Snapshots are shared by shared_ptr, so a snapshot lives until
+/// the last reader holding it is done.
+class PDGSnapshot
+{
+public:
+    /// No slice cache is made if sliceCacheSize is 0
+    PDGSnapshot(std::unique_ptr<FrozenPDG> pdg, bool buildIndex, uint64_t version, uint64_t sliceCacheSize = 0);
+
+    PDGSnapshot(const PDGSnapshot& ) = delete;
+    PDGSnapshot(PDGSnapshot&& ) = delete;
+    PDGSnapshot& operator =(const PDGSnapshot& ) = delete;
+    PDGSnapshot& operator =(PDGSnapshot&& ) = delete;
+
+public:
+    /// Maps the frozen PDG in the directory, null if it can not be opened
+    static std::shared_ptr<const PDGSnapshot> open(const std::string& directory, bool buildIndex, uint64_t version,
+                                                   uint64_t sliceCacheSize = 0);
+
+    const FrozenPDG& getPDG() const
+    {
+        return *m_pdg;
+    }
+
+    /// Null if the snapshot was made without an index
+    const ReachabilityIndex* getIndex() const
+    {
+        return m_index.get();
+    }
+
+    /// Null if the snapshot was made without a slice cache
+    SliceCache* getSliceCache() const
+    {
+        return m_sliceCache.get();
+    }
+
+    uint64_t getVersion() const
+    {
+        return m_version;
+    }
+
+private:
+    std::unique_ptr<FrozenPDG> m_pdg;
+    std::unique_ptr<ReachabilityIndex> m_index;
+    std::unique_ptr<SliceCache> m_sliceCache;
+    uint64_t m_version;
+}; // class PDGSnapshot
+
+/// The current snapshot, replaced atomically in the manner of RCU. Readers
+/// acquire the current snapshot and keep using it for as long as they
+/// like; publishing a new one only affects later acquires, and the replaced
+/// snapshot is freed when its last reader releases it. Readers never wait
+/// for a rebuild and a rebuild never waits for readers.
+class SnapshotPublisher
+{
+public:
+    explicit SnapshotPublisher(std::shared_ptr<const PDGSnapshot> snapshot = nullptr)
+        : m_current(std::move(snapshot))
+    {
+    }
+
+    SnapshotPublisher(const SnapshotPublisher& ) = delete;
+    SnapshotPublisher(SnapshotPublisher&& ) = delete;
+    SnapshotPublisher& operator =(const SnapshotPublisher& ) = delete;
+    SnapshotPublisher& operator =(SnapshotPublisher&& ) = delete;
+
+public:
+    std::shared_ptr<const PDGSnapshot> acquire() const
+    {
+        return std::atomic_load(&m_current);
+    }
+
+    /// Returns the replaced snapshot
+    std::shared_ptr<const PDGSnapshot> publish(std::shared_ptr<const PDGSnapshot> snapshot)
+    {
+        return std::atomic_exchange(&m_current, std::move(snapshot));
+    }
+
+private:
+    std::shared_ptr<const PDGSnapshot> m_current;
+}; // class SnapshotPublisher
+
+} // namespace pdg
+
@@ -0,0 +1,198 @@
+#pragma once
+
+#include "PDG/DefUseResults.h"
+#include "PDG/IndirectCallSiteResults.h"
+
+#include <functional>
+#include <iosfwd>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace llvm {
+
+class BasicBlock;
+class CallSite;
+class Function;
+class Module;
+class Value;
+} // namespace llvm
+
+namespace pdg {
+
+/// Pointer analysis results of one module as consumed by the PDG builder and
+/// the CSV export: def sites of queried values, callees of indirect call sites
+/// and the SVF block features.
+/// Entries are addressed by the hash of the module bitcode, so values are
+/// identified by their position in the module and reload into a fresh parse.
+class PointerAnalysisCacheEntry
+{
+public:
+    using FunctionSet = IndirectCallSiteResults::FunctionSet;
+    using DefSite = DefUseResults::DefSite;
+    using PDGNodeTy = DefUseResults::PDGNodeTy;
+    using Features = std::vector<int>;
+
+public:
+    PointerAnalysisCacheEntry(llvm::Module& M, const std::string& path);
+
+    PointerAnalysisCacheEntry(const PointerAnalysisCacheEntry& ) = delete;
+    PointerAnalysisCacheEntry(PointerAnalysisCacheEntry&& ) = delete;
+    PointerAnalysisCacheEntry& operator =(const PointerAnalysisCacheEntry& ) = delete;
+    PointerAnalysisCacheEntry& operator =(PointerAnalysisCacheEntry&& ) = delete;
+
+public:
+    /// True if the entry was read from disk, i.e. pointer analysis can be skipped
+    bool isLoaded() const
+    {
+        return m_loaded;
+    }
+
+    bool load();
+    bool save() const;
+
+    /// A loaded entry that misses a queried record gets the answers of the
+    /// analysis added and is saved again
+    void invalidate()
+    {
+        m_loaded = false;
+    }
+
+    /// Returns false if the value has no record
+    bool findDefSite(llvm::Value* value, DefSite& defSite);
+    void addDefSite(llvm::Value* value, const DefSite& defSite);
+
+    bool hasCallSite(const llvm::CallSite& callSite) const;
+    bool hasIndCSCallees(const llvm::CallSite& callSite) const;
+    FunctionSet getIndCSCallees(const llvm::CallSite& callSite) const;
+    void addIndCSCallees(const llvm::CallSite& callSite, bool hasCallees, const FunctionSet& callees);
+
+    bool hasBlockFeatures() const
+    {
+        return m_hasBlockFeatures;
+    }
+
+    Features getBlockFeatures(llvm::BasicBlock* block) const;
+    void addBlockFeatures(llvm::BasicBlock* block, const Features& features);
+    void setHasBlockFeatures(bool hasBlockFeatures)
+    {
+        m_hasBlockFeatures = hasBlockFeatures;
+    }
+
+private:
+    enum class DefNodeKind
+    {
+        None,
+        Instruction,
+        Phi
+    };
+
+    struct DefSiteRecord
+    {
+        int value;
+        DefNodeKind nodeKind;
+        std::vector<unsigned> phiValues;
+        std::vector<unsigned> phiBlocks;
+    };
+
+    struct CallSiteRecord
+    {
+        bool hasCallees;
+        std::vector<unsigned> callees;
+    };
+
+private:
+    void numberValues();
+    int getValueId(const llvm::Value* value) const;
+    llvm::Value* getValue(unsigned id) const;
+    bool read(std::istream& in);
+    void write(std::ostream& out) const;
+
+private:
+    llvm::Module& m_module;
+    std::string m_path;
+    bool m_loaded;
+    // values that could not be numbered make the entry unsafe to reuse
+    bool m_complete;
+    bool m_hasBlockFeatures;
+    std::vector<llvm::Value*> m_values;
+    std::unordered_map<const llvm::Value*, unsigned> m_valueIds;
+    std::unordered_map<unsigned, DefSiteRecord> m_defSites;
+    std::unordered_map<unsigned, DefSite> m_replayedDefSites;
+    std::unordered_map<unsigned, CallSiteRecord> m_callSites;
+    std::unordered_map<unsigned, Features> m_blockFeatures;
+}; // class PointerAnalysisCacheEntry
+
+/// Content addressed directory of pointer analysis cache entries
+class PointerAnalysisCache
+{
+public:
+    using EntryTy = std::shared_ptr<PointerAnalysisCacheEntry>;
+
+public:
+    explicit PointerAnalysisCache(const std::string& directory);
+
+    /// Returns the entry for the module, loaded if the module was analyzed before
+    EntryTy getEntry(llvm::Module& M);
+
+private:
+    static std::string getModuleHash(llvm::Module& M);
+
+private:
+    std::string m_directory;
+}; // class PointerAnalysisCache
+
+/// Def-use results recording the answers of underlying results into a cache
+/// entry, or replaying them from a loaded entry when there are none. A value
+/// the loaded entry has no record of is a miss: the underlying results are
+/// then taken from the getter, which runs the analysis, and answer the rest.
+class CachedDefUseResults : public DefUseResults
+{
+public:
+    using DefUseResultsTy = std::shared_ptr<DefUseResults>;
+    using DefUseResultsGetter = std::function<DefUseResultsTy ()>;
+    using EntryTy = PointerAnalysisCache::EntryTy;
+
+public:
+    CachedDefUseResults(EntryTy entry,
+                        DefUseResultsTy results,
+                        const DefUseResultsGetter& resultsGetter = DefUseResultsGetter());
+
+    virtual DefSite getDefNode(llvm::Value* value) override;
+
+private:
+    EntryTy m_entry;
+    DefUseResultsTy m_results;
+    const DefUseResultsGetter m_resultsGetter;
+}; // class CachedDefUseResults
+
+/// Indirect call site results recording into or replaying from a cache entry,
+/// with misses handled as by CachedDefUseResults
+class CachedIndirectCallSiteResults : public IndirectCallSiteResults
+{
+public:
+    using IndCSResultsTy = std::shared_ptr<IndirectCallSiteResults>;
+    using IndCSResultsGetter = std::function<IndCSResultsTy ()>;
+    using EntryTy = PointerAnalysisCache::EntryTy;
+
+public:
+    CachedIndirectCallSiteResults(EntryTy entry,
+                                  IndCSResultsTy results,
+                                  const IndCSResultsGetter& resultsGetter = IndCSResultsGetter());
+
+    virtual bool hasIndCSCallees(const llvm::CallSite& callSite) const override;
+    virtual FunctionSet getIndCSCallees(const llvm::CallSite& callSite) override;
+
+private:
+    /// Takes the underlying results on a miss, false if there are none
+    bool getResults(const llvm::CallSite& callSite) const;
+
+private:
+    EntryTy m_entry;
+    mutable IndCSResultsTy m_results;
+    const IndCSResultsGetter m_resultsGetter;
+}; // class CachedIndirectCallSiteResults
+
+} // namespace pdg
+
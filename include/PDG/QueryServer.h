@@ -0,0 +1,118 @@
+#pragma once
+
+#include "PDG/PDGChopper.h"
+#include "PDG/PDGSlicer.h"
+#include "PDG/PDGSnapshot.h"
+
+#include "llvm/ADT/StringRef.h"
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+namespace pdg {
+
+/// Answers queries on a frozen PDG over a Unix domain socket. Requests and
+/// responses are frames of a 4 byte little endian length followed by that
+/// many bytes of text. A request is one command:
+///     slice backward|forward <edges> <node>...
+///     path <edges> <source> <sink>
+///     reaches <source> <dest>
+///     out|in <node>
+///     node <node>
+///     stats
+///     cache
+///     version
+///     reload <frozen PDG directory>
+/// where edges is all or a comma separated list of data, control and
+/// summary. Responses start with ok or error. Every connection is served by
+/// its own thread with its own slicer state, and up to a maximum number of
+/// connections are served at once. Slices come from the slice
+/// cache of the snapshot if it has one, whose statistics cache reports. A
+/// request is answered on the snapshot current when it arrives; reload
+/// publishes a new snapshot while requests in flight finish on the old one,
+/// and only opens directories under the reload root.
+class QueryServer
+{
+public:
+    /// Per connection traversal state, bound to the snapshot of the last
+    /// request. The slicer and chopper are created by the first request that
+    /// needs them and dropped when a newer snapshot is published.
+    class Session
+    {
+    public:
+        const PDGSnapshot& bind(std::shared_ptr<const PDGSnapshot> snapshot);
+
+        PDGSlicer& getSlicer();
+        PDGChopper& getChopper();
+
+    private:
+        std::shared_ptr<const PDGSnapshot> m_snapshot;
+        std::unique_ptr<PDGSlicer> m_slicer;
+        std::unique_ptr<PDGChopper> m_chopper;
+    };
+
+public:
+    /// Snapshots without an index answer reaches by a search
+    explicit QueryServer(SnapshotPublisher& snapshots);
+    ~QueryServer();
+
+    QueryServer(const QueryServer& ) = delete;
+    QueryServer(QueryServer&& ) = delete;
+    QueryServer& operator =(const QueryServer& ) = delete;
+    QueryServer& operator =(QueryServer&& ) = delete;
+
+public:
+    /// Directories that reload may open, reload is refused without one
+    void setReloadRoot(const std::string& root)
+    {
+        m_reloadRoot = root;
+    }
+
+    /// Connections served at once, each holding slicer state as large as
+    /// the graph. Further clients wait until one of them is closed.
+    void setMaxConnections(unsigned maxConnections)
+    {
+        m_maxConnections = std::max(1u, maxConnections);
+    }
+
+    /// Binds the socket, accessible to the owner only. A stale socket at the
+    /// path is replaced, but not one a server is listening on.
+    bool listen(const std::string& path);
+
+    /// Accepts connections until stop is called, then closes them and
+    /// waits for their threads. Failed accepts are retried after a pause.
+    void serve();
+
+    /// Makes serve return, safe to call from a signal handler
+    void stop();
+
+    /// Response text of one request
+    std::string answer(llvm::StringRef request, Session& session);
+
+private:
+    void serveConnection(int fd);
+    std::string reload(const std::string& directory);
+    bool isUnderReloadRoot(const std::string& directory) const;
+
+private:
+    SnapshotPublisher& m_snapshots;
+    /// Serializes reloads, readers never take it
+    std::mutex m_reloadLock;
+    std::string m_reloadRoot;
+    std::string m_path;
+    int m_listenFd;
+    std::atomic<bool> m_stopped;
+    /// Sockets of the open connections, each served by a detached thread
+    std::mutex m_connectionsLock;
+    std::condition_variable m_connectionsClosed;
+    std::vector<int> m_connections;
+    unsigned m_maxConnections;
+}; // class QueryServer
+
+} // namespace pdg
+
@@ -0,0 +1,109 @@
+#pragma once
+
+#include "PDG/FrozenPDG.h"
+#include "PDG/PDGSlicer.h"
+
+#include <atomic>
+#include <cstdint>
+#include <vector>
+
+namespace pdg {
+
+/// Precomputed reachability over a frozen PDG. Strongly connected components
+/// are collapsed into a DAG whose components are numbered in reverse
+/// topological order, and every component gets GRAIL interval labels from a
+/// few randomized depth first traversals. A query is answered from the
+/// component numbers and labels alone unless the labels can not rule the
+/// path out, in which case a depth first search pruned by the labels decides.
+/// Queries are thread safe.
+class ReachabilityIndex
+{
+public:
+    using NodeId = FrozenPDG::NodeId;
+    using ComponentId = uint32_t;
+
+    /// Counts of queries and of queries that needed a search
+    struct Stats
+    {
+        uint64_t queries;
+        uint64_t searches;
+    };
+
+public:
+    ReachabilityIndex(const FrozenPDG& pdg,
+                      unsigned edges = AllEdges,
+                      unsigned numLabels = 3,
+                      unsigned seed = 0);
+
+    ReachabilityIndex(const ReachabilityIndex& ) = delete;
+    ReachabilityIndex(ReachabilityIndex&& ) = delete;
+    ReachabilityIndex& operator =(const ReachabilityIndex& ) = delete;
+    ReachabilityIndex& operator =(ReachabilityIndex&& ) = delete;
+
+public:
+    /// Numbers the strongly connected components of the followed edges in
+    /// reverse topological order and returns their number
+    static unsigned findComponents(const FrozenPDG& pdg, unsigned edges, std::vector<ComponentId>& components);
+
+    /// Whether a path of followed edges leads from source to dest
+    bool reaches(NodeId source, NodeId dest) const;
+
+    /// Whether node depends on dependency, i.e. dependency reaches node
+    bool dependsOn(NodeId node, NodeId dependency) const
+    {
+        return reaches(dependency, node);
+    }
+
+    /// EdgeFilter the index was built for
+    unsigned getEdges() const
+    {
+        return m_edges;
+    }
+
+    ComponentId getComponent(NodeId node) const
+    {
+        return m_components[node];
+    }
+
+    unsigned getNumComponents() const
+    {
+        return m_numComponents;
+    }
+
+    uint64_t getNumDAGEdges() const
+    {
+        return m_dagEdges.size();
+    }
+
+    /// Bytes held by the index
+    uint64_t getMemoryUsage() const;
+
+    Stats getStats() const
+    {
+        return Stats{m_numQueries.load(), m_numSearches.load()};
+    }
+
+private:
+    void buildDAG(const FrozenPDG& pdg, unsigned edges);
+    void buildLabels(unsigned numLabels, unsigned seed);
+
+    bool isContained(ComponentId inner, ComponentId outer) const;
+    bool search(ComponentId source, ComponentId dest) const;
+
+private:
+    unsigned m_edges;
+    unsigned m_numLabels;
+    unsigned m_numComponents;
+    /// Component of every node. Components are numbered in reverse
+    /// topological order, a component only reaches lower numbered ones.
+    std::vector<ComponentId> m_components;
+    std::vector<uint64_t> m_dagOffsets;
+    std::vector<ComponentId> m_dagEdges;
+    /// numLabels intervals per component, as lowest and own post order rank
+    std::vector<uint32_t> m_labels;
+    mutable std::atomic<uint64_t> m_numQueries;
+    mutable std::atomic<uint64_t> m_numSearches;
+}; // class ReachabilityIndex
+
+} // namespace pdg
+
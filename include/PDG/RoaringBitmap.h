@@ -0,0 +1,67 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+namespace pdg {
+
+/// Compressed set of 32 bit values in the manner of roaring bitmaps. Values
+/// are split by their upper 16 bits into containers, which hold the lower 16
+/// bits as a sorted array while sparse and as a 65536 bit bitmap once they
+/// have more than 4096 values. Slices of a PDG cover ranges of nearby node
+/// ids, so they take a fraction of a sorted id list or a bitset over all
+/// nodes.
+class RoaringBitmap
+{
+public:
+    /// Returns false if the value was in the set already
+    bool add(uint32_t value);
+    bool contains(uint32_t value) const;
+    void unionWith(const RoaringBitmap& other);
+
+    uint64_t size() const
+    {
+        return m_size;
+    }
+
+    bool empty() const
+    {
+        return m_size == 0;
+    }
+
+    /// Values in ascending order
+    std::vector<uint32_t> toVector() const;
+
+    /// Bytes held by the containers
+    uint64_t getMemoryUsage() const;
+
+private:
+    struct Container
+    {
+        uint16_t key;
+        uint32_t cardinality;
+        /// Sorted lower bits while the container is an array
+        std::vector<uint16_t> values;
+        /// 1024 words once the container is a bitmap
+        std::vector<uint64_t> bits;
+
+        bool isBitmap() const
+        {
+            return !bits.empty();
+        }
+    };
+
+    Container& getContainer(uint16_t key);
+    const Container* findContainer(uint16_t key) const;
+    static void toBitmap(Container& container);
+    static void unionContainers(Container& container, const Container& other);
+
+private:
+    std::vector<Container> m_containers;
+    uint64_t m_size = 0;
+    /// Index of the last container added to, BFS orders visit nearby ids
+    unsigned m_lastContainer = 0;
+}; // class RoaringBitmap
+
+} // namespace pdg
+
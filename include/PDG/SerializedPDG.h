@@ -0,0 +1,145 @@
+#pragma once
+
+#include <iosfwd>
+#include <string>
+#include <vector>
+
+namespace pdg {
+
+class PDG;
+class PDGNode;
+
+/// Module independent copy of a PDG. Nodes are addressed by their index and
+/// refer to functions and globals by linkage name, so graphs of separately
+/// analyzed modules can be stored, read back without LLVM and linked.
+class SerializedPDG
+{
+public:
+    /// How the function or global a node stands for is defined in its module
+    enum class Linkage : unsigned
+    {
+        None = 0,
+        Local,
+        Declaration,
+        Definition,
+        /// Local symbol whose body was left out, e.g. built by another shard
+        LocalDeclaration,
+        /// Definition that may be replaced by another one, e.g. linkonce or weak
+        WeakDefinition
+    };
+
+    enum class EdgeKind : unsigned
+    {
+        Data = 0,
+        Control,
+        Summary
+    };
+
+    struct Node
+    {
+        unsigned module;
+        /// PDGLLVMNode::NodeType
+        unsigned type;
+        Linkage linkage;
+        /// Function of function, formal argument and va arg nodes, or global
+        std::string symbol;
+        /// Formal or actual argument number, number of parameters for va arg nodes
+        int argIdx;
+        /// Name of the parent function, empty for nodes without one
+        std::string function;
+        std::string label;
+        /// llvm::Instruction opcode of instruction nodes, 0 for other nodes
+        unsigned opcode;
+        /// Labeling metadata kind of the instruction, e.g. oh_hash, or empty
+        std::string metadataLabel;
+    };
+
+    struct Edge
+    {
+        unsigned source;
+        unsigned dest;
+        EdgeKind kind;
+    };
+
+    using Nodes = std::vector<Node>;
+    using Edges = std::vector<Edge>;
+    using Modules = std::vector<std::string>;
+
+    /// Receives the records of a serialized PDG in file order: modules, nodes
+    /// and then edges
+    class Visitor
+    {
+    public:
+        virtual ~Visitor() = default;
+
+        virtual void visitModule(const std::string& moduleName) = 0;
+        virtual void visitNode(const Node& node) = 0;
+        virtual void visitEdge(const Edge& edge) = 0;
+    }; // class Visitor
+
+public:
+    SerializedPDG() = default;
+    SerializedPDG(const SerializedPDG& ) = delete;
+    SerializedPDG(SerializedPDG&& ) = default;
+    SerializedPDG& operator =(const SerializedPDG& ) = delete;
+    SerializedPDG& operator =(SerializedPDG&& ) = default;
+
+public:
+    /// Copies the nodes and edges of the PDG of the given module. The PDG
+    /// node of each node index is stored in nodeOrder if given.
+    static SerializedPDG fromPDG(const PDG& pdg,
+                                 const std::string& moduleName,
+                                 std::vector<PDGNode*>* nodeOrder = nullptr);
+
+    /// Reads a serialized PDG record by record without keeping it in memory.
+    /// Edge endpoints are not checked against the number of nodes.
+    static bool read(const std::string& path, Visitor& visitor);
+
+    bool load(const std::string& path);
+    bool save(const std::string& path) const;
+
+public:
+    const Modules& getModules() const
+    {
+        return m_modules;
+    }
+
+    const Nodes& getNodes() const
+    {
+        return m_nodes;
+    }
+
+    const Edges& getEdges() const
+    {
+        return m_edges;
+    }
+
+    unsigned addModule(const std::string& moduleName)
+    {
+        m_modules.push_back(moduleName);
+        return m_modules.size() - 1;
+    }
+
+    unsigned addNode(const Node& node)
+    {
+        m_nodes.push_back(node);
+        return m_nodes.size() - 1;
+    }
+
+    void addEdge(unsigned source, unsigned dest, EdgeKind kind)
+    {
+        m_edges.push_back(Edge{source, dest, kind});
+    }
+
+private:
+    static bool read(std::istream& in, Visitor& visitor);
+    void write(std::ostream& out) const;
+
+private:
+    Modules m_modules;
+    Nodes m_nodes;
+    Edges m_edges;
+}; // class SerializedPDG
+
+} // namespace pdg
+
@@ -0,0 +1,116 @@
+#pragma once
+
+#include "PDG/FrozenPDG.h"
+#include "PDG/PDGSlicer.h"
+#include "PDG/ReachabilityIndex.h"
+#include "PDG/RoaringBitmap.h"
+
+#include "llvm/ADT/ArrayRef.h"
+
+#include <atomic>
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <shared_mutex>
+#include <unordered_map>
+#include <vector>
+
+namespace pdg {
+
+/// Memoized interprocedural slices of single criteria, keyed by criterion,
+/// direction and edge filter and stored as roaring bitmaps. A slice contains
+/// the slice of every node it reaches, so a traversal that reaches a shared
+/// node takes the cached slice of that node instead of traversing on: shared
+/// nodes are function, formal argument and global nodes, where the slices of
+/// all callers meet, and, if a reachability index for the same edges is
+/// given, nodes of strongly connected components, whose members all have the
+/// same slice and share one entry. A missing slice of a shared node is
+/// computed and cached on the way. Entries beyond the memory budget are
+/// evicted in clock order. The cache is thread safe.
+class SliceCache
+{
+public:
+    using NodeId = FrozenPDG::NodeId;
+
+    struct Stats
+    {
+        /// Criteria found in the cache
+        uint64_t hits;
+        /// Slices computed, shared nodes included
+        uint64_t misses;
+        /// Cached slices of shared nodes taken by other traversals
+        uint64_t reused;
+        uint64_t entries;
+        uint64_t bytes;
+    };
+
+public:
+    SliceCache(const FrozenPDG& pdg, const ReachabilityIndex* index, uint64_t memoryBudget);
+
+    SliceCache(const SliceCache& ) = delete;
+    SliceCache(SliceCache&& ) = delete;
+    SliceCache& operator =(const SliceCache& ) = delete;
+    SliceCache& operator =(SliceCache&& ) = delete;
+
+public:
+    std::shared_ptr<const RoaringBitmap> slice(NodeId criterion, SliceDirection direction, unsigned edges = AllEdges);
+
+    /// Union of the slices of the criteria
+    Slice slice(llvm::ArrayRef<NodeId> criteria, SliceDirection direction, unsigned edges = AllEdges);
+
+    uint64_t getMemoryBudget() const
+    {
+        return m_memoryBudget;
+    }
+
+    Stats getStats() const;
+
+private:
+    /// Slot of the clock, free while it has no slice
+    struct Entry
+    {
+        Entry(uint64_t key, std::shared_ptr<const RoaringBitmap> slice)
+            : key(key)
+            , slice(std::move(slice))
+            , referenced(true)
+        {
+        }
+
+        uint64_t key;
+        std::shared_ptr<const RoaringBitmap> slice;
+        /// Set by lookups, cleared when the clock hand passes
+        mutable std::atomic<bool> referenced;
+    };
+
+    uint64_t getKey(NodeId node, SliceDirection direction, unsigned edges) const;
+    bool isShared(NodeId node, unsigned edges) const;
+    std::shared_ptr<const RoaringBitmap> lookup(uint64_t key) const;
+    void insert(uint64_t key, std::shared_ptr<const RoaringBitmap> slice);
+    /// Advances the clock hand until the entries fit into the budget
+    void evict(size_t keptSlot);
+    /// Keys of the slices being computed by this thread are pending
+    std::shared_ptr<const RoaringBitmap> get(NodeId node, SliceDirection direction, unsigned edges,
+                                             std::vector<uint64_t>& pending);
+    std::shared_ptr<const RoaringBitmap> compute(NodeId criterion, SliceDirection direction, unsigned edges,
+                                                 std::vector<uint64_t>& pending);
+
+private:
+    const FrozenPDG& m_pdg;
+    const ReachabilityIndex* m_index;
+    const uint64_t m_memoryBudget;
+    /// Components with more than one node
+    std::vector<bool> m_cyclicComponents;
+    mutable std::shared_mutex m_lock;
+    /// Entries never move, so lookups may set their flags under the shared lock
+    std::deque<Entry> m_entries;
+    std::vector<size_t> m_freeSlots;
+    std::unordered_map<uint64_t, size_t> m_slots;
+    size_t m_hand;
+    uint64_t m_bytes;
+    std::atomic<uint64_t> m_hits;
+    std::atomic<uint64_t> m_misses;
+    std::atomic<uint64_t> m_reused;
+}; // class SliceCache
+
+} // namespace pdg
+
@@ -0,0 +1,138 @@
+#pragma once
+
+#include "PDG/FrozenPDG.h"
+#include "PDG/PDGChopper.h"
+
+#include "llvm/ADT/BitVector.h"
+#include "llvm/ADT/DenseMap.h"
+#include "llvm/ADT/StringRef.h"
+
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace pdg {
+
+/// Declarative taint configuration, one rule per line:
+///     source recv arg1
+///     sink system arg0
+///     sanitizer escape ret
+/// A rule names a role, a function and a position: ret is the result of
+/// the calls of the function, argN the N-th actual argument of its calls and
+/// paramN its own N-th formal argument. Lines starting with # are comments.
+class TaintSpec
+{
+public:
+    enum class Role
+    {
+        Source,
+        Sink,
+        /// Values at the position are clean, taint does not pass them
+        Sanitizer
+    };
+
+    enum class Position
+    {
+        Return,
+        Argument,
+        Parameter
+    };
+
+    struct Rule
+    {
+        Role role;
+        std::string function;
+        Position position;
+        /// Argument number, unused for Return
+        unsigned index;
+    };
+
+public:
+    /// Adds the rules of a spec file, reports malformed lines to errs()
+    bool read(const std::string& path);
+    /// Adds the rules of a spec text, name is used in error messages
+    bool parse(llvm::StringRef text, llvm::StringRef name);
+
+    void addRule(const Rule& rule)
+    {
+        m_rules.push_back(rule);
+    }
+
+    const std::vector<Rule>& getRules() const
+    {
+        return m_rules;
+    }
+
+private:
+    std::vector<Rule> m_rules;
+}; // class TaintSpec
+
+/// A source whose taint reaches a sink, with the shortest path it takes
+struct TaintFinding
+{
+    FrozenPDG::NodeId source;
+    FrozenPDG::NodeId sink;
+    /// Indices of the matching rules of the spec
+    unsigned sourceRule;
+    unsigned sinkRule;
+    DependencePath path;
+};
+
+/// Taint propagation over a frozen PDG. The rules of a spec are resolved to
+/// nodes once: call sites through the control edges to the function nodes of
+/// the named functions, actual arguments by their argument number. Taint
+/// flows along data and summary edges, which include the edges from actual
+/// to formal arguments and from returns through function nodes back to the
+/// call sites, and stops at sanitized nodes. Each source is propagated on
+/// its own by a breadth first worklist over dense node ids, so sources are
+/// independent and spread over threads.
+class TaintEngine
+{
+public:
+    TaintEngine(const FrozenPDG& pdg, const TaintSpec& spec);
+
+    TaintEngine(const TaintEngine& ) = delete;
+    TaintEngine(TaintEngine&& ) = delete;
+    TaintEngine& operator =(const TaintEngine& ) = delete;
+    TaintEngine& operator =(TaintEngine&& ) = delete;
+
+public:
+    /// Source nodes with the index of their rule, sorted by node
+    const std::vector<std::pair<FrozenPDG::NodeId, unsigned>>& getSources() const
+    {
+        return m_sources;
+    }
+
+    unsigned getNumSinks() const
+    {
+        return m_sinkRules.size();
+    }
+
+    /// One finding per reachable pair of source and sink, sorted by source
+    /// and sink
+    std::vector<TaintFinding> run(unsigned numThreads = 1) const;
+
+private:
+    /// Breadth first tree of one source, reused for the sources of a thread
+    struct Propagation
+    {
+        std::vector<FrozenPDG::NodeId> parents;
+        std::vector<uint8_t> kinds;
+        std::vector<FrozenPDG::NodeId> reached;
+
+        explicit Propagation(unsigned numNodes);
+    };
+
+    void resolve(const TaintSpec& spec);
+    void match(FrozenPDG::NodeId node, const TaintSpec::Rule& rule, unsigned ruleIndex);
+    void propagate(unsigned sourceIndex, Propagation& propagation, std::vector<TaintFinding>& findings) const;
+
+private:
+    const FrozenPDG& m_pdg;
+    std::vector<std::pair<FrozenPDG::NodeId, unsigned>> m_sources;
+    llvm::DenseMap<FrozenPDG::NodeId, unsigned> m_sinkRules;
+    llvm::BitVector m_sanitized;
+}; // class TaintEngine
+
+} // namespace pdg
+
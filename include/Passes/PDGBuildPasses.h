@@ -1,18 +1,25 @@
 #pragma once
 
+#include "llvm/IR/PassManager.h"
 #include "llvm/Pass.h"
 
+#include <functional>
 #include <memory>
 
 namespace pdg {
 
 class PDG;
+class FunctionPDG;
+class FunctionSummaryAnalysis;
+class PointerAnalysisCacheEntry;
 
 /// LLVM pass to build PDG from SVFG
 class SVFGPDGBuilder : public llvm::ModulePass
 {
 public:
     using PDGType = std::shared_ptr<PDG>;
+    using SummariesType = std::shared_ptr<FunctionSummaryAnalysis>;
+    using PTACacheEntryType = std::shared_ptr<PointerAnalysisCacheEntry>;
 
 public:
     static char ID;
@@ -29,8 +36,21 @@ public:
         return m_pdg;
     }
 
+    SummariesType getFunctionSummaries()
+    {
+        return m_summaries;
+    }
+
+    /// Pointer analysis cache entry of the module, null without -pta-cache-dir
+    PTACacheEntryType getPTACacheEntry()
+    {
+        return m_ptaCacheEntry;
+    }
+
 private:
     PDGType m_pdg;
+    SummariesType m_summaries;
+    PTACacheEntryType m_ptaCacheEntry;
 };
 
 /*
@@ -65,6 +85,7 @@ class LLVMPDGBuilder : public llvm::ModulePass
 {
 public:
     using PDGType = std::shared_ptr<PDG>;
+    using SummariesType = std::shared_ptr<FunctionSummaryAnalysis>;
 
 public:
     static char ID;
@@ -81,10 +102,77 @@ public:
         return m_pdg;
     }
 
+    SummariesType getFunctionSummaries()
+    {
+        return m_summaries;
+    }
+
 private:
     PDGType m_pdg;
+    SummariesType m_summaries;
+};
 
+/// Result of the new pass manager PDG analyses
+struct PDGAnalysisResult
+{
+    std::shared_ptr<PDG> pdg;
+    std::shared_ptr<FunctionSummaryAnalysis> summaries;
+    std::shared_ptr<PointerAnalysisCacheEntry> ptaCacheEntry;
+};
+
+/// New pass manager analysis building PDG from SVFG
+class PDGAnalysis : public llvm::AnalysisInfoMixin<PDGAnalysis>
+{
+public:
+    using Result = PDGAnalysisResult;
+
+public:
+    Result run(llvm::Module& M, llvm::ModuleAnalysisManager& MAM);
+
+private:
+    friend llvm::AnalysisInfoMixin<PDGAnalysis>;
+    static llvm::AnalysisKey Key;
 };
 
+/// New pass manager analysis building PDG from LLVM MemorySSA
+class LLVMPDGAnalysis : public llvm::AnalysisInfoMixin<LLVMPDGAnalysis>
+{
+public:
+    using Result = PDGAnalysisResult;
+
+public:
+    Result run(llvm::Module& M, llvm::ModuleAnalysisManager& MAM);
+
+private:
+    friend llvm::AnalysisInfoMixin<LLVMPDGAnalysis>;
+    static llvm::AnalysisKey Key;
+};
+
+/// New pass manager analysis building PDG from LLVM MemorySSA without any
+/// pointer analysis. Indirect call sites are resolved by function type.
+class MemorySSAPDGAnalysis : public llvm::AnalysisInfoMixin<MemorySSAPDGAnalysis>
+{
+public:
+    using Result = PDGAnalysisResult;
+
+public:
+    Result run(llvm::Module& M, llvm::ModuleAnalysisManager& MAM);
+
+private:
+    friend llvm::AnalysisInfoMixin<MemorySSAPDGAnalysis>;
+    static llvm::AnalysisKey Key;
+};
+
+using FunctionPDGConsumer = std::function<void (llvm::Function*, std::shared_ptr<FunctionPDG>)>;
+
+/// Builds the PDG as PDGAnalysis does, or as MemorySSAPDGAnalysis without SVF,
+/// but hands each function PDG to the consumer once it is complete and then
+/// frees its body. The result keeps only the interprocedural nodes and has no
+/// function summaries.
+PDGAnalysisResult streamPDG(llvm::Module& M,
+                            llvm::ModuleAnalysisManager& MAM,
+                            const FunctionPDGConsumer& consumer,
+                            bool useSVF);
+
 }
 
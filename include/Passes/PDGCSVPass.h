@@ -0,0 +1,81 @@
+#pragma once
+
+#include "llvm/IR/PassManager.h"
+
+#include <string>
+
+class PDGCSV;
+
+namespace pdg {
+
+/// New pass manager pass exporting block features and relations in CSV
+class PDGCSVPass : public llvm::PassInfoMixin<PDGCSVPass>
+{
+public:
+    /// Takes output files from -relations, -blocks and -append
+    PDGCSVPass();
+    PDGCSVPass(const std::string& relationsFile,
+               const std::string& blocksFile,
+               bool append);
+
+    /// Resolves relative output files against the given directory
+    void setOutputDirectory(const std::string& directory);
+
+    /// Writes to the output files with the suffix appended, truncating them,
+    /// instead of appending to the output files. The module output is then
+    /// complete or missing there, and can be appended by the caller.
+    void setPartialOutputSuffix(const std::string& suffix)
+    {
+        m_partialOutputSuffix = suffix;
+    }
+
+    bool isAppending() const
+    {
+        return m_append;
+    }
+
+    /// Without SVF the PDG comes from MemorySSAPDGAnalysis and the SVF based
+    /// block features are left out. Used when pointer analysis is too expensive.
+    void setUseSVF(bool useSVF)
+    {
+        m_useSVF = useSVF;
+    }
+
+    /// Exports each function as soon as its PDG is complete and frees it, so
+    /// only one function body is resident at a time. Defaults to -pdg-stream.
+    void setStreaming(bool streaming)
+    {
+        m_streaming = streaming;
+    }
+
+    const std::string& getRelationsFile() const
+    {
+        return m_relationsFile;
+    }
+
+    const std::string& getBlocksFile() const
+    {
+        return m_blocksFile;
+    }
+
+    llvm::PreservedAnalyses run(llvm::Module& M, llvm::ModuleAnalysisManager& MAM);
+
+private:
+    llvm::PreservedAnalyses runStreaming(llvm::Module& M,
+                                         llvm::ModuleAnalysisManager& MAM,
+                                         ::PDGCSV& exporter,
+                                         const std::string& relationsFile,
+                                         const std::string& blocksFile,
+                                         bool append);
+
+private:
+    std::string m_relationsFile;
+    std::string m_blocksFile;
+    bool m_append;
+    std::string m_partialOutputSuffix;
+    bool m_useSVF;
+    bool m_streaming;
+}; // class PDGCSVPass
+
+} // namespace pdg
+
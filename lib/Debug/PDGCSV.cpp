@@ -4,11 +4,13 @@
 #include "SVF/Util/SVFModule.h"
 #include "SVF/WPA/Andersen.h"
 #include "Passes/PDGBuildPasses.h"
+#include "Passes/PDGCSVPass.h"
 #include "PDG/PDG.h"
 #include "PDG/PDGNode.h"
 #include "PDG/PDGLLVMNode.h"
 #include "PDG/PDGEdge.h"
 #include "PDG/FunctionPDG.h"
+#include "PDG/PointerAnalysisCache.h"
 #include "llvm/ADT/SCCIterator.h"
 #include "llvm/IR/CFG.h"
 #include "llvm/IR/LegacyPassManager.h"
@@ -19,6 +21,7 @@
 #include "llvm/Support/Debug.h"
 #include "llvm/Support/FileSystem.h"
 #include "llvm/Support/GraphWriter.h"
+#include "llvm/Support/Path.h"
 #include "llvm/Support/raw_ostream.h"
 #include "llvm/Transforms/IPO/PassManagerBuilder.h"
 #include <algorithm>
@@ -31,6 +34,7 @@
 #include <sstream>
 #include <unordered_set>
 #include <regex>
+#include <sys/file.h>
 
 using namespace llvm;
 namespace fs = std::filesystem;
@@ -45,6 +49,11 @@ static llvm::cl::opt<std::string>
 static cl::opt<bool> Append("append", cl::Hidden,
                             cl::desc("Append to the specified file"));
 
+static cl::opt<bool>
+    Stream("pdg-stream", cl::Hidden,
+           cl::desc("Export each function as soon as its PDG is built and "
+                    "free it afterwards"));
+
 class PDGCSV : public llvm::ModulePass {
 public:
   static char ID;
@@ -89,44 +98,104 @@ public:
      AU.setPreservesAll();
   }
   bool runOnModule(llvm::Module &M) override {
+    auto &builder = getAnalysis<pdg::SVFGPDGBuilder>();
+    auto ptaCacheEntry = builder.getPTACacheEntry();
+    SVFG *svfg = hasCachedFeatures(ptaCacheEntry.get()) ? nullptr : buildSVFG(M);
+    return exportModule(M, builder.getPDG(), svfg, ptaCacheEntry.get(),
+                        RelationsFile, BlocksFile, Append);
+  }
+  bool hasCachedFeatures(pdg::PointerAnalysisCacheEntry *ptaCacheEntry) {
+    return ptaCacheEntry && ptaCacheEntry->hasBlockFeatures();
+  }
+  SVFG *buildSVFG(llvm::Module &M) {
     SVFModule svfM(M);
     AndersenWaveDiff *ander = new AndersenWaveDiff();
     ander->disablePrintStat();
     ander->analyze(svfM);
     SVFGBuilder memSSA(true);
-    SVFG *svfg = memSSA.buildSVFG((BVDataPTAImpl *)ander);
-
-    auto pdgp = getAnalysis<pdg::SVFGPDGBuilder>().getPDG();
-    if (RelationsFile.empty() || BlocksFile.empty()) {
-      llvm::errs()
-          << "-relations and -blocks must be supplied (path to CSV files)";
-      exit(1);
-    }
-    // std::ofstream blockfile, blockrelfile, instructionfile;
-    FILE *blockfile, *blockrelfile;
-    std::string fileMode = Append ? "a" : "w";
-    blockrelfile = fopen(RelationsFile.c_str(), fileMode.c_str());
-    blockfile = fopen(BlocksFile.c_str(), fileMode.c_str());
-    auto *pag = svfg->getPAG();
+    return memSSA.buildSVFG((BVDataPTAImpl *)ander);
+  }
+  // State of an export running over the functions of one module
+  struct CSVExport {
+    FILE *blockfile = nullptr;
+    FILE *blockrelfile = nullptr;
+    SVFG *svfg = nullptr;
+    pdg::PointerAnalysisCacheEntry *ptaCacheEntry = nullptr;
+    bool useCachedFeatures = false;
     std::vector<std::size_t> blockIds;
     std::vector<tuple<size_t, std::vector<int>, std::string, std::string>>
         blockFeatures;
     std::vector<std::pair<std::size_t, std::size_t>> blockSCCRelationIds,
         blockCFGRelationIds;
-    std::vector<std::tuple<std::size_t, std::size_t,std::string>> blockSVFRelationIds;
+    std::vector<std::tuple<std::size_t, std::size_t, std::string>>
+        blockSVFRelationIds;
     std::vector<size_t> soloBlocks;
+  };
+  // Without svfg the SVF based block features are taken from the pointer
+  // analysis cache entry if it has them, or left out otherwise. With both,
+  // the features are recorded into the entry.
+  bool exportModule(llvm::Module &M, std::shared_ptr<pdg::PDG> pdgp,
+                    SVFG *svfg, pdg::PointerAnalysisCacheEntry *ptaCacheEntry,
+                    const std::string &relationsFile,
+                    const std::string &blocksFile, bool append) {
+    CSVExport csv;
+    beginExport(csv, svfg, ptaCacheEntry, relationsFile, blocksFile, append);
     for (auto &F : M) {
       if (F.isDeclaration()) {
         continue;
       }
-      llvm::dbgs() << "Function   " << F.getName() << "\n";
-      auto fpdg = pdgp->getFunctionPDG(&F);
-      for (auto &B : F) {
-        featureVector.clear();
-        auto blockId = getUniqueBlockName(&B, &F);
-        blockIds.push_back(blockId);
-
-        ///--------------Handle CFG Relations -------------
+      exportFunction(csv, F, pdgp->getFunctionPDG(&F));
+    }
+    return finishExport(csv, M);
+  }
+  // Opens and locks the output files. The relations are written by
+  // finishExport, as solo blocks are only known once all functions are seen.
+  void beginExport(CSVExport &csv, SVFG *svfg,
+                   pdg::PointerAnalysisCacheEntry *ptaCacheEntry,
+                   const std::string &relationsFile,
+                   const std::string &blocksFile, bool append) {
+    csv.svfg = svfg;
+    csv.ptaCacheEntry = ptaCacheEntry;
+    csv.useCachedFeatures = !svfg && hasCachedFeatures(ptaCacheEntry);
+    if (relationsFile.empty() || blocksFile.empty()) {
+      llvm::errs()
+          << "-relations and -blocks must be supplied (path to CSV files)";
+      exit(1);
+    }
+    // std::ofstream blockfile, blockrelfile, instructionfile;
+    std::string fileMode = append ? "a" : "w";
+    csv.blockrelfile = fopen(relationsFile.c_str(), fileMode.c_str());
+    csv.blockfile = fopen(blocksFile.c_str(), fileMode.c_str());
+    if (!csv.blockrelfile || !csv.blockfile) {
+      llvm::errs() << "Could not open " << relationsFile << " or "
+                   << blocksFile << "\n";
+      exit(1);
+    }
+    // Batch workers may append to the same dataset files concurrently, the
+    // locks are released by fclose
+    flock(fileno(csv.blockrelfile), LOCK_EX);
+    flock(fileno(csv.blockfile), LOCK_EX);
+  }
+  // Only reads the out edges of the function's own nodes, so it can run as
+  // soon as the function PDG is complete, before later functions are built.
+  void exportFunction(CSVExport &csv, llvm::Function &F,
+                      std::shared_ptr<pdg::FunctionPDG> fpdg) {
+    SVFG *svfg = csv.svfg;
+    auto *ptaCacheEntry = csv.ptaCacheEntry;
+    const bool useCachedFeatures = csv.useCachedFeatures;
+    auto &blockIds = csv.blockIds;
+    auto &blockFeatures = csv.blockFeatures;
+    auto &blockSCCRelationIds = csv.blockSCCRelationIds;
+    auto &blockCFGRelationIds = csv.blockCFGRelationIds;
+    auto &blockSVFRelationIds = csv.blockSVFRelationIds;
+    auto &soloBlocks = csv.soloBlocks;
+    llvm::dbgs() << "Function   " << F.getName() << "\n";
+    for (auto &B : F) {
+      featureVector.clear();
+      auto blockId = getUniqueBlockName(&B, &F);
+      blockIds.push_back(blockId);
+
+      ///--------------Handle CFG Relations -------------
 	bool hasSuccBlocks = false;
 	//llvm::dbgs()<<"block:"<<blockId<<" successors:\n";
 	for(BasicBlock *succBB: successors(&B)){
@@ -141,90 +210,104 @@ public:
 	 // B.print(dbgs());
 	 // dbgs()<<"num succ:"<<B.getTerminator()->getNumSuccessors()<<"\n";
 	//}
-        //---------------End of CFG reltions --------------
+      //---------------End of CFG reltions --------------
 	
-        //llvm::dbgs() << "BB: " << blockId << "\n";
-        std::vector<std::tuple<std::size_t, std::size_t,std::string>> BBOutBBs;
-        std::string BBLabel = "none";
-        // getCleanBBContent(&B);
-        std::string blockContent = "";
+      //llvm::dbgs() << "BB: " << blockId << "\n";
+      std::vector<std::tuple<std::size_t, std::size_t,std::string>> BBOutBBs;
+      std::string BBLabel = "none";
+      // getCleanBBContent(&B);
+      std::string blockContent = "";
 	bool hasSVF = false;
-        for (auto &I : B) {
-          llvm::raw_string_ostream rso(blockContent);
-          I.print(rso);
-          blockContent += "|.|";
-          //llvm::dbgs() << "Instr: " << I << "\n";
+      for (auto &I : B) {
+        llvm::raw_string_ostream rso(blockContent);
+        I.print(rso);
+        blockContent += "|.|";
+        //llvm::dbgs() << "Instr: " << I << "\n";
+        if (svfg) {
           process(svfg, &I);
-          
-          auto instOutBBs = getOutEdgeBB(fpdg, &I, &F, blockId);
-          if (instOutBBs.size() > 0) {
-            BBOutBBs.insert(BBOutBBs.end(), instOutBBs.begin(),
-                            instOutBBs.end());
+        }
+        
+        auto instOutBBs = getOutEdgeBB(fpdg, &I, &F, blockId);
+        if (instOutBBs.size() > 0) {
+          BBOutBBs.insert(BBOutBBs.end(), instOutBBs.begin(),
+                          instOutBBs.end());
 	    hasSVF = true;
-          } 
+        } 
 	  std::sort(BBOutBBs.begin(),BBOutBBs.end());
 	  BBOutBBs.erase(std::unique(BBOutBBs.begin(),BBOutBBs.end()),BBOutBBs.end());
-          blockSVFRelationIds.insert(blockSVFRelationIds.end(),
-                                     BBOutBBs.begin(), BBOutBBs.end());
-          //llvm::dbgs() << "---------------\n";
-          auto instLabel = getInstLabel(I);
-          if (instLabel.compare("none") != 0)
-            BBLabel = instLabel;
-        }
-        if(!hasSuccBlocks && !hasSVF) {
-          soloBlocks.push_back(blockId);
+        blockSVFRelationIds.insert(blockSVFRelationIds.end(),
+                                   BBOutBBs.begin(), BBOutBBs.end());
+        //llvm::dbgs() << "---------------\n";
+        auto instLabel = getInstLabel(I);
+        if (instLabel.compare("none") != 0)
+          BBLabel = instLabel;
+      }
+      if(!hasSuccBlocks && !hasSVF) {
+        soloBlocks.push_back(blockId);
 	  if(BBLabel.compare("none")!=0){
 	    llvm::errs()<<"Labled block with no relations found!\n";
 	    //B.print(llvm::errs());
 	    //exit(1);
 	   }  
 	}
-	std::replace(blockContent.begin(),blockContent.end(),';',' ');
-        blockFeatures.push_back(std::make_tuple(blockId, featureVector, BBLabel, blockContent));
-        // dumpBBFeatures(blockfile, blockId, featureVector,
-        // BBLabel,blockContent); blockfile.flush();
+      if (svfg && ptaCacheEntry) {
+        ptaCacheEntry->addBlockFeatures(&B, featureVector);
+      } else if (useCachedFeatures) {
+        featureVector = ptaCacheEntry->getBlockFeatures(&B);
       }
+	std::replace(blockContent.begin(),blockContent.end(),';',' ');
+      blockFeatures.push_back(std::make_tuple(blockId, featureVector, BBLabel, blockContent));
+      // dumpBBFeatures(blockfile, blockId, featureVector,
+      // BBLabel,blockContent); blockfile.flush();
+    }
 
-      unsigned sccNum = 0;
-      BasicBlock *previousBlock = nullptr;
-      // errs() << "SCCs for Function " << F.getName() << " in PostOrder:";
-      for (scc_iterator<Function *> SCCI = scc_begin(&F); !SCCI.isAtEnd();
-           ++SCCI) {
-        const std::vector<BasicBlock *> &nextSCC = *SCCI;
-        ++sccNum;
-        std::size_t previous = -1;
+    unsigned sccNum = 0;
+    BasicBlock *previousBlock = nullptr;
+    // errs() << "SCCs for Function " << F.getName() << " in PostOrder:";
+    for (scc_iterator<Function *> SCCI = scc_begin(&F); !SCCI.isAtEnd();
+         ++SCCI) {
+      const std::vector<BasicBlock *> &nextSCC = *SCCI;
+      ++sccNum;
+      std::size_t previous = -1;
 	//dbgs()<<"SCC group-----\n";
-        for (std::vector<BasicBlock *>::const_iterator I = nextSCC.begin(),
-                                                       E = nextSCC.end();
-             I != E; ++I) {
-          size_t current = getUniqueBlockName((*I), &F);
+      for (std::vector<BasicBlock *>::const_iterator I = nextSCC.begin(),
+                                                     E = nextSCC.end();
+           I != E; ++I) {
+        size_t current = getUniqueBlockName((*I), &F);
 	  //dbgs()<<current<<", ";
-          bool relationAdded = false;
-          if (previous != -1) {
-            blockSCCRelationIds.push_back(make_pair(current, previous));
-            relationAdded = true;
-          } else if (previousBlock != nullptr) {
-            // first bb should be connected to the previous function by scc
-            size_t bbIdPreviousFunc =
-                getUniqueBlockName(previousBlock, previousBlock->getParent());
-            blockSCCRelationIds.push_back(make_pair(bbIdPreviousFunc, current));
-            relationAdded = true;
-          }
-          // now that there is scc relation, the block is not relationless
-          // thus we remove it from soloBlocks vector
-          if (relationAdded && std::find(soloBlocks.begin(), soloBlocks.end(),
-                                         current) != soloBlocks.end()) {
-            soloBlocks.erase(
-                std::remove(soloBlocks.begin(), soloBlocks.end(), current),
-                soloBlocks.end());
-          }
-          previous = current;
+        bool relationAdded = false;
+        if (previous != -1) {
+          blockSCCRelationIds.push_back(make_pair(current, previous));
+          relationAdded = true;
+        } else if (previousBlock != nullptr) {
+          // first bb should be connected to the previous function by scc
+          size_t bbIdPreviousFunc =
+              getUniqueBlockName(previousBlock, previousBlock->getParent());
+          blockSCCRelationIds.push_back(make_pair(bbIdPreviousFunc, current));
+          relationAdded = true;
         }
-	//dbgs()<<"--------\n";
-        previousBlock = (*nextSCC.begin());
+        // now that there is scc relation, the block is not relationless
+        // thus we remove it from soloBlocks vector
+        if (relationAdded && std::find(soloBlocks.begin(), soloBlocks.end(),
+                                       current) != soloBlocks.end()) {
+          soloBlocks.erase(
+              std::remove(soloBlocks.begin(), soloBlocks.end(), current),
+              soloBlocks.end());
+        }
+        previous = current;
       }
+	//dbgs()<<"--------\n";
+      previousBlock = (*nextSCC.begin());
     }
-
+  }
+  bool finishExport(CSVExport &csv, llvm::Module &M) {
+    FILE *blockfile = csv.blockfile;
+    FILE *blockrelfile = csv.blockrelfile;
+    auto &blockFeatures = csv.blockFeatures;
+    auto &blockSCCRelationIds = csv.blockSCCRelationIds;
+    auto &blockCFGRelationIds = csv.blockCFGRelationIds;
+    auto &blockSVFRelationIds = csv.blockSVFRelationIds;
+    auto &soloBlocks = csv.soloBlocks;
     std::sort(blockSCCRelationIds.begin(),blockSCCRelationIds.end());
     blockSCCRelationIds.erase(std::unique(blockSCCRelationIds.begin(),blockSCCRelationIds.end()),blockSCCRelationIds.end());
 
@@ -329,6 +412,10 @@ public:
     // blockfile.close();
     fclose(blockrelfile);
     fclose(blockfile);
+    if (csv.svfg && csv.ptaCacheEntry) {
+      csv.ptaCacheEntry->setHasBlockFeatures(true);
+      csv.ptaCacheEntry->save();
+    }
 
     llvm::dbgs() << "badblocks:" << badBlocks.size() << "\n";
     return false;
@@ -888,3 +975,74 @@ public:
 char PDGCSV::ID = 0;
 static llvm::RegisterPass<PDGCSV>
     X("pdg-csv", "Traverse SVFG graph and print information in CSV");
+
+namespace pdg {
+
+PDGCSVPass::PDGCSVPass()
+    : PDGCSVPass(RelationsFile, BlocksFile, Append) {}
+
+PDGCSVPass::PDGCSVPass(const std::string &relationsFile,
+                       const std::string &blocksFile, bool append)
+    : m_relationsFile(relationsFile), m_blocksFile(blocksFile),
+      m_append(append), m_useSVF(true), m_streaming(Stream) {}
+
+void PDGCSVPass::setOutputDirectory(const std::string &directory) {
+  auto rebase = [&directory](std::string &file) {
+    if (file.empty() || llvm::sys::path::is_absolute(file)) {
+      return;
+    }
+    llvm::SmallString<256> path(directory);
+    llvm::sys::path::append(path, file);
+    file = path.str();
+  };
+  rebase(m_relationsFile);
+  rebase(m_blocksFile);
+}
+
+llvm::PreservedAnalyses PDGCSVPass::run(llvm::Module &M,
+                                        llvm::ModuleAnalysisManager &MAM) {
+  ::PDGCSV exporter;
+  const std::string relationsFile = m_relationsFile + m_partialOutputSuffix;
+  const std::string blocksFile = m_blocksFile + m_partialOutputSuffix;
+  const bool append = m_append && m_partialOutputSuffix.empty();
+  if (m_streaming) {
+    return runStreaming(M, MAM, exporter, relationsFile, blocksFile, append);
+  }
+  if (!m_useSVF) {
+    auto &result = MAM.getResult<MemorySSAPDGAnalysis>(M);
+    exporter.exportModule(M, result.pdg, nullptr, nullptr, relationsFile,
+                          blocksFile, append);
+    return llvm::PreservedAnalyses::all();
+  }
+  auto &result = MAM.getResult<PDGAnalysis>(M);
+  auto *ptaCacheEntry = result.ptaCacheEntry.get();
+  SVFG *svfg = exporter.hasCachedFeatures(ptaCacheEntry)
+                   ? nullptr
+                   : exporter.buildSVFG(M);
+  exporter.exportModule(M, result.pdg, svfg, ptaCacheEntry, relationsFile,
+                        blocksFile, append);
+  return llvm::PreservedAnalyses::all();
+}
+
+llvm::PreservedAnalyses PDGCSVPass::runStreaming(
+    llvm::Module &M, llvm::ModuleAnalysisManager &MAM, ::PDGCSV &exporter,
+    const std::string &relationsFile, const std::string &blocksFile,
+    bool append) {
+  // The cache entry comes with the PDG, after the functions were exported,
+  // so the SVF based features are always computed from a fresh SVFG
+  SVFG *svfg = m_useSVF ? exporter.buildSVFG(M) : nullptr;
+  ::PDGCSV::CSVExport csv;
+  exporter.beginExport(csv, svfg, nullptr, relationsFile, blocksFile,
+                       append);
+  auto consumer = [&exporter, &csv](llvm::Function *F,
+                                    std::shared_ptr<FunctionPDG> fpdg) {
+    exporter.exportFunction(csv, *F, fpdg);
+  };
+  // the streamed PDG is not cached as an analysis result, only its
+  // interprocedural nodes are left
+  streamPDG(M, MAM, consumer, m_useSVF);
+  exporter.finishExport(csv, M);
+  return llvm::PreservedAnalyses::all();
+}
+
+} // namespace pdg
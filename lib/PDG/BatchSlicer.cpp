@@ -0,0 +1,149 @@
+#include "PDG/BatchSlicer.h"
+
+#include <algorithm>
+#include <deque>
+
+namespace pdg {
+
+BatchSlice::BatchSlice(unsigned numCriteria, unsigned maskWords)
+    : m_numCriteria(numCriteria)
+    , m_maskWords(maskWords)
+{
+}
+
+bool BatchSlice::contains(unsigned criterion, FrozenPDG::NodeId node) const
+{
+    if (criterion >= m_numCriteria) {
+        return false;
+    }
+    auto pos = std::lower_bound(m_nodes.begin(), m_nodes.end(), node);
+    if (pos == m_nodes.end() || *pos != node) {
+        return false;
+    }
+    return hasBit(pos - m_nodes.begin(), criterion);
+}
+
+Slice BatchSlice::getSlice(unsigned criterion) const
+{
+    std::vector<FrozenPDG::NodeId> nodes;
+    for (unsigned i = 0; criterion < m_numCriteria && i < m_nodes.size(); ++i) {
+        if (hasBit(i, criterion)) {
+            nodes.push_back(m_nodes[i]);
+        }
+    }
+    return Slice(std::move(nodes), true);
+}
+
+BatchSlicer::BatchSlicer(const FrozenPDG& pdg, unsigned maskWords)
+    : m_pdg(pdg)
+    , m_maskWords(std::max(maskWords, 1u))
+    , m_masks(static_cast<uint64_t>(pdg.getNumNodes()) * m_maskWords)
+    , m_pending(m_masks.size())
+    , m_queued(pdg.getNumNodes())
+{
+}
+
+BatchSlice BatchSlicer::sliceBatch(llvm::ArrayRef<FrozenPDG::NodeId> criteria, const SliceOptions& options)
+{
+    const unsigned numCriteria = std::min<size_t>(criteria.size(), getBatchSize());
+    const unsigned W = m_maskWords;
+    const bool backward = options.direction == SliceDirection::Backward;
+    std::vector<FrozenPDG::NodeId> reached;
+    std::deque<FrozenPDG::NodeId> worklist;
+    auto isEmpty = [W] (const uint64_t* mask) {
+        return std::all_of(mask, mask + W, [] (uint64_t word) { return word == 0; });
+    };
+    auto enqueue = [&] (FrozenPDG::NodeId node) {
+        if (!m_queued.test(node)) {
+            m_queued.set(node);
+            worklist.push_back(node);
+        }
+    };
+    for (unsigned i = 0; i < numCriteria; ++i) {
+        const auto node = criteria[i];
+        if (node >= m_pdg.getNumNodes()) {
+            continue;
+        }
+        uint64_t* mask = getMask(node);
+        if (isEmpty(mask)) {
+            reached.push_back(node);
+        }
+        mask[i / 64] |= uint64_t(1) << (i % 64);
+        getPending(node)[i / 64] |= uint64_t(1) << (i % 64);
+        enqueue(node);
+    }
+
+    std::vector<uint64_t> delta(W);
+    while (!worklist.empty()) {
+        const auto node = worklist.front();
+        worklist.pop_front();
+        m_queued.reset(node);
+        uint64_t* pending = getPending(node);
+        std::copy(pending, pending + W, delta.begin());
+        std::fill(pending, pending + W, 0);
+        const auto function = m_pdg.getFunction(node);
+        for (const auto& edge : backward ? m_pdg.getInEdges(node) : m_pdg.getOutEdges(node)) {
+            if (!isFollowed(options.edges, edge)) {
+                continue;
+            }
+            if (!options.interprocedural && m_pdg.getFunction(edge.node) != function) {
+                continue;
+            }
+            uint64_t* mask = getMask(edge.node);
+            uint64_t* neighbourPending = getPending(edge.node);
+            const bool wasEmpty = isEmpty(mask);
+            uint64_t changed = 0;
+            for (unsigned w = 0; w < W; ++w) {
+                const uint64_t bits = delta[w] & ~mask[w];
+                mask[w] |= bits;
+                neighbourPending[w] |= bits;
+                changed |= bits;
+            }
+            if (changed == 0) {
+                continue;
+            }
+            if (wasEmpty) {
+                reached.push_back(edge.node);
+            }
+            enqueue(edge.node);
+        }
+    }
+
+    BatchSlice result(numCriteria, W);
+    std::sort(reached.begin(), reached.end());
+    result.m_nodes = reached;
+    result.m_masks.reserve(reached.size() * W);
+    for (auto node : reached) {
+        uint64_t* mask = getMask(node);
+        result.m_masks.insert(result.m_masks.end(), mask, mask + W);
+        std::fill(mask, mask + W, 0);
+    }
+    return result;
+}
+
+std::vector<Slice> BatchSlicer::slice(llvm::ArrayRef<FrozenPDG::NodeId> criteria, const SliceOptions& options)
+{
+    std::vector<std::vector<FrozenPDG::NodeId>> nodes(criteria.size());
+    for (size_t first = 0; first < criteria.size(); first += getBatchSize()) {
+        auto batch = criteria.slice(first, std::min<size_t>(getBatchSize(), criteria.size() - first));
+        const BatchSlice batchSlice = sliceBatch(batch, options);
+        // one pass over the reached nodes splits the batch into its slices
+        const auto& reached = batchSlice.getReachedNodes();
+        for (unsigned i = 0; i < reached.size(); ++i) {
+            for (unsigned w = 0; w < m_maskWords; ++w) {
+                for (uint64_t bits = batchSlice.m_masks[i * m_maskWords + w]; bits != 0; bits &= bits - 1) {
+                    nodes[first + w * 64 + __builtin_ctzll(bits)].push_back(reached[i]);
+                }
+            }
+        }
+    }
+    std::vector<Slice> slices;
+    slices.reserve(criteria.size());
+    for (auto& sliceNodes : nodes) {
+        slices.emplace_back(std::move(sliceNodes), true);
+    }
+    return slices;
+}
+
+} // namespace pdg
+
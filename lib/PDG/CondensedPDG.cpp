@@ -0,0 +1,221 @@
+#include "PDG/CondensedPDG.h"
+
+#include "PDG/ReachabilityIndex.h"
+
+#include <algorithm>
+#include <numeric>
+#include <utility>
+
+namespace pdg {
+
+namespace {
+
+using EdgeList = std::vector<std::pair<uint32_t, uint32_t>>;
+
+void buildRows(uint32_t numKeys, EdgeList& edges, std::vector<uint64_t>& offsets, std::vector<uint32_t>& values)
+{
+    std::sort(edges.begin(), edges.end());
+    edges.erase(std::unique(edges.begin(), edges.end()), edges.end());
+    offsets.assign(numKeys + 1, 0);
+    values.clear();
+    values.reserve(edges.size());
+    for (const auto& edge : edges) {
+        ++offsets[edge.first + 1];
+        values.push_back(edge.second);
+    }
+    std::partial_sum(offsets.begin(), offsets.end(), offsets.begin());
+}
+
+} // unnamed namespace
+
+CondensedPDG::CondensedPDG(const FrozenPDG& pdg, unsigned edges)
+    : m_pdg(pdg)
+    , m_edges(edges)
+    , m_numComponents(0)
+{
+    std::vector<ReachabilityIndex::ComponentId> components;
+    m_numComponents = ReachabilityIndex::findComponents(pdg, edges, components);
+    EdgeList dagEdges;
+    for (NodeId node = 0; node < pdg.getNumNodes(); ++node) {
+        for (const auto& edge : pdg.getOutEdges(node)) {
+            if (isFollowed(edges, edge) && components[edge.node] != components[node]) {
+                dagEdges.push_back(std::make_pair(components[node], components[edge.node]));
+            }
+        }
+    }
+    std::sort(dagEdges.begin(), dagEdges.end());
+    dagEdges.erase(std::unique(dagEdges.begin(), dagEdges.end()), dagEdges.end());
+    std::vector<uint32_t> outDegrees(m_numComponents);
+    std::vector<uint32_t> inDegrees(m_numComponents);
+    std::vector<uint32_t> successors(m_numComponents);
+    for (const auto& edge : dagEdges) {
+        ++outDegrees[edge.first];
+        ++inDegrees[edge.second];
+        successors[edge.first] = edge.second;
+    }
+
+    // successors have lower numbers, so a chain is numbered from its end
+    std::vector<CondensedId> componentNodes(m_numComponents);
+    std::vector<uint32_t> componentDepths(m_numComponents);
+    CondensedId numNodes = 0;
+    for (uint32_t component = 0; component < m_numComponents; ++component) {
+        const uint32_t successor = successors[component];
+        if (outDegrees[component] == 1 && inDegrees[successor] == 1) {
+            componentNodes[component] = componentNodes[successor];
+            componentDepths[component] = componentDepths[successor] + 1;
+        } else {
+            componentNodes[component] = numNodes++;
+            componentDepths[component] = 0;
+        }
+    }
+
+    EdgeList condensedEdges;
+    for (const auto& edge : dagEdges) {
+        const CondensedId source = componentNodes[edge.first];
+        const CondensedId dest = componentNodes[edge.second];
+        if (source != dest) {
+            condensedEdges.push_back(std::make_pair(source, dest));
+        }
+    }
+    EdgeList().swap(dagEdges);
+    buildRows(numNodes, condensedEdges, m_successorOffsets, m_successors);
+    for (auto& edge : condensedEdges) {
+        std::swap(edge.first, edge.second);
+    }
+    buildRows(numNodes, condensedEdges, m_predecessorOffsets, m_predecessors);
+
+    m_condensed.resize(pdg.getNumNodes());
+    m_depths.resize(pdg.getNumNodes());
+    m_memberOffsets.assign(numNodes + 1, 0);
+    for (NodeId node = 0; node < pdg.getNumNodes(); ++node) {
+        m_condensed[node] = componentNodes[components[node]];
+        m_depths[node] = componentDepths[components[node]];
+        ++m_memberOffsets[m_condensed[node] + 1];
+    }
+    std::partial_sum(m_memberOffsets.begin(), m_memberOffsets.end(), m_memberOffsets.begin());
+    m_members.resize(pdg.getNumNodes());
+    std::vector<uint64_t> next(m_memberOffsets.begin(), m_memberOffsets.end() - 1);
+    for (NodeId node = 0; node < pdg.getNumNodes(); ++node) {
+        m_members[next[m_condensed[node]]++] = node;
+    }
+    // members are in id order already, stable sorting keeps it within a depth
+    for (CondensedId node = 0; node < numNodes; ++node) {
+        if (m_memberOffsets[node + 1] - m_memberOffsets[node] > 1) {
+            std::stable_sort(m_members.begin() + m_memberOffsets[node], m_members.begin() + m_memberOffsets[node + 1],
+                             [this] (NodeId lhs, NodeId rhs) { return m_depths[lhs] < m_depths[rhs]; });
+        }
+    }
+}
+
+uint64_t CondensedPDG::getMemoryUsage() const
+{
+    return m_condensed.capacity() * sizeof(CondensedId)
+        + m_depths.capacity() * sizeof(uint32_t)
+        + m_memberOffsets.capacity() * sizeof(uint64_t)
+        + m_members.capacity() * sizeof(NodeId)
+        + m_successorOffsets.capacity() * sizeof(uint64_t)
+        + m_successors.capacity() * sizeof(CondensedId)
+        + m_predecessorOffsets.capacity() * sizeof(uint64_t)
+        + m_predecessors.capacity() * sizeof(CondensedId);
+}
+
+CondensedSlicer::CondensedSlicer(const CondensedPDG& graph)
+    : m_graph(graph)
+    , m_visited(graph.getNumNodes())
+{
+}
+
+bool CondensedSlicer::reaches(FrozenPDG::NodeId source, FrozenPDG::NodeId dest)
+{
+    const auto sourceNode = m_graph.getCondensedNode(source);
+    const auto destNode = m_graph.getCondensedNode(dest);
+    if (sourceNode == destNode) {
+        return m_graph.getDepth(source) >= m_graph.getDepth(dest);
+    }
+    // condensed edges lead to lower numbers only
+    if (sourceNode < destNode) {
+        return false;
+    }
+    bool reached = false;
+    m_visited.set(sourceNode);
+    m_reached.push_back(sourceNode);
+    for (size_t i = 0; i < m_reached.size() && !reached; ++i) {
+        for (auto successor : m_graph.getSuccessors(m_reached[i])) {
+            if (successor == destNode) {
+                reached = true;
+                break;
+            }
+            if (successor > destNode && !m_visited.test(successor)) {
+                m_visited.set(successor);
+                m_reached.push_back(successor);
+            }
+        }
+    }
+    clear();
+    return reached;
+}
+
+Slice CondensedSlicer::slice(llvm::ArrayRef<FrozenPDG::NodeId> criteria, SliceDirection direction)
+{
+    const bool forward = direction == SliceDirection::Forward;
+    // the condensed nodes of the criteria are reached from the criterion on,
+    // i.e. down to depth 0 forward and up to the start of the chain backward
+    std::vector<std::pair<CondensedPDG::CondensedId, uint32_t>> partial;
+    for (auto criterion : criteria) {
+        partial.push_back(std::make_pair(m_graph.getCondensedNode(criterion), m_graph.getDepth(criterion)));
+    }
+    auto expand = [&] (CondensedPDG::CondensedId node) {
+        for (auto next : forward ? m_graph.getSuccessors(node) : m_graph.getPredecessors(node)) {
+            if (!m_visited.test(next)) {
+                m_visited.set(next);
+                m_reached.push_back(next);
+            }
+        }
+    };
+    for (const auto& start : partial) {
+        expand(start.first);
+    }
+    for (size_t i = 0; i < m_reached.size(); ++i) {
+        expand(m_reached[i]);
+    }
+
+    std::vector<FrozenPDG::NodeId> nodes;
+    for (auto node : m_reached) {
+        const auto members = m_graph.getMembers(node);
+        nodes.insert(nodes.end(), members.begin(), members.end());
+    }
+    // of several criteria in one condensed node the deepest covers the
+    // others forward and the shallowest backward
+    std::sort(partial.begin(), partial.end());
+    for (size_t i = 0; i < partial.size(); ++i) {
+        const auto node = partial[i].first;
+        if (m_visited.test(node)
+                || (i + 1 < partial.size() && partial[i + 1].first == node && forward)
+                || (i != 0 && partial[i - 1].first == node && !forward)) {
+            continue;
+        }
+        const auto members = m_graph.getMembers(node);
+        const uint32_t depth = partial[i].second;
+        auto boundary = std::partition_point(members.begin(), members.end(), [&] (FrozenPDG::NodeId member) {
+            return forward ? m_graph.getDepth(member) <= depth : m_graph.getDepth(member) < depth;
+        });
+        if (forward) {
+            nodes.insert(nodes.end(), members.begin(), boundary);
+        } else {
+            nodes.insert(nodes.end(), boundary, members.end());
+        }
+    }
+    clear();
+    return Slice(std::move(nodes), true);
+}
+
+void CondensedSlicer::clear()
+{
+    for (auto node : m_reached) {
+        m_visited.reset(node);
+    }
+    m_reached.clear();
+}
+
+} // namespace pdg
+
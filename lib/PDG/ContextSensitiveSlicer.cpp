@@ -0,0 +1,239 @@
+#include "PDG/ContextSensitiveSlicer.h"
+
+#include "PDG/PDGLLVMNode.h"
+
+namespace pdg {
+
+namespace {
+
+bool isFormalArgument(unsigned type)
+{
+    return type == PDGLLVMNode::FormalArgumentNode || type == PDGLLVMNode::VaArgumentNode;
+}
+
+} // unnamed namespace
+
+ContextSensitiveSlicer::ContextSensitiveSlicer(const FrozenPDG& pdg)
+    : m_pdg(pdg)
+    , m_visited(pdg.getNumNodes())
+    , m_numEvaluations(0)
+{
+}
+
+Slice ContextSensitiveSlicer::slice(llvm::ArrayRef<NodeId> criteria, SliceDirection direction, unsigned edges)
+{
+    const llvm::BitVector& summaries = getSummaries(edges);
+    const bool backward = direction == SliceDirection::Backward;
+    // the first phase does not descend into callees, the second does not ascend to callers
+    const EdgeClass skipped[] = {backward ? EdgeClass::Return : EdgeClass::Call,
+                                 backward ? EdgeClass::Call : EdgeClass::Return};
+    std::vector<NodeId> nodes;
+    auto reach = [&] (NodeId node) {
+        if (!m_visited.test(node)) {
+            m_visited.set(node);
+            nodes.push_back(node);
+        }
+    };
+    for (auto criterion : criteria) {
+        if (criterion < m_pdg.getNumNodes()) {
+            reach(criterion);
+        }
+    }
+    for (auto phaseSkipped : skipped) {
+        // the second phase starts over from every node of the first
+        for (size_t i = 0; i < nodes.size(); ++i) {
+            const auto node = nodes[i];
+            for (const auto& edge : backward ? m_pdg.getInEdges(node) : m_pdg.getOutEdges(node)) {
+                if (!isFollowed(edges, edge) || m_visited.test(edge.node)) {
+                    continue;
+                }
+                const NodeId source = backward ? edge.node : node;
+                const NodeId dest = backward ? node : edge.node;
+                const EdgeClass edgeClass = classify(source, dest, edge);
+                if (edgeClass == phaseSkipped
+                        || (edgeClass == EdgeClass::Local && !isSummarized(source, dest, edge, summaries))) {
+                    continue;
+                }
+                reach(edge.node);
+            }
+        }
+    }
+    for (auto node : nodes) {
+        m_visited.reset(node);
+    }
+    return Slice(std::move(nodes), true);
+}
+
+Slice ContextSensitiveSlicer::backwardSlice(llvm::ArrayRef<NodeId> criteria, unsigned edges)
+{
+    return slice(criteria, SliceDirection::Backward, edges);
+}
+
+Slice ContextSensitiveSlicer::forwardSlice(llvm::ArrayRef<NodeId> criteria, unsigned edges)
+{
+    return slice(criteria, SliceDirection::Forward, edges);
+}
+
+bool ContextSensitiveSlicer::reachesResult(NodeId formal, unsigned edges)
+{
+    return getSummaries(edges).test(formal);
+}
+
+ContextSensitiveSlicer::EdgeClass
+ContextSensitiveSlicer::classify(NodeId source, NodeId dest, const FrozenPDG::Edge& edge) const
+{
+    const unsigned sourceType = m_pdg.getNodeType(source);
+    const unsigned destType = m_pdg.getNodeType(dest);
+    if (edge.getKind() == SerializedPDG::EdgeKind::Control) {
+        return destType == PDGLLVMNode::FunctionNode ? EdgeClass::Call : EdgeClass::Local;
+    }
+    if (edge.getKind() != SerializedPDG::EdgeKind::Data) {
+        return EdgeClass::Local;
+    }
+    if (sourceType == PDGLLVMNode::ActualArgumentNode && isFormalArgument(destType)) {
+        return EdgeClass::Call;
+    }
+    if (sourceType == PDGLLVMNode::FunctionNode) {
+        // function nodes are also sources of the functions' addresses
+        for (const auto& callEdge : m_pdg.getOutEdges(dest)) {
+            if (callEdge.node == source && callEdge.getKind() == SerializedPDG::EdgeKind::Control) {
+                return EdgeClass::Return;
+            }
+        }
+    }
+    return EdgeClass::Local;
+}
+
+bool ContextSensitiveSlicer::isSummarized(NodeId source,
+                                          NodeId dest,
+                                          const FrozenPDG::Edge& edge,
+                                          const llvm::BitVector& summaries) const
+{
+    if (edge.getKind() != SerializedPDG::EdgeKind::Data
+            || m_pdg.getNodeType(source) != PDGLLVMNode::ActualArgumentNode
+            || m_pdg.getNodeType(dest) != PDGLLVMNode::InstructionNode) {
+        return true;
+    }
+    bool entersCallee = false;
+    for (const auto& paramEdge : m_pdg.getOutEdges(source)) {
+        if (paramEdge.getKind() != SerializedPDG::EdgeKind::Data || !isFormalArgument(m_pdg.getNodeType(paramEdge.node))) {
+            continue;
+        }
+        if (summaries.test(paramEdge.node)) {
+            return true;
+        }
+        entersCallee = true;
+    }
+    // arguments of unknown callees keep their edge
+    return !entersCallee;
+}
+
+const llvm::BitVector& ContextSensitiveSlicer::getSummaries(unsigned edges)
+{
+    auto pos = m_summaries.find(edges);
+    if (pos != m_summaries.end()) {
+        return pos->second;
+    }
+    llvm::BitVector& summaries = m_summaries[edges];
+    summaries.resize(m_pdg.getNumNodes());
+    tabulate(edges, summaries);
+    return summaries;
+}
+
+void ContextSensitiveSlicer::tabulate(unsigned edges, llvm::BitVector& summaries)
+{
+    const unsigned numFunctions = m_pdg.getNumFunctions();
+    std::vector<std::vector<NodeId>> returns(numFunctions);
+    std::vector<NodeId> functionNodes(numFunctions, FrozenPDG::InvalidNode);
+    for (NodeId node = 0; node < m_pdg.getNumNodes(); ++node) {
+        const FunctionId function = m_pdg.getFunction(node);
+        if (function == FrozenPDG::NoFunction) {
+            continue;
+        }
+        for (const auto& edge : m_pdg.getOutEdges(node)) {
+            if (edge.getKind() == SerializedPDG::EdgeKind::Data
+                    && isFollowed(edges, edge)
+                    && m_pdg.getNodeType(edge.node) == PDGLLVMNode::FunctionNode) {
+                returns[function].push_back(node);
+                functionNodes[function] = edge.node;
+                break;
+            }
+        }
+    }
+    // nothing is known of functions without returns, their formals may reach anything
+    for (NodeId node = 0; node < m_pdg.getNumNodes(); ++node) {
+        const FunctionId function = m_pdg.getFunction(node);
+        if (isFormalArgument(m_pdg.getNodeType(node)) && function != FrozenPDG::NoFunction
+                && returns[function].empty()) {
+            summaries.set(node);
+        }
+    }
+
+    std::vector<FunctionId> worklist;
+    llvm::BitVector queued(numFunctions);
+    for (FunctionId function = 0; function < numFunctions; ++function) {
+        if (!returns[function].empty()) {
+            worklist.push_back(function);
+            queued.set(function);
+        }
+    }
+    while (!worklist.empty()) {
+        const FunctionId function = worklist.back();
+        worklist.pop_back();
+        queued.reset(function);
+        if (!evaluate(function, returns[function], edges, summaries)) {
+            continue;
+        }
+        // new summaries of a function may add summary edges to its callers
+        for (const auto& edge : m_pdg.getInEdges(functionNodes[function])) {
+            if (edge.getKind() != SerializedPDG::EdgeKind::Control) {
+                continue;
+            }
+            const FunctionId caller = m_pdg.getFunction(edge.node);
+            if (caller != FrozenPDG::NoFunction && !returns[caller].empty() && !queued.test(caller)) {
+                worklist.push_back(caller);
+                queued.set(caller);
+            }
+        }
+    }
+}
+
+bool ContextSensitiveSlicer::evaluate(FunctionId function,
+                                      const std::vector<NodeId>& returns,
+                                      unsigned edges,
+                                      llvm::BitVector& summaries)
+{
+    ++m_numEvaluations;
+    std::vector<NodeId> nodes;
+    for (auto node : returns) {
+        m_visited.set(node);
+        nodes.push_back(node);
+    }
+    bool changed = false;
+    for (size_t i = 0; i < nodes.size(); ++i) {
+        const auto node = nodes[i];
+        for (const auto& edge : m_pdg.getInEdges(node)) {
+            if (!isFollowed(edges, edge) || m_visited.test(edge.node) || m_pdg.getFunction(edge.node) != function) {
+                continue;
+            }
+            // recursive calls stay in the function but are crossed by summary edges only
+            if (classify(edge.node, node, edge) != EdgeClass::Local
+                    || !isSummarized(edge.node, node, edge, summaries)) {
+                continue;
+            }
+            m_visited.set(edge.node);
+            nodes.push_back(edge.node);
+            if (isFormalArgument(m_pdg.getNodeType(edge.node)) && !summaries.test(edge.node)) {
+                summaries.set(edge.node);
+                changed = true;
+            }
+        }
+    }
+    for (auto node : nodes) {
+        m_visited.reset(node);
+    }
+    return changed;
+}
+
+} // namespace pdg
+
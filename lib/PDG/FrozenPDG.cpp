@@ -0,0 +1,322 @@
+#include "PDG/FrozenPDG.h"
+
+#include "PDG/FrozenPDGWriter.h"
+
+#include "llvm/ADT/SmallString.h"
+#include "llvm/Support/Path.h"
+#include "llvm/Support/raw_ostream.h"
+
+#include <fstream>
+#include <limits>
+#include <sstream>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace pdg {
+
+namespace {
+
+const char* FrozenFormat = "frozen-pdg 3";
+
+std::string getPath(const std::string& directory, const std::string& name)
+{
+    llvm::SmallString<256> path(directory);
+    llvm::sys::path::append(path, name);
+    return path.str().str();
+}
+
+bool readMeta(const std::string& directory,
+              unsigned& numNodes,
+              uint64_t& numEdges,
+              unsigned& numFunctions,
+              SerializedPDG::Modules& modules)
+{
+    std::ifstream meta(getPath(directory, "meta"));
+    std::string line;
+    if (!std::getline(meta, line) || line != FrozenFormat) {
+        return false;
+    }
+    std::string key;
+    if (!(meta >> key >> numNodes) || key != "nodes"
+            || !(meta >> key >> numEdges) || key != "edges"
+            || !(meta >> key >> numFunctions) || key != "functions") {
+        return false;
+    }
+    std::getline(meta, line);
+    while (std::getline(meta, line)) {
+        if (line.compare(0, 7, "module ") != 0) {
+            return false;
+        }
+        modules.push_back(line.substr(7));
+    }
+    return true;
+}
+
+/// Offsets of compressed sparse rows start at 0, never decrease and end at
+/// the number of values
+bool isValidOffsets(llvm::ArrayRef<uint64_t> offsets, uint64_t numValues)
+{
+    if (offsets.empty() || offsets.front() != 0 || offsets.back() != numValues) {
+        return false;
+    }
+    for (size_t i = 1; i < offsets.size(); ++i) {
+        if (offsets[i] < offsets[i - 1]) {
+            return false;
+        }
+    }
+    return true;
+}
+
+bool isValidNodeIds(llvm::ArrayRef<uint32_t> nodes, unsigned numNodes)
+{
+    for (auto node : nodes) {
+        if (node >= numNodes) {
+            return false;
+        }
+    }
+    return true;
+}
+
+} // unnamed namespace
+
+/// Read only mapping of a whole file, released with the frozen graph
+class FrozenPDG::MappedFile
+{
+public:
+    MappedFile()
+        : m_data(nullptr)
+        , m_size(0)
+    {
+    }
+
+    ~MappedFile()
+    {
+        if (m_data) {
+            munmap(m_data, m_size);
+        }
+    }
+
+    MappedFile(const MappedFile& ) = delete;
+    MappedFile& operator =(const MappedFile& ) = delete;
+
+    bool map(const std::string& path)
+    {
+        int fd = ::open(path.c_str(), O_RDONLY);
+        if (fd < 0) {
+            return false;
+        }
+        struct stat st;
+        bool success = fstat(fd, &st) == 0;
+        m_size = success ? st.st_size : 0;
+        // mmap rejects empty mappings, e.g. of a graph without edges
+        if (success && m_size != 0) {
+            m_data = mmap(nullptr, m_size, PROT_READ, MAP_SHARED, fd, 0);
+            if (m_data == MAP_FAILED) {
+                m_data = nullptr;
+                success = false;
+            }
+        }
+        close(fd);
+        return success;
+    }
+
+    const void* getData() const
+    {
+        return m_data;
+    }
+
+    size_t getSize() const
+    {
+        return m_size;
+    }
+
+private:
+    void* m_data;
+    size_t m_size;
+}; // class MappedFile
+
+FrozenPDG::FrozenPDG() = default;
+
+FrozenPDG::~FrozenPDG() = default;
+
+std::unique_ptr<FrozenPDG> FrozenPDG::open(const std::string& directory)
+{
+    std::unique_ptr<FrozenPDG> frozen(new FrozenPDG());
+    if (!frozen->map(directory)) {
+        llvm::errs() << directory << ": missing or malformed frozen PDG\n";
+        return nullptr;
+    }
+    return frozen;
+}
+
+std::unique_ptr<FrozenPDG> FrozenPDG::freeze(const PDG& pdg,
+                                             const std::string& moduleName,
+                                             const std::string& directory)
+{
+    std::vector<PDGNode*> nodes;
+    {
+        const auto serialized = SerializedPDG::fromPDG(pdg, moduleName, &nodes);
+        // the graph is in memory already, so is the copy being sorted
+        FrozenPDGWriter writer(directory, std::numeric_limits<uint64_t>::max());
+        writer.addModule(moduleName);
+        for (const auto& node : serialized.getNodes()) {
+            writer.addNode(node);
+        }
+        for (const auto& edge : serialized.getEdges()) {
+            writer.addEdge(edge.source, edge.dest, edge.kind);
+        }
+        if (!writer.finish()) {
+            return nullptr;
+        }
+    }
+    auto frozen = open(directory);
+    if (!frozen) {
+        return nullptr;
+    }
+    frozen->m_pdgNodes = std::move(nodes);
+    for (unsigned i = 0; i < frozen->m_pdgNodes.size(); ++i) {
+        frozen->m_pdgNodeIds.insert(std::make_pair(frozen->m_pdgNodes[i], i));
+    }
+    return frozen;
+}
+
+FrozenPDG::FunctionId FrozenPDG::findFunction(llvm::StringRef name) const
+{
+    auto pos = m_functionIds.find(name.str());
+    return pos == m_functionIds.end() ? NoFunction : pos->second;
+}
+
+llvm::ArrayRef<FrozenPDG::NodeId> FrozenPDG::getCallSites(llvm::StringRef callee) const
+{
+    auto pos = m_calleeKeys.find(callee.str());
+    return pos == m_calleeKeys.end() ? llvm::ArrayRef<NodeId>() : getIndexNodes(m_calleeIndex, pos->second);
+}
+
+llvm::ArrayRef<FrozenPDG::NodeId> FrozenPDG::getNodesWithLabel(llvm::StringRef label) const
+{
+    auto pos = m_labelKeys.find(label.str());
+    return pos == m_labelKeys.end() ? llvm::ArrayRef<NodeId>() : getIndexNodes(m_labelIndex, pos->second);
+}
+
+FrozenPDG::NodeId FrozenPDG::getNodeId(PDGNode* node) const
+{
+    auto pos = m_pdgNodeIds.find(node);
+    return pos == m_pdgNodeIds.end() ? InvalidNode : pos->second;
+}
+
+bool FrozenPDG::map(const std::string& directory)
+{
+    unsigned numNodes = 0;
+    uint64_t numEdges = 0;
+    unsigned numFunctions = 0;
+    if (!readMeta(directory, numNodes, numEdges, numFunctions, m_modules)) {
+        return false;
+    }
+    if (!mapArray(directory, "nodes", m_nodes)
+            || !mapArray(directory, "strings", m_strings)
+            || !mapArray(directory, "out.offsets", m_outOffsets)
+            || !mapArray(directory, "out.edges", m_outEdges)
+            || !mapArray(directory, "in.offsets", m_inOffsets)
+            || !mapArray(directory, "in.edges", m_inEdges)
+            || !mapArray(directory, "functions", m_functions)
+            || !mapArray(directory, "function.offsets", m_functionOffsets)
+            || !mapArray(directory, "function.nodes", m_functionNodes)) {
+        return false;
+    }
+    // accessors do not check bounds, so the array sizes are checked here
+    if (m_nodes.size() != numNodes || m_outEdges.size() != numEdges || m_inEdges.size() != numEdges
+            || m_functions.size() != numFunctions
+            || m_outOffsets.size() != numNodes + 1u || m_inOffsets.size() != numNodes + 1u
+            || m_functionOffsets.size() != numFunctions + 1u
+            || m_strings.empty() || m_strings.back() != '\0') {
+        return false;
+    }
+    if (!isValidOffsets(m_outOffsets, numEdges) || !isValidOffsets(m_inOffsets, numEdges)
+            || !isValidOffsets(m_functionOffsets, m_functionNodes.size())
+            || !isValidNodeIds(m_functionNodes, numNodes)
+            || !validateRecords()) {
+        return false;
+    }
+    // keys of the indexes point into the string pool
+    if (!mapIndex(directory, "type", m_typeIndex)
+            || !mapIndex(directory, "opcode", m_opcodeIndex)
+            || !mapKeyedIndex(directory, "callee", m_calleeIndex, m_calleeKeys)
+            || !mapKeyedIndex(directory, "label", m_labelIndex, m_labelKeys)) {
+        return false;
+    }
+    for (FunctionId function = 0; function < numFunctions; ++function) {
+        // local functions of several modules may share a name
+        m_functionIds.insert(std::make_pair(getFunctionName(function).str(), function));
+    }
+    return true;
+}
+
+bool FrozenPDG::validateRecords() const
+{
+    // strings end at the terminating null of the pool, so their offsets are
+    // all there is to check
+    const uint64_t numStrings = m_strings.size();
+    for (const auto& node : m_nodes) {
+        if (node.symbol >= numStrings || node.label >= numStrings || node.metadataLabel >= numStrings
+                || (node.function != NoFunction && node.function >= m_functions.size())
+                || node.module >= m_modules.size()) {
+            return false;
+        }
+    }
+    for (const auto& function : m_functions) {
+        if (function.name >= numStrings || function.module >= m_modules.size()) {
+            return false;
+        }
+    }
+    for (auto edges : {m_outEdges, m_inEdges}) {
+        for (const auto& edge : edges) {
+            if (edge.node >= m_nodes.size() || edge.kind > static_cast<uint32_t>(SerializedPDG::EdgeKind::Summary)) {
+                return false;
+            }
+        }
+    }
+    return true;
+}
+
+bool FrozenPDG::mapIndex(const std::string& directory, const std::string& name, NodeIndex& index)
+{
+    if (!mapArray(directory, name + ".offsets", index.offsets) || !mapArray(directory, name + ".nodes", index.nodes)) {
+        return false;
+    }
+    return isValidOffsets(index.offsets, index.nodes.size()) && isValidNodeIds(index.nodes, m_nodes.size());
+}
+
+bool FrozenPDG::mapKeyedIndex(const std::string& directory, const std::string& name, NodeIndex& index,
+                              std::unordered_map<std::string, uint32_t>& keys)
+{
+    llvm::ArrayRef<uint64_t> strings;
+    if (!mapIndex(directory, name, index) || !mapArray(directory, name + ".keys", strings)
+            || strings.size() + 1 != index.offsets.size()) {
+        return false;
+    }
+    for (uint32_t key = 0; key < strings.size(); ++key) {
+        if (strings[key] >= m_strings.size()) {
+            return false;
+        }
+        keys.insert(std::make_pair(getString(strings[key]).str(), key));
+    }
+    return true;
+}
+
+template <typename T>
+bool FrozenPDG::mapArray(const std::string& directory, const std::string& name, llvm::ArrayRef<T>& array)
+{
+    std::unique_ptr<MappedFile> file(new MappedFile());
+    if (!file->map(getPath(directory, name)) || file->getSize() % sizeof(T) != 0) {
+        return false;
+    }
+    array = llvm::ArrayRef<T>(static_cast<const T*>(file->getData()), file->getSize() / sizeof(T));
+    m_files.push_back(std::move(file));
+    return true;
+}
+
+} // namespace pdg
+
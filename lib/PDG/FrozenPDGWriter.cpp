@@ -0,0 +1,505 @@
+#include "PDG/FrozenPDGWriter.h"
+
+#include "PDG/PDGLLVMNode.h"
+
+#include "llvm/Support/FileSystem.h"
+#include "llvm/Support/Path.h"
+#include "llvm/Support/raw_ostream.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <functional>
+#include <queue>
+#include <tuple>
+#include <vector>
+
+#include <unistd.h>
+
+namespace pdg {
+
+namespace {
+
+const char* FrozenFormat = "frozen-pdg 3";
+
+/// Runs are read back in blocks of this many records
+const size_t RunBlockRecords = 1 << 16;
+/// Lower bound of the sort buffer of each sorter, in records
+const size_t MinSortRecords = 1 << 10;
+
+struct RunRecord
+{
+    uint32_t key;
+    uint32_t value;
+    uint32_t kind;
+
+    bool operator <(const RunRecord& other) const
+    {
+        return std::tie(key, value, kind) < std::tie(other.key, other.value, other.kind);
+    }
+
+    bool operator ==(const RunRecord& other) const
+    {
+        return key == other.key && value == other.value && kind == other.kind;
+    }
+};
+
+template <typename T>
+void writeValue(std::ofstream& out, const T& value)
+{
+    out.write(reinterpret_cast<const char*>(&value), sizeof(T));
+}
+
+class RunReader
+{
+public:
+    explicit RunReader(const std::string& path)
+        : m_in(path, std::ios::binary)
+        , m_pos(0)
+    {
+    }
+
+    bool isValid() const
+    {
+        return static_cast<bool>(m_in);
+    }
+
+    bool next(RunRecord& record)
+    {
+        if (m_pos == m_block.size() && !readBlock()) {
+            return false;
+        }
+        record = m_block[m_pos++];
+        return true;
+    }
+
+private:
+    bool readBlock()
+    {
+        m_block.resize(RunBlockRecords);
+        m_in.read(reinterpret_cast<char*>(m_block.data()), RunBlockRecords * sizeof(RunRecord));
+        m_block.resize(m_in.gcount() / sizeof(RunRecord));
+        m_pos = 0;
+        return !m_block.empty();
+    }
+
+private:
+    std::ifstream m_in;
+    std::vector<RunRecord> m_block;
+    size_t m_pos;
+}; // class RunReader
+
+/// Empty directories and earlier frozen graphs may be replaced by a new graph
+bool isReplaceable(const std::string& directory)
+{
+    llvm::SmallString<256> meta(directory);
+    llvm::sys::path::append(meta, "meta");
+    if (llvm::sys::fs::exists(meta)) {
+        return true;
+    }
+    std::error_code EC;
+    llvm::sys::fs::directory_iterator entry(directory, EC);
+    return !EC && entry == llvm::sys::fs::directory_iterator();
+}
+
+} // unnamed namespace
+
+/// External merge sort of (key, value, kind) records into compressed sparse
+/// rows: an offsets array with one entry per key plus one, and the values of
+/// each key in ascending order, with their kinds if requested
+class FrozenPDGWriter::RunSorter
+{
+public:
+    RunSorter(const std::string& runPrefix, size_t maxRecords)
+        : m_runPrefix(runPrefix)
+        , m_maxRecords(std::max(maxRecords, MinSortRecords))
+        , m_numValues(0)
+    {
+    }
+
+    ~RunSorter()
+    {
+        removeRuns();
+    }
+
+    bool add(uint32_t key, uint32_t value, uint32_t kind)
+    {
+        m_buffer.push_back(RunRecord{key, value, kind});
+        if (m_buffer.size() < m_maxRecords) {
+            return true;
+        }
+        return spill();
+    }
+
+    /// Duplicate records are written once. Fails if a key or a value is not
+    /// below its limit.
+    bool write(uint32_t numKeys, uint32_t valueLimit, bool withKinds,
+               const std::string& offsetsFile, const std::string& valuesFile)
+    {
+        std::ofstream offsets(offsetsFile, std::ios::binary);
+        std::ofstream values(valuesFile, std::ios::binary);
+        if (!offsets || !values) {
+            llvm::errs() << "Could not write " << offsetsFile << " or " << valuesFile << "\n";
+            return false;
+        }
+        uint64_t count = 0;
+        uint32_t nextKey = 0;
+        bool hasPrevious = false;
+        bool valid = true;
+        RunRecord previous{0, 0, 0};
+        auto emit = [&] (const RunRecord& record) {
+            if (hasPrevious && record == previous) {
+                return;
+            }
+            if (record.key >= numKeys || record.value >= valueLimit) {
+                valid = false;
+                return;
+            }
+            for (; nextKey <= record.key; ++nextKey) {
+                writeValue(offsets, count);
+            }
+            writeValue(values, record.value);
+            if (withKinds) {
+                writeValue(values, record.kind);
+            }
+            ++count;
+            previous = record;
+            hasPrevious = true;
+        };
+        if (m_runs.empty()) {
+            // everything fit into the buffer
+            std::sort(m_buffer.begin(), m_buffer.end());
+            std::for_each(m_buffer.begin(), m_buffer.end(), emit);
+        } else if (!spill() || !merge(emit)) {
+            return false;
+        }
+        for (; nextKey <= numKeys; ++nextKey) {
+            writeValue(offsets, count);
+        }
+        m_buffer.clear();
+        m_buffer.shrink_to_fit();
+        removeRuns();
+        m_numValues = count;
+        if (!valid) {
+            llvm::errs() << "Edge between unknown nodes\n";
+            return false;
+        }
+        if (!offsets || !values) {
+            llvm::errs() << "Could not write " << offsetsFile << " or " << valuesFile << "\n";
+            return false;
+        }
+        return true;
+    }
+
+    uint64_t getNumValues() const
+    {
+        return m_numValues;
+    }
+
+private:
+    bool spill()
+    {
+        if (m_buffer.empty()) {
+            return true;
+        }
+        std::sort(m_buffer.begin(), m_buffer.end());
+        const std::string run = m_runPrefix + std::to_string(m_runs.size());
+        std::ofstream out(run, std::ios::binary);
+        out.write(reinterpret_cast<const char*>(m_buffer.data()), m_buffer.size() * sizeof(RunRecord));
+        m_runs.push_back(run);
+        if (!out) {
+            llvm::errs() << "Could not write edge run " << run << "\n";
+            return false;
+        }
+        m_buffer.clear();
+        return true;
+    }
+
+    bool merge(const std::function<void (const RunRecord&)>& emit)
+    {
+        std::vector<std::unique_ptr<RunReader>> readers;
+        using HeapEntry = std::pair<RunRecord, unsigned>;
+        auto greater = [] (const HeapEntry& lhs, const HeapEntry& rhs) {
+            return rhs.first < lhs.first;
+        };
+        std::priority_queue<HeapEntry, std::vector<HeapEntry>, decltype(greater)> heap(greater);
+        for (const auto& run : m_runs) {
+            readers.emplace_back(new RunReader(run));
+            if (!readers.back()->isValid()) {
+                llvm::errs() << "Could not read edge run " << run << "\n";
+                return false;
+            }
+            RunRecord record;
+            if (readers.back()->next(record)) {
+                heap.push(HeapEntry(record, readers.size() - 1));
+            }
+        }
+        while (!heap.empty()) {
+            const HeapEntry top = heap.top();
+            heap.pop();
+            emit(top.first);
+            RunRecord record;
+            if (readers[top.second]->next(record)) {
+                heap.push(HeapEntry(record, top.second));
+            }
+        }
+        return true;
+    }
+
+    void removeRuns()
+    {
+        for (const auto& run : m_runs) {
+            std::remove(run.c_str());
+        }
+        m_runs.clear();
+    }
+
+private:
+    const std::string m_runPrefix;
+    const size_t m_maxRecords;
+    std::vector<RunRecord> m_buffer;
+    std::vector<std::string> m_runs;
+    uint64_t m_numValues;
+}; // class RunSorter
+
+FrozenPDGWriter::FrozenPDGWriter(const std::string& directory, uint64_t memoryBudget)
+    : m_directory(directory)
+    , m_workDirectory(directory + ".tmp." + std::to_string(getpid()))
+    , m_failed(false)
+    , m_stringsSize(0)
+    , m_numNodes(0)
+    , m_numTypes(0)
+    , m_numOpcodes(0)
+{
+    // left over by a writer of the same pid that did not finish
+    llvm::sys::fs::remove_directories(m_workDirectory);
+    if (auto EC = llvm::sys::fs::create_directories(m_workDirectory)) {
+        llvm::errs() << "Could not create " << m_workDirectory << ": " << EC.message() << "\n";
+        m_failed = true;
+    }
+    m_nodesFile.open(getPath("nodes"), std::ios::binary);
+    m_stringsFile.open(getPath("strings"), std::ios::binary);
+    m_functionsFile.open(getPath("functions"), std::ios::binary);
+    if (!m_nodesFile || !m_stringsFile || !m_functionsFile) {
+        llvm::errs() << "Could not write frozen PDG into " << directory << "\n";
+        m_failed = true;
+    }
+    // offset 0 is the empty string
+    m_stringsFile.put('\0');
+    m_stringsSize = 1;
+    // every edge is recorded in both directions, and nodes share the rest
+    // among their function and index lists
+    const size_t sortRecords = memoryBudget / 3 / sizeof(RunRecord);
+    m_outEdges.reset(new RunSorter(getPath("run.out."), sortRecords));
+    m_inEdges.reset(new RunSorter(getPath("run.in."), sortRecords));
+    m_functionNodes.reset(new RunSorter(getPath("run.functions."), sortRecords / 5));
+    m_typeNodes.reset(new RunSorter(getPath("run.types."), sortRecords / 5));
+    m_opcodeNodes.reset(new RunSorter(getPath("run.opcodes."), sortRecords / 5));
+    m_calleeNodes.reset(new RunSorter(getPath("run.callees."), sortRecords / 5));
+    m_labelNodes.reset(new RunSorter(getPath("run.labels."), sortRecords / 5));
+}
+
+FrozenPDGWriter::~FrozenPDGWriter()
+{
+    // gone once finish published it
+    llvm::sys::fs::remove_directories(m_workDirectory);
+}
+
+unsigned FrozenPDGWriter::addModule(const std::string& moduleName)
+{
+    m_modules.push_back(moduleName);
+    return m_modules.size() - 1;
+}
+
+FrozenPDGWriter::NodeId FrozenPDGWriter::addNode(const SerializedPDG::Node& node)
+{
+    const NodeId id = m_numNodes++;
+    FrozenPDG::NodeRecord record;
+    record.type = node.type;
+    record.function = node.function.empty() ? FrozenPDG::NoFunction : getFunctionId(node.module, node.function);
+    record.module = node.module;
+    record.linkage = static_cast<uint32_t>(node.linkage);
+    record.argIdx = node.argIdx;
+    record.opcode = node.opcode;
+    record.symbol = addString(node.symbol);
+    record.label = addString(node.label);
+    record.metadataLabel = addString(node.metadataLabel);
+    writeValue(m_nodesFile, record);
+    if (record.function != FrozenPDG::NoFunction) {
+        m_failed |= !m_functionNodes->add(record.function, id, 0);
+    }
+    m_numTypes = std::max(m_numTypes, record.type + 1);
+    m_failed |= !m_typeNodes->add(record.type, id, 0);
+    if (record.opcode != 0) {
+        m_numOpcodes = std::max(m_numOpcodes, record.opcode + 1);
+        m_failed |= !m_opcodeNodes->add(record.opcode, id, 0);
+    }
+    if (record.metadataLabel != 0) {
+        const uint32_t label = getKey(m_labelIds, m_labelKeys, node.metadataLabel, record.metadataLabel);
+        m_failed |= !m_labelNodes->add(label, id, 0);
+    }
+    if (record.type == PDGLLVMNode::FunctionNode && record.symbol != 0) {
+        // call sites are known once the in edges are sorted
+        m_functionNodeCallees.emplace_back(id, getKey(m_calleeIds, m_calleeKeys, node.symbol, record.symbol));
+    }
+    return id;
+}
+
+void FrozenPDGWriter::addEdge(NodeId source, NodeId dest, SerializedPDG::EdgeKind kind)
+{
+    const auto edgeKind = static_cast<uint32_t>(kind);
+    m_failed |= !m_outEdges->add(source, dest, edgeKind);
+    m_failed |= !m_inEdges->add(dest, source, edgeKind);
+}
+
+bool FrozenPDGWriter::finish()
+{
+    const unsigned numFunctions = m_functionIds.size();
+    m_nodesFile.close();
+    m_stringsFile.close();
+    m_functionsFile.close();
+    if (m_failed || !m_nodesFile || !m_stringsFile || !m_functionsFile) {
+        llvm::errs() << "Could not write frozen PDG into " << m_directory << "\n";
+        return false;
+    }
+    if (!m_outEdges->write(m_numNodes, m_numNodes, true, getPath("out.offsets"), getPath("out.edges"))
+            || !m_inEdges->write(m_numNodes, m_numNodes, true, getPath("in.offsets"), getPath("in.edges"))
+            || !m_functionNodes->write(numFunctions, m_numNodes, false,
+                                       getPath("function.offsets"), getPath("function.nodes"))
+            || !m_typeNodes->write(m_numTypes, m_numNodes, false, getPath("type.offsets"), getPath("type.nodes"))
+            || !m_opcodeNodes->write(m_numOpcodes, m_numNodes, false,
+                                     getPath("opcode.offsets"), getPath("opcode.nodes"))
+            || !m_labelNodes->write(m_labelKeys.size(), m_numNodes, false,
+                                    getPath("label.offsets"), getPath("label.nodes"))
+            || !writeKeys("label.keys", m_labelKeys)
+            || !indexCallSites()
+            || !m_calleeNodes->write(m_calleeKeys.size(), m_numNodes, false,
+                                     getPath("callee.offsets"), getPath("callee.nodes"))
+            || !writeKeys("callee.keys", m_calleeKeys)) {
+        return false;
+    }
+    // written last, a directory without it is incomplete
+    std::ofstream meta(getPath("meta"));
+    meta << FrozenFormat << "\n"
+         << "nodes " << m_numNodes << "\n"
+         << "edges " << m_outEdges->getNumValues() << "\n"
+         << "functions " << numFunctions << "\n";
+    for (const auto& module : m_modules) {
+        meta << "module " << module << "\n";
+    }
+    meta.close();
+    if (!meta) {
+        llvm::errs() << "Could not write frozen PDG into " << m_directory << "\n";
+        return false;
+    }
+    return publish();
+}
+
+bool FrozenPDGWriter::publish()
+{
+    // files of a mapped graph must not be truncated under its readers, so a
+    // graph in the directory is moved aside and unlinked instead
+    std::string oldDirectory;
+    if (llvm::sys::fs::exists(m_directory)) {
+        if (!isReplaceable(m_directory)) {
+            llvm::errs() << m_directory << " is not empty and holds no frozen PDG, not replacing it\n";
+            return false;
+        }
+        oldDirectory = m_directory + ".old." + std::to_string(getpid());
+        llvm::sys::fs::remove_directories(oldDirectory);
+        if (auto EC = llvm::sys::fs::rename(m_directory, oldDirectory)) {
+            llvm::errs() << "Could not replace " << m_directory << ": " << EC.message() << "\n";
+            return false;
+        }
+    }
+    if (auto EC = llvm::sys::fs::rename(m_workDirectory, m_directory)) {
+        llvm::errs() << "Could not write frozen PDG into " << m_directory << ": " << EC.message() << "\n";
+        if (!oldDirectory.empty()) {
+            llvm::sys::fs::rename(oldDirectory, m_directory);
+        }
+        return false;
+    }
+    if (!oldDirectory.empty()) {
+        llvm::sys::fs::remove_directories(oldDirectory);
+    }
+    return true;
+}
+
+uint64_t FrozenPDGWriter::addString(const std::string& str)
+{
+    if (str.empty()) {
+        return 0;
+    }
+    const uint64_t offset = m_stringsSize;
+    m_stringsFile.write(str.c_str(), str.size() + 1);
+    m_stringsSize += str.size() + 1;
+    return offset;
+}
+
+uint32_t FrozenPDGWriter::getKey(std::map<std::string, uint32_t>& ids, std::vector<uint64_t>& keys,
+                                 const std::string& name, uint64_t offset)
+{
+    auto res = ids.insert(std::make_pair(name, keys.size()));
+    if (res.second) {
+        keys.push_back(offset);
+    }
+    return res.first->second;
+}
+
+bool FrozenPDGWriter::indexCallSites()
+{
+    // in edges of the function nodes are read back from the sorted rows
+    std::ifstream offsets(getPath("in.offsets"), std::ios::binary);
+    std::ifstream edges(getPath("in.edges"), std::ios::binary);
+    std::vector<FrozenPDG::Edge> callers;
+    for (const auto& functionNode : m_functionNodeCallees) {
+        uint64_t range[2];
+        offsets.seekg(functionNode.first * sizeof(uint64_t));
+        offsets.read(reinterpret_cast<char*>(range), sizeof(range));
+        callers.resize(range[1] - range[0]);
+        edges.seekg(range[0] * sizeof(FrozenPDG::Edge));
+        edges.read(reinterpret_cast<char*>(callers.data()), callers.size() * sizeof(FrozenPDG::Edge));
+        if (!offsets || !edges) {
+            llvm::errs() << "Could not read in edges of " << m_directory << "\n";
+            return false;
+        }
+        for (const auto& edge : callers) {
+            if (edge.getKind() == SerializedPDG::EdgeKind::Control
+                    && !m_calleeNodes->add(functionNode.second, edge.node, 0)) {
+                return false;
+            }
+        }
+    }
+    return true;
+}
+
+bool FrozenPDGWriter::writeKeys(const std::string& name, const std::vector<uint64_t>& keys)
+{
+    std::ofstream out(getPath(name), std::ios::binary);
+    out.write(reinterpret_cast<const char*>(keys.data()), keys.size() * sizeof(uint64_t));
+    if (!out) {
+        llvm::errs() << "Could not write " << getPath(name) << "\n";
+        return false;
+    }
+    return true;
+}
+
+FrozenPDG::FunctionId FrozenPDGWriter::getFunctionId(unsigned module, const std::string& name)
+{
+    // the same name may be a local function of several modules
+    auto res = m_functionIds.insert(std::make_pair(std::make_pair(module, name), m_functionIds.size()));
+    if (res.second) {
+        FrozenPDG::FunctionRecord record{addString(name), module, 0};
+        writeValue(m_functionsFile, record);
+    }
+    return res.first->second;
+}
+
+std::string FrozenPDGWriter::getPath(const std::string& name) const
+{
+    llvm::SmallString<256> path(m_workDirectory);
+    llvm::sys::path::append(path, name);
+    return path.str().str();
+}
+
+} // namespace pdg
+
@@ -0,0 +1,348 @@
+#include "PDG/FunctionSummaryAnalysis.h"
+
+#include "PDG/PDG.h"
+#include "PDG/FunctionPDG.h"
+#include "PDG/PDGEdge.h"
+#include "PDG/PDGLLVMNode.h"
+
+#include "llvm/ADT/STLExtras.h"
+#include "llvm/Analysis/ValueTracking.h"
+#include "llvm/IR/Function.h"
+#include "llvm/IR/Instructions.h"
+#include "llvm/IR/Module.h"
+#include "llvm/Support/Debug.h"
+#include "llvm/Support/raw_ostream.h"
+
+#include <deque>
+#include <vector>
+
+namespace pdg {
+
+namespace {
+
+llvm::Value* getWrittenPointer(llvm::Instruction* instr)
+{
+    if (auto* store = llvm::dyn_cast<llvm::StoreInst>(instr)) {
+        return store->getPointerOperand();
+    }
+    if (auto* rmw = llvm::dyn_cast<llvm::AtomicRMWInst>(instr)) {
+        return rmw->getPointerOperand();
+    }
+    if (auto* cmpxchg = llvm::dyn_cast<llvm::AtomicCmpXchgInst>(instr)) {
+        return cmpxchg->getPointerOperand();
+    }
+    return nullptr;
+}
+
+/// Whether the instruction writes memory callers or globals can observe
+bool writesMemory(llvm::Instruction* instr)
+{
+    // memory effects of calls are taken from callee summaries
+    if (llvm::isa<llvm::CallInst>(instr) || llvm::isa<llvm::InvokeInst>(instr)) {
+        return false;
+    }
+    if (!instr->mayWriteToMemory()) {
+        return false;
+    }
+    // stores into the function's own stack slots, such as the spills of
+    // reg2mem and of arguments at -O0, are gone once it returns
+    if (auto* pointer = getWrittenPointer(instr)) {
+        auto* object = llvm::GetUnderlyingObject(pointer, instr->getModule()->getDataLayout());
+        auto* alloca = llvm::dyn_cast<llvm::AllocaInst>(object);
+        if (alloca && alloca->getFunction() == instr->getFunction()) {
+            return false;
+        }
+    }
+    return true;
+}
+
+bool isFormalArgumentNode(PDGNode* node)
+{
+    return llvm::isa<PDGLLVMFormalArgumentNode>(node) || llvm::isa<PDGLLVMVaArgNode>(node);
+}
+
+bool hasDataEdge(PDGNode* source, PDGNode* dest)
+{
+    for (auto edge_it = source->outEdgesBegin(); edge_it != source->outEdgesEnd(); ++edge_it) {
+        if ((*edge_it)->isDataEdge() && (*edge_it)->getDestination().get() == dest) {
+            return true;
+        }
+    }
+    return false;
+}
+
+void addSummaryEdge(PDGNode* source, PDGNode* dest)
+{
+    if (hasDataEdge(source, dest)) {
+        return;
+    }
+    PDGNode::PDGEdgeType edge = PDGNode::PDGEdgeType(
+            new PDGSummaryEdge(source->shared_from_this(), dest->shared_from_this()));
+    source->addOutEdge(edge);
+    dest->addInEdge(edge);
+}
+
+/// Nodes reading memory defined by the call, i.e. its data dependents that do
+/// not take the returned value as an operand
+std::vector<PDGNode*> getMemoryUses(PDGNode* callNode, llvm::Instruction* callInstr)
+{
+    std::vector<PDGNode*> uses;
+    for (auto edge_it = callNode->outEdgesBegin(); edge_it != callNode->outEdgesEnd(); ++edge_it) {
+        if (!(*edge_it)->isDataEdge() || (*edge_it)->isSummaryEdge()) {
+            continue;
+        }
+        auto* instrNode = llvm::dyn_cast<PDGLLVMInstructionNode>((*edge_it)->getDestination().get());
+        if (!instrNode) {
+            continue;
+        }
+        auto* instr = llvm::dyn_cast<llvm::Instruction>(instrNode->getNodeValue());
+        if (instr && !llvm::is_contained(instr->operand_values(), callInstr)) {
+            uses.push_back(instrNode);
+        }
+    }
+    return uses;
+}
+
+} // unnamed namespace
+
+FunctionSummaryAnalysis::FunctionSummaryAnalysis(PDGType pdg)
+    : m_pdg(pdg)
+{
+}
+
+const FunctionSummary& FunctionSummaryAnalysis::getSummary(llvm::Function* F) const
+{
+    assert(hasSummary(F));
+    return m_summaries.find(F)->second;
+}
+
+void FunctionSummaryAnalysis::run()
+{
+    std::deque<llvm::Function*> worklist;
+    FunctionSet inWorklist;
+    // Definitions start from empty summaries and grow until fixpoint,
+    // which keeps the result precise for recursive functions
+    for (auto& entry : m_pdg->getFunctionPDGs()) {
+        llvm::Function* F = entry.first;
+        if (F->isDeclaration()) {
+            m_summaries[F] = getConservativeSummary(F);
+            continue;
+        }
+        FunctionSummary& summary = m_summaries[F];
+        const unsigned size = getSummaryIndex(F, F->getFunctionType()->getNumParams()) + 1;
+        summary.argFlowsToReturn.assign(size, false);
+        summary.argFlowsToMemory.assign(size, false);
+        worklist.push_back(F);
+        inWorklist.insert(F);
+    }
+
+    while (!worklist.empty()) {
+        llvm::Function* F = worklist.front();
+        worklist.pop_front();
+        inWorklist.erase(F);
+        auto functionPDG = m_pdg->getFunctionPDG(F);
+        FunctionSummary summary = computeSummary(F, functionPDG.get());
+        if (summary == m_summaries[F]) {
+            continue;
+        }
+        m_summaries[F] = summary;
+        for (const auto& callSite : functionPDG->getCallSites()) {
+            llvm::Function* caller = callSite.getCaller();
+            if (m_pdg->hasFunctionPDG(caller) && inWorklist.insert(caller).second) {
+                worklist.push_back(caller);
+            }
+        }
+    }
+}
+
+void FunctionSummaryAnalysis::attachSummaryEdges()
+{
+    for (auto& entry : m_pdg->getFunctionPDGs()) {
+        if (entry.first->isDeclaration()) {
+            continue;
+        }
+        auto& functionPDG = entry.second;
+        for (auto node_it = functionPDG->nodesBegin(); node_it != functionPDG->nodesEnd(); ++node_it) {
+            auto* actualArgNode = llvm::dyn_cast<PDGLLVMActualArgumentNode>(*node_it);
+            if (!actualArgNode) {
+                continue;
+            }
+            auto* callInstr = actualArgNode->getCallSite().getInstruction();
+            if (!functionPDG->hasNode(callInstr)) {
+                continue;
+            }
+            const auto& callees = getCallees(actualArgNode);
+            // no summary for unresolved call sites
+            if (callees.empty()) {
+                continue;
+            }
+            // the builder connects actual arguments to their call already,
+            // summary edges only add flows that have no direct edge
+            auto callNode = functionPDG->getNode(callInstr);
+            const unsigned argIdx = actualArgNode->getArgIndex();
+            if (!callInstr->getType()->isVoidTy() && calleesFlowToReturn(callees, argIdx)) {
+                addSummaryEdge(actualArgNode, callNode.get());
+            }
+            // memory written by the callee through the argument is read after the call
+            if (calleesFlowToMemory(callees, argIdx)) {
+                for (auto* use : getMemoryUses(callNode.get(), callInstr)) {
+                    addSummaryEdge(actualArgNode, use);
+                }
+            }
+        }
+    }
+}
+
+FunctionSummary FunctionSummaryAnalysis::computeSummary(llvm::Function* F, FunctionPDG* functionPDG)
+{
+    FunctionSummary summary = m_summaries[F];
+    for (auto arg_it = functionPDG->formalArgBegin(); arg_it != functionPDG->formalArgEnd(); ++arg_it) {
+        bool flowsToReturn = false;
+        bool flowsToMemory = false;
+        computeArgumentFlows(F, functionPDG, arg_it->second.get(), flowsToReturn, flowsToMemory);
+        const unsigned idx = getSummaryIndex(F, arg_it->first->getArgNo());
+        summary.argFlowsToReturn[idx] = flowsToReturn;
+        summary.argFlowsToMemory[idx] = flowsToMemory;
+    }
+    if (functionPDG->isVarArg() && functionPDG->getVaArgNode()) {
+        bool flowsToReturn = false;
+        bool flowsToMemory = false;
+        computeArgumentFlows(F, functionPDG, functionPDG->getVaArgNode().get(), flowsToReturn, flowsToMemory);
+        const unsigned idx = getSummaryIndex(F, F->getFunctionType()->getNumParams());
+        summary.argFlowsToReturn[idx] = flowsToReturn;
+        summary.argFlowsToMemory[idx] = flowsToMemory;
+    }
+    return summary;
+}
+
+void FunctionSummaryAnalysis::computeArgumentFlows(llvm::Function* F,
+                                                   FunctionPDG* functionPDG,
+                                                   PDGNode* formalArgNode,
+                                                   bool& flowsToReturn,
+                                                   bool& flowsToMemory)
+{
+    PDGNode* functionNode = m_pdg->hasFunctionNode(F) ? m_pdg->getFunctionNode(F).get() : nullptr;
+    std::vector<PDGNode*> worklist;
+    std::unordered_set<PDGNode*> visited;
+    worklist.push_back(formalArgNode);
+    visited.insert(formalArgNode);
+    while (!worklist.empty()) {
+        PDGNode* node = worklist.back();
+        worklist.pop_back();
+        if (node == functionNode) {
+            flowsToReturn = true;
+            continue;
+        }
+        if (auto* instrNode = llvm::dyn_cast<PDGLLVMInstructionNode>(node)) {
+            auto* instr = llvm::dyn_cast<llvm::Instruction>(instrNode->getNodeValue());
+            if (instr && writesMemory(instr)) {
+                flowsToMemory = true;
+            }
+        }
+        // Flow through a call site is decided by callee summaries instead of
+        // the context-insensitive actual argument to call edge
+        PDGNode* skippedCallNode = nullptr;
+        auto* actualArgNode = llvm::dyn_cast<PDGLLVMActualArgumentNode>(node);
+        if (actualArgNode) {
+            const auto& callees = getCallees(node);
+            const unsigned argIdx = actualArgNode->getArgIndex();
+            if (calleesFlowToMemory(callees, argIdx)) {
+                flowsToMemory = true;
+            }
+            auto* callInstr = actualArgNode->getCallSite().getInstruction();
+            if (!calleesFlowToReturn(callees, argIdx) && functionPDG->hasNode(callInstr)) {
+                skippedCallNode = functionPDG->getNode(callInstr).get();
+            }
+        }
+        for (auto edge_it = node->outEdgesBegin(); edge_it != node->outEdgesEnd(); ++edge_it) {
+            if (!(*edge_it)->isDataEdge()) {
+                continue;
+            }
+            PDGNode* dest = (*edge_it)->getDestination().get();
+            if (dest == skippedCallNode) {
+                continue;
+            }
+            if (actualArgNode && isFormalArgumentNode(dest)) {
+                continue;
+            }
+            if (dest != functionNode && dest->hasParent() && dest->getParent() != F) {
+                continue;
+            }
+            if (visited.insert(dest).second) {
+                worklist.push_back(dest);
+            }
+        }
+    }
+}
+
+FunctionSummaryAnalysis::FunctionSet FunctionSummaryAnalysis::getCallees(PDGNode* actualArgNode) const
+{
+    FunctionSet callees;
+    for (auto edge_it = actualArgNode->outEdgesBegin(); edge_it != actualArgNode->outEdgesEnd(); ++edge_it) {
+        PDGNode* dest = (*edge_it)->getDestination().get();
+        if (isFormalArgumentNode(dest)) {
+            callees.insert(dest->getParent());
+        }
+    }
+    return callees;
+}
+
+bool FunctionSummaryAnalysis::calleesFlowToReturn(const FunctionSet& callees, unsigned argIdx) const
+{
+    // unresolved call sites are treated conservatively
+    if (callees.empty()) {
+        return true;
+    }
+    for (auto* callee : callees) {
+        if (!hasSummary(callee)) {
+            return true;
+        }
+        const auto& flows = getSummary(callee).argFlowsToReturn;
+        const unsigned idx = getSummaryIndex(callee, argIdx);
+        if (idx < flows.size() && flows[idx]) {
+            return true;
+        }
+    }
+    return false;
+}
+
+bool FunctionSummaryAnalysis::calleesFlowToMemory(const FunctionSet& callees, unsigned argIdx) const
+{
+    if (callees.empty()) {
+        return true;
+    }
+    for (auto* callee : callees) {
+        if (!hasSummary(callee)) {
+            return true;
+        }
+        const auto& flows = getSummary(callee).argFlowsToMemory;
+        const unsigned idx = getSummaryIndex(callee, argIdx);
+        if (idx < flows.size() && flows[idx]) {
+            return true;
+        }
+    }
+    return false;
+}
+
+FunctionSummary FunctionSummaryAnalysis::getConservativeSummary(llvm::Function* F) const
+{
+    FunctionSummary summary;
+    const unsigned size = getSummaryIndex(F, F->getFunctionType()->getNumParams()) + 1;
+    const bool returnsValue = !F->getReturnType()->isVoidTy();
+    summary.argFlowsToReturn.assign(size, returnsValue);
+    summary.argFlowsToMemory.assign(size, !F->doesNotAccessMemory() && !F->onlyReadsMemory());
+    return summary;
+}
+
+unsigned FunctionSummaryAnalysis::getSummaryIndex(llvm::Function* F, unsigned argIdx)
+{
+    const unsigned numParams = F->getFunctionType()->getNumParams();
+    if (argIdx < numParams) {
+        return argIdx;
+    }
+    // non-variadic functions get an unused trailing slot
+    return numParams;
+}
+
+} // namespace pdg
+
@@ -305,6 +305,25 @@ IndirectCallSiteAnalysisResult::FunctionSet IndirectCallSiteAnalysisResult::getI
     return getIndirectTargets(callSite.getFunctionType());
 }
 
+TypeBasedIndirectCallSiteResults::TypeBasedIndirectCallSiteResults(llvm::Module& M)
+{
+    for (auto& F : M) {
+        if (!F.isDeclaration()) {
+            m_candidates.addIndirectCallTarget(F.getFunctionType(), &F);
+        }
+    }
+}
+
+bool TypeBasedIndirectCallSiteResults::hasIndCSCallees(const llvm::CallSite& callSite) const
+{
+    return isIndirectCall(&callSite) && m_candidates.hasIndirectTargets(callSite.getFunctionType());
+}
+
+TypeBasedIndirectCallSiteResults::FunctionSet TypeBasedIndirectCallSiteResults::getIndCSCallees(const llvm::CallSite& callSite)
+{
+    return m_candidates.getIndirectTargets(callSite.getFunctionType());
+}
+
 void IndirectCallSiteAnalysisResult::dump()
 {
     for (const auto& item : m_indirectCallTargets) {
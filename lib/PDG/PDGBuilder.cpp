@@ -14,12 +14,32 @@
 #include "llvm/IR/GlobalVariable.h"
 #include "llvm/IR/Constants.h"
 #include "llvm/Support/Debug.h"
+#include "llvm/Support/Error.h"
 #include "llvm/Support/raw_ostream.h"
 
 namespace pdg {
 
+namespace {
+
+void detachEdges(PDGNode* node)
+{
+    const auto outEdges = node->getOutEdges();
+    for (const auto& edge : outEdges) {
+        edge->getDestination()->removeInEdge(edge);
+        node->removeOutEdge(edge);
+    }
+    const auto inEdges = node->getInEdges();
+    for (const auto& edge : inEdges) {
+        edge->getSource()->removeOutEdge(edge);
+        node->removeInEdge(edge);
+    }
+}
+
+} // unnamed namespace
+
 PDGBuilder::PDGBuilder(llvm::Module* M)
     : m_module(M)
+    , m_maxCallSiteFanOut(0)
 {
 }
 
@@ -38,20 +58,100 @@ void PDGBuilder::setDominanceResults(DominanceResultsTy domResults)
     m_domResults = domResults;
 }
 
+void PDGBuilder::setMaxCallSiteFanOut(unsigned maxFanOut)
+{
+    m_maxCallSiteFanOut = maxFanOut;
+}
+
+void PDGBuilder::setFunctionMaterializer(const FunctionMaterializer& materializer)
+{
+    m_materializer = materializer;
+}
+
+void PDGBuilder::setFunctionPDGConsumer(const FunctionPDGConsumer& consumer)
+{
+    m_consumer = consumer;
+}
+
 void PDGBuilder::build()
 {
     m_pdg.reset(new PDG(m_module));
     visitGlobals();
 
     for (auto& F : *m_module) {
-        m_pdg->addFunctionNode(&F);
-        if (F.isDeclaration()) {
+        buildFunction(F);
+        connectDeferredDependencies();
+        emitFunctionPDG(F);
+    }
+    m_reachedCallees.clear();
+}
+
+void PDGBuilder::buildSkeleton()
+{
+    m_pdg.reset(new PDG(m_module));
+    visitGlobals();
+
+    for (auto& F : *m_module) {
+        buildFunction(F);
+    }
+}
+
+void PDGBuilder::connectSkeleton()
+{
+    assert(m_pdg);
+    connectDeferredDependencies();
+    m_reachedCallees.clear();
+}
+
+void PDGBuilder::buildFromEntries(const std::vector<llvm::Function*>& entries)
+{
+    m_pdg.reset(new PDG(m_module));
+    visitGlobals();
+
+    std::vector<llvm::Function*> worklist(entries.rbegin(), entries.rend());
+    FunctionSet visited(entries.begin(), entries.end());
+    while (!worklist.empty()) {
+        llvm::Function* F = worklist.back();
+        worklist.pop_back();
+        buildFunction(*F);
+        connectDeferredDependencies();
+        emitFunctionPDG(*F);
+        for (auto* callee : m_reachedCallees) {
+            if (visited.insert(callee).second) {
+                worklist.push_back(callee);
+            }
+        }
+        m_reachedCallees.clear();
+    }
+}
+
+void PDGBuilder::buildFunction(llvm::Function& F)
+{
+    m_pdg->addFunctionNode(&F);
+    if (F.isDeclaration() || !materializeFunction(F)) {
+        if (!m_pdg->hasFunctionPDG(&F)) {
             buildFunctionDefinition(&F);
-            continue;
         }
-        buildFunctionPDG(&F);
-        m_currentFPDG.reset();
+        return;
+    }
+    buildFunctionPDG(&F);
+    m_currentFPDG.reset();
+}
+
+bool PDGBuilder::materializeFunction(llvm::Function& F)
+{
+    if (!F.isMaterializable()) {
+        return true;
     }
+    if (m_materializer) {
+        return m_materializer(&F);
+    }
+    if (auto err = F.materialize()) {
+        llvm::errs() << "Could not materialize " << F.getName() << ": "
+                     << llvm::toString(std::move(err)) << "\n";
+        return false;
+    }
+    return true;
 }
 
 void PDGBuilder::visitGlobals()
@@ -152,7 +252,7 @@ void PDGBuilder::visitLoadInst(llvm::LoadInst& I)
     auto ptrOp = getNodeFor(I.getPointerOperand());
     addDataEdge(ptrOp, destNode);
     m_currentFPDG->addNode(&I, destNode);
-    connectToDefSite(&I, destNode);
+    m_deferredDefSites.push_back(DeferredDefSite{m_currentFPDG, &I, destNode});
 }
 
 void PDGBuilder::visitStoreInst(llvm::StoreInst& I)
@@ -302,9 +402,36 @@ PDGBuilder::PDGNodeTy PDGBuilder::createConstantNodeFor(llvm::Constant* constant
     return std::make_shared<PDGLLVMConstantNode>(constant);
 }
 
+PDGBuilder::PDGNodeTy PDGBuilder::createUnknownCalleeNodeFor(llvm::CallSite& callSite, unsigned numCandidates)
+{
+    return std::make_shared<PDGLLVMUnknownCalleeNode>(callSite, numCandidates);
+}
+
 void PDGBuilder::visitCallSite(llvm::CallSite& callSite)
 {
     auto destNode = getInstructionNodeFor(callSite.getInstruction());
+    DeferredCallSite deferredCallSite{m_currentFPDG, callSite, destNode, {}};
+    for (unsigned i = 0; i < callSite.getNumArgOperands(); ++i) {
+        if (auto* val = llvm::dyn_cast<llvm::Value>(callSite.getArgOperand(i))) {
+            auto sourceNode = getNodeFor(val);
+            if (!sourceNode) {
+                continue;
+            }
+            auto actualArgNode = PDGNodeTy(new PDGLLVMActualArgumentNode(callSite, val, i));
+            addDataEdge(sourceNode, actualArgNode);
+            addDataEdge(actualArgNode, destNode);
+            m_currentFPDG->addNode(actualArgNode);
+            deferredCallSite.actualArgNodes.push_back(actualArgNode);
+        }
+    }
+    // callees and pointer argument definitions need pointer analysis results
+    m_deferredCallSites.push_back(std::move(deferredCallSite));
+}
+
+void PDGBuilder::connectCallSite(DeferredCallSite& deferredCallSite)
+{
+    llvm::CallSite& callSite = deferredCallSite.callSite;
+    auto destNode = deferredCallSite.callNode;
     FunctionSet callees;
     if (!m_indCSResults->hasIndCSCallees(callSite)) {
         if (auto* calledF = callSite.getCalledFunction()) {
@@ -313,43 +440,94 @@ void PDGBuilder::visitCallSite(llvm::CallSite& callSite)
     } else {
         callees = m_indCSResults->getIndCSCallees(callSite);
     }
-    for (auto callee : callees) {
-        if (!m_pdg->hasFunctionNode(callee)) {
-            m_pdg->addFunctionNode(callee);
-        }
-        auto calleeNode = m_pdg->getFunctionNode(callee);
+    PDGNodeTy unknownCalleeNode;
+    if (m_maxCallSiteFanOut != 0 && callees.size() > m_maxCallSiteFanOut) {
+        // Route megamorphic call sites through one node and keep the candidates aside
+        unknownCalleeNode = createUnknownCalleeNodeFor(callSite, callees.size());
+        m_currentFPDG->addNode(unknownCalleeNode);
+        m_pdg->addUnknownCalleeCandidates(callSite.getInstruction(), callees);
         if (!callSite.getFunctionType()->isVoidTy()) {
-            addDataEdge(calleeNode, destNode);
+            addDataEdge(unknownCalleeNode, destNode);
         }
-        addControlEdge(destNode, calleeNode);
-    }
-    for (unsigned i = 0; i < callSite.getNumArgOperands(); ++i) {
-        if (auto* val = llvm::dyn_cast<llvm::Value>(callSite.getArgOperand(i))) {
-            auto sourceNode = getNodeFor(val);
-            if (!sourceNode) {
-                continue;
+        addControlEdge(destNode, unknownCalleeNode);
+    } else {
+        for (auto callee : callees) {
+            if (!m_pdg->hasFunctionNode(callee)) {
+                m_pdg->addFunctionNode(callee);
             }
-            if (val->getType()->isPointerTy()
-                    && !llvm::isa<PDGNullNode>(sourceNode.get())
-                    && !llvm::isa<llvm::Function>(val)) {
-                //llvm::dbgs() << *val << "\n";
-                connectToDefSite(val, sourceNode);
+            auto calleeNode = m_pdg->getFunctionNode(callee);
+            if (!callSite.getFunctionType()->isVoidTy()) {
+                addDataEdge(calleeNode, destNode);
             }
-            auto actualArgNode = PDGNodeTy(new PDGLLVMActualArgumentNode(callSite, val, i));
-            addDataEdge(sourceNode, actualArgNode);
-            addDataEdge(actualArgNode, destNode);
-            m_currentFPDG->addNode(actualArgNode);
-            // connect actual args with formal args
-            addActualArgumentNodeConnections(actualArgNode, i, callSite, callees);
+            addControlEdge(destNode, calleeNode);
+        }
+    }
+    for (auto& actualArgNode : deferredCallSite.actualArgNodes) {
+        auto* actualArg = llvm::dyn_cast<PDGLLVMActualArgumentNode>(actualArgNode.get());
+        llvm::Value* val = actualArg->getNodeValue();
+        auto sourceNode = getNodeFor(val);
+        if (val->getType()->isPointerTy()
+                && !llvm::isa<PDGNullNode>(sourceNode.get())
+                && !llvm::isa<llvm::Function>(val)) {
+            //llvm::dbgs() << *val << "\n";
+            connectToDefSite(val, sourceNode);
+        }
+        if (unknownCalleeNode) {
+            addDataEdge(actualArgNode, unknownCalleeNode);
+            continue;
         }
+        // connect actual args with formal args
+        addActualArgumentNodeConnections(actualArgNode, actualArg->getArgIndex(), callSite, callees);
     }
+    // candidates behind an unknown callee node are still called from here
     for (auto& F : callees) {
         if (!m_pdg->hasFunctionPDG(F)) {
             buildFunctionDefinition(F);
         }
         FunctionPDGTy calleePDG = m_pdg->getFunctionPDG(F);
         calleePDG->addCallSite(callSite);
+        m_reachedCallees.push_back(F);
+    }
+}
+
+void PDGBuilder::connectDeferredDependencies()
+{
+    assert(m_defUse && m_indCSResults);
+    for (auto& deferredDefSite : m_deferredDefSites) {
+        m_currentFPDG = deferredDefSite.functionPDG;
+        connectToDefSite(deferredDefSite.value, deferredDefSite.node);
+    }
+    m_deferredDefSites.clear();
+    for (auto& deferredCallSite : m_deferredCallSites) {
+        m_currentFPDG = deferredCallSite.functionPDG;
+        connectCallSite(deferredCallSite);
+    }
+    m_deferredCallSites.clear();
+    m_currentFPDG.reset();
+}
+
+void PDGBuilder::emitFunctionPDG(llvm::Function& F)
+{
+    // stubs of declarations and unread bodies stay as they are
+    if (!m_consumer || F.isDeclaration() || F.isMaterializable() || !m_pdg->hasFunctionPDG(&F)) {
+        return;
+    }
+    // Out edges of the function's own nodes are final here, later functions
+    // only add edges into its formal arguments
+    auto functionPDG = m_pdg->getFunctionPDG(&F);
+    m_consumer(&F, functionPDG);
+    releaseFunctionBody(functionPDG.get());
+}
+
+void PDGBuilder::releaseFunctionBody(FunctionPDG* functionPDG)
+{
+    // nodes and edges reference each other, so edges are removed explicitly
+    for (auto node_it = functionPDG->nodesBegin(); node_it != functionPDG->nodesEnd(); ++node_it) {
+        if (!llvm::isa<PDGLLVMFormalArgumentNode>(*node_it)) {
+            detachEdges(*node_it);
+        }
     }
+    functionPDG->releaseBody();
 }
 
 void PDGBuilder::addDataEdge(PDGNodeTy source, PDGNodeTy dest)
@@ -0,0 +1,152 @@
+#include "PDG/PDGChopper.h"
+
+#include <algorithm>
+
+namespace pdg {
+
+PDGChopper::Search::Search(unsigned numNodes)
+    : parents(numNodes, FrozenPDG::InvalidNode)
+    , distances(numNodes)
+    , kinds(numNodes)
+{
+}
+
+void PDGChopper::Search::reach(FrozenPDG::NodeId node, FrozenPDG::NodeId parent, uint32_t kind, uint32_t distance)
+{
+    parents[node] = parent;
+    kinds[node] = kind;
+    distances[node] = distance;
+    reached.push_back(node);
+}
+
+void PDGChopper::Search::clear()
+{
+    // only the reached nodes are reset, not the whole arrays
+    for (auto node : reached) {
+        parents[node] = FrozenPDG::InvalidNode;
+    }
+    reached.clear();
+}
+
+PDGChopper::PDGChopper(const FrozenPDG& pdg)
+    : m_pdg(pdg)
+    , m_forward(pdg.getNumNodes())
+    , m_backward(pdg.getNumNodes())
+{
+}
+
+Slice PDGChopper::chop(llvm::ArrayRef<FrozenPDG::NodeId> sources,
+                       llvm::ArrayRef<FrozenPDG::NodeId> sinks,
+                       unsigned edges)
+{
+    seed(m_forward, sources);
+    for (size_t begin = 0; begin < m_forward.reached.size(); ) {
+        begin = expand(m_forward, true, begin, edges);
+    }
+    // every node on a path from a forward reached node to a sink is forward reached
+    std::vector<FrozenPDG::NodeId> roots;
+    for (auto sink : sinks) {
+        if (sink < m_pdg.getNumNodes() && m_forward.isReached(sink)) {
+            roots.push_back(sink);
+        }
+    }
+    seed(m_backward, roots);
+    for (size_t begin = 0; begin < m_backward.reached.size(); ) {
+        begin = expand(m_backward, false, begin, edges, &m_forward);
+    }
+    Slice result(m_backward.reached, true);
+    m_forward.clear();
+    m_backward.clear();
+    return result;
+}
+
+DependencePath PDGChopper::shortestPath(llvm::ArrayRef<FrozenPDG::NodeId> sources,
+                                        llvm::ArrayRef<FrozenPDG::NodeId> sinks,
+                                        unsigned edges)
+{
+    seed(m_forward, sources);
+    seed(m_backward, sinks);
+    FrozenPDG::NodeId meeting = FrozenPDG::InvalidNode;
+    uint32_t shortest = ~0u;
+    auto meet = [&] (FrozenPDG::NodeId node) {
+        if (!m_forward.isReached(node) || !m_backward.isReached(node)) {
+            return;
+        }
+        const uint32_t length = m_forward.distances[node] + m_backward.distances[node];
+        if (length < shortest) {
+            shortest = length;
+            meeting = node;
+        }
+    };
+    for (auto sink : m_backward.reached) {
+        meet(sink);
+    }
+    size_t forwardBegin = 0;
+    size_t backwardBegin = 0;
+    while (meeting == FrozenPDG::InvalidNode) {
+        const size_t forwardLevel = m_forward.reached.size() - forwardBegin;
+        const size_t backwardLevel = m_backward.reached.size() - backwardBegin;
+        if (forwardLevel == 0 || backwardLevel == 0) {
+            break;
+        }
+        // whole levels of the smaller side are expanded, the shortest
+        // path is among the ones meeting in the first level that meets
+        const bool forward = forwardLevel <= backwardLevel;
+        Search& search = forward ? m_forward : m_backward;
+        size_t& begin = forward ? forwardBegin : backwardBegin;
+        const size_t end = search.reached.size();
+        begin = expand(search, forward, begin, edges);
+        for (size_t i = end; i < search.reached.size(); ++i) {
+            meet(search.reached[i]);
+        }
+    }
+
+    DependencePath path;
+    if (meeting != FrozenPDG::InvalidNode) {
+        auto node = meeting;
+        for (; m_forward.parents[node] != node; node = m_forward.parents[node]) {
+            path.nodes.push_back(node);
+            path.edges.push_back(static_cast<SerializedPDG::EdgeKind>(m_forward.kinds[node]));
+        }
+        path.nodes.push_back(node);
+        std::reverse(path.nodes.begin(), path.nodes.end());
+        std::reverse(path.edges.begin(), path.edges.end());
+        for (auto node = meeting; m_backward.parents[node] != node; node = m_backward.parents[node]) {
+            path.nodes.push_back(m_backward.parents[node]);
+            path.edges.push_back(static_cast<SerializedPDG::EdgeKind>(m_backward.kinds[node]));
+        }
+    }
+    m_forward.clear();
+    m_backward.clear();
+    return path;
+}
+
+void PDGChopper::seed(Search& search, llvm::ArrayRef<FrozenPDG::NodeId> roots)
+{
+    for (auto root : roots) {
+        if (root < m_pdg.getNumNodes() && !search.isReached(root)) {
+            search.reach(root, root, 0, 0);
+        }
+    }
+}
+
+size_t PDGChopper::expand(Search& search, bool forward, size_t begin, unsigned edges, const Search* restriction)
+{
+    const size_t end = search.reached.size();
+    for (size_t i = begin; i < end; ++i) {
+        const auto node = search.reached[i];
+        for (const auto& edge : forward ? m_pdg.getOutEdges(node) : m_pdg.getInEdges(node)) {
+            if (!isFollowed(edges, edge) || search.isReached(edge.node)) {
+                continue;
+            }
+            if (restriction && !restriction->isReached(edge.node)) {
+                continue;
+            }
+            search.reach(edge.node, node, edge.kind, search.distances[node] + 1);
+        }
+    }
+    return end;
+}
+
+} // namespace pdg
+
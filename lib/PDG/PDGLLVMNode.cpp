@@ -30,6 +30,8 @@ std::string getNodeTypeAsString(PDGLLVMNode::NodeType type)
         return "NullNode";
     case PDGLLVMNode::PhiNode:
         return "PhiNode";
+    case PDGLLVMNode::UnknownCalleeNode:
+        return "UnknownCalleeNode";
     default:
         break;
     }
@@ -67,5 +69,14 @@ std::string PDGLLVMVaArgNode::getNodeAsString() const
     return rawstr.str();
 }
 
+std::string PDGLLVMUnknownCalleeNode::getNodeAsString() const
+{
+    std::string str;
+    llvm::raw_string_ostream rawstr(str);
+    rawstr << "UnknownCalleeNode (" << m_numCandidates << " candidates) ";
+    rawstr << *m_value;
+    return rawstr.str();
+}
+
 } // namespace pdg
 
@@ -0,0 +1,394 @@
+#include "PDG/PDGLinker.h"
+
+#include "PDG/FrozenPDGWriter.h"
+#include "PDG/PDGLLVMNode.h"
+
+#include "llvm/Support/raw_ostream.h"
+
+#include <algorithm>
+#include <limits>
+#include <set>
+#include <tuple>
+
+namespace pdg {
+
+using Linkage = SerializedPDG::Linkage;
+
+/// Collects the symbol nodes of a file in the first pass of a streamed link
+class PDGLinker::SymbolReader : public SerializedPDG::Visitor
+{
+public:
+    SymbolReader(PDGLinker& linker, InputFile& file, bool shard)
+        : m_linker(linker)
+        , m_file(file)
+        , m_shard(shard)
+    {
+    }
+
+    void visitModule(const std::string& moduleName) override
+    {
+        m_file.moduleIds.push_back(getModuleId(m_linker.m_symbols, m_linker.m_fileShardModuleIds,
+                                               moduleName, m_shard));
+    }
+
+    void visitNode(const SerializedPDG::Node& node) override
+    {
+        if (!isSymbolNode(node)) {
+            return;
+        }
+        SerializedPDG::Node symbol = node;
+        symbol.module = m_file.moduleIds[node.module];
+        m_linker.m_symbols.addNode(symbol);
+    }
+
+    void visitEdge(const SerializedPDG::Edge& ) override
+    {
+    }
+
+private:
+    PDGLinker& m_linker;
+    InputFile& m_file;
+    bool m_shard;
+}; // class SymbolReader
+
+/// Writes the remapped nodes and edges of a file in the second pass of a
+/// streamed link
+class PDGLinker::NodeStreamer : public SerializedPDG::Visitor
+{
+public:
+    using NodeId = FrozenPDGWriter::NodeId;
+
+    static constexpr NodeId Discarded = std::numeric_limits<NodeId>::max();
+
+public:
+    NodeStreamer(const InputFile& file,
+                 const std::vector<NodeId>& symbolIds,
+                 const DiscardedBodies& discardedBodies,
+                 FrozenPDGWriter& writer)
+        : m_file(file)
+        , m_symbolIds(symbolIds)
+        , m_discardedBodies(discardedBodies)
+        , m_writer(writer)
+        , m_numSymbols(0)
+        , m_numDiscarded(0)
+        , m_failed(false)
+    {
+    }
+
+    unsigned getNumDiscarded() const
+    {
+        return m_numDiscarded;
+    }
+
+    bool hasFailed() const
+    {
+        return m_failed || m_numSymbols != m_file.numSymbols;
+    }
+
+    void visitModule(const std::string& ) override
+    {
+    }
+
+    void visitNode(const SerializedPDG::Node& node) override
+    {
+        if (isSymbolNode(node)) {
+            if (m_numSymbols == m_file.numSymbols) {
+                fail("symbols changed since the first pass");
+                m_ids.push_back(Discarded);
+                return;
+            }
+            m_ids.push_back(m_symbolIds[m_file.firstSymbol + m_numSymbols++]);
+            return;
+        }
+        SerializedPDG::Node linked = node;
+        linked.module = m_file.moduleIds[node.module];
+        if (!linked.function.empty() && m_discardedBodies.count(std::make_pair(linked.module, linked.function))) {
+            m_ids.push_back(Discarded);
+            ++m_numDiscarded;
+            return;
+        }
+        m_ids.push_back(m_writer.addNode(linked));
+    }
+
+    void visitEdge(const SerializedPDG::Edge& edge) override
+    {
+        if (edge.source >= m_ids.size() || edge.dest >= m_ids.size()) {
+            fail("edge of an unknown node");
+            return;
+        }
+        const NodeId source = m_ids[edge.source];
+        const NodeId dest = m_ids[edge.dest];
+        if (source == Discarded || dest == Discarded) {
+            return;
+        }
+        // edges between symbol nodes of several files may coincide once
+        // merged, the writer drops the duplicates
+        m_writer.addEdge(source, dest, edge.kind);
+    }
+
+private:
+    void fail(const char* reason)
+    {
+        if (!m_failed) {
+            llvm::errs() << m_file.path << ": " << reason << "\n";
+        }
+        m_failed = true;
+    }
+
+private:
+    const InputFile& m_file;
+    const std::vector<NodeId>& m_symbolIds;
+    const DiscardedBodies& m_discardedBodies;
+    FrozenPDGWriter& m_writer;
+    /// Linked id of each node of the file
+    std::vector<NodeId> m_ids;
+    unsigned m_numSymbols;
+    unsigned m_numDiscarded;
+    bool m_failed;
+}; // class NodeStreamer
+
+void PDGLinker::addModule(const SerializedPDG& pdg)
+{
+    add(pdg, false);
+}
+
+void PDGLinker::addShard(const SerializedPDG& pdg)
+{
+    add(pdg, true);
+}
+
+void PDGLinker::add(const SerializedPDG& pdg, bool shard)
+{
+    const unsigned nodeOffset = m_merged.getNodes().size();
+    std::vector<unsigned> moduleIds;
+    for (const auto& module : pdg.getModules()) {
+        moduleIds.push_back(getModuleId(m_merged, m_shardModuleIds, module, shard));
+    }
+    for (auto node : pdg.getNodes()) {
+        node.module = moduleIds[node.module];
+        m_merged.addNode(node);
+    }
+    for (const auto& edge : pdg.getEdges()) {
+        m_merged.addEdge(edge.source + nodeOffset, edge.dest + nodeOffset, edge.kind);
+    }
+}
+
+bool PDGLinker::addModuleFile(const std::string& path)
+{
+    return addFile(path, false);
+}
+
+bool PDGLinker::addShardFile(const std::string& path)
+{
+    return addFile(path, true);
+}
+
+bool PDGLinker::addFile(const std::string& path, bool shard)
+{
+    InputFile file{path, {}, static_cast<unsigned>(m_symbols.getNodes().size()), 0};
+    SymbolReader reader(*this, file, shard);
+    if (!SerializedPDG::read(path, reader)) {
+        return false;
+    }
+    file.numSymbols = m_symbols.getNodes().size() - file.firstSymbol;
+    m_files.push_back(std::move(file));
+    return true;
+}
+
+SerializedPDG PDGLinker::link()
+{
+    const auto& nodes = m_merged.getNodes();
+    std::vector<unsigned> representatives;
+    DiscardedBodies discardedBodies;
+    resolve(nodes, representatives, discardedBodies);
+
+    std::vector<bool> discarded(nodes.size());
+    m_numDiscarded = 0;
+    if (!discardedBodies.empty()) {
+        for (unsigned i = 0; i < nodes.size(); ++i) {
+            const auto& node = nodes[i];
+            if (!isSymbolNode(node) && !node.function.empty()
+                    && discardedBodies.count(std::make_pair(node.module, node.function))) {
+                discarded[i] = true;
+                ++m_numDiscarded;
+            }
+        }
+    }
+
+    SerializedPDG linked;
+    for (const auto& module : m_merged.getModules()) {
+        linked.addModule(module);
+    }
+    std::vector<unsigned> linkedIds(nodes.size());
+    for (unsigned i = 0; i < nodes.size(); ++i) {
+        if (representatives[i] == i && !discarded[i]) {
+            linkedIds[i] = linked.addNode(nodes[i]);
+        }
+    }
+    // edges of merged nodes may now coincide
+    std::vector<std::tuple<unsigned, unsigned, unsigned>> edges;
+    edges.reserve(m_merged.getEdges().size());
+    for (const auto& edge : m_merged.getEdges()) {
+        if (discarded[edge.source] || discarded[edge.dest]) {
+            continue;
+        }
+        edges.emplace_back(linkedIds[representatives[edge.source]],
+                           linkedIds[representatives[edge.dest]],
+                           static_cast<unsigned>(edge.kind));
+    }
+    std::sort(edges.begin(), edges.end());
+    edges.erase(std::unique(edges.begin(), edges.end()), edges.end());
+    for (const auto& edge : edges) {
+        linked.addEdge(std::get<0>(edge), std::get<1>(edge),
+                       static_cast<SerializedPDG::EdgeKind>(std::get<2>(edge)));
+    }
+    return linked;
+}
+
+bool PDGLinker::link(FrozenPDGWriter& writer)
+{
+    using NodeId = FrozenPDGWriter::NodeId;
+    const auto& symbols = m_symbols.getNodes();
+    std::vector<unsigned> representatives;
+    DiscardedBodies discardedBodies;
+    resolve(symbols, representatives, discardedBodies);
+
+    for (const auto& module : m_symbols.getModules()) {
+        writer.addModule(module);
+    }
+    // winning symbol nodes are written first, so edges of every file can
+    // refer to them
+    std::vector<NodeId> symbolIds(symbols.size());
+    for (unsigned i = 0; i < symbols.size(); ++i) {
+        if (representatives[i] == i) {
+            symbolIds[i] = writer.addNode(symbols[i]);
+        }
+    }
+    for (unsigned i = 0; i < symbols.size(); ++i) {
+        symbolIds[i] = symbolIds[representatives[i]];
+    }
+
+    m_numDiscarded = 0;
+    for (const auto& file : m_files) {
+        NodeStreamer streamer(file, symbolIds, discardedBodies, writer);
+        if (!SerializedPDG::read(file.path, streamer)) {
+            return false;
+        }
+        if (streamer.hasFailed()) {
+            return false;
+        }
+        m_numDiscarded += streamer.getNumDiscarded();
+    }
+    return true;
+}
+
+void PDGLinker::resolve(const SerializedPDG::Nodes& nodes,
+                        std::vector<unsigned>& representatives,
+                        DiscardedBodies& discardedBodies)
+{
+    m_numResolved = 0;
+    m_unresolvedSymbols.clear();
+    m_multipleDefinitions.clear();
+
+    // a strong definition replaces weak ones (e.g. linkonce functions), otherwise
+    // the first definition wins and later ones are merged into it
+    Definitions definitions;
+    std::set<std::string> multipleDefinitions;
+    for (unsigned i = 0; i < nodes.size(); ++i) {
+        const auto& node = nodes[i];
+        if (!isSymbolNode(node) || !isDefinition(node)) {
+            continue;
+        }
+        auto inserted = definitions.insert(std::make_pair(getSymbolKey(node), i));
+        if (inserted.second || node.linkage != Linkage::Definition) {
+            continue;
+        }
+        const auto& definition = nodes[inserted.first->second];
+        if (definition.linkage == Linkage::WeakDefinition) {
+            inserted.first->second = i;
+        } else if (definition.linkage == Linkage::Definition && definition.module != node.module
+                   && node.argIdx < 0) {
+            // partial graphs of one module all define its globals
+            multipleDefinitions.insert(node.symbol);
+        }
+    }
+    m_multipleDefinitions.assign(multipleDefinitions.begin(), multipleDefinitions.end());
+
+    representatives.resize(nodes.size());
+    std::set<std::string> unresolved;
+    for (unsigned i = 0; i < nodes.size(); ++i) {
+        representatives[i] = i;
+        const auto& node = nodes[i];
+        if (!isSymbolNode(node)) {
+            continue;
+        }
+        auto pos = definitions.find(getSymbolKey(node));
+        if (pos == definitions.end()) {
+            if (node.argIdx < 0 && !isDefinition(node)) {
+                unresolved.insert(node.symbol);
+            }
+            continue;
+        }
+        if (pos->second != i) {
+            representatives[i] = pos->second;
+            ++m_numResolved;
+        }
+    }
+    m_unresolvedSymbols.assign(unresolved.begin(), unresolved.end());
+
+    // bodies of definitions that lost to another module's are dropped, only
+    // their function and formal argument nodes are merged into the winner's
+    discardedBodies.clear();
+    for (unsigned i = 0; i < nodes.size(); ++i) {
+        const auto& node = nodes[i];
+        if (node.type == PDGLLVMNode::FunctionNode && representatives[i] != i && isDefinition(node)
+                && nodes[representatives[i]].module != node.module) {
+            discardedBodies.insert(std::make_pair(node.module, node.symbol));
+        }
+    }
+}
+
+unsigned PDGLinker::getModuleId(SerializedPDG& pdg, ShardModuleIds& shardModuleIds,
+                                const std::string& moduleName, bool shard)
+{
+    // separate inputs never share local symbols, even if their modules have the same name
+    if (!shard) {
+        return pdg.addModule(moduleName);
+    }
+    auto pos = shardModuleIds.find(moduleName);
+    if (pos != shardModuleIds.end()) {
+        return pos->second;
+    }
+    const unsigned moduleId = pdg.addModule(moduleName);
+    shardModuleIds.insert(std::make_pair(moduleName, moduleId));
+    return moduleId;
+}
+
+bool PDGLinker::isSymbolNode(const SerializedPDG::Node& node)
+{
+    switch (node.type) {
+    case PDGLLVMNode::FunctionNode:
+    case PDGLLVMNode::FormalArgumentNode:
+    case PDGLLVMNode::VaArgumentNode:
+    case PDGLLVMNode::GlobalVariableNode:
+        return !node.symbol.empty();
+    default:
+        break;
+    }
+    return false;
+}
+
+bool PDGLinker::isDefinition(const SerializedPDG::Node& node)
+{
+    return node.linkage == Linkage::Definition || node.linkage == Linkage::Local
+        || node.linkage == Linkage::WeakDefinition;
+}
+
+PDGLinker::SymbolKey PDGLinker::getSymbolKey(const SerializedPDG::Node& node)
+{
+    const bool local = node.linkage == Linkage::Local || node.linkage == Linkage::LocalDeclaration;
+    return SymbolKey(local ? static_cast<int>(node.module) : -1, node.symbol, node.argIdx);
+}
+
+} // namespace pdg
+
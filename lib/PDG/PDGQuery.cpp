@@ -0,0 +1,648 @@
+#include "PDG/PDGQuery.h"
+
+#include "PDG/PDGLLVMNode.h"
+#include "PDG/PDGSlicer.h"
+
+#include "llvm/ADT/BitVector.h"
+#include "llvm/ADT/SmallVector.h"
+#include "llvm/IR/Instruction.h"
+#include "llvm/Support/raw_ostream.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cctype>
+#include <thread>
+
+namespace pdg {
+
+namespace {
+
+bool parseNodeType(llvm::StringRef name, unsigned& type)
+{
+    for (type = PDGLLVMNode::InstructionNode; type <= PDGLLVMNode::UnknownCalleeNode; ++type) {
+        if (name == getNodeTypeAsString(static_cast<PDGLLVMNode::NodeType>(type))) {
+            return true;
+        }
+    }
+    return false;
+}
+
+bool parseOpcode(llvm::StringRef name, unsigned& opcode)
+{
+    for (opcode = 1; opcode < llvm::Instruction::OtherOpsEnd; ++opcode) {
+        if (name == llvm::Instruction::getOpcodeName(opcode)) {
+            return true;
+        }
+    }
+    return false;
+}
+
+bool isIdentifierChar(char c)
+{
+    return std::isalnum(static_cast<unsigned char>(c)) || c == '_' || c == '.' || c == '$';
+}
+
+std::string getEdgePattern(const PDGQuery::Constraint& constraint)
+{
+    std::string pattern = "-[";
+    const char* kinds[] = {"data", "control", "summary"};
+    if (constraint.edges == AllEdges) {
+        pattern += "any";
+    } else {
+        for (unsigned kind = 0; kind < 3; ++kind) {
+            if (constraint.edges & (1u << kind)) {
+                pattern += pattern.size() == 2 ? "" : "|";
+                pattern += kinds[kind];
+            }
+        }
+    }
+    if (constraint.transitive) {
+        pattern += constraint.minLength == 0 ? "*" : "+";
+    }
+    return pattern + "]->";
+}
+
+} // unnamed namespace
+
+/// Recursive descent over the query text
+class QueryParser
+{
+public:
+    QueryParser(llvm::StringRef text, PDGQuery& query)
+        : m_text(text)
+        , m_pos(0)
+        , m_query(query)
+    {
+    }
+
+    bool parse()
+    {
+        do {
+            if (!parsePattern()) {
+                return false;
+            }
+        } while (consume(";") && !atEnd());
+        if (!atEnd()) {
+            return error("expected ';' or end of query");
+        }
+        return true;
+    }
+
+private:
+    bool parsePattern()
+    {
+        unsigned from;
+        if (!parseNode(from)) {
+            return false;
+        }
+        while (peek("-[") || peek("<-[")) {
+            PDGQuery::Constraint constraint;
+            const bool backward = consume("<-[");
+            if (!backward) {
+                consume("-[");
+            }
+            if (!parseEdges(constraint) || !consume(backward ? "]-" : "]->")) {
+                return error(backward ? "expected ']-'" : "expected ']->'");
+            }
+            unsigned to;
+            if (!parseNode(to)) {
+                return false;
+            }
+            constraint.from = backward ? to : from;
+            constraint.to = backward ? from : to;
+            m_query.m_constraints.push_back(constraint);
+            from = to;
+        }
+        return true;
+    }
+
+    bool parseNode(unsigned& variable)
+    {
+        if (!consume("(")) {
+            return error("expected '('");
+        }
+        const std::string name = parseIdentifier();
+        variable = getVariable(name);
+        if (consume(":")) {
+            do {
+                if (!parsePredicate(m_query.m_variables[variable])) {
+                    return false;
+                }
+            } while (consume(","));
+        }
+        if (!consume(")")) {
+            return error("expected ')'");
+        }
+        return true;
+    }
+
+    bool parsePredicate(PDGQuery::Variable& variable)
+    {
+        const std::string key = parseIdentifier();
+        if (!consume("=")) {
+            return error("expected '=' after predicate key");
+        }
+        PDGQuery::Predicate predicate;
+        if (peek("\"")) {
+            if (!parseString(predicate.value)) {
+                return false;
+            }
+        } else {
+            predicate.value = parseIdentifier();
+        }
+        predicate.number = 0;
+        if (key == "type") {
+            predicate.kind = PDGQuery::Predicate::Type;
+            if (!parseNodeType(predicate.value, predicate.number)) {
+                return error("unknown node type");
+            }
+        } else if (key == "opcode") {
+            predicate.kind = PDGQuery::Predicate::Opcode;
+            if (!parseOpcode(predicate.value, predicate.number)) {
+                return error("unknown opcode");
+            }
+        } else if (key == "callee") {
+            predicate.kind = PDGQuery::Predicate::Callee;
+        } else if (key == "label") {
+            predicate.kind = PDGQuery::Predicate::Label;
+        } else if (key == "function") {
+            predicate.kind = PDGQuery::Predicate::Function;
+        } else {
+            return error("expected type, opcode, callee, label or function");
+        }
+        if (predicate.value.empty()) {
+            return error("expected predicate value");
+        }
+        variable.predicates.push_back(predicate);
+        return true;
+    }
+
+    bool parseEdges(PDGQuery::Constraint& constraint)
+    {
+        constraint.edges = 0;
+        do {
+            const std::string kind = parseIdentifier();
+            if (kind == "data") {
+                constraint.edges |= DataEdges;
+            } else if (kind == "control") {
+                constraint.edges |= ControlEdges;
+            } else if (kind == "summary") {
+                constraint.edges |= SummaryEdges;
+            } else if (kind == "any") {
+                constraint.edges |= AllEdges;
+            } else {
+                return error("expected data, control, summary or any");
+            }
+        } while (consume("|"));
+        constraint.transitive = true;
+        if (consume("+")) {
+            constraint.minLength = 1;
+        } else if (consume("*")) {
+            constraint.minLength = 0;
+        } else {
+            constraint.minLength = 1;
+            constraint.transitive = false;
+        }
+        return true;
+    }
+
+    unsigned getVariable(const std::string& name)
+    {
+        auto& variables = m_query.m_variables;
+        if (!name.empty()) {
+            for (unsigned i = 0; i < variables.size(); ++i) {
+                if (variables[i].name == name) {
+                    return i;
+                }
+            }
+            m_query.m_outputs.push_back(variables.size());
+        }
+        variables.push_back(PDGQuery::Variable{name, {}});
+        return variables.size() - 1;
+    }
+
+    std::string parseIdentifier()
+    {
+        skipSpace();
+        const size_t begin = m_pos;
+        while (m_pos < m_text.size() && isIdentifierChar(m_text[m_pos])) {
+            ++m_pos;
+        }
+        return m_text.slice(begin, m_pos).str();
+    }
+
+    /// Double quoted string, in which a backslash escapes the next character
+    bool parseString(std::string& str)
+    {
+        consume("\"");
+        str.clear();
+        while (m_pos < m_text.size() && m_text[m_pos] != '"') {
+            if (m_text[m_pos] == '\\' && m_pos + 1 < m_text.size()) {
+                ++m_pos;
+            }
+            str += m_text[m_pos++];
+        }
+        if (m_pos == m_text.size()) {
+            return error("unterminated string");
+        }
+        ++m_pos;
+        return true;
+    }
+
+    bool peek(llvm::StringRef token)
+    {
+        skipSpace();
+        return m_text.substr(m_pos).startswith(token);
+    }
+
+    bool consume(llvm::StringRef token)
+    {
+        if (!peek(token)) {
+            return false;
+        }
+        m_pos += token.size();
+        return true;
+    }
+
+    bool atEnd()
+    {
+        skipSpace();
+        return m_pos == m_text.size();
+    }
+
+    void skipSpace()
+    {
+        while (m_pos < m_text.size() && std::isspace(static_cast<unsigned char>(m_text[m_pos]))) {
+            ++m_pos;
+        }
+    }
+
+    bool error(const char* message)
+    {
+        llvm::errs() << "query:" << m_pos + 1 << ": " << message << "\n";
+        return false;
+    }
+
+private:
+    llvm::StringRef m_text;
+    size_t m_pos;
+    PDGQuery& m_query;
+}; // class QueryParser
+
+std::unique_ptr<PDGQuery> PDGQuery::parse(llvm::StringRef text)
+{
+    std::unique_ptr<PDGQuery> query(new PDGQuery());
+    QueryParser parser(text, *query);
+    if (!parser.parse()) {
+        return nullptr;
+    }
+    return query;
+}
+
+/// Backtracking over the plan steps with the traversal state of one thread
+class QueryEngine::Evaluation
+{
+public:
+    Evaluation(const QueryEngine& engine, const PDGQuery& query, const std::vector<PlanStep>& plan)
+        : m_engine(engine)
+        , m_pdg(engine.m_pdg)
+        , m_query(query)
+        , m_plan(plan)
+        , m_bindings(query.getVariables().size(), FrozenPDG::InvalidNode)
+        , m_visited(engine.m_pdg.getNumNodes())
+    {
+    }
+
+    /// Matches with the first variable bound to each of the candidates
+    void run(const NodeList& candidates)
+    {
+        const auto& variable = m_query.getVariables()[m_plan[0].variable];
+        for (auto node : candidates) {
+            if (m_engine.matches(node, variable)) {
+                m_bindings[m_plan[0].variable] = node;
+                extend(1);
+            }
+        }
+    }
+
+    std::vector<QueryMatch>& getMatches()
+    {
+        return m_matches;
+    }
+
+private:
+    void extend(unsigned stepIndex)
+    {
+        if (stepIndex == m_plan.size()) {
+            QueryMatch match;
+            for (auto output : m_query.getOutputs()) {
+                match.push_back(m_bindings[output]);
+            }
+            m_matches.push_back(std::move(match));
+            return;
+        }
+        const PlanStep& step = m_plan[stepIndex];
+        const auto& variable = m_query.getVariables()[step.variable];
+        switch (step.kind) {
+        case PlanStep::Scan: {
+            llvm::ArrayRef<FrozenPDG::NodeId> candidates;
+            if (m_engine.getCandidates(variable, candidates)) {
+                for (auto node : candidates) {
+                    bind(stepIndex, step.variable, node);
+                }
+            } else {
+                for (FrozenPDG::NodeId node = 0; node < m_pdg.getNumNodes(); ++node) {
+                    bind(stepIndex, step.variable, node);
+                }
+            }
+            break;
+        }
+        case PlanStep::Expand: {
+            const auto& constraint = m_query.getConstraints()[step.constraint];
+            const bool forward = constraint.to == step.variable;
+            const auto start = m_bindings[forward ? constraint.from : constraint.to];
+            // the targets are collected first, the visited set is reused below
+            for (auto node : traverse(start, constraint, forward, FrozenPDG::InvalidNode)) {
+                bind(stepIndex, step.variable, node);
+            }
+            break;
+        }
+        case PlanStep::Check: {
+            const auto& constraint = m_query.getConstraints()[step.constraint];
+            const auto dest = m_bindings[constraint.to];
+            if (!traverse(m_bindings[constraint.from], constraint, true, dest).empty()) {
+                extend(stepIndex + 1);
+            }
+            break;
+        }
+        }
+    }
+
+    void bind(unsigned stepIndex, unsigned variable, FrozenPDG::NodeId node)
+    {
+        if (m_engine.matches(node, m_query.getVariables()[variable])) {
+            m_bindings[variable] = node;
+            extend(stepIndex + 1);
+        }
+    }
+
+    /// Ends of the paths of the constraint from start, or only dest if it is
+    /// given and reached
+    NodeList traverse(FrozenPDG::NodeId start, const PDGQuery::Constraint& constraint, bool forward,
+                      FrozenPDG::NodeId dest)
+    {
+        NodeList reached;
+        NodeList ends;
+        auto visit = [&] (FrozenPDG::NodeId node) {
+            if (!m_visited.test(node)) {
+                m_visited.set(node);
+                reached.push_back(node);
+                if (dest == FrozenPDG::InvalidNode || node == dest) {
+                    ends.push_back(node);
+                }
+            }
+        };
+        if (constraint.minLength == 0) {
+            visit(start);
+        }
+        auto expand = [&] (FrozenPDG::NodeId node) {
+            for (const auto& edge : forward ? m_pdg.getOutEdges(node) : m_pdg.getInEdges(node)) {
+                if (isFollowed(constraint.edges, edge)) {
+                    visit(edge.node);
+                }
+            }
+        };
+        expand(start);
+        for (size_t i = 0; constraint.transitive && i < reached.size() && (dest == FrozenPDG::InvalidNode || ends.empty()); ++i) {
+            expand(reached[i]);
+        }
+        for (auto node : reached) {
+            m_visited.reset(node);
+        }
+        return ends;
+    }
+
+private:
+    const QueryEngine& m_engine;
+    const FrozenPDG& m_pdg;
+    const PDGQuery& m_query;
+    const std::vector<PlanStep>& m_plan;
+    std::vector<FrozenPDG::NodeId> m_bindings;
+    llvm::BitVector m_visited;
+    std::vector<QueryMatch> m_matches;
+}; // class Evaluation
+
+std::vector<QueryMatch> QueryEngine::run(const PDGQuery& query, unsigned numThreads) const
+{
+    const std::vector<PlanStep> plan = compile(query);
+    if (plan.empty()) {
+        return std::vector<QueryMatch>();
+    }
+    // candidates of the first variable are grouped by function, one group per task
+    std::vector<NodeList> groups(m_pdg.getNumFunctions() + 1);
+    auto addCandidate = [&] (FrozenPDG::NodeId node) {
+        const auto function = m_pdg.getFunction(node);
+        groups[function == FrozenPDG::NoFunction ? m_pdg.getNumFunctions() : function].push_back(node);
+    };
+    llvm::ArrayRef<FrozenPDG::NodeId> candidates;
+    if (getCandidates(query.getVariables()[plan[0].variable], candidates)) {
+        std::for_each(candidates.begin(), candidates.end(), addCandidate);
+    } else {
+        for (FrozenPDG::NodeId node = 0; node < m_pdg.getNumNodes(); ++node) {
+            addCandidate(node);
+        }
+    }
+    groups.erase(std::remove_if(groups.begin(), groups.end(), [] (const NodeList& group) { return group.empty(); }),
+                 groups.end());
+
+    numThreads = std::max(1u, std::min<unsigned>(numThreads, groups.size()));
+    std::vector<std::vector<QueryMatch>> threadMatches(numThreads);
+    std::atomic<unsigned> nextGroup(0);
+    auto work = [&] (unsigned thread) {
+        Evaluation evaluation(*this, query, plan);
+        for (unsigned group = nextGroup++; group < groups.size(); group = nextGroup++) {
+            evaluation.run(groups[group]);
+        }
+        threadMatches[thread] = std::move(evaluation.getMatches());
+    };
+    std::vector<std::thread> threads;
+    for (unsigned thread = 1; thread < numThreads; ++thread) {
+        threads.emplace_back(work, thread);
+    }
+    work(0);
+    for (auto& thread : threads) {
+        thread.join();
+    }
+
+    std::vector<QueryMatch> matches;
+    for (auto& found : threadMatches) {
+        std::move(found.begin(), found.end(), std::back_inserter(matches));
+    }
+    // matches differing only in anonymous variables are the same
+    std::sort(matches.begin(), matches.end());
+    matches.erase(std::unique(matches.begin(), matches.end()), matches.end());
+    return matches;
+}
+
+std::string QueryEngine::explain(const PDGQuery& query) const
+{
+    std::string text;
+    llvm::raw_string_ostream out(text);
+    auto getName = [&] (unsigned variable) {
+        const auto& name = query.getVariables()[variable].name;
+        return name.empty() ? "_" + std::to_string(variable) : name;
+    };
+    for (const auto& step : compile(query)) {
+        const auto& variable = query.getVariables()[step.variable];
+        switch (step.kind) {
+        case PlanStep::Scan:
+            out << "scan " << getName(step.variable) << " of " << getNumCandidates(variable) << " candidates\n";
+            break;
+        case PlanStep::Expand: {
+            const auto& constraint = query.getConstraints()[step.constraint];
+            const bool forward = constraint.to == step.variable;
+            out << "expand " << getName(step.variable) << " " << (forward ? "along " : "against ")
+                << getEdgePattern(constraint) << " from " << getName(forward ? constraint.from : constraint.to) << "\n";
+            break;
+        }
+        case PlanStep::Check: {
+            const auto& constraint = query.getConstraints()[step.constraint];
+            out << "check " << getName(constraint.from) << " " << getEdgePattern(constraint) << " "
+                << getName(constraint.to) << "\n";
+            break;
+        }
+        }
+    }
+    return out.str();
+}
+
+bool QueryEngine::getCandidates(const PDGQuery::Variable& variable,
+                                llvm::ArrayRef<FrozenPDG::NodeId>& candidates) const
+{
+    bool indexed = false;
+    for (const auto& predicate : variable.predicates) {
+        llvm::ArrayRef<FrozenPDG::NodeId> nodes;
+        switch (predicate.kind) {
+        case PDGQuery::Predicate::Type:
+            nodes = m_pdg.getNodesOfType(predicate.number);
+            break;
+        case PDGQuery::Predicate::Opcode:
+            nodes = m_pdg.getNodesWithOpcode(predicate.number);
+            break;
+        case PDGQuery::Predicate::Callee:
+            nodes = m_pdg.getCallSites(predicate.value);
+            break;
+        case PDGQuery::Predicate::Label:
+            nodes = m_pdg.getNodesWithLabel(predicate.value);
+            break;
+        case PDGQuery::Predicate::Function:
+            continue;
+        }
+        if (!indexed || nodes.size() < candidates.size()) {
+            candidates = nodes;
+            indexed = true;
+        }
+    }
+    return indexed;
+}
+
+uint64_t QueryEngine::getNumCandidates(const PDGQuery::Variable& variable) const
+{
+    llvm::ArrayRef<FrozenPDG::NodeId> candidates;
+    return getCandidates(variable, candidates) ? candidates.size() : m_pdg.getNumNodes();
+}
+
+std::vector<QueryEngine::PlanStep> QueryEngine::compile(const PDGQuery& query) const
+{
+    const auto& variables = query.getVariables();
+    const auto& constraints = query.getConstraints();
+    std::vector<PlanStep> plan;
+    std::vector<bool> bound(variables.size());
+    std::vector<bool> done(constraints.size());
+    auto addChecks = [&] () {
+        for (unsigned i = 0; i < constraints.size(); ++i) {
+            if (!done[i] && bound[constraints[i].from] && bound[constraints[i].to]) {
+                plan.push_back(PlanStep{PlanStep::Check, constraints[i].to, i});
+                done[i] = true;
+            }
+        }
+    };
+    for (unsigned numBound = 0; numBound < variables.size(); ++numBound) {
+        // prefer joining along a constraint to the variable with fewest candidates
+        unsigned bestVariable = variables.size();
+        unsigned bestConstraint = constraints.size();
+        for (unsigned i = 0; i < constraints.size(); ++i) {
+            const auto& constraint = constraints[i];
+            if (bound[constraint.from] == bound[constraint.to]) {
+                continue;
+            }
+            const unsigned variable = bound[constraint.from] ? constraint.to : constraint.from;
+            if (bestVariable == variables.size()
+                    || getNumCandidates(variables[variable]) < getNumCandidates(variables[bestVariable])) {
+                bestVariable = variable;
+                bestConstraint = i;
+            }
+        }
+        if (bestConstraint != constraints.size()) {
+            plan.push_back(PlanStep{PlanStep::Expand, bestVariable, bestConstraint});
+            done[bestConstraint] = true;
+        } else {
+            // the first variable, or one not connected to the bound ones
+            for (unsigned variable = 0; variable < variables.size(); ++variable) {
+                if (!bound[variable] && (bestVariable == variables.size()
+                        || getNumCandidates(variables[variable]) < getNumCandidates(variables[bestVariable]))) {
+                    bestVariable = variable;
+                }
+            }
+            plan.push_back(PlanStep{PlanStep::Scan, bestVariable, 0});
+        }
+        bound[bestVariable] = true;
+        addChecks();
+    }
+    return plan;
+}
+
+bool QueryEngine::matches(FrozenPDG::NodeId node, const PDGQuery::Variable& variable) const
+{
+    for (const auto& predicate : variable.predicates) {
+        bool matched = false;
+        switch (predicate.kind) {
+        case PDGQuery::Predicate::Type:
+            matched = m_pdg.getNodeType(node) == predicate.number;
+            break;
+        case PDGQuery::Predicate::Opcode:
+            matched = m_pdg.getOpcode(node) == predicate.number;
+            break;
+        case PDGQuery::Predicate::Callee:
+            matched = isCallOf(node, predicate.value);
+            break;
+        case PDGQuery::Predicate::Label:
+            matched = m_pdg.getMetadataLabel(node) == predicate.value;
+            break;
+        case PDGQuery::Predicate::Function: {
+            const auto function = m_pdg.getFunction(node);
+            matched = function != FrozenPDG::NoFunction && m_pdg.getFunctionName(function) == predicate.value;
+            break;
+        }
+        }
+        if (!matched) {
+            return false;
+        }
+    }
+    return true;
+}
+
+bool QueryEngine::isCallOf(FrozenPDG::NodeId node, llvm::StringRef callee) const
+{
+    for (const auto& edge : m_pdg.getOutEdges(node)) {
+        if (edge.getKind() == SerializedPDG::EdgeKind::Control
+                && m_pdg.getNodeType(edge.node) == PDGLLVMNode::FunctionNode
+                && m_pdg.getSymbol(edge.node) == callee) {
+            return true;
+        }
+    }
+    return false;
+}
+
+} // namespace pdg
+
@@ -0,0 +1,87 @@
+#include "PDG/PDGSlicer.h"
+
+#include <algorithm>
+
+namespace pdg {
+
+Slice::Slice(std::vector<FrozenPDG::NodeId> nodes, bool complete)
+    : m_nodes(std::move(nodes))
+    , m_complete(complete)
+{
+    std::sort(m_nodes.begin(), m_nodes.end());
+}
+
+bool Slice::contains(FrozenPDG::NodeId node) const
+{
+    return std::binary_search(m_nodes.begin(), m_nodes.end(), node);
+}
+
+PDGSlicer::PDGSlicer(const FrozenPDG& pdg)
+    : m_pdg(pdg)
+    , m_visited(pdg.getNumNodes())
+{
+}
+
+Slice PDGSlicer::slice(llvm::ArrayRef<FrozenPDG::NodeId> criteria,
+                       const SliceOptions& options,
+                       const Visitor& visitor)
+{
+    const bool backward = options.direction == SliceDirection::Backward;
+    // reached nodes double as the breadth first queue
+    std::vector<FrozenPDG::NodeId> nodes;
+    bool complete = true;
+    auto reach = [&] (FrozenPDG::NodeId node) {
+        if (m_visited.test(node)) {
+            return true;
+        }
+        m_visited.set(node);
+        nodes.push_back(node);
+        return !visitor || visitor(node);
+    };
+    for (auto criterion : criteria) {
+        if (criterion < m_pdg.getNumNodes() && !reach(criterion)) {
+            complete = false;
+            break;
+        }
+    }
+    for (size_t i = 0; complete && i < nodes.size(); ++i) {
+        const auto node = nodes[i];
+        const auto function = m_pdg.getFunction(node);
+        for (const auto& edge : backward ? m_pdg.getInEdges(node) : m_pdg.getOutEdges(node)) {
+            if (!isFollowed(options.edges, edge)) {
+                continue;
+            }
+            if (!options.interprocedural && m_pdg.getFunction(edge.node) != function) {
+                continue;
+            }
+            if (!reach(edge.node)) {
+                complete = false;
+                break;
+            }
+        }
+    }
+    // only the reached bits are cleared, not the whole set
+    for (auto node : nodes) {
+        m_visited.reset(node);
+    }
+    return Slice(std::move(nodes), complete);
+}
+
+Slice PDGSlicer::backwardSlice(llvm::ArrayRef<FrozenPDG::NodeId> criteria, unsigned edges)
+{
+    SliceOptions options;
+    options.direction = SliceDirection::Backward;
+    options.edges = edges;
+    return slice(criteria, options);
+}
+
+Slice PDGSlicer::forwardSlice(llvm::ArrayRef<FrozenPDG::NodeId> criteria, unsigned edges)
+{
+    SliceOptions options;
+    options.direction = SliceDirection::Forward;
+    options.edges = edges;
+    return slice(criteria, options);
+}
+
+} // namespace pdg
+
@@ -0,0 +1,29 @@
+#include "PDG/PDGSnapshot.h"
+
+namespace pdg {
+
+PDGSnapshot::PDGSnapshot(std::unique_ptr<FrozenPDG> pdg, bool buildIndex, uint64_t version, uint64_t sliceCacheSize)
+    : m_pdg(std::move(pdg))
+    , m_version(version)
+{
+    if (buildIndex) {
+        m_index.reset(new ReachabilityIndex(*m_pdg));
+    }
+    if (sliceCacheSize != 0) {
+        // slices share the components of the index
+        m_sliceCache.reset(new SliceCache(*m_pdg, m_index.get(), sliceCacheSize));
+    }
+}
+
+std::shared_ptr<const PDGSnapshot> PDGSnapshot::open(const std::string& directory, bool buildIndex, uint64_t version,
+                                                     uint64_t sliceCacheSize)
+{
+    auto pdg = FrozenPDG::open(directory);
+    if (!pdg) {
+        return nullptr;
+    }
+    return std::make_shared<const PDGSnapshot>(std::move(pdg), buildIndex, version, sliceCacheSize);
+}
+
+} // namespace pdg
+
@@ -0,0 +1,486 @@
+#include "PDG/PointerAnalysisCache.h"
+
+#include "PDG/PDGLLVMNode.h"
+
+#include "llvm/ADT/SmallString.h"
+#include "llvm/ADT/SmallVector.h"
+#include "llvm/Bitcode/BitcodeWriter.h"
+#include "llvm/IR/CallSite.h"
+#include "llvm/IR/Function.h"
+#include "llvm/IR/Instructions.h"
+#include "llvm/IR/Module.h"
+#include "llvm/Support/FileSystem.h"
+#include "llvm/Support/MD5.h"
+#include "llvm/Support/Path.h"
+#include "llvm/Support/raw_ostream.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <fstream>
+#include <sstream>
+
+#include <unistd.h>
+
+namespace pdg {
+
+namespace {
+
+const char* CacheFormat = "pdg-pta-cache 1";
+
+template <typename T>
+void writeList(std::ostream& out, const std::vector<T>& list)
+{
+    out << " " << list.size();
+    for (const auto& item : list) {
+        out << " " << item;
+    }
+}
+
+template <typename T>
+bool readList(std::istream& in, std::vector<T>& list)
+{
+    size_t size = 0;
+    if (!(in >> size)) {
+        return false;
+    }
+    // the size of a corrupt record may be anything, so it is not reserved
+    list.clear();
+    for (size_t i = 0; i < size; ++i) {
+        T item;
+        if (!(in >> item)) {
+            return false;
+        }
+        list.push_back(item);
+    }
+    return true;
+}
+
+} // unnamed namespace
+
+PointerAnalysisCacheEntry::PointerAnalysisCacheEntry(llvm::Module& M, const std::string& path)
+    : m_module(M)
+    , m_path(path)
+    , m_loaded(false)
+    , m_complete(true)
+    , m_hasBlockFeatures(false)
+{
+    numberValues();
+}
+
+bool PointerAnalysisCacheEntry::load()
+{
+    std::ifstream in(m_path);
+    if (!in) {
+        return false;
+    }
+    if (!read(in)) {
+        // a partially read file is no better than a miss
+        m_defSites.clear();
+        m_callSites.clear();
+        m_blockFeatures.clear();
+        m_hasBlockFeatures = false;
+        return false;
+    }
+    m_loaded = true;
+    return true;
+}
+
+bool PointerAnalysisCacheEntry::save() const
+{
+    if (!m_complete) {
+        return false;
+    }
+    // concurrent workers may store the same module, the rename keeps the entry whole
+    const std::string tmpPath = m_path + "." + std::to_string(getpid());
+    {
+        std::ofstream out(tmpPath);
+        if (!out) {
+            llvm::errs() << "Could not write pointer analysis cache " << tmpPath << "\n";
+            return false;
+        }
+        write(out);
+        // a short write, e.g. on a full disk, must not be renamed into place
+        out.close();
+        if (out.fail()) {
+            llvm::errs() << "Could not write pointer analysis cache " << tmpPath << "\n";
+            std::remove(tmpPath.c_str());
+            return false;
+        }
+    }
+    if (std::rename(tmpPath.c_str(), m_path.c_str()) != 0) {
+        std::remove(tmpPath.c_str());
+        return false;
+    }
+    return true;
+}
+
+bool PointerAnalysisCacheEntry::findDefSite(llvm::Value* value, DefSite& defSite)
+{
+    const int id = getValueId(value);
+    if (id < 0) {
+        return false;
+    }
+    // same node for repeated queries, as the analysis results do
+    auto replayed = m_replayedDefSites.find(id);
+    if (replayed != m_replayedDefSites.end()) {
+        defSite = replayed->second;
+        return true;
+    }
+    auto pos = m_defSites.find(id);
+    if (pos == m_defSites.end()) {
+        return false;
+    }
+    defSite = DefSite(nullptr, PDGNodeTy());
+    const DefSiteRecord& record = pos->second;
+    if (record.value >= 0) {
+        defSite.first = getValue(record.value);
+    }
+    if (record.nodeKind == DefNodeKind::Instruction) {
+        if (auto* instr = llvm::dyn_cast_or_null<llvm::Instruction>(defSite.first)) {
+            defSite.second.reset(new PDGLLVMInstructionNode(instr));
+        }
+    } else if (record.nodeKind == DefNodeKind::Phi) {
+        PDGPhiNode::Values values;
+        PDGPhiNode::Blocks blocks;
+        for (unsigned i = 0; i < record.phiValues.size(); ++i) {
+            values.push_back(getValue(record.phiValues[i]));
+            blocks.push_back(llvm::dyn_cast<llvm::BasicBlock>(getValue(record.phiBlocks[i])));
+        }
+        defSite.second.reset(new PDGPhiNode(values, blocks));
+    }
+    m_replayedDefSites.insert(std::make_pair(id, defSite));
+    return true;
+}
+
+void PointerAnalysisCacheEntry::addDefSite(llvm::Value* value, const DefSite& defSite)
+{
+    const int id = getValueId(value);
+    DefSiteRecord record{-1, DefNodeKind::None, {}, {}};
+    if (defSite.first) {
+        record.value = getValueId(defSite.first);
+    }
+    if (auto* phiNode = llvm::dyn_cast_or_null<PDGPhiNode>(defSite.second.get())) {
+        record.nodeKind = DefNodeKind::Phi;
+        for (unsigned i = 0; i < phiNode->getNumValues(); ++i) {
+            const int valueId = getValueId(phiNode->getValue(i));
+            const int blockId = getValueId(phiNode->getBlock(i));
+            if (valueId < 0 || blockId < 0) {
+                m_complete = false;
+                return;
+            }
+            record.phiValues.push_back(valueId);
+            record.phiBlocks.push_back(blockId);
+        }
+    } else if (defSite.second) {
+        record.nodeKind = DefNodeKind::Instruction;
+    }
+    if (id < 0 || (defSite.first && record.value < 0)) {
+        m_complete = false;
+        return;
+    }
+    m_defSites[id] = std::move(record);
+}
+
+bool PointerAnalysisCacheEntry::hasCallSite(const llvm::CallSite& callSite) const
+{
+    return m_callSites.find(getValueId(callSite.getInstruction())) != m_callSites.end();
+}
+
+bool PointerAnalysisCacheEntry::hasIndCSCallees(const llvm::CallSite& callSite) const
+{
+    auto pos = m_callSites.find(getValueId(callSite.getInstruction()));
+    return pos != m_callSites.end() && pos->second.hasCallees;
+}
+
+PointerAnalysisCacheEntry::FunctionSet PointerAnalysisCacheEntry::getIndCSCallees(const llvm::CallSite& callSite) const
+{
+    FunctionSet callees;
+    auto pos = m_callSites.find(getValueId(callSite.getInstruction()));
+    if (pos == m_callSites.end()) {
+        return callees;
+    }
+    for (unsigned id : pos->second.callees) {
+        if (auto* F = llvm::dyn_cast<llvm::Function>(getValue(id))) {
+            callees.insert(F);
+        }
+    }
+    return callees;
+}
+
+void PointerAnalysisCacheEntry::addIndCSCallees(const llvm::CallSite& callSite,
+                                                bool hasCallees,
+                                                const FunctionSet& callees)
+{
+    const int id = getValueId(callSite.getInstruction());
+    if (id < 0) {
+        m_complete = false;
+        return;
+    }
+    CallSiteRecord record{hasCallees, {}};
+    for (auto* F : callees) {
+        const int calleeId = getValueId(F);
+        if (calleeId < 0) {
+            m_complete = false;
+            return;
+        }
+        record.callees.push_back(calleeId);
+    }
+    m_callSites[id] = std::move(record);
+}
+
+PointerAnalysisCacheEntry::Features PointerAnalysisCacheEntry::getBlockFeatures(llvm::BasicBlock* block) const
+{
+    auto pos = m_blockFeatures.find(getValueId(block));
+    if (pos == m_blockFeatures.end()) {
+        return Features();
+    }
+    return pos->second;
+}
+
+void PointerAnalysisCacheEntry::addBlockFeatures(llvm::BasicBlock* block, const Features& features)
+{
+    const int id = getValueId(block);
+    if (id < 0) {
+        m_complete = false;
+        return;
+    }
+    m_blockFeatures[id] = features;
+}
+
+void PointerAnalysisCacheEntry::numberValues()
+{
+    auto addValue = [this] (llvm::Value* value) {
+        m_valueIds.insert(std::make_pair(value, m_values.size()));
+        m_values.push_back(value);
+    };
+    for (auto& global : m_module.globals()) {
+        addValue(&global);
+    }
+    for (auto& F : m_module) {
+        addValue(&F);
+    }
+    for (auto& F : m_module) {
+        for (auto& arg : F.args()) {
+            addValue(&arg);
+        }
+        for (auto& B : F) {
+            addValue(&B);
+            for (auto& I : B) {
+                addValue(&I);
+            }
+        }
+    }
+}
+
+int PointerAnalysisCacheEntry::getValueId(const llvm::Value* value) const
+{
+    auto pos = m_valueIds.find(value);
+    if (pos == m_valueIds.end()) {
+        return -1;
+    }
+    return pos->second;
+}
+
+llvm::Value* PointerAnalysisCacheEntry::getValue(unsigned id) const
+{
+    return id < m_values.size() ? m_values[id] : nullptr;
+}
+
+bool PointerAnalysisCacheEntry::read(std::istream& in)
+{
+    std::string line;
+    if (!std::getline(in, line) || line != CacheFormat) {
+        return false;
+    }
+    // records of a corrupt or edited entry must not reach the replay
+    auto isValueId = [this] (unsigned id) {
+        return id < m_values.size();
+    };
+    auto areValueIds = [&] (const std::vector<unsigned>& ids) {
+        return std::all_of(ids.begin(), ids.end(), isValueId);
+    };
+    while (std::getline(in, line)) {
+        std::istringstream record(line);
+        std::string kind;
+        record >> kind;
+        unsigned id = 0;
+        if (kind == "defsite") {
+            DefSiteRecord defSite;
+            int nodeKind = 0;
+            if (!(record >> id >> defSite.value >> nodeKind)
+                    || !readList(record, defSite.phiValues)
+                    || !readList(record, defSite.phiBlocks)) {
+                return false;
+            }
+            if (!isValueId(id) || defSite.value < -1 || (defSite.value >= 0 && !isValueId(defSite.value))
+                    || nodeKind < static_cast<int>(DefNodeKind::None) || nodeKind > static_cast<int>(DefNodeKind::Phi)
+                    || defSite.phiValues.size() != defSite.phiBlocks.size() || !areValueIds(defSite.phiValues)) {
+                return false;
+            }
+            for (unsigned block : defSite.phiBlocks) {
+                if (!isValueId(block) || !llvm::isa<llvm::BasicBlock>(m_values[block])) {
+                    return false;
+                }
+            }
+            defSite.nodeKind = static_cast<DefNodeKind>(nodeKind);
+            m_defSites[id] = std::move(defSite);
+        } else if (kind == "callsite") {
+            CallSiteRecord callSite;
+            if (!(record >> id >> callSite.hasCallees) || !readList(record, callSite.callees)) {
+                return false;
+            }
+            if (!isValueId(id) || !areValueIds(callSite.callees)) {
+                return false;
+            }
+            m_callSites[id] = std::move(callSite);
+        } else if (kind == "features") {
+            Features features;
+            if (!(record >> id) || !readList(record, features) || !isValueId(id)) {
+                return false;
+            }
+            m_blockFeatures[id] = std::move(features);
+        } else if (kind == "has-features") {
+            m_hasBlockFeatures = true;
+        } else {
+            return false;
+        }
+    }
+    return true;
+}
+
+void PointerAnalysisCacheEntry::write(std::ostream& out) const
+{
+    out << CacheFormat << "\n";
+    for (const auto& entry : m_defSites) {
+        const DefSiteRecord& defSite = entry.second;
+        out << "defsite " << entry.first << " " << defSite.value << " " << static_cast<int>(defSite.nodeKind);
+        writeList(out, defSite.phiValues);
+        writeList(out, defSite.phiBlocks);
+        out << "\n";
+    }
+    for (const auto& entry : m_callSites) {
+        out << "callsite " << entry.first << " " << entry.second.hasCallees;
+        writeList(out, entry.second.callees);
+        out << "\n";
+    }
+    for (const auto& entry : m_blockFeatures) {
+        out << "features " << entry.first;
+        writeList(out, entry.second);
+        out << "\n";
+    }
+    if (m_hasBlockFeatures) {
+        out << "has-features\n";
+    }
+}
+
+PointerAnalysisCache::PointerAnalysisCache(const std::string& directory)
+    : m_directory(directory)
+{
+}
+
+PointerAnalysisCache::EntryTy PointerAnalysisCache::getEntry(llvm::Module& M)
+{
+    if (auto EC = llvm::sys::fs::create_directories(m_directory)) {
+        llvm::errs() << "Could not create pointer analysis cache " << m_directory << ": "
+                     << EC.message() << "\n";
+        return EntryTy();
+    }
+    llvm::SmallString<256> path(m_directory);
+    llvm::sys::path::append(path, getModuleHash(M) + ".pta");
+    EntryTy entry = std::make_shared<PointerAnalysisCacheEntry>(M, path.str());
+    entry->load();
+    return entry;
+}
+
+std::string PointerAnalysisCache::getModuleHash(llvm::Module& M)
+{
+    llvm::SmallVector<char, 0> buffer;
+    llvm::raw_svector_ostream stream(buffer);
+    llvm::WriteBitcodeToFile(M, stream);
+    llvm::MD5 hash;
+    hash.update(llvm::StringRef(buffer.data(), buffer.size()));
+    llvm::MD5::MD5Result result;
+    hash.final(result);
+    return result.digest().str();
+}
+
+CachedDefUseResults::CachedDefUseResults(EntryTy entry,
+                                         DefUseResultsTy results,
+                                         const DefUseResultsGetter& resultsGetter)
+    : m_entry(entry)
+    , m_results(results)
+    , m_resultsGetter(resultsGetter)
+{
+}
+
+DefUseResults::DefSite CachedDefUseResults::getDefNode(llvm::Value* value)
+{
+    if (!m_results) {
+        DefSite defSite(nullptr, PDGNodeTy());
+        if (m_entry->findDefSite(value, defSite)) {
+            return defSite;
+        }
+        // an empty def site would silently drop the dependence
+        if (m_resultsGetter) {
+            m_results = m_resultsGetter();
+        }
+        if (!m_results) {
+            llvm::errs() << "No def site cached for " << *value << "\n";
+            return defSite;
+        }
+        m_entry->invalidate();
+    }
+    const DefSite defSite = m_results->getDefNode(value);
+    m_entry->addDefSite(value, defSite);
+    return defSite;
+}
+
+CachedIndirectCallSiteResults::CachedIndirectCallSiteResults(EntryTy entry,
+                                                             IndCSResultsTy results,
+                                                             const IndCSResultsGetter& resultsGetter)
+    : m_entry(entry)
+    , m_results(results)
+    , m_resultsGetter(resultsGetter)
+{
+}
+
+bool CachedIndirectCallSiteResults::getResults(const llvm::CallSite& callSite) const
+{
+    if (m_results) {
+        return true;
+    }
+    if (m_entry->hasCallSite(callSite)) {
+        return false;
+    }
+    if (m_resultsGetter) {
+        m_results = m_resultsGetter();
+    }
+    if (!m_results) {
+        llvm::errs() << "No callees cached for " << *callSite.getInstruction() << "\n";
+        return false;
+    }
+    m_entry->invalidate();
+    return true;
+}
+
+bool CachedIndirectCallSiteResults::hasIndCSCallees(const llvm::CallSite& callSite) const
+{
+    if (!getResults(callSite)) {
+        return m_entry->hasIndCSCallees(callSite);
+    }
+    const bool hasCallees = m_results->hasIndCSCallees(callSite);
+    m_entry->addIndCSCallees(callSite, hasCallees,
+                             hasCallees ? m_results->getIndCSCallees(callSite) : FunctionSet());
+    return hasCallees;
+}
+
+IndirectCallSiteResults::FunctionSet CachedIndirectCallSiteResults::getIndCSCallees(const llvm::CallSite& callSite)
+{
+    if (!getResults(callSite)) {
+        return m_entry->getIndCSCallees(callSite);
+    }
+    return m_results->getIndCSCallees(callSite);
+}
+
+} // namespace pdg
+
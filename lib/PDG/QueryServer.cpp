@@ -0,0 +1,435 @@
+#include "PDG/QueryServer.h"
+
+#include "llvm/ADT/SmallString.h"
+#include "llvm/ADT/SmallVector.h"
+#include "llvm/Support/FileSystem.h"
+#include "llvm/Support/raw_ostream.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <chrono>
+#include <cstring>
+#include <thread>
+
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+namespace pdg {
+
+namespace {
+
+/// Requests larger than this are rejected and their connection closed
+const uint32_t MaxRequestSize = 1u << 24;
+
+/// Bounds of the pause after a failed accept in milliseconds, doubled on
+/// every failure in a row
+const unsigned MinAcceptBackoff = 10;
+const unsigned MaxAcceptBackoff = 1000;
+
+bool readFully(int fd, char* data, size_t size)
+{
+    while (size != 0) {
+        const ssize_t count = ::read(fd, data, size);
+        if (count < 0 && errno == EINTR) {
+            continue;
+        }
+        if (count <= 0) {
+            return false;
+        }
+        data += count;
+        size -= count;
+    }
+    return true;
+}
+
+bool writeFully(int fd, const char* data, size_t size)
+{
+    while (size != 0) {
+        // a client gone away must not raise SIGPIPE
+        const ssize_t count = ::send(fd, data, size, MSG_NOSIGNAL);
+        if (count < 0 && errno == EINTR) {
+            continue;
+        }
+        if (count <= 0) {
+            return false;
+        }
+        data += count;
+        size -= count;
+    }
+    return true;
+}
+
+bool readFrame(int fd, std::string& frame)
+{
+    unsigned char header[4];
+    if (!readFully(fd, reinterpret_cast<char*>(header), sizeof(header))) {
+        return false;
+    }
+    const uint32_t size = header[0] | (header[1] << 8) | (header[2] << 16) | (uint32_t(header[3]) << 24);
+    if (size > MaxRequestSize) {
+        return false;
+    }
+    frame.resize(size);
+    return readFully(fd, &frame[0], size);
+}
+
+bool writeFrame(int fd, const std::string& frame)
+{
+    const uint32_t size = frame.size();
+    const unsigned char header[4] = {static_cast<unsigned char>(size),
+                                     static_cast<unsigned char>(size >> 8),
+                                     static_cast<unsigned char>(size >> 16),
+                                     static_cast<unsigned char>(size >> 24)};
+    return writeFully(fd, reinterpret_cast<const char*>(header), sizeof(header))
+        && writeFully(fd, frame.data(), frame.size());
+}
+
+bool parseEdges(llvm::StringRef field, unsigned& edges)
+{
+    if (field == "all") {
+        edges = AllEdges;
+        return true;
+    }
+    llvm::SmallVector<llvm::StringRef, 3> kinds;
+    field.split(kinds, ',');
+    edges = 0;
+    for (auto kind : kinds) {
+        if (kind == "data") {
+            edges |= DataEdges;
+        } else if (kind == "control") {
+            edges |= ControlEdges;
+        } else if (kind == "summary") {
+            edges |= SummaryEdges;
+        } else {
+            return false;
+        }
+    }
+    return true;
+}
+
+const char* getEdgeKindName(SerializedPDG::EdgeKind kind)
+{
+    switch (kind) {
+    case SerializedPDG::EdgeKind::Data:
+        return "data";
+    case SerializedPDG::EdgeKind::Control:
+        return "control";
+    case SerializedPDG::EdgeKind::Summary:
+        return "summary";
+    }
+    return "";
+}
+
+/// Removes a socket left behind at the address by a server that is gone.
+/// Fails if a server still accepts connections there, or if the path is not
+/// a socket.
+bool removeStaleSocket(const sockaddr_un& address)
+{
+    struct stat st;
+    if (::lstat(address.sun_path, &st) != 0) {
+        return errno == ENOENT;
+    }
+    if (!S_ISSOCK(st.st_mode)) {
+        llvm::errs() << address.sun_path << " exists and is not a socket\n";
+        return false;
+    }
+    const int fd = ::socket(AF_UNIX, SOCK_STREAM, 0);
+    if (fd == -1) {
+        llvm::errs() << "Could not create socket: " << std::strerror(errno) << "\n";
+        return false;
+    }
+    const bool live = ::connect(fd, reinterpret_cast<const sockaddr*>(&address), sizeof(address)) == 0;
+    const int error = errno;
+    ::close(fd);
+    if (live) {
+        llvm::errs() << "A server is listening on " << address.sun_path << " already\n";
+        return false;
+    }
+    if (error != ECONNREFUSED) {
+        llvm::errs() << "Could not connect to " << address.sun_path << ": " << std::strerror(error) << "\n";
+        return false;
+    }
+    return ::unlink(address.sun_path) == 0 || errno == ENOENT;
+}
+
+} // unnamed namespace
+
+const PDGSnapshot& QueryServer::Session::bind(std::shared_ptr<const PDGSnapshot> snapshot)
+{
+    if (snapshot != m_snapshot) {
+        m_chopper.reset();
+        m_slicer.reset();
+        m_snapshot = std::move(snapshot);
+    }
+    return *m_snapshot;
+}
+
+PDGSlicer& QueryServer::Session::getSlicer()
+{
+    // most requests are answered by the slice cache or the index, and the
+    // slicer state is as large as the graph
+    if (!m_slicer) {
+        m_slicer.reset(new PDGSlicer(m_snapshot->getPDG()));
+    }
+    return *m_slicer;
+}
+
+PDGChopper& QueryServer::Session::getChopper()
+{
+    if (!m_chopper) {
+        m_chopper.reset(new PDGChopper(m_snapshot->getPDG()));
+    }
+    return *m_chopper;
+}
+
+QueryServer::QueryServer(SnapshotPublisher& snapshots)
+    : m_snapshots(snapshots)
+    , m_listenFd(-1)
+    , m_stopped(false)
+    , m_maxConnections(64)
+{
+}
+
+QueryServer::~QueryServer()
+{
+    if (m_listenFd != -1) {
+        ::close(m_listenFd);
+        ::unlink(m_path.c_str());
+    }
+}
+
+bool QueryServer::listen(const std::string& path)
+{
+    sockaddr_un address;
+    std::memset(&address, 0, sizeof(address));
+    address.sun_family = AF_UNIX;
+    if (path.size() >= sizeof(address.sun_path)) {
+        llvm::errs() << path << ": socket path too long\n";
+        return false;
+    }
+    std::strcpy(address.sun_path, path.c_str());
+    m_listenFd = ::socket(AF_UNIX, SOCK_STREAM, 0);
+    if (m_listenFd == -1) {
+        llvm::errs() << "Could not create socket: " << std::strerror(errno) << "\n";
+        return false;
+    }
+    if (!removeStaleSocket(address)) {
+        ::close(m_listenFd);
+        m_listenFd = -1;
+        return false;
+    }
+    // the socket file is created with the process umask, which threads share,
+    // so listen has to be called before serving
+    const mode_t umask = ::umask(S_IRWXG | S_IRWXO | S_IXUSR);
+    const bool bound = ::bind(m_listenFd, reinterpret_cast<sockaddr*>(&address), sizeof(address)) == 0;
+    ::umask(umask);
+    if (!bound || ::listen(m_listenFd, SOMAXCONN) != 0) {
+        llvm::errs() << "Could not listen on " << path << ": " << std::strerror(errno) << "\n";
+        ::close(m_listenFd);
+        m_listenFd = -1;
+        return false;
+    }
+    m_path = path;
+    return true;
+}
+
+void QueryServer::serve()
+{
+    unsigned backoff = MinAcceptBackoff;
+    while (!m_stopped) {
+        {
+            // further clients wait in the listen backlog; stop can not notify
+            // from a signal handler, so the wait polls it
+            std::unique_lock<std::mutex> guard(m_connectionsLock);
+            while (!m_stopped && m_connections.size() >= m_maxConnections) {
+                m_connectionsClosed.wait_for(guard, std::chrono::milliseconds(100));
+            }
+        }
+        if (m_stopped) {
+            break;
+        }
+        const int fd = ::accept(m_listenFd, nullptr, nullptr);
+        if (fd == -1) {
+            const int error = errno;
+            if (m_stopped) {
+                break;
+            }
+            if (error == EINTR || error == ECONNABORTED) {
+                continue;
+            }
+            // running out of descriptors or memory passes as connections close
+            llvm::errs() << "Could not accept a connection: " << std::strerror(error) << "\n";
+            std::this_thread::sleep_for(std::chrono::milliseconds(backoff));
+            backoff = std::min(backoff * 2, MaxAcceptBackoff);
+            continue;
+        }
+        backoff = MinAcceptBackoff;
+        std::lock_guard<std::mutex> guard(m_connectionsLock);
+        m_connections.push_back(fd);
+        std::thread(&QueryServer::serveConnection, this, fd).detach();
+    }
+    // blocked reads of open connections return once their sockets are shut down
+    std::unique_lock<std::mutex> guard(m_connectionsLock);
+    for (auto fd : m_connections) {
+        ::shutdown(fd, SHUT_RDWR);
+    }
+    m_connectionsClosed.wait(guard, [this] () { return m_connections.empty(); });
+}
+
+void QueryServer::stop()
+{
+    m_stopped = true;
+    // shutdown is async signal safe and wakes up a blocked accept
+    ::shutdown(m_listenFd, SHUT_RDWR);
+}
+
+void QueryServer::serveConnection(int fd)
+{
+    Session session;
+    std::string request;
+    while (!m_stopped && readFrame(fd, request)) {
+        if (!writeFrame(fd, answer(request, session))) {
+            break;
+        }
+    }
+    std::lock_guard<std::mutex> guard(m_connectionsLock);
+    ::close(fd);
+    m_connections.erase(std::find(m_connections.begin(), m_connections.end(), fd));
+    m_connectionsClosed.notify_all();
+}
+
+std::string QueryServer::answer(llvm::StringRef request, Session& session)
+{
+    llvm::SmallVector<llvm::StringRef, 8> fields;
+    request.trim().split(fields, ' ', -1, false);
+    const PDGSnapshot& snapshot = session.bind(m_snapshots.acquire());
+    const FrozenPDG& pdg = snapshot.getPDG();
+    std::vector<FrozenPDG::NodeId> nodes;
+    // nodes are the trailing fields from first on
+    auto parseNodes = [&] (unsigned first) {
+        for (unsigned i = first; i < fields.size(); ++i) {
+            FrozenPDG::NodeId node;
+            if (fields[i].getAsInteger(10, node) || node >= pdg.getNumNodes()) {
+                return false;
+            }
+            nodes.push_back(node);
+        }
+        return true;
+    };
+    std::string response;
+    llvm::raw_string_ostream out(response);
+    const llvm::StringRef command = fields.empty() ? llvm::StringRef() : fields[0];
+    unsigned edges = AllEdges;
+    if (command == "slice") {
+        if (fields.size() < 4 || (fields[1] != "backward" && fields[1] != "forward")
+                || !parseEdges(fields[2], edges) || !parseNodes(3)) {
+            return "error expected slice backward|forward <edges> <node>...";
+        }
+        const auto direction = fields[1] == "backward" ? SliceDirection::Backward : SliceDirection::Forward;
+        Slice slice;
+        if (auto* cache = snapshot.getSliceCache()) {
+            slice = cache->slice(nodes, direction, edges);
+        } else {
+            slice = direction == SliceDirection::Backward ? session.getSlicer().backwardSlice(nodes, edges)
+                                                          : session.getSlicer().forwardSlice(nodes, edges);
+        }
+        out << "ok " << slice.size();
+        for (auto node : slice.getNodes()) {
+            out << " " << node;
+        }
+    } else if (command == "path") {
+        if (fields.size() != 4 || !parseEdges(fields[1], edges) || !parseNodes(2)) {
+            return "error expected path <edges> <source> <sink>";
+        }
+        const DependencePath path = session.getChopper().shortestPath(nodes[0], nodes[1], edges);
+        out << "ok " << path.edges.size();
+        for (unsigned i = 0; i < path.nodes.size(); ++i) {
+            out << " " << path.nodes[i];
+            if (i < path.edges.size()) {
+                out << " " << getEdgeKindName(path.edges[i]);
+            }
+        }
+    } else if (command == "reaches") {
+        if (fields.size() != 3 || !parseNodes(1)) {
+            return "error expected reaches <source> <dest>";
+        }
+        const bool reached = snapshot.getIndex() ? snapshot.getIndex()->reaches(nodes[0], nodes[1])
+                                                 : !session.getChopper().shortestPath(nodes[0], nodes[1]).empty();
+        out << "ok " << (reached ? 1 : 0);
+    } else if (command == "out" || command == "in") {
+        if (fields.size() != 2 || !parseNodes(1)) {
+            return "error expected out|in <node>";
+        }
+        const auto neighbours = command == "out" ? pdg.getOutEdges(nodes[0]) : pdg.getInEdges(nodes[0]);
+        out << "ok " << neighbours.size();
+        for (const auto& edge : neighbours) {
+            out << " " << edge.node << " " << getEdgeKindName(edge.getKind());
+        }
+    } else if (command == "node") {
+        if (fields.size() != 2 || !parseNodes(1)) {
+            return "error expected node <node>";
+        }
+        const auto node = nodes[0];
+        const auto function = pdg.getFunction(node);
+        out << "ok " << pdg.getNodeType(node) << "\t"
+            << (function == FrozenPDG::NoFunction ? llvm::StringRef() : pdg.getFunctionName(function)) << "\t"
+            << pdg.getSymbol(node) << "\t" << pdg.getLabel(node);
+    } else if (command == "stats") {
+        out << "ok " << pdg.getNumNodes() << " " << pdg.getNumEdges() << " " << pdg.getNumFunctions();
+    } else if (command == "cache") {
+        if (!snapshot.getSliceCache()) {
+            return "error no slice cache";
+        }
+        const auto stats = snapshot.getSliceCache()->getStats();
+        out << "ok " << stats.hits << " " << stats.misses << " " << stats.reused << " "
+            << stats.entries << " " << stats.bytes;
+    } else if (command == "version") {
+        out << "ok " << snapshot.getVersion();
+    } else if (command == "reload") {
+        if (fields.size() != 2) {
+            return "error expected reload <frozen PDG directory>";
+        }
+        return reload(fields[1].str());
+    } else {
+        return "error unknown command";
+    }
+    return out.str();
+}
+
+std::string QueryServer::reload(const std::string& directory)
+{
+    if (!isUnderReloadRoot(directory)) {
+        return "error " + directory + " is not under the reload root";
+    }
+    std::lock_guard<std::mutex> guard(m_reloadLock);
+    const auto current = m_snapshots.acquire();
+    // the new graph is mapped and indexed while readers keep using the current one
+    const auto* cache = current->getSliceCache();
+    auto snapshot = PDGSnapshot::open(directory, current->getIndex() != nullptr, current->getVersion() + 1,
+                                      cache ? cache->getMemoryBudget() : 0);
+    if (!snapshot) {
+        return "error could not open " + directory;
+    }
+    const uint64_t version = snapshot->getVersion();
+    m_snapshots.publish(std::move(snapshot));
+    return "ok " + std::to_string(version);
+}
+
+bool QueryServer::isUnderReloadRoot(const std::string& directory) const
+{
+    if (m_reloadRoot.empty()) {
+        return false;
+    }
+    // symbolic links and .. are resolved before the paths are compared
+    llvm::SmallString<256> root;
+    llvm::SmallString<256> path;
+    if (llvm::sys::fs::real_path(m_reloadRoot, root) || llvm::sys::fs::real_path(directory, path)) {
+        return false;
+    }
+    return path.str().startswith(root.str())
+        && (path.size() == root.size() || path[root.size()] == '/' || root.str().endswith("/"));
+}
+
+} // namespace pdg
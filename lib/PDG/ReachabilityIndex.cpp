@@ -0,0 +1,239 @@
+#include "PDG/ReachabilityIndex.h"
+
+#include "llvm/ADT/BitVector.h"
+#include "llvm/ADT/DenseSet.h"
+
+#include <algorithm>
+#include <numeric>
+#include <random>
+#include <utility>
+
+namespace pdg {
+
+ReachabilityIndex::ReachabilityIndex(const FrozenPDG& pdg,
+                                     unsigned edges,
+                                     unsigned numLabels,
+                                     unsigned seed)
+    : m_edges(edges)
+    , m_numLabels(std::max(numLabels, 1u))
+    , m_numComponents(0)
+    , m_numQueries(0)
+    , m_numSearches(0)
+{
+    m_numComponents = findComponents(pdg, edges, m_components);
+    buildDAG(pdg, edges);
+    buildLabels(m_numLabels, seed);
+}
+
+bool ReachabilityIndex::reaches(NodeId source, NodeId dest) const
+{
+    ++m_numQueries;
+    const ComponentId sourceComponent = m_components[source];
+    const ComponentId destComponent = m_components[dest];
+    if (sourceComponent == destComponent) {
+        return true;
+    }
+    if (sourceComponent < destComponent || !isContained(destComponent, sourceComponent)) {
+        return false;
+    }
+    ++m_numSearches;
+    return search(sourceComponent, destComponent);
+}
+
+uint64_t ReachabilityIndex::getMemoryUsage() const
+{
+    return m_components.capacity() * sizeof(ComponentId)
+        + m_dagOffsets.capacity() * sizeof(uint64_t)
+        + m_dagEdges.capacity() * sizeof(ComponentId)
+        + m_labels.capacity() * sizeof(uint32_t);
+}
+
+unsigned ReachabilityIndex::findComponents(const FrozenPDG& pdg, unsigned edges, std::vector<ComponentId>& components)
+{
+    // iterative Tarjan, recursion would overflow the stack on long chains
+    const unsigned numNodes = pdg.getNumNodes();
+    const uint32_t Unvisited = ~0u;
+    std::vector<uint32_t> index(numNodes, Unvisited);
+    std::vector<uint32_t> lowlink(numNodes);
+    std::vector<NodeId> stack;
+    llvm::BitVector onStack(numNodes);
+    std::vector<std::pair<NodeId, uint64_t>> callStack;
+    uint32_t nextIndex = 0;
+    unsigned numComponents = 0;
+    components.assign(numNodes, 0);
+
+    auto visit = [&] (NodeId node) {
+        index[node] = lowlink[node] = nextIndex++;
+        stack.push_back(node);
+        onStack.set(node);
+        callStack.push_back(std::make_pair(node, 0));
+    };
+    for (NodeId root = 0; root < numNodes; ++root) {
+        if (index[root] != Unvisited) {
+            continue;
+        }
+        visit(root);
+        while (!callStack.empty()) {
+            const NodeId node = callStack.back().first;
+            const auto outEdges = pdg.getOutEdges(node);
+            bool descended = false;
+            while (callStack.back().second < outEdges.size()) {
+                const auto& edge = outEdges[callStack.back().second++];
+                if (!isFollowed(edges, edge)) {
+                    continue;
+                }
+                if (index[edge.node] == Unvisited) {
+                    visit(edge.node);
+                    descended = true;
+                    break;
+                }
+                if (onStack.test(edge.node)) {
+                    lowlink[node] = std::min(lowlink[node], index[edge.node]);
+                }
+            }
+            if (descended) {
+                continue;
+            }
+            callStack.pop_back();
+            if (lowlink[node] == index[node]) {
+                // completed components only have edges to completed ones
+                NodeId member;
+                do {
+                    member = stack.back();
+                    stack.pop_back();
+                    onStack.reset(member);
+                    components[member] = numComponents;
+                } while (member != node);
+                ++numComponents;
+            }
+            if (!callStack.empty()) {
+                const NodeId parent = callStack.back().first;
+                lowlink[parent] = std::min(lowlink[parent], lowlink[node]);
+            }
+        }
+    }
+    return numComponents;
+}
+
+void ReachabilityIndex::buildDAG(const FrozenPDG& pdg, unsigned edges)
+{
+    std::vector<std::pair<ComponentId, ComponentId>> dagEdges;
+    for (NodeId node = 0; node < pdg.getNumNodes(); ++node) {
+        const ComponentId component = m_components[node];
+        for (const auto& edge : pdg.getOutEdges(node)) {
+            if (isFollowed(edges, edge) && m_components[edge.node] != component) {
+                dagEdges.push_back(std::make_pair(component, m_components[edge.node]));
+            }
+        }
+    }
+    std::sort(dagEdges.begin(), dagEdges.end());
+    dagEdges.erase(std::unique(dagEdges.begin(), dagEdges.end()), dagEdges.end());
+    m_dagOffsets.assign(m_numComponents + 1, 0);
+    m_dagEdges.reserve(dagEdges.size());
+    for (const auto& edge : dagEdges) {
+        ++m_dagOffsets[edge.first + 1];
+        m_dagEdges.push_back(edge.second);
+    }
+    std::partial_sum(m_dagOffsets.begin(), m_dagOffsets.end(), m_dagOffsets.begin());
+}
+
+void ReachabilityIndex::buildLabels(unsigned numLabels, unsigned seed)
+{
+    std::mt19937 random(seed);
+    m_labels.assign(static_cast<uint64_t>(m_numComponents) * numLabels * 2, 0);
+    std::vector<ComponentId> roots(m_numComponents);
+    std::iota(roots.begin(), roots.end(), 0);
+    // component, next child and rotation of the child order
+    struct Frame
+    {
+        ComponentId component;
+        uint64_t child;
+        uint64_t rotation;
+    };
+    std::vector<Frame> stack;
+    llvm::BitVector visited(m_numComponents);
+    for (unsigned label = 0; label < numLabels; ++label) {
+        std::shuffle(roots.begin(), roots.end(), random);
+        visited.reset();
+        uint32_t rank = 0;
+        auto getLow = [&] (ComponentId component) -> uint32_t& {
+            return m_labels[(static_cast<uint64_t>(component) * numLabels + label) * 2];
+        };
+        auto getRank = [&] (ComponentId component) -> uint32_t& {
+            return m_labels[(static_cast<uint64_t>(component) * numLabels + label) * 2 + 1];
+        };
+        auto push = [&] (ComponentId component) {
+            visited.set(component);
+            const uint64_t degree = m_dagOffsets[component + 1] - m_dagOffsets[component];
+            stack.push_back(Frame{component, 0, degree == 0 ? 0 : random() % degree});
+            getLow(component) = ~0u;
+        };
+        for (auto root : roots) {
+            if (visited.test(root)) {
+                continue;
+            }
+            push(root);
+            while (!stack.empty()) {
+                Frame& frame = stack.back();
+                const ComponentId component = frame.component;
+                const uint64_t begin = m_dagOffsets[component];
+                const uint64_t degree = m_dagOffsets[component + 1] - begin;
+                if (frame.child < degree) {
+                    const ComponentId child = m_dagEdges[begin + (frame.child++ + frame.rotation) % degree];
+                    if (!visited.test(child)) {
+                        push(child);
+                    } else {
+                        getLow(component) = std::min(getLow(component), getLow(child));
+                    }
+                    continue;
+                }
+                stack.pop_back();
+                getRank(component) = ++rank;
+                getLow(component) = std::min(getLow(component), rank);
+                if (!stack.empty()) {
+                    const ComponentId parent = stack.back().component;
+                    getLow(parent) = std::min(getLow(parent), getLow(component));
+                }
+            }
+        }
+    }
+}
+
+bool ReachabilityIndex::isContained(ComponentId inner, ComponentId outer) const
+{
+    const uint32_t* innerLabels = &m_labels[static_cast<uint64_t>(inner) * m_numLabels * 2];
+    const uint32_t* outerLabels = &m_labels[static_cast<uint64_t>(outer) * m_numLabels * 2];
+    for (unsigned label = 0; label < m_numLabels; ++label) {
+        if (innerLabels[2 * label] < outerLabels[2 * label]
+                || innerLabels[2 * label + 1] > outerLabels[2 * label + 1]) {
+            return false;
+        }
+    }
+    return true;
+}
+
+bool ReachabilityIndex::search(ComponentId source, ComponentId dest) const
+{
+    std::vector<ComponentId> stack(1, source);
+    llvm::DenseSet<ComponentId> visited;
+    visited.insert(source);
+    while (!stack.empty()) {
+        const ComponentId component = stack.back();
+        stack.pop_back();
+        for (uint64_t i = m_dagOffsets[component]; i < m_dagOffsets[component + 1]; ++i) {
+            const ComponentId child = m_dagEdges[i];
+            if (child == dest) {
+                return true;
+            }
+            // lower numbered and label disjoint components can not lead to dest
+            if (child < dest || !isContained(dest, child) || !visited.insert(child).second) {
+                continue;
+            }
+            stack.push_back(child);
+        }
+    }
+    return false;
+}
+
+} // namespace pdg
+
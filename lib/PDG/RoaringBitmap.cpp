@@ -0,0 +1,156 @@
+#include "PDG/RoaringBitmap.h"
+
+#include <algorithm>
+#include <iterator>
+
+namespace pdg {
+
+namespace {
+
+/// Arrays larger than this take more space than a bitmap
+const uint32_t MaxArraySize = 4096;
+const unsigned BitmapWords = 1024;
+
+} // unnamed namespace
+
+bool RoaringBitmap::add(uint32_t value)
+{
+    Container& container = getContainer(value >> 16);
+    const uint16_t low = value & 0xffff;
+    if (container.isBitmap()) {
+        uint64_t& word = container.bits[low >> 6];
+        const uint64_t bit = uint64_t(1) << (low & 63);
+        if (word & bit) {
+            return false;
+        }
+        word |= bit;
+    } else {
+        auto pos = std::lower_bound(container.values.begin(), container.values.end(), low);
+        if (pos != container.values.end() && *pos == low) {
+            return false;
+        }
+        container.values.insert(pos, low);
+        if (container.values.size() > MaxArraySize) {
+            toBitmap(container);
+        }
+    }
+    ++container.cardinality;
+    ++m_size;
+    return true;
+}
+
+bool RoaringBitmap::contains(uint32_t value) const
+{
+    const Container* container = findContainer(value >> 16);
+    if (!container) {
+        return false;
+    }
+    const uint16_t low = value & 0xffff;
+    if (container->isBitmap()) {
+        return (container->bits[low >> 6] >> (low & 63)) & 1;
+    }
+    return std::binary_search(container->values.begin(), container->values.end(), low);
+}
+
+void RoaringBitmap::unionWith(const RoaringBitmap& other)
+{
+    for (const Container& otherContainer : other.m_containers) {
+        Container& container = getContainer(otherContainer.key);
+        m_size -= container.cardinality;
+        unionContainers(container, otherContainer);
+        m_size += container.cardinality;
+    }
+}
+
+std::vector<uint32_t> RoaringBitmap::toVector() const
+{
+    std::vector<uint32_t> values;
+    values.reserve(m_size);
+    for (const Container& container : m_containers) {
+        const uint32_t high = uint32_t(container.key) << 16;
+        if (!container.isBitmap()) {
+            for (auto low : container.values) {
+                values.push_back(high | low);
+            }
+            continue;
+        }
+        for (unsigned i = 0; i < BitmapWords; ++i) {
+            for (uint64_t word = container.bits[i]; word != 0; word &= word - 1) {
+                values.push_back(high | (i << 6) | __builtin_ctzll(word));
+            }
+        }
+    }
+    return values;
+}
+
+uint64_t RoaringBitmap::getMemoryUsage() const
+{
+    uint64_t bytes = m_containers.capacity() * sizeof(Container);
+    for (const Container& container : m_containers) {
+        bytes += container.values.capacity() * sizeof(uint16_t) + container.bits.capacity() * sizeof(uint64_t);
+    }
+    return bytes;
+}
+
+RoaringBitmap::Container& RoaringBitmap::getContainer(uint16_t key)
+{
+    if (m_lastContainer < m_containers.size() && m_containers[m_lastContainer].key == key) {
+        return m_containers[m_lastContainer];
+    }
+    auto pos = std::lower_bound(m_containers.begin(), m_containers.end(), key,
+                                [] (const Container& container, uint16_t key) { return container.key < key; });
+    if (pos == m_containers.end() || pos->key != key) {
+        pos = m_containers.insert(pos, Container{key, 0, {}, {}});
+    }
+    m_lastContainer = pos - m_containers.begin();
+    return *pos;
+}
+
+const RoaringBitmap::Container* RoaringBitmap::findContainer(uint16_t key) const
+{
+    auto pos = std::lower_bound(m_containers.begin(), m_containers.end(), key,
+                                [] (const Container& container, uint16_t key) { return container.key < key; });
+    return pos != m_containers.end() && pos->key == key ? &*pos : nullptr;
+}
+
+void RoaringBitmap::toBitmap(Container& container)
+{
+    container.bits.assign(BitmapWords, 0);
+    for (auto low : container.values) {
+        container.bits[low >> 6] |= uint64_t(1) << (low & 63);
+    }
+    std::vector<uint16_t>().swap(container.values);
+}
+
+void RoaringBitmap::unionContainers(Container& container, const Container& other)
+{
+    if (!container.isBitmap() && !other.isBitmap()
+            && container.values.size() + other.values.size() <= MaxArraySize) {
+        std::vector<uint16_t> values;
+        values.reserve(container.values.size() + other.values.size());
+        std::set_union(container.values.begin(), container.values.end(),
+                       other.values.begin(), other.values.end(), std::back_inserter(values));
+        container.values = std::move(values);
+        container.cardinality = container.values.size();
+        return;
+    }
+    if (!container.isBitmap()) {
+        toBitmap(container);
+    }
+    if (other.isBitmap()) {
+        for (unsigned i = 0; i < BitmapWords; ++i) {
+            container.bits[i] |= other.bits[i];
+        }
+    } else {
+        for (auto low : other.values) {
+            container.bits[low >> 6] |= uint64_t(1) << (low & 63);
+        }
+    }
+    container.cardinality = 0;
+    for (auto word : container.bits) {
+        container.cardinality += __builtin_popcountll(word);
+    }
+}
+
+} // namespace pdg
+
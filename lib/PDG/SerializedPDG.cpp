@@ -0,0 +1,467 @@
+#include "PDG/SerializedPDG.h"
+
+#include "PDG/PDG.h"
+#include "PDG/FunctionPDG.h"
+#include "PDG/PDGEdge.h"
+#include "PDG/PDGLLVMNode.h"
+
+#include "llvm/IR/Function.h"
+#include "llvm/IR/GlobalVariable.h"
+#include "llvm/IR/Instruction.h"
+#include "llvm/IR/Module.h"
+#include "llvm/Support/raw_ostream.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <fstream>
+#include <sstream>
+#include <tuple>
+#include <unordered_map>
+
+#include <unistd.h>
+
+namespace pdg {
+
+namespace {
+
+const char* SerializedFormat = "pdg-serialized 3";
+/// Without escapes in string fields
+const char* SerializedFormatV2 = "pdg-serialized 2";
+/// Without opcodes and metadata labels
+const char* SerializedFormatV1 = "pdg-serialized 1";
+
+/// Metadata kinds attached by the protection passes whose instructions are labeled
+const char* MetadataLabels[] = {"oh_hash", "oh_verify", "cfi_register", "cfi_verify", "sc_guard"};
+
+using Linkage = SerializedPDG::Linkage;
+using EdgeKind = SerializedPDG::EdgeKind;
+
+Linkage getLinkage(const llvm::GlobalValue* value)
+{
+    // bodies left in lazily loaded bitcode are not part of this PDG
+    const bool declaration = value->isDeclaration() || value->isMaterializable();
+    if (value->hasLocalLinkage()) {
+        return declaration ? Linkage::LocalDeclaration : Linkage::Local;
+    }
+    if (declaration) {
+        return Linkage::Declaration;
+    }
+    return value->isWeakForLinker() ? Linkage::WeakDefinition : Linkage::Definition;
+}
+
+void setSymbol(SerializedPDG::Node& record, const llvm::GlobalValue* value)
+{
+    record.symbol = value->getName().str();
+    record.linkage = getLinkage(value);
+}
+
+std::string getMetadataLabel(const llvm::Instruction& instr)
+{
+    for (const char* label : MetadataLabels) {
+        if (instr.getMetadata(label)) {
+            return label;
+        }
+    }
+    return "";
+}
+
+// fields are tab separated and records newline separated
+std::string sanitize(std::string field)
+{
+    std::replace(field.begin(), field.end(), '\t', ' ');
+    std::replace(field.begin(), field.end(), '\n', ' ');
+    return field;
+}
+
+SerializedPDG::Node getNodeRecord(PDGNode* node, unsigned module)
+{
+    SerializedPDG::Node record{module, node->getNodeType(), Linkage::None, "", -1, "", "", 0, ""};
+    if (node->hasParent()) {
+        record.function = node->getParent()->getName().str();
+    }
+    record.label = sanitize(node->getNodeAsString());
+    if (auto* functionNode = llvm::dyn_cast<PDGLLVMFunctionNode>(node)) {
+        setSymbol(record, functionNode->getFunction());
+    } else if (auto* formalArgNode = llvm::dyn_cast<PDGLLVMFormalArgumentNode>(node)) {
+        setSymbol(record, formalArgNode->getFunction());
+        record.argIdx = llvm::cast<llvm::Argument>(formalArgNode->getNodeValue())->getArgNo();
+    } else if (auto* vaArgNode = llvm::dyn_cast<PDGLLVMVaArgNode>(node)) {
+        setSymbol(record, vaArgNode->getFunction());
+        record.argIdx = vaArgNode->getFunction()->getFunctionType()->getNumParams();
+    } else if (auto* instrNode = llvm::dyn_cast<PDGLLVMInstructionNode>(node)) {
+        auto* instr = llvm::cast<llvm::Instruction>(instrNode->getNodeValue());
+        record.opcode = instr->getOpcode();
+        record.metadataLabel = getMetadataLabel(*instr);
+    } else if (auto* actualArgNode = llvm::dyn_cast<PDGLLVMActualArgumentNode>(node)) {
+        record.argIdx = actualArgNode->getArgIndex();
+    } else if (auto* globalNode = llvm::dyn_cast<PDGLLVMGlobalVariableNode>(node)) {
+        setSymbol(record, llvm::cast<llvm::GlobalVariable>(globalNode->getNodeValue()));
+    }
+    return record;
+}
+
+EdgeKind getEdgeKind(const PDGEdge& edge)
+{
+    if (edge.isSummaryEdge()) {
+        return EdgeKind::Summary;
+    }
+    return edge.isDataEdge() ? EdgeKind::Data : EdgeKind::Control;
+}
+
+std::vector<std::string> splitFields(const std::string& line)
+{
+    std::vector<std::string> fields;
+    std::istringstream in(line);
+    std::string field;
+    while (std::getline(in, field, '\t')) {
+        fields.push_back(field);
+    }
+    // getline drops a trailing empty field
+    if (!line.empty() && line.back() == '\t') {
+        fields.push_back(std::string());
+    }
+    return fields;
+}
+
+/// Escapes tabs, newlines and backslashes of a string field. Unlike
+/// sanitize it is reversible, as linkage names have to survive unchanged.
+std::string escape(const std::string& field)
+{
+    std::string escaped;
+    escaped.reserve(field.size());
+    for (char c : field) {
+        switch (c) {
+        case '\\':
+            escaped += "\\\\";
+            break;
+        case '\t':
+            escaped += "\\t";
+            break;
+        case '\n':
+            escaped += "\\n";
+            break;
+        default:
+            escaped += c;
+            break;
+        }
+    }
+    return escaped;
+}
+
+bool unescape(const std::string& field, std::string& unescaped)
+{
+    unescaped.clear();
+    unescaped.reserve(field.size());
+    for (size_t i = 0; i < field.size(); ++i) {
+        if (field[i] != '\\') {
+            unescaped += field[i];
+            continue;
+        }
+        if (++i == field.size()) {
+            return false;
+        }
+        switch (field[i]) {
+        case '\\':
+            unescaped += '\\';
+            break;
+        case 't':
+            unescaped += '\t';
+            break;
+        case 'n':
+            unescaped += '\n';
+            break;
+        default:
+            return false;
+        }
+    }
+    return true;
+}
+
+template <typename T>
+bool parseNumber(const std::string& field, T& number)
+{
+    std::istringstream in(field);
+    return (in >> number) && in.eof();
+}
+
+class Loader : public SerializedPDG::Visitor
+{
+public:
+    explicit Loader(SerializedPDG& pdg)
+        : m_pdg(pdg)
+    {
+    }
+
+    void visitModule(const std::string& moduleName) override
+    {
+        m_pdg.addModule(moduleName);
+    }
+
+    void visitNode(const SerializedPDG::Node& node) override
+    {
+        m_pdg.addNode(node);
+    }
+
+    void visitEdge(const SerializedPDG::Edge& edge) override
+    {
+        m_pdg.addEdge(edge.source, edge.dest, edge.kind);
+    }
+
+private:
+    SerializedPDG& m_pdg;
+}; // class Loader
+
+} // unnamed namespace
+
+SerializedPDG SerializedPDG::fromPDG(const PDG& pdg,
+                                     const std::string& moduleName,
+                                     std::vector<PDGNode*>* nodeOrder)
+{
+    SerializedPDG serialized;
+    const unsigned module = serialized.addModule(moduleName);
+    std::unordered_map<PDGNode*, unsigned> nodeIds;
+    std::vector<PDGNode*> nodes;
+    auto addNode = [&] (PDGNode* node) {
+        if (!node || !nodeIds.insert(std::make_pair(node, nodes.size())).second) {
+            return;
+        }
+        nodes.push_back(node);
+        serialized.addNode(getNodeRecord(node, module));
+    };
+    // nodes without a place in the module are numbered by their records
+    auto addNodes = [&] (std::vector<PDGNode*>& candidates) {
+        std::vector<std::pair<SerializedPDG::Node, PDGNode*>> records;
+        for (auto* node : candidates) {
+            if (node && nodeIds.find(node) == nodeIds.end()) {
+                records.emplace_back(getNodeRecord(node, module), node);
+            }
+        }
+        std::stable_sort(records.begin(), records.end(), [] (const auto& a, const auto& b) {
+            return std::tie(a.first.type, a.first.function, a.first.label, a.first.argIdx)
+                < std::tie(b.first.type, b.first.function, b.first.label, b.first.argIdx);
+        });
+        for (const auto& record : records) {
+            addNode(record.second);
+        }
+    };
+    auto addFunctionNodes = [&] (const FunctionPDG& functionPDG) {
+        for (auto node_it = functionPDG.nodesBegin(); node_it != functionPDG.nodesEnd(); ++node_it) {
+            addNode(*node_it);
+        }
+        addNode(functionPDG.getVaArgNode().get());
+    };
+    // nodes are numbered in module order, so rebuilding a module gives the same graph
+    llvm::Module* M = const_cast<llvm::Module*>(pdg.getModule());
+    if (M) {
+        for (auto& global : M->globals()) {
+            if (pdg.hasGlobalVariableNode(&global)) {
+                addNode(pdg.getGlobalVariableNode(&global).get());
+            }
+        }
+        for (auto& F : *M) {
+            if (pdg.hasFunctionNode(&F)) {
+                addNode(pdg.getFunctionNode(&F).get());
+            }
+        }
+        for (auto& F : *M) {
+            if (pdg.hasFunctionPDG(&F)) {
+                addFunctionNodes(*pdg.getFunctionPDG(&F));
+            }
+        }
+    }
+    for (const auto& entry : pdg.getGlobalVariableNodes()) {
+        addNode(entry.second.get());
+    }
+    for (const auto& entry : pdg.getFunctionNodes()) {
+        addNode(entry.second.get());
+    }
+    for (const auto& entry : pdg.getFunctionPDGs()) {
+        addFunctionNodes(*entry.second);
+    }
+    // nodes only reachable through edges, e.g. def sites kept by other functions
+    std::vector<PDGNode*> neighbours;
+    for (unsigned i = 0; i < nodes.size(); ++i) {
+        neighbours.clear();
+        for (const auto& edge : nodes[i]->getOutEdges()) {
+            neighbours.push_back(edge->getDestination().get());
+        }
+        for (const auto& edge : nodes[i]->getInEdges()) {
+            neighbours.push_back(edge->getSource().get());
+        }
+        addNodes(neighbours);
+    }
+    // edge sets are unordered
+    std::vector<std::pair<unsigned, unsigned>> outEdges;
+    for (unsigned i = 0; i < nodes.size(); ++i) {
+        outEdges.clear();
+        for (const auto& edge : nodes[i]->getOutEdges()) {
+            outEdges.emplace_back(nodeIds[edge->getDestination().get()],
+                                  static_cast<unsigned>(getEdgeKind(*edge)));
+        }
+        std::sort(outEdges.begin(), outEdges.end());
+        for (const auto& edge : outEdges) {
+            serialized.addEdge(i, edge.first, static_cast<EdgeKind>(edge.second));
+        }
+    }
+    if (nodeOrder) {
+        *nodeOrder = std::move(nodes);
+    }
+    return serialized;
+}
+
+bool SerializedPDG::read(const std::string& path, Visitor& visitor)
+{
+    std::ifstream in(path);
+    if (!in) {
+        llvm::errs() << "Could not read serialized PDG " << path << "\n";
+        return false;
+    }
+    if (!read(in, visitor)) {
+        llvm::errs() << path << ": malformed serialized PDG\n";
+        return false;
+    }
+    return true;
+}
+
+bool SerializedPDG::load(const std::string& path)
+{
+    std::ifstream in(path);
+    if (!in) {
+        llvm::errs() << "Could not read serialized PDG " << path << "\n";
+        return false;
+    }
+    Loader loader(*this);
+    bool valid = read(in, loader);
+    // edges may only be checked once all nodes are known
+    for (unsigned i = 0; valid && i < m_edges.size(); ++i) {
+        valid = m_edges[i].source < m_nodes.size() && m_edges[i].dest < m_nodes.size();
+    }
+    if (!valid) {
+        llvm::errs() << path << ": malformed serialized PDG\n";
+        m_modules.clear();
+        m_nodes.clear();
+        m_edges.clear();
+        return false;
+    }
+    return true;
+}
+
+bool SerializedPDG::save(const std::string& path) const
+{
+    // readers never see a partially written graph
+    const std::string tmpPath = path + "." + std::to_string(getpid());
+    {
+        std::ofstream out(tmpPath);
+        if (!out) {
+            llvm::errs() << "Could not write serialized PDG " << tmpPath << "\n";
+            return false;
+        }
+        write(out);
+        if (!out) {
+            llvm::errs() << "Could not write serialized PDG " << tmpPath << "\n";
+            std::remove(tmpPath.c_str());
+            return false;
+        }
+    }
+    if (std::rename(tmpPath.c_str(), path.c_str()) != 0) {
+        llvm::errs() << "Could not write serialized PDG " << path << "\n";
+        std::remove(tmpPath.c_str());
+        return false;
+    }
+    return true;
+}
+
+bool SerializedPDG::read(std::istream& in, Visitor& visitor)
+{
+    unsigned numModules = 0;
+    std::string line;
+    if (!std::getline(in, line)
+            || (line != SerializedFormat && line != SerializedFormatV2 && line != SerializedFormatV1)) {
+        return false;
+    }
+    const unsigned numNodeFields = line == SerializedFormatV1 ? 8 : 10;
+    const bool escaped = line == SerializedFormat;
+    // string fields of older formats were written as they are
+    auto getString = [escaped] (const std::string& field, std::string& value) {
+        if (escaped) {
+            return unescape(field, value);
+        }
+        value = field;
+        return true;
+    };
+    while (std::getline(in, line)) {
+        const auto fields = splitFields(line);
+        if (fields.empty()) {
+            return false;
+        }
+        const std::string& kind = fields[0];
+        if (kind == "module" && fields.size() == 2) {
+            std::string moduleName;
+            if (!getString(fields[1], moduleName)) {
+                return false;
+            }
+            visitor.visitModule(moduleName);
+            ++numModules;
+        } else if (kind == "node" && fields.size() == numNodeFields) {
+            Node node;
+            node.opcode = 0;
+            unsigned linkage = 0;
+            if (!parseNumber(fields[1], node.module) || node.module >= numModules
+                    || !parseNumber(fields[2], node.type)
+                    || !parseNumber(fields[3], linkage) || linkage > static_cast<unsigned>(Linkage::WeakDefinition)
+                    || !parseNumber(fields[4], node.argIdx)) {
+                return false;
+            }
+            node.linkage = static_cast<Linkage>(linkage);
+            if (!getString(fields[5], node.symbol) || !getString(fields[6], node.function)
+                    || !getString(fields[7], node.label)) {
+                return false;
+            }
+            if (numNodeFields == 10) {
+                if (!parseNumber(fields[8], node.opcode) || !getString(fields[9], node.metadataLabel)) {
+                    return false;
+                }
+            }
+            visitor.visitNode(node);
+        } else if (kind == "edge" && fields.size() == 4) {
+            Edge edge;
+            unsigned edgeKind = 0;
+            if (!parseNumber(fields[1], edge.source) || !parseNumber(fields[2], edge.dest)
+                    || !parseNumber(fields[3], edgeKind) || edgeKind > static_cast<unsigned>(EdgeKind::Summary)) {
+                return false;
+            }
+            edge.kind = static_cast<EdgeKind>(edgeKind);
+            visitor.visitEdge(edge);
+        } else {
+            return false;
+        }
+    }
+    return true;
+}
+
+void SerializedPDG::write(std::ostream& out) const
+{
+    out << SerializedFormat << "\n";
+    for (const auto& module : m_modules) {
+        out << "module\t" << escape(module) << "\n";
+    }
+    for (const auto& node : m_nodes) {
+        out << "node\t" << node.module
+            << "\t" << node.type
+            << "\t" << static_cast<unsigned>(node.linkage)
+            << "\t" << node.argIdx
+            << "\t" << escape(node.symbol)
+            << "\t" << escape(node.function)
+            << "\t" << escape(node.label)
+            << "\t" << node.opcode
+            << "\t" << escape(node.metadataLabel) << "\n";
+    }
+    for (const auto& edge : m_edges) {
+        out << "edge\t" << edge.source
+            << "\t" << edge.dest
+            << "\t" << static_cast<unsigned>(edge.kind) << "\n";
+    }
+}
+
+} // namespace pdg
+
@@ -0,0 +1,195 @@
+#include "PDG/SliceCache.h"
+
+#include "PDG/PDGLLVMNode.h"
+
+#include <algorithm>
+#include <mutex>
+
+namespace pdg {
+
+namespace {
+
+/// Shared slices computed within a traversal nest at most this deep, deeper
+/// shared nodes are traversed like others
+const unsigned MaxPendingSlices = 32;
+
+} // unnamed namespace
+
+SliceCache::SliceCache(const FrozenPDG& pdg, const ReachabilityIndex* index, uint64_t memoryBudget)
+    : m_pdg(pdg)
+    , m_index(index)
+    , m_memoryBudget(memoryBudget)
+    , m_hand(0)
+    , m_bytes(0)
+    , m_hits(0)
+    , m_misses(0)
+    , m_reused(0)
+{
+    if (!m_index) {
+        return;
+    }
+    std::vector<uint8_t> seen(m_index->getNumComponents());
+    m_cyclicComponents.resize(m_index->getNumComponents());
+    for (NodeId node = 0; node < m_pdg.getNumNodes(); ++node) {
+        const auto component = m_index->getComponent(node);
+        m_cyclicComponents[component] = seen[component];
+        seen[component] = 1;
+    }
+}
+
+std::shared_ptr<const RoaringBitmap> SliceCache::slice(NodeId criterion, SliceDirection direction, unsigned edges)
+{
+    std::vector<uint64_t> pending;
+    return get(criterion, direction, edges, pending);
+}
+
+Slice SliceCache::slice(llvm::ArrayRef<NodeId> criteria, SliceDirection direction, unsigned edges)
+{
+    RoaringBitmap nodes;
+    for (auto criterion : criteria) {
+        nodes.unionWith(*slice(criterion, direction, edges));
+    }
+    return Slice(nodes.toVector(), true);
+}
+
+SliceCache::Stats SliceCache::getStats() const
+{
+    std::shared_lock<std::shared_mutex> guard(m_lock);
+    return Stats{m_hits.load(), m_misses.load(), m_reused.load(), m_slots.size(), m_bytes};
+}
+
+uint64_t SliceCache::getKey(NodeId node, SliceDirection direction, unsigned edges) const
+{
+    uint64_t key = (static_cast<uint64_t>(direction) << 3) | (edges & AllEdges);
+    // members of a component have the same slice
+    if (m_index && m_index->getEdges() == edges && m_cyclicComponents[m_index->getComponent(node)]) {
+        return key | (uint64_t(m_index->getComponent(node)) << 5) | (uint64_t(1) << 63);
+    }
+    return key | (uint64_t(node) << 5);
+}
+
+bool SliceCache::isShared(NodeId node, unsigned edges) const
+{
+    switch (m_pdg.getNodeType(node)) {
+    case PDGLLVMNode::FunctionNode:
+    case PDGLLVMNode::FormalArgumentNode:
+    case PDGLLVMNode::VaArgumentNode:
+    case PDGLLVMNode::GlobalVariableNode:
+        return true;
+    default:
+        break;
+    }
+    return m_index && m_index->getEdges() == edges && m_cyclicComponents[m_index->getComponent(node)];
+}
+
+std::shared_ptr<const RoaringBitmap> SliceCache::lookup(uint64_t key) const
+{
+    std::shared_lock<std::shared_mutex> guard(m_lock);
+    auto pos = m_slots.find(key);
+    if (pos == m_slots.end()) {
+        return nullptr;
+    }
+    const Entry& entry = m_entries[pos->second];
+    entry.referenced = true;
+    return entry.slice;
+}
+
+void SliceCache::insert(uint64_t key, std::shared_ptr<const RoaringBitmap> slice)
+{
+    const uint64_t bytes = slice->getMemoryUsage();
+    if (bytes > m_memoryBudget) {
+        return;
+    }
+    std::unique_lock<std::shared_mutex> guard(m_lock);
+    // another thread may have computed the same slice meanwhile
+    if (m_slots.find(key) != m_slots.end()) {
+        return;
+    }
+    size_t slot = m_entries.size();
+    if (m_freeSlots.empty()) {
+        m_entries.emplace_back(key, std::move(slice));
+    } else {
+        slot = m_freeSlots.back();
+        m_freeSlots.pop_back();
+        Entry& entry = m_entries[slot];
+        entry.key = key;
+        entry.slice = std::move(slice);
+        entry.referenced = true;
+    }
+    m_slots.emplace(key, slot);
+    m_bytes += bytes;
+    evict(slot);
+}
+
+void SliceCache::evict(size_t keptSlot)
+{
+    // the hand resumes where the last eviction stopped, so every entry is
+    // passed once per round instead of those at the front on every insert.
+    // The first round clears the flags it passes, so two rounds always get
+    // below the budget.
+    for (size_t steps = 0; m_bytes > m_memoryBudget && steps < 2 * m_entries.size(); ++steps) {
+        if (m_hand >= m_entries.size()) {
+            m_hand = 0;
+        }
+        Entry& entry = m_entries[m_hand];
+        if (entry.slice && m_hand != keptSlot && !entry.referenced.exchange(false)) {
+            m_bytes -= entry.slice->getMemoryUsage();
+            m_slots.erase(entry.key);
+            entry.slice.reset();
+            m_freeSlots.push_back(m_hand);
+        }
+        ++m_hand;
+    }
+}
+
+std::shared_ptr<const RoaringBitmap> SliceCache::get(NodeId node, SliceDirection direction, unsigned edges,
+                                                     std::vector<uint64_t>& pending)
+{
+    const uint64_t key = getKey(node, direction, edges);
+    if (auto cached = lookup(key)) {
+        if (pending.empty()) {
+            ++m_hits;
+        } else {
+            ++m_reused;
+        }
+        return cached;
+    }
+    ++m_misses;
+    pending.push_back(key);
+    auto slice = compute(node, direction, edges, pending);
+    pending.pop_back();
+    insert(key, slice);
+    return slice;
+}
+
+std::shared_ptr<const RoaringBitmap> SliceCache::compute(NodeId criterion, SliceDirection direction, unsigned edges,
+                                                         std::vector<uint64_t>& pending)
+{
+    auto slice = std::make_shared<RoaringBitmap>();
+    std::vector<NodeId> worklist;
+    slice->add(criterion);
+    worklist.push_back(criterion);
+    const bool forward = direction == SliceDirection::Forward;
+    for (size_t i = 0; i < worklist.size(); ++i) {
+        const auto node = worklist[i];
+        for (const auto& edge : forward ? m_pdg.getOutEdges(node) : m_pdg.getInEdges(node)) {
+            if (!isFollowed(edges, edge) || slice->contains(edge.node)) {
+                continue;
+            }
+            if (isShared(edge.node, edges) && pending.size() < MaxPendingSlices) {
+                // a pending slice, e.g. of a caller through recursion, is traversed instead
+                const uint64_t key = getKey(edge.node, direction, edges);
+                if (std::find(pending.begin(), pending.end(), key) == pending.end()) {
+                    slice->unionWith(*get(edge.node, direction, edges, pending));
+                    continue;
+                }
+            }
+            slice->add(edge.node);
+            worklist.push_back(edge.node);
+        }
+    }
+    return slice;
+}
+
+} // namespace pdg
+
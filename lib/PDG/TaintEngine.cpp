@@ -0,0 +1,239 @@
+#include "PDG/TaintEngine.h"
+
+#include "PDG/PDGLLVMNode.h"
+
+#include "llvm/ADT/SmallVector.h"
+#include "llvm/ADT/StringMap.h"
+#include "llvm/Support/LineIterator.h"
+#include "llvm/Support/MemoryBuffer.h"
+#include "llvm/Support/raw_ostream.h"
+
+#include <algorithm>
+#include <atomic>
+#include <iterator>
+#include <thread>
+
+namespace pdg {
+
+namespace {
+
+bool parseRole(llvm::StringRef field, TaintSpec::Role& role)
+{
+    if (field == "source") {
+        role = TaintSpec::Role::Source;
+    } else if (field == "sink") {
+        role = TaintSpec::Role::Sink;
+    } else if (field == "sanitizer") {
+        role = TaintSpec::Role::Sanitizer;
+    } else {
+        return false;
+    }
+    return true;
+}
+
+bool parsePosition(llvm::StringRef field, TaintSpec::Position& position, unsigned& index)
+{
+    index = 0;
+    if (field == "ret") {
+        position = TaintSpec::Position::Return;
+        return true;
+    }
+    if (field.consume_front("arg")) {
+        position = TaintSpec::Position::Argument;
+    } else if (field.consume_front("param")) {
+        position = TaintSpec::Position::Parameter;
+    } else {
+        return false;
+    }
+    return !field.getAsInteger(10, index);
+}
+
+bool isPropagated(const FrozenPDG::Edge& edge)
+{
+    return edge.getKind() == SerializedPDG::EdgeKind::Data || edge.getKind() == SerializedPDG::EdgeKind::Summary;
+}
+
+} // unnamed namespace
+
+bool TaintSpec::read(const std::string& path)
+{
+    auto buffer = llvm::MemoryBuffer::getFile(path);
+    if (!buffer) {
+        llvm::errs() << "Could not read taint spec " << path << ": " << buffer.getError().message() << "\n";
+        return false;
+    }
+    return parse((*buffer)->getBuffer(), path);
+}
+
+bool TaintSpec::parse(llvm::StringRef text, llvm::StringRef name)
+{
+    auto buffer = llvm::MemoryBuffer::getMemBuffer(text, name, false);
+    // skips blank lines and lines starting with #
+    for (llvm::line_iterator line(*buffer, true, '#'); !line.is_at_end(); ++line) {
+        llvm::SmallVector<llvm::StringRef, 3> fields;
+        line->trim().split(fields, ' ', -1, false);
+        Rule rule;
+        if (fields.size() != 3 || !parseRole(fields[0], rule.role)
+                || !parsePosition(fields[2], rule.position, rule.index)) {
+            llvm::errs() << name << ":" << line.line_number()
+                         << ": expected '<source|sink|sanitizer> <function> <ret|argN|paramN>'\n";
+            return false;
+        }
+        rule.function = fields[1].str();
+        m_rules.push_back(rule);
+    }
+    return true;
+}
+
+TaintEngine::Propagation::Propagation(unsigned numNodes)
+    : parents(numNodes, FrozenPDG::InvalidNode)
+    , kinds(numNodes)
+{
+}
+
+TaintEngine::TaintEngine(const FrozenPDG& pdg, const TaintSpec& spec)
+    : m_pdg(pdg)
+    , m_sanitized(pdg.getNumNodes())
+{
+    resolve(spec);
+}
+
+std::vector<TaintFinding> TaintEngine::run(unsigned numThreads) const
+{
+    numThreads = std::max(1u, std::min<unsigned>(numThreads, m_sources.size()));
+    std::vector<std::vector<TaintFinding>> threadFindings(numThreads);
+    std::atomic<unsigned> nextSource(0);
+    auto work = [&] (unsigned thread) {
+        Propagation propagation(m_pdg.getNumNodes());
+        for (unsigned source = nextSource++; source < m_sources.size(); source = nextSource++) {
+            propagate(source, propagation, threadFindings[thread]);
+        }
+    };
+    std::vector<std::thread> threads;
+    for (unsigned thread = 1; thread < numThreads; ++thread) {
+        threads.emplace_back(work, thread);
+    }
+    work(0);
+    for (auto& thread : threads) {
+        thread.join();
+    }
+
+    std::vector<TaintFinding> findings;
+    for (auto& found : threadFindings) {
+        std::move(found.begin(), found.end(), std::back_inserter(findings));
+    }
+    std::sort(findings.begin(), findings.end(), [] (const TaintFinding& first, const TaintFinding& second) {
+        return std::make_pair(first.source, first.sink) < std::make_pair(second.source, second.sink);
+    });
+    return findings;
+}
+
+void TaintEngine::resolve(const TaintSpec& spec)
+{
+    llvm::StringMap<std::vector<unsigned>> functionRules;
+    for (unsigned i = 0; i < spec.getRules().size(); ++i) {
+        functionRules[spec.getRules()[i].function].push_back(i);
+    }
+    for (const unsigned type : {PDGLLVMNode::FunctionNode, PDGLLVMNode::FormalArgumentNode}) {
+        for (auto node : m_pdg.getNodesOfType(type)) {
+            auto pos = functionRules.find(m_pdg.getSymbol(node));
+            if (pos == functionRules.end()) {
+                continue;
+            }
+            for (auto ruleIndex : pos->second) {
+                const TaintSpec::Rule& rule = spec.getRules()[ruleIndex];
+                if (type == PDGLLVMNode::FormalArgumentNode) {
+                    if (rule.position == TaintSpec::Position::Parameter
+                            && m_pdg.getArgIdx(node) == static_cast<int>(rule.index)) {
+                        match(node, rule, ruleIndex);
+                    }
+                    continue;
+                }
+                if (rule.position == TaintSpec::Position::Parameter) {
+                    continue;
+                }
+                // call sites have a control edge to the function node
+                for (const auto& callEdge : m_pdg.getInEdges(node)) {
+                    if (callEdge.getKind() != SerializedPDG::EdgeKind::Control) {
+                        continue;
+                    }
+                    const auto callSite = callEdge.node;
+                    if (rule.position == TaintSpec::Position::Return) {
+                        match(callSite, rule, ruleIndex);
+                        continue;
+                    }
+                    for (const auto& argEdge : m_pdg.getInEdges(callSite)) {
+                        if (m_pdg.getNodeType(argEdge.node) == PDGLLVMNode::ActualArgumentNode
+                                && m_pdg.getArgIdx(argEdge.node) == static_cast<int>(rule.index)) {
+                            match(argEdge.node, rule, ruleIndex);
+                        }
+                    }
+                }
+            }
+        }
+    }
+    std::sort(m_sources.begin(), m_sources.end());
+    // a node matched by several source rules is propagated once
+    m_sources.erase(std::unique(m_sources.begin(), m_sources.end(),
+                                [] (const std::pair<FrozenPDG::NodeId, unsigned>& first,
+                                    const std::pair<FrozenPDG::NodeId, unsigned>& second) {
+                                    return first.first == second.first;
+                                }),
+                    m_sources.end());
+}
+
+void TaintEngine::match(FrozenPDG::NodeId node, const TaintSpec::Rule& rule, unsigned ruleIndex)
+{
+    switch (rule.role) {
+    case TaintSpec::Role::Source:
+        m_sources.push_back(std::make_pair(node, ruleIndex));
+        break;
+    case TaintSpec::Role::Sink:
+        m_sinkRules.insert(std::make_pair(node, ruleIndex));
+        break;
+    case TaintSpec::Role::Sanitizer:
+        m_sanitized.set(node);
+        break;
+    }
+}
+
+void TaintEngine::propagate(unsigned sourceIndex, Propagation& propagation, std::vector<TaintFinding>& findings) const
+{
+    const auto source = m_sources[sourceIndex].first;
+    auto& parents = propagation.parents;
+    auto& reached = propagation.reached;
+    parents[source] = source;
+    reached.push_back(source);
+    for (size_t i = 0; i < reached.size(); ++i) {
+        const auto node = reached[i];
+        auto sink = m_sinkRules.find(node);
+        if (sink != m_sinkRules.end()) {
+            TaintFinding finding{source, node, m_sources[sourceIndex].second, sink->second, DependencePath()};
+            // the breadth first tree holds a shortest path back to the source
+            for (auto pathNode = node; pathNode != source; pathNode = parents[pathNode]) {
+                finding.path.nodes.push_back(pathNode);
+                finding.path.edges.push_back(static_cast<SerializedPDG::EdgeKind>(propagation.kinds[pathNode]));
+            }
+            finding.path.nodes.push_back(source);
+            std::reverse(finding.path.nodes.begin(), finding.path.nodes.end());
+            std::reverse(finding.path.edges.begin(), finding.path.edges.end());
+            findings.push_back(std::move(finding));
+        }
+        for (const auto& edge : m_pdg.getOutEdges(node)) {
+            if (!isPropagated(edge) || parents[edge.node] != FrozenPDG::InvalidNode || m_sanitized.test(edge.node)) {
+                continue;
+            }
+            parents[edge.node] = node;
+            propagation.kinds[edge.node] = edge.kind;
+            reached.push_back(edge.node);
+        }
+    }
+    // only the reached nodes are reset for the next source
+    for (auto node : reached) {
+        parents[node] = FrozenPDG::InvalidNode;
+    }
+    reached.clear();
+}
+
+} // namespace pdg
+
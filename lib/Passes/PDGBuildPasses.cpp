@@ -9,12 +9,17 @@
 #include "llvm/IR/LegacyPassManager.h"
 #include "llvm/IR/Module.h"
 #include "llvm/PassRegistry.h"
+#include "llvm/Support/CommandLine.h"
 #include "llvm/Support/Debug.h"
+#include "llvm/Support/Error.h"
 #include "llvm/Support/FileSystem.h"
 #include "llvm/Support/GraphWriter.h"
 #include "llvm/Support/raw_ostream.h"
 #include "llvm/Transforms/IPO/PassManagerBuilder.h"
 
+#include "PDG/FunctionSummaryAnalysis.h"
+#include "PDG/IndirectCallSitesAnalysis.h"
+#include "PDG/PointerAnalysisCache.h"
 #include "PDG/SVFGDefUseAnalysisResults.h"
 #include "PDG/LLVMMemorySSADefUseAnalysisResults.h"
 #include "PDG/LLVMDominanceTree.h"
@@ -30,42 +35,214 @@
 #include "SVF/PDG/PDGPointerAnalysis.h"
 
 #include <fstream>
+#include <future>
+#include <memory>
+#include <unordered_map>
 
 namespace pdg {
 
-char SVFGPDGBuilder::ID = 0;
-static llvm::RegisterPass<SVFGPDGBuilder> X("svfg-pdg","build pdg using svfg");
+static llvm::cl::opt<bool> BuildSummaries(
+    "pdg-summaries",
+    llvm::cl::desc("Compute function summaries and attach summary edges at call sites"));
 
-void SVFGPDGBuilder::getAnalysisUsage(llvm::AnalysisUsage& AU) const
+static llvm::cl::opt<unsigned> MaxCallSiteFanOut(
+    "pdg-max-fanout",
+    llvm::cl::desc("Connect call sites with more candidate callees than this to a single unknown callee node (0 for no limit)"),
+    llvm::cl::init(0));
+
+static llvm::cl::opt<bool> AsyncSkeleton(
+    "pdg-async",
+    llvm::cl::desc("Build the intraprocedural PDG skeleton concurrently with pointer analysis"));
+
+static llvm::cl::opt<std::string> PTACacheDirectory(
+    "pta-cache-dir",
+    llvm::cl::desc("Directory caching pointer analysis results by module hash"),
+    llvm::cl::value_desc("directory"));
+
+namespace {
+
+using DominatorTreeGetter = LLVMDominanceTree::DominatorTreeGetter;
+using PostDominatorTreeGetter = LLVMDominanceTree::PostDominatorTreeGetter;
+using MemorySSAGetter = LLVMMemorySSADefUseAnalysisResults::MemorySSAGetter;
+using AARGetter = LLVMMemorySSADefUseAnalysisResults::AARGetter;
+using PTACacheEntryTy = PointerAnalysisCache::EntryTy;
+
+void buildFunctionSummaries(PDGBuilder::PDGType pdg,
+                            std::shared_ptr<FunctionSummaryAnalysis>& summaries)
 {
-    AU.addRequired<llvm::PostDominatorTreeWrapperPass>();
-    AU.addRequired<llvm::DominatorTreeWrapperPass>();
-    AU.setPreservesAll();
+    if (!BuildSummaries) {
+        return;
+    }
+    summaries = std::make_shared<FunctionSummaryAnalysis>(pdg);
+    summaries->run();
+    summaries->attachSummaryEdges();
 }
 
-bool SVFGPDGBuilder::runOnModule(llvm::Module& M)
+/// Dominator trees of the defined functions of a module, computed without a
+/// pass manager so that another thread may read them
+class ModuleDominatorTrees
 {
-    auto domTreeGetter = [&] (llvm::Function* F) {
-        return &this->getAnalysis<llvm::DominatorTreeWrapperPass>(*F).getDomTree();
-    };
-    auto postdomTreeGetter = [&] (llvm::Function* F) {
-        return &this->getAnalysis<llvm::PostDominatorTreeWrapperPass>(*F).getPostDomTree();
+public:
+    explicit ModuleDominatorTrees(llvm::Module& M)
+    {
+        for (auto& F : M) {
+            // bodies are materialized here rather than by the reading thread
+            if (F.isMaterializable()) {
+                if (auto err = F.materialize()) {
+                    llvm::errs() << "Could not materialize " << F.getName() << ": "
+                                 << llvm::toString(std::move(err)) << "\n";
+                    continue;
+                }
+            }
+            if (F.isDeclaration()) {
+                continue;
+            }
+            m_domTrees[&F].reset(new llvm::DominatorTree(F));
+            m_postdomTrees[&F].reset(new llvm::PostDominatorTree());
+            m_postdomTrees[&F]->recalculate(F);
+        }
+    }
+
+    DominatorTreeGetter getDomTreeGetter() const
+    {
+        return [this] (llvm::Function* F) -> const llvm::DominatorTree* {
+            auto pos = m_domTrees.find(F);
+            return pos == m_domTrees.end() ? nullptr : pos->second.get();
+        };
+    }
+
+    PostDominatorTreeGetter getPostDomTreeGetter() const
+    {
+        return [this] (llvm::Function* F) -> const llvm::PostDominatorTree* {
+            auto pos = m_postdomTrees.find(F);
+            return pos == m_postdomTrees.end() ? nullptr : pos->second.get();
+        };
+    }
+
+private:
+    std::unordered_map<llvm::Function*, std::unique_ptr<llvm::DominatorTree>> m_domTrees;
+    std::unordered_map<llvm::Function*, std::unique_ptr<llvm::PostDominatorTree>> m_postdomTrees;
+}; // class ModuleDominatorTrees
+
+PTACacheEntryTy getPTACacheEntry(llvm::Module& M)
+{
+    if (PTACacheDirectory.empty()) {
+        return PTACacheEntryTy();
+    }
+    PointerAnalysisCache cache(PTACacheDirectory);
+    return cache.getEntry(M);
+}
+
+PDGBuilder::PDGType buildSVFGPDG(llvm::Module& M,
+                                 const DominatorTreeGetter& domTreeGetter,
+                                 const PostDominatorTreeGetter& postdomTreeGetter,
+                                 PTACacheEntryTy& ptaCacheEntry,
+                                 const PDGBuilder::FunctionPDGConsumer& consumer)
+{
+    using DefUseResultsTy = PDGBuilder::DefUseResultsTy;
+    using IndCSResultsTy = PDGBuilder::IndCSResultsTy;
+    using DominanceResultsTy = PDGBuilder::DominanceResultsTy;
+    // The skeleton only reads the IR and dominator trees, which Andersen does not touch.
+    // Streamed functions are completed one by one, so they can not be built ahead.
+    const bool async = AsyncSkeleton && !consumer;
+    // Pass managers are not thread safe, so the skeleton thread gets dominator
+    // trees computed up front instead of the getters
+    std::unique_ptr<ModuleDominatorTrees> domTrees;
+    DominanceResultsTy domResults;
+    if (async) {
+        domTrees.reset(new ModuleDominatorTrees(M));
+        domResults = DominanceResultsTy(new LLVMDominanceTree(domTrees->getDomTreeGetter(),
+                    domTrees->getPostDomTreeGetter()));
+    } else {
+        domResults = DominanceResultsTy(new LLVMDominanceTree(domTreeGetter, postdomTreeGetter));
+    }
+
+    // the module hash serializes the module, which the skeleton thread reads
+    ptaCacheEntry = getPTACacheEntry(M);
+
+    pdg::PDGBuilder pdgBuilder(&M);
+    pdgBuilder.setDominanceResults(domResults);
+    pdgBuilder.setMaxCallSiteFanOut(MaxCallSiteFanOut);
+    pdgBuilder.setFunctionPDGConsumer(consumer);
+    std::future<void> skeleton;
+    if (async) {
+        skeleton = std::async(std::launch::async, [&pdgBuilder] () {
+            pdgBuilder.buildSkeleton();
+        });
+    }
+
+    // SVF runs once, up front or on the first query a loaded cache entry misses
+    DefUseResultsTy svfDefUse;
+    IndCSResultsTy svfIndCSRes;
+    auto runPointerAnalysis = [&M, &svfDefUse, &svfIndCSRes] () {
+        if (svfDefUse) {
+            return;
+        }
+        SVFModule svfM(M);
+        AndersenWaveDiff* ander = new svfg::PDGAndersenWaveDiff();
+        ander->disablePrintStat();
+        ander->analyze(svfM);
+        SVFGBuilder memSSA(true);
+        SVFG *svfg = memSSA.buildSVFG((BVDataPTAImpl*)ander);
+
+        svfDefUse = DefUseResultsTy(new SVFGDefUseAnalysisResults(svfg));
+        svfIndCSRes = IndCSResultsTy(new pdg::SVFGIndirectCallSiteResults(ander->getPTACallGraph()));
     };
+    DefUseResultsTy defUse;
+    IndCSResultsTy indCSRes;
+    if (ptaCacheEntry && ptaCacheEntry->isLoaded()) {
+        defUse = std::make_shared<CachedDefUseResults>(ptaCacheEntry, nullptr, [&] () {
+            runPointerAnalysis();
+            return svfDefUse;
+        });
+        indCSRes = std::make_shared<CachedIndirectCallSiteResults>(ptaCacheEntry, nullptr, [&] () {
+            runPointerAnalysis();
+            return svfIndCSRes;
+        });
+    } else {
+        runPointerAnalysis();
+        defUse = svfDefUse;
+        indCSRes = svfIndCSRes;
+        if (ptaCacheEntry) {
+            // record what the builder asks for
+            defUse = std::make_shared<CachedDefUseResults>(ptaCacheEntry, defUse);
+            indCSRes = std::make_shared<CachedIndirectCallSiteResults>(ptaCacheEntry, indCSRes);
+        }
+    }
+    pdgBuilder.setDesUseResults(defUse);
+    pdgBuilder.setIndirectCallSitesResults(indCSRes);
+    if (async) {
+        skeleton.get();
+        pdgBuilder.connectSkeleton();
+    } else {
+        pdgBuilder.build();
+    }
+    if (ptaCacheEntry && !ptaCacheEntry->isLoaded()) {
+        ptaCacheEntry->save();
+    }
+    return pdgBuilder.getPDG();
+}
 
+PDGBuilder::IndCSResultsTy getAndersenIndirectCallSiteResults(llvm::Module& M)
+{
     SVFModule svfM(M);
     AndersenWaveDiff* ander = new svfg::PDGAndersenWaveDiff();
     ander->disablePrintStat();
     ander->analyze(svfM);
-    SVFGBuilder memSSA(true);
-    SVFG *svfg = memSSA.buildSVFG((BVDataPTAImpl*)ander);
-
+    return PDGBuilder::IndCSResultsTy(new pdg::SVFGIndirectCallSiteResults(ander->getPTACallGraph()));
+}
 
+PDGBuilder::PDGType buildLLVMPDG(llvm::Module& M,
+                                 PDGBuilder::IndCSResultsTy indCSRes,
+                                 const MemorySSAGetter& memSSAGetter,
+                                 const AARGetter& aarGetter,
+                                 const DominatorTreeGetter& domTreeGetter,
+                                 const PostDominatorTreeGetter& postdomTreeGetter,
+                                 const PDGBuilder::FunctionPDGConsumer& consumer)
+{
     using DefUseResultsTy = PDGBuilder::DefUseResultsTy;
-    using IndCSResultsTy = PDGBuilder::IndCSResultsTy;
     using DominanceResultsTy = PDGBuilder::DominanceResultsTy;
-    DefUseResultsTy defUse = DefUseResultsTy(new SVFGDefUseAnalysisResults(svfg));
-    IndCSResultsTy indCSRes = IndCSResultsTy(new
-            pdg::SVFGIndirectCallSiteResults(ander->getPTACallGraph()));
+    DefUseResultsTy defUse = DefUseResultsTy(new LLVMMemorySSADefUseAnalysisResults(memSSAGetter, aarGetter));
     DominanceResultsTy domResults = DominanceResultsTy(new LLVMDominanceTree(domTreeGetter,
                 postdomTreeGetter));
 
@@ -73,9 +250,36 @@ bool SVFGPDGBuilder::runOnModule(llvm::Module& M)
     pdgBuilder.setDesUseResults(defUse);
     pdgBuilder.setIndirectCallSitesResults(indCSRes);
     pdgBuilder.setDominanceResults(domResults);
+    pdgBuilder.setMaxCallSiteFanOut(MaxCallSiteFanOut);
+    pdgBuilder.setFunctionPDGConsumer(consumer);
     pdgBuilder.build();
+    return pdgBuilder.getPDG();
+}
 
-    m_pdg = pdgBuilder.getPDG();
+} // unnamed namespace
+
+char SVFGPDGBuilder::ID = 0;
+static llvm::RegisterPass<SVFGPDGBuilder> X("svfg-pdg","build pdg using svfg");
+
+void SVFGPDGBuilder::getAnalysisUsage(llvm::AnalysisUsage& AU) const
+{
+    AU.addRequired<llvm::PostDominatorTreeWrapperPass>();
+    AU.addRequired<llvm::DominatorTreeWrapperPass>();
+    AU.setPreservesAll();
+}
+
+bool SVFGPDGBuilder::runOnModule(llvm::Module& M)
+{
+    auto domTreeGetter = [&] (llvm::Function* F) {
+        return &this->getAnalysis<llvm::DominatorTreeWrapperPass>(*F).getDomTree();
+    };
+    auto postdomTreeGetter = [&] (llvm::Function* F) {
+        return &this->getAnalysis<llvm::PostDominatorTreeWrapperPass>(*F).getPostDomTree();
+    };
+
+    m_pdg = buildSVFGPDG(M, domTreeGetter, postdomTreeGetter, m_ptaCacheEntry,
+                         PDGBuilder::FunctionPDGConsumer());
+    buildFunctionSummaries(m_pdg, m_summaries);
     return false;
 }
 
@@ -168,29 +372,100 @@ bool LLVMPDGBuilder::runOnModule(llvm::Module& M)
             return functionAAResults[F];
     };
 
-    // TODO: consider not using SVF here at all
-    SVFModule svfM(M);
-    AndersenWaveDiff* ander = new svfg::PDGAndersenWaveDiff();
-    ander->disablePrintStat();
-    ander->analyze(svfM);
+    m_pdg = buildLLVMPDG(M, getAndersenIndirectCallSiteResults(M),
+                         memSSAGetter, aliasAnalysisResGetter, domTreeGetter, postdomTreeGetter,
+                         PDGBuilder::FunctionPDGConsumer());
+    buildFunctionSummaries(m_pdg, m_summaries);
+    return false;
+}
 
-    using DefUseResultsTy = PDGBuilder::DefUseResultsTy;
-    using IndCSResultsTy = PDGBuilder::IndCSResultsTy;
-    using DominanceResultsTy = PDGBuilder::DominanceResultsTy;
-    DefUseResultsTy defUse = DefUseResultsTy(new LLVMMemorySSADefUseAnalysisResults(memSSAGetter, aliasAnalysisResGetter));
-    IndCSResultsTy indCSRes = IndCSResultsTy(new
-            pdg::SVFGIndirectCallSiteResults(ander->getPTACallGraph()));
-    DominanceResultsTy domResults = DominanceResultsTy(new LLVMDominanceTree(domTreeGetter,
-                postdomTreeGetter));
+llvm::AnalysisKey PDGAnalysis::Key;
 
-    pdg::PDGBuilder pdgBuilder(&M);
-    pdgBuilder.setDesUseResults(defUse);
-    pdgBuilder.setIndirectCallSitesResults(indCSRes);
-    pdgBuilder.setDominanceResults(domResults);
-    pdgBuilder.build();
+namespace {
 
-    m_pdg = pdgBuilder.getPDG();
-    return false;
+PDGAnalysisResult runSVFGPDGAnalysis(llvm::Module& M,
+                                     llvm::ModuleAnalysisManager& MAM,
+                                     const PDGBuilder::FunctionPDGConsumer& consumer)
+{
+    // Function analyses are cached in the function analysis manager and shared
+    // with every other consumer in the pipeline
+    auto& FAM = MAM.getResult<llvm::FunctionAnalysisManagerModuleProxy>(M).getManager();
+    auto domTreeGetter = [&FAM] (llvm::Function* F) -> const llvm::DominatorTree* {
+        return &FAM.getResult<llvm::DominatorTreeAnalysis>(*F);
+    };
+    auto postdomTreeGetter = [&FAM] (llvm::Function* F) -> const llvm::PostDominatorTree* {
+        return &FAM.getResult<llvm::PostDominatorTreeAnalysis>(*F);
+    };
+
+    PDGAnalysisResult result;
+    result.pdg = buildSVFGPDG(M, domTreeGetter, postdomTreeGetter, result.ptaCacheEntry, consumer);
+    // summaries need the bodies released by streaming
+    if (!consumer) {
+        buildFunctionSummaries(result.pdg, result.summaries);
+    }
+    return result;
+}
+
+PDGAnalysisResult runLLVMPDGAnalysis(llvm::Module& M,
+                                     llvm::ModuleAnalysisManager& MAM,
+                                     PDGBuilder::IndCSResultsTy indCSRes,
+                                     const PDGBuilder::FunctionPDGConsumer& consumer)
+{
+    auto& FAM = MAM.getResult<llvm::FunctionAnalysisManagerModuleProxy>(M).getManager();
+    auto memSSAGetter = [&FAM] (llvm::Function* F) -> llvm::MemorySSA* {
+        return &FAM.getResult<llvm::MemorySSAAnalysis>(*F).getMSSA();
+    };
+    auto aarGetter = [&FAM] (llvm::Function* F) -> llvm::AAResults* {
+        return &FAM.getResult<llvm::AAManager>(*F);
+    };
+    auto domTreeGetter = [&FAM] (llvm::Function* F) -> const llvm::DominatorTree* {
+        return &FAM.getResult<llvm::DominatorTreeAnalysis>(*F);
+    };
+    auto postdomTreeGetter = [&FAM] (llvm::Function* F) -> const llvm::PostDominatorTree* {
+        return &FAM.getResult<llvm::PostDominatorTreeAnalysis>(*F);
+    };
+
+    PDGAnalysisResult result;
+    result.pdg = buildLLVMPDG(M, indCSRes, memSSAGetter, aarGetter, domTreeGetter, postdomTreeGetter,
+                              consumer);
+    if (!consumer) {
+        buildFunctionSummaries(result.pdg, result.summaries);
+    }
+    return result;
+}
+
+} // unnamed namespace
+
+PDGAnalysis::Result PDGAnalysis::run(llvm::Module& M, llvm::ModuleAnalysisManager& MAM)
+{
+    return runSVFGPDGAnalysis(M, MAM, PDGBuilder::FunctionPDGConsumer());
+}
+
+llvm::AnalysisKey LLVMPDGAnalysis::Key;
+
+LLVMPDGAnalysis::Result LLVMPDGAnalysis::run(llvm::Module& M, llvm::ModuleAnalysisManager& MAM)
+{
+    return runLLVMPDGAnalysis(M, MAM, getAndersenIndirectCallSiteResults(M),
+                              PDGBuilder::FunctionPDGConsumer());
+}
+
+llvm::AnalysisKey MemorySSAPDGAnalysis::Key;
+
+MemorySSAPDGAnalysis::Result MemorySSAPDGAnalysis::run(llvm::Module& M, llvm::ModuleAnalysisManager& MAM)
+{
+    return runLLVMPDGAnalysis(M, MAM, std::make_shared<TypeBasedIndirectCallSiteResults>(M),
+                              PDGBuilder::FunctionPDGConsumer());
+}
+
+PDGAnalysisResult streamPDG(llvm::Module& M,
+                            llvm::ModuleAnalysisManager& MAM,
+                            const FunctionPDGConsumer& consumer,
+                            bool useSVF)
+{
+    if (useSVF) {
+        return runSVFGPDGAnalysis(M, MAM, consumer);
+    }
+    return runLLVMPDGAnalysis(M, MAM, std::make_shared<TypeBasedIndirectCallSiteResults>(M), consumer);
 }
 
 }
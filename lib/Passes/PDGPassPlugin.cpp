@@ -0,0 +1,39 @@
+#include "Passes/PDGBuildPasses.h"
+#include "Passes/PDGCSVPass.h"
+
+#include "llvm/Config/llvm-config.h"
+#include "llvm/IR/PassManager.h"
+#include "llvm/Passes/PassBuilder.h"
+#include "llvm/Passes/PassPlugin.h"
+
+namespace pdg {
+
+namespace {
+
+void registerPDGPasses(llvm::PassBuilder& PB)
+{
+    PB.registerAnalysisRegistrationCallback([] (llvm::ModuleAnalysisManager& MAM) {
+        MAM.registerPass([] { return PDGAnalysis(); });
+        MAM.registerPass([] { return LLVMPDGAnalysis(); });
+        MAM.registerPass([] { return MemorySSAPDGAnalysis(); });
+    });
+    PB.registerPipelineParsingCallback([] (llvm::StringRef name,
+                                           llvm::ModulePassManager& MPM,
+                                           llvm::ArrayRef<llvm::PassBuilder::PipelineElement>) {
+        if (name == "pdg-csv") {
+            MPM.addPass(PDGCSVPass());
+            return true;
+        }
+        return false;
+    });
+}
+
+} // unnamed namespace
+
+} // namespace pdg
+
+extern "C" LLVM_ATTRIBUTE_WEAK ::llvm::PassPluginLibraryInfo llvmGetPassPluginInfo()
+{
+    return {LLVM_PLUGIN_API_VERSION, "pdg", LLVM_VERSION_STRING, pdg::registerPDGPasses};
+}
+
@@ -0,0 +1,80 @@
+#include "FrozenFixture.h"
+
+#include "PDG/BatchSlicer.h"
+#include "PDG/PDGSlicer.h"
+
+#include <random>
+
+using namespace pdg;
+using namespace pdg::test;
+
+namespace {
+
+using EdgeKind = SerializedPDG::EdgeKind;
+
+/// Slices of more criteria than fit into one batch and one mask word agree
+/// with those of PDGSlicer
+void testAgainstSlicer()
+{
+    const unsigned numNodes = 400;
+    FrozenFixture fixture;
+    std::mt19937 random(17);
+    for (unsigned i = 0; i < numNodes; ++i) {
+        fixture.addInstruction("f" + std::to_string(i % 5));
+    }
+    for (unsigned i = 0; i < numNodes * 2; ++i) {
+        fixture.addEdge(random() % numNodes, random() % numNodes, static_cast<EdgeKind>(random() % 3));
+    }
+    const FrozenPDG& pdg = fixture.freeze();
+    NodeIds criteria;
+    for (unsigned i = 0; i < 150; ++i) {
+        criteria.push_back(random() % numNodes);
+    }
+    PDGSlicer slicer(pdg);
+    BatchSlicer batchSlicer(pdg, 1);
+    PDG_CHECK(batchSlicer.getBatchSize() == 64);
+    for (auto direction : {SliceDirection::Backward, SliceDirection::Forward}) {
+        SliceOptions options;
+        options.direction = direction;
+        options.edges = DataEdges | SummaryEdges;
+        const auto slices = batchSlicer.slice(criteria, options);
+        PDG_CHECK(slices.size() == criteria.size());
+        for (unsigned i = 0; i < criteria.size() && i < slices.size(); ++i) {
+            PDG_CHECK(slices[i].getNodes() == slicer.slice(criteria[i], options).getNodes());
+        }
+    }
+}
+
+void testBatchSlice()
+{
+    FrozenFixture fixture;
+    const auto a = fixture.addInstruction("f");
+    const auto b = fixture.addInstruction("f");
+    const auto c = fixture.addInstruction("f");
+    fixture.addEdge(a, b);
+    fixture.addEdge(b, c);
+    const FrozenPDG& pdg = fixture.freeze();
+    BatchSlicer batchSlicer(pdg);
+    SliceOptions options;
+    options.direction = SliceDirection::Forward;
+    const BatchSlice batch = batchSlicer.sliceBatch(getNodeIds({b, a}), options);
+    PDG_CHECK(batch.getNumCriteria() == 2);
+    PDG_CHECK(batch.getReachedNodes() == getNodeIds({a, b, c}));
+    PDG_CHECK(!batch.contains(0, a));
+    PDG_CHECK(batch.contains(0, c));
+    PDG_CHECK(batch.contains(1, a));
+    PDG_CHECK(batch.getSlice(0).getNodes() == getNodeIds({b, c}));
+    // criteria beyond the batch
+    PDG_CHECK(!batch.contains(2, a));
+    PDG_CHECK(!batch.contains(200, a));
+    PDG_CHECK(batch.getSlice(2).size() == 0);
+}
+
+} // unnamed namespace
+
+int main()
+{
+    testAgainstSlicer();
+    testBatchSlice();
+    return getResult();
+}
@@ -0,0 +1,114 @@
+#include "FrozenFixture.h"
+
+#include "PDG/CondensedPDG.h"
+#include "PDG/PDGSlicer.h"
+
+#include <random>
+
+using namespace pdg;
+using namespace pdg::test;
+
+namespace {
+
+using EdgeKind = SerializedPDG::EdgeKind;
+
+/// The chain a -> b -> {c, x} -> d, where c and x form a cycle, ends at d,
+/// which has the successors e and f. y -> e.
+void testChains()
+{
+    FrozenFixture fixture;
+    const auto a = fixture.addInstruction("f");
+    const auto b = fixture.addInstruction("f");
+    const auto c = fixture.addInstruction("f");
+    const auto x = fixture.addInstruction("f");
+    const auto d = fixture.addInstruction("f");
+    const auto e = fixture.addInstruction("f");
+    const auto f = fixture.addInstruction("f");
+    const auto y = fixture.addInstruction("f");
+    fixture.addEdge(a, b);
+    fixture.addEdge(b, c, EdgeKind::Control);
+    fixture.addEdge(c, x);
+    fixture.addEdge(x, c);
+    fixture.addEdge(c, d);
+    fixture.addEdge(d, e);
+    fixture.addEdge(d, f);
+    fixture.addEdge(y, e);
+    const FrozenPDG& pdg = fixture.freeze();
+
+    CondensedPDG graph(pdg);
+    PDG_CHECK(graph.getNumComponents() == 7);
+    PDG_CHECK(graph.getNumNodes() == 4);
+    PDG_CHECK(graph.getNumEdges() == 3);
+    const auto chain = graph.getCondensedNode(a);
+    for (auto member : {b, c, x, d}) {
+        PDG_CHECK(graph.getCondensedNode(member) == chain);
+    }
+    PDG_CHECK(graph.getMembers(chain).vec() == getNodeIds({d, c, x, b, a}));
+    PDG_CHECK(graph.getDepth(d) == 0);
+    PDG_CHECK(graph.getDepth(c) == 1 && graph.getDepth(x) == 1);
+    PDG_CHECK(graph.getDepth(a) == 3);
+    PDG_CHECK(graph.getSuccessors(chain).size() == 2);
+    PDG_CHECK(graph.getPredecessors(graph.getCondensedNode(e)).size() == 2);
+    // reverse topological order
+    PDG_CHECK(graph.getCondensedNode(e) < chain && graph.getCondensedNode(f) < chain);
+    PDG_CHECK(graph.getCondensedNode(e) < graph.getCondensedNode(y));
+
+    CondensedSlicer slicer(graph);
+    PDG_CHECK(slicer.reaches(a, d));
+    PDG_CHECK(slicer.reaches(x, c));
+    PDG_CHECK(slicer.reaches(c, x));
+    PDG_CHECK(!slicer.reaches(d, a));
+    PDG_CHECK(!slicer.reaches(x, b));
+    PDG_CHECK(slicer.reaches(b, f));
+    PDG_CHECK(!slicer.reaches(y, f));
+    PDG_CHECK(slicer.backwardSlice(e).getNodes() == getNodeIds({a, b, c, x, d, e, y}));
+    PDG_CHECK(slicer.forwardSlice(x).getNodes() == getNodeIds({c, x, d, e, f}));
+
+    // without control edges the chain starts at c
+    CondensedPDG dataGraph(pdg, DataEdges);
+    PDG_CHECK(dataGraph.getCondensedNode(a) == dataGraph.getCondensedNode(b));
+    PDG_CHECK(dataGraph.getCondensedNode(b) != dataGraph.getCondensedNode(c));
+    PDG_CHECK(dataGraph.getCondensedNode(c) == dataGraph.getCondensedNode(d));
+    CondensedSlicer dataSlicer(dataGraph);
+    PDG_CHECK(!dataSlicer.reaches(a, d));
+    PDG_CHECK(dataSlicer.backwardSlice(d).getNodes() == getNodeIds({c, x, d}));
+}
+
+/// Reachability and slices over the condensed graph agree with PDGSlicer
+void testAgainstSlicer()
+{
+    const unsigned numNodes = 300;
+    FrozenFixture fixture;
+    std::mt19937 random(29);
+    for (unsigned i = 0; i < numNodes; ++i) {
+        fixture.addInstruction("f");
+    }
+    // sparse enough for chains
+    for (unsigned i = 0; i < numNodes; ++i) {
+        fixture.addEdge(random() % numNodes, random() % numNodes, static_cast<EdgeKind>(random() % 3));
+    }
+    const FrozenPDG& pdg = fixture.freeze();
+    PDGSlicer slicer(pdg);
+    for (unsigned edges : {unsigned(AllEdges), unsigned(DataEdges)}) {
+        CondensedPDG graph(pdg, edges);
+        PDG_CHECK(graph.getNumNodes() < graph.getNumComponents());
+        CondensedSlicer condensedSlicer(graph);
+        for (FrozenPDG::NodeId node = 0; node < numNodes; node += 5) {
+            PDG_CHECK(condensedSlicer.backwardSlice(node).getNodes() == slicer.backwardSlice(node, edges).getNodes());
+            const Slice forward = slicer.forwardSlice(node, edges);
+            PDG_CHECK(condensedSlicer.forwardSlice(node).getNodes() == forward.getNodes());
+            for (FrozenPDG::NodeId dest = 0; dest < numNodes; dest += 3) {
+                PDG_CHECK(condensedSlicer.reaches(node, dest) == forward.contains(dest));
+            }
+        }
+    }
+}
+
+} // unnamed namespace
+
+int main()
+{
+    testChains();
+    testAgainstSlicer();
+    return getResult();
+}
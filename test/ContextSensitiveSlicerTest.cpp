@@ -0,0 +1,105 @@
+#include "FrozenFixture.h"
+
+#include "PDG/ContextSensitiveSlicer.h"
+#include "PDG/PDGSlicer.h"
+
+using namespace pdg;
+using namespace pdg::test;
+
+namespace {
+
+using EdgeKind = SerializedPDG::EdgeKind;
+
+/// A call of function, with its call site returned
+FrozenFixture::NodeId addCall(FrozenFixture& fixture,
+                              const std::string& caller,
+                              FrozenFixture::NodeId functionNode,
+                              const std::vector<FrozenFixture::NodeId>& actuals)
+{
+    const auto call = fixture.addInstruction(caller);
+    for (auto actual : actuals) {
+        fixture.addEdge(actual, call);
+    }
+    fixture.addEdge(call, functionNode, EdgeKind::Control);
+    fixture.addEdge(functionNode, call);
+    return call;
+}
+
+/// f1 and f2 both call id(p), which returns p. A slice through one call
+/// site does not leave id through the other.
+void testTwoCallers()
+{
+    FrozenFixture fixture;
+    const auto id = fixture.addNode(PDGLLVMNode::FunctionNode, "", 0, "id");
+    const auto p = fixture.addNode(PDGLLVMNode::FormalArgumentNode, "id", 0, "id", 0);
+    const auto r = fixture.addInstruction("id");
+    fixture.addEdge(p, r);
+    fixture.addEdge(r, id);
+
+    const auto x1 = fixture.addInstruction("f1");
+    const auto a1 = fixture.addNode(PDGLLVMNode::ActualArgumentNode, "f1");
+    fixture.addEdge(x1, a1);
+    fixture.addEdge(a1, p);
+    const auto c1 = addCall(fixture, "f1", id, {a1});
+
+    const auto x2 = fixture.addInstruction("f2");
+    const auto a2 = fixture.addNode(PDGLLVMNode::ActualArgumentNode, "f2");
+    fixture.addEdge(x2, a2);
+    fixture.addEdge(a2, p);
+    const auto c2 = addCall(fixture, "f2", id, {a2});
+    const FrozenPDG& pdg = fixture.freeze();
+
+    ContextSensitiveSlicer slicer(pdg);
+    PDGSlicer insensitiveSlicer(pdg);
+    PDG_CHECK(slicer.backwardSlice(c1).getNodes() == getNodeIds({id, p, r, x1, a1, c1}));
+    PDG_CHECK(insensitiveSlicer.backwardSlice(c1).getNodes() == getNodeIds({id, p, r, x1, a1, c1, x2, a2, c2}));
+    PDG_CHECK(slicer.forwardSlice(x1).getNodes() == getNodeIds({id, p, r, x1, a1, c1}));
+    PDG_CHECK(insensitiveSlicer.forwardSlice(x1).getNodes() == getNodeIds({id, p, r, x1, a1, c1, c2}));
+    // starting inside the callee the slice ascends to both callers
+    PDG_CHECK(slicer.forwardSlice(p).getNodes() == getNodeIds({id, p, r, c1, c2}));
+    PDG_CHECK(slicer.reachesResult(p));
+}
+
+/// h(p, q) returns p only, so the call site does not depend on q
+void testSummaries()
+{
+    FrozenFixture fixture;
+    const auto h = fixture.addNode(PDGLLVMNode::FunctionNode, "", 0, "h");
+    const auto p = fixture.addNode(PDGLLVMNode::FormalArgumentNode, "h", 0, "h", 0);
+    const auto q = fixture.addNode(PDGLLVMNode::FormalArgumentNode, "h", 0, "h", 1);
+    const auto r = fixture.addInstruction("h");
+    fixture.addEdge(p, r);
+    fixture.addEdge(r, h);
+
+    const auto y = fixture.addInstruction("f");
+    const auto z = fixture.addInstruction("f");
+    const auto a = fixture.addNode(PDGLLVMNode::ActualArgumentNode, "f");
+    const auto b = fixture.addNode(PDGLLVMNode::ActualArgumentNode, "f");
+    fixture.addEdge(y, a);
+    fixture.addEdge(z, b);
+    fixture.addEdge(a, p);
+    fixture.addEdge(b, q);
+    const auto call = addCall(fixture, "f", h, {a, b});
+    const FrozenPDG& pdg = fixture.freeze();
+
+    ContextSensitiveSlicer slicer(pdg);
+    PDG_CHECK(slicer.reachesResult(p));
+    PDG_CHECK(!slicer.reachesResult(q));
+    const uint64_t numEvaluations = slicer.getNumEvaluations();
+    PDG_CHECK(numEvaluations > 0);
+    PDG_CHECK(slicer.backwardSlice(call).getNodes() == getNodeIds({h, p, r, y, a, call}));
+    PDG_CHECK(slicer.forwardSlice(z).getNodes() == getNodeIds({q, z, b}));
+    // summaries are tabulated once per edge filter
+    PDG_CHECK(slicer.getNumEvaluations() == numEvaluations);
+    // without data edges h has no returns, so nothing is known of q
+    PDG_CHECK(slicer.reachesResult(q, ControlEdges));
+}
+
+} // unnamed namespace
+
+int main()
+{
+    testTwoCallers();
+    testSummaries();
+    return getResult();
+}
@@ -0,0 +1,150 @@
+#pragma once
+
+#include "PDG/FrozenPDG.h"
+#include "PDG/FrozenPDGWriter.h"
+#include "PDG/PDGLLVMNode.h"
+#include "PDG/SerializedPDG.h"
+
+#include "llvm/ADT/SmallString.h"
+#include "llvm/Support/ErrorHandling.h"
+#include "llvm/Support/FileSystem.h"
+#include "llvm/Support/Path.h"
+#include "llvm/Support/raw_ostream.h"
+
+#include <initializer_list>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace pdg {
+namespace test {
+
+inline unsigned& getNumFailures()
+{
+    static unsigned numFailures = 0;
+    return numFailures;
+}
+
+inline void check(bool condition, const char* expression, const char* file, unsigned line)
+{
+    if (!condition) {
+        llvm::errs() << file << ":" << line << ": check failed: " << expression << "\n";
+        ++getNumFailures();
+    }
+}
+
+/// Exit status of a test program
+inline int getResult()
+{
+    return getNumFailures() == 0 ? 0 : 1;
+}
+
+using NodeIds = std::vector<FrozenPDG::NodeId>;
+
+inline NodeIds getNodeIds(std::initializer_list<FrozenPDG::NodeId> nodes)
+{
+    return NodeIds(nodes);
+}
+
+/// Small PDG built node by node and frozen into a temporary directory, which
+/// is removed with the fixture
+class FrozenFixture
+{
+public:
+    using NodeId = FrozenPDG::NodeId;
+    using EdgeKind = SerializedPDG::EdgeKind;
+
+public:
+    FrozenFixture()
+    {
+        llvm::SmallString<128> directory;
+        if (llvm::sys::fs::createUniqueDirectory("pdg-test", directory)) {
+            llvm::report_fatal_error("Could not create a fixture directory");
+        }
+        m_directory = directory.str().str();
+        m_pdg.addModule("test.bc");
+    }
+
+    ~FrozenFixture()
+    {
+        m_frozen.reset();
+        llvm::sys::fs::remove_directories(m_directory);
+    }
+
+    FrozenFixture(const FrozenFixture& ) = delete;
+    FrozenFixture& operator =(const FrozenFixture& ) = delete;
+
+public:
+    /// Node of the given PDGLLVMNode::NodeType in function, none if empty
+    NodeId addNode(unsigned type,
+                   const std::string& function,
+                   unsigned opcode = 0,
+                   const std::string& symbol = "",
+                   int argIdx = -1)
+    {
+        const auto linkage = symbol.empty() ? SerializedPDG::Linkage::None : SerializedPDG::Linkage::Definition;
+        return m_pdg.addNode(SerializedPDG::Node{0, type, linkage, symbol, argIdx, function,
+                                                 "node " + std::to_string(m_pdg.getNodes().size()), opcode, ""});
+    }
+
+    NodeId addInstruction(const std::string& function, unsigned opcode = 0)
+    {
+        return addNode(PDGLLVMNode::InstructionNode, function, opcode);
+    }
+
+    void addEdge(NodeId source, NodeId dest, EdgeKind kind = EdgeKind::Data)
+    {
+        m_pdg.addEdge(source, dest, kind);
+    }
+
+    /// Writes the graph into the frozen subdirectory and maps it
+    const FrozenPDG& freeze()
+    {
+        m_frozen.reset();
+        {
+            FrozenPDGWriter writer(getFrozenDirectory(), uint64_t(1) << 20);
+            writer.addModule(m_pdg.getModules().front());
+            for (const auto& node : m_pdg.getNodes()) {
+                writer.addNode(node);
+            }
+            for (const auto& edge : m_pdg.getEdges()) {
+                writer.addEdge(edge.source, edge.dest, edge.kind);
+            }
+            if (!writer.finish()) {
+                llvm::report_fatal_error("Could not freeze the fixture");
+            }
+        }
+        m_frozen = FrozenPDG::open(getFrozenDirectory());
+        if (!m_frozen) {
+            llvm::report_fatal_error("Could not open the frozen fixture");
+        }
+        return *m_frozen;
+    }
+
+    const std::string& getDirectory() const
+    {
+        return m_directory;
+    }
+
+    std::string getFrozenDirectory() const
+    {
+        return getPath("frozen");
+    }
+
+    std::string getPath(const std::string& name) const
+    {
+        llvm::SmallString<256> path(m_directory);
+        llvm::sys::path::append(path, name);
+        return path.str().str();
+    }
+
+private:
+    std::string m_directory;
+    SerializedPDG m_pdg;
+    std::unique_ptr<FrozenPDG> m_frozen;
+}; // class FrozenFixture
+
+} // namespace test
+} // namespace pdg
+
+#define PDG_CHECK(condition) ::pdg::test::check((condition), #condition, __FILE__, __LINE__)
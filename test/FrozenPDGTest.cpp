@@ -0,0 +1,112 @@
+#include "FrozenFixture.h"
+
+#include "llvm/IR/Instruction.h"
+
+#include <cstddef>
+#include <fstream>
+
+using namespace pdg;
+using namespace pdg::test;
+
+namespace {
+
+using EdgeKind = SerializedPDG::EdgeKind;
+
+/// Overwrites a value of a frozen array in place
+template <typename T>
+void patch(const std::string& path, uint64_t offset, const T& value)
+{
+    std::fstream file(path, std::ios::in | std::ios::out | std::ios::binary);
+    file.seekp(offset);
+    file.write(reinterpret_cast<const char*>(&value), sizeof(T));
+}
+
+void testLayout()
+{
+    FrozenFixture fixture;
+    const auto global = fixture.addNode(PDGLLVMNode::GlobalVariableNode, "", 0, "counter");
+    const auto callee = fixture.addNode(PDGLLVMNode::FunctionNode, "", 0, "g");
+    const auto load = fixture.addInstruction("f", llvm::Instruction::Load);
+    const auto call = fixture.addInstruction("f", llvm::Instruction::Call);
+    const auto store = fixture.addInstruction("f", llvm::Instruction::Store);
+    fixture.addEdge(global, load);
+    fixture.addEdge(load, call);
+    fixture.addEdge(call, callee, EdgeKind::Control);
+    fixture.addEdge(callee, call);
+    fixture.addEdge(call, store);
+    const FrozenPDG& pdg = fixture.freeze();
+
+    PDG_CHECK(pdg.getNumNodes() == 5);
+    PDG_CHECK(pdg.getNumEdges() == 5);
+    PDG_CHECK(pdg.getFunction(global) == FrozenPDG::NoFunction);
+    PDG_CHECK(pdg.getSymbol(global) == "counter");
+    PDG_CHECK(pdg.getFunctionName(pdg.getFunction(load)) == "f");
+    PDG_CHECK(pdg.getFunctionNodes(pdg.findFunction("f")).vec() == getNodeIds({load, call, store}));
+    PDG_CHECK(pdg.getOutEdges(call).size() == 2);
+    PDG_CHECK(pdg.getOutEdges(call)[0].node == callee);
+    PDG_CHECK(pdg.getOutEdges(call)[0].getKind() == EdgeKind::Control);
+    PDG_CHECK(pdg.getInEdges(call).size() == 2);
+    PDG_CHECK(pdg.getNodesOfType(PDGLLVMNode::InstructionNode).vec() == getNodeIds({load, call, store}));
+    PDG_CHECK(pdg.getNodesWithOpcode(llvm::Instruction::Store).vec() == getNodeIds({store}));
+    PDG_CHECK(pdg.getCallSites("g").vec() == getNodeIds({call}));
+    PDG_CHECK(pdg.getCallSites("h").empty());
+}
+
+void testValidation()
+{
+    FrozenFixture fixture;
+    const auto first = fixture.addInstruction("f");
+    const auto second = fixture.addInstruction("f");
+    fixture.addEdge(first, second);
+    fixture.freeze();
+    const std::string directory = fixture.getFrozenDirectory();
+    PDG_CHECK(FrozenPDG::open(directory) != nullptr);
+
+    // edge target beyond the nodes
+    patch(fixture.getPath("frozen/out.edges"), 0, FrozenPDG::NodeId(7));
+    PDG_CHECK(FrozenPDG::open(directory) == nullptr);
+    fixture.freeze();
+    // label offset beyond the string pool
+    patch(fixture.getPath("frozen/nodes"), offsetof(FrozenPDG::NodeRecord, label), uint64_t(1) << 40);
+    PDG_CHECK(FrozenPDG::open(directory) == nullptr);
+    fixture.freeze();
+    // decreasing row offsets
+    patch(fixture.getPath("frozen/in.offsets"), sizeof(uint64_t), uint64_t(1));
+    patch(fixture.getPath("frozen/in.offsets"), 2 * sizeof(uint64_t), uint64_t(0));
+    PDG_CHECK(FrozenPDG::open(directory) == nullptr);
+}
+
+void testReplace()
+{
+    FrozenFixture fixture;
+    fixture.addInstruction("f");
+    fixture.freeze();
+    auto old = FrozenPDG::open(fixture.getFrozenDirectory());
+    fixture.addInstruction("f");
+    const FrozenPDG& replaced = fixture.freeze();
+    // the old graph stays mapped and intact
+    PDG_CHECK(old->getNumNodes() == 1);
+    PDG_CHECK(old->getLabel(0) == "node 0");
+    PDG_CHECK(replaced.getNumNodes() == 2);
+
+    // a directory that holds something else is not replaced
+    const std::string other = fixture.getPath("other");
+    llvm::sys::fs::create_directories(other);
+    std::ofstream(fixture.getPath("other/notes.txt")) << "keep\n";
+    FrozenPDGWriter writer(other, uint64_t(1) << 20);
+    writer.addModule("test.bc");
+    writer.addNode(SerializedPDG::Node{0, PDGLLVMNode::InstructionNode, SerializedPDG::Linkage::None,
+                                       "", -1, "f", "", 0, ""});
+    PDG_CHECK(!writer.finish());
+    PDG_CHECK(llvm::sys::fs::exists(fixture.getPath("other/notes.txt")));
+}
+
+} // unnamed namespace
+
+int main()
+{
+    testLayout();
+    testValidation();
+    testReplace();
+    return getResult();
+}
@@ -0,0 +1,132 @@
+#include "FrozenFixture.h"
+
+#include "PDG/PDGChopper.h"
+#include "PDG/PDGSlicer.h"
+
+#include <algorithm>
+#include <iterator>
+#include <random>
+
+using namespace pdg;
+using namespace pdg::test;
+
+namespace {
+
+using EdgeKind = SerializedPDG::EdgeKind;
+
+/// s -> a -> b -> t, s -> c -control-> t, a -> d, e -> b
+void testChop()
+{
+    FrozenFixture fixture;
+    const auto s = fixture.addInstruction("f");
+    const auto a = fixture.addInstruction("f");
+    const auto b = fixture.addInstruction("f");
+    const auto c = fixture.addInstruction("f");
+    const auto d = fixture.addInstruction("f");
+    const auto e = fixture.addInstruction("f");
+    const auto t = fixture.addInstruction("f");
+    fixture.addEdge(s, a);
+    fixture.addEdge(a, b);
+    fixture.addEdge(b, t);
+    fixture.addEdge(s, c);
+    fixture.addEdge(c, t, EdgeKind::Control);
+    fixture.addEdge(a, d);
+    fixture.addEdge(e, b);
+    const FrozenPDG& pdg = fixture.freeze();
+    PDGChopper chopper(pdg);
+
+    PDG_CHECK(chopper.chop(s, t).getNodes() == getNodeIds({s, a, b, c, t}));
+    PDG_CHECK(chopper.chop(s, t, DataEdges).getNodes() == getNodeIds({s, a, b, t}));
+    PDG_CHECK(chopper.chop(getNodeIds({s, e}), b).getNodes() == getNodeIds({s, a, b, e}));
+    PDG_CHECK(chopper.chop(t, s).size() == 0);
+
+    const DependencePath path = chopper.shortestPath(s, t);
+    PDG_CHECK(path.nodes == getNodeIds({s, c, t}));
+    PDG_CHECK(path.edges == std::vector<EdgeKind>({EdgeKind::Data, EdgeKind::Control}));
+    const DependencePath dataPath = chopper.shortestPath(s, t, DataEdges);
+    PDG_CHECK(dataPath.nodes == getNodeIds({s, a, b, t}));
+    PDG_CHECK(dataPath.edges.size() == 3);
+    PDG_CHECK(chopper.shortestPath(d, t).empty());
+    // a node that is both a source and a sink is a path by itself
+    const DependencePath trivial = chopper.shortestPath(getNodeIds({a, e}), getNodeIds({e, t}));
+    PDG_CHECK(trivial.nodes == getNodeIds({e}));
+    PDG_CHECK(trivial.edges.empty());
+}
+
+/// Distances from the sources by a plain breadth first search
+std::vector<unsigned> getDistances(const FrozenPDG& pdg, const NodeIds& sources)
+{
+    const unsigned unreached = ~0u;
+    std::vector<unsigned> distances(pdg.getNumNodes(), unreached);
+    NodeIds queue;
+    for (auto source : sources) {
+        if (distances[source] == unreached) {
+            distances[source] = 0;
+            queue.push_back(source);
+        }
+    }
+    for (size_t i = 0; i < queue.size(); ++i) {
+        for (const auto& edge : pdg.getOutEdges(queue[i])) {
+            if (distances[edge.node] == unreached) {
+                distances[edge.node] = distances[queue[i]] + 1;
+                queue.push_back(edge.node);
+            }
+        }
+    }
+    return distances;
+}
+
+/// Chops are the intersection of forward and backward slices and paths are
+/// shortest paths of existing edges
+void testAgainstSlicer()
+{
+    const unsigned numNodes = 300;
+    FrozenFixture fixture;
+    std::mt19937 random(11);
+    for (unsigned i = 0; i < numNodes; ++i) {
+        fixture.addInstruction("f");
+    }
+    for (unsigned i = 0; i < numNodes + numNodes / 3; ++i) {
+        fixture.addEdge(random() % numNodes, random() % numNodes, static_cast<EdgeKind>(random() % 3));
+    }
+    const FrozenPDG& pdg = fixture.freeze();
+    PDGSlicer slicer(pdg);
+    PDGChopper chopper(pdg);
+    for (unsigned i = 0; i < 50; ++i) {
+        const NodeIds sources = getNodeIds({FrozenPDG::NodeId(random() % numNodes),
+                                            FrozenPDG::NodeId(random() % numNodes)});
+        const NodeIds sinks = getNodeIds({FrozenPDG::NodeId(random() % numNodes)});
+        const NodeIds forward = slicer.forwardSlice(sources).getNodes();
+        const NodeIds backward = slicer.backwardSlice(sinks).getNodes();
+        NodeIds expected;
+        std::set_intersection(forward.begin(), forward.end(), backward.begin(), backward.end(),
+                              std::back_inserter(expected));
+        PDG_CHECK(chopper.chop(sources, sinks).getNodes() == expected);
+
+        const DependencePath path = chopper.shortestPath(sources, sinks);
+        const unsigned distance = getDistances(pdg, sources)[sinks.front()];
+        PDG_CHECK(path.empty() == expected.empty());
+        if (path.empty()) {
+            continue;
+        }
+        PDG_CHECK(path.nodes.size() == distance + 1);
+        PDG_CHECK(path.edges.size() + 1 == path.nodes.size());
+        PDG_CHECK(std::find(sources.begin(), sources.end(), path.nodes.front()) != sources.end());
+        PDG_CHECK(path.nodes.back() == sinks.front());
+        for (size_t j = 0; j + 1 < path.nodes.size() && j < path.edges.size(); ++j) {
+            const auto edges = pdg.getOutEdges(path.nodes[j]);
+            PDG_CHECK(std::any_of(edges.begin(), edges.end(), [&] (const FrozenPDG::Edge& edge) {
+                return edge.node == path.nodes[j + 1] && edge.getKind() == path.edges[j];
+            }));
+        }
+    }
+}
+
+} // unnamed namespace
+
+int main()
+{
+    testChop();
+    testAgainstSlicer();
+    return getResult();
+}
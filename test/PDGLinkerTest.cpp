@@ -0,0 +1,306 @@
+#include "FrozenFixture.h"
+
+#include "PDG/PDGLinker.h"
+
+#include <algorithm>
+
+using namespace pdg;
+using namespace pdg::test;
+
+namespace {
+
+using Linkage = SerializedPDG::Linkage;
+using EdgeKind = SerializedPDG::EdgeKind;
+
+/// Graph of one module with a function node of symbol, and with a call of
+/// it if it is a declaration
+SerializedPDG getModule(const std::string& moduleName, const std::string& symbol, Linkage linkage)
+{
+    SerializedPDG pdg;
+    pdg.addModule(moduleName);
+    const unsigned function = pdg.addNode(SerializedPDG::Node{0, PDGLLVMNode::FunctionNode, linkage, symbol, -1,
+                                                              "", moduleName + " " + symbol, 0, ""});
+    if (linkage == Linkage::Declaration || linkage == Linkage::LocalDeclaration) {
+        const unsigned call = pdg.addNode(SerializedPDG::Node{0, PDGLLVMNode::InstructionNode, Linkage::None, "", -1,
+                                                              "main", moduleName + " call", 0, ""});
+        pdg.addEdge(call, function, EdgeKind::Control);
+    } else {
+        const unsigned formal = pdg.addNode(SerializedPDG::Node{0, PDGLLVMNode::FormalArgumentNode, linkage, symbol, 0,
+                                                                symbol, moduleName + " formal", 0, ""});
+        pdg.addEdge(formal, function, EdgeKind::Data);
+    }
+    return pdg;
+}
+
+/// Function node the first call is wired to
+const SerializedPDG::Node* getCallee(const SerializedPDG& pdg)
+{
+    for (const auto& edge : pdg.getEdges()) {
+        if (edge.kind == EdgeKind::Control && pdg.getNodes()[edge.dest].type == PDGLLVMNode::FunctionNode) {
+            return &pdg.getNodes()[edge.dest];
+        }
+    }
+    return nullptr;
+}
+
+bool isCallOf(const SerializedPDG& pdg, const std::string& label)
+{
+    const SerializedPDG::Node* callee = getCallee(pdg);
+    return callee && callee->label == label;
+}
+
+void testResolve()
+{
+    PDGLinker linker;
+    linker.addModule(getModule("a.bc", "foo", Linkage::Definition));
+    linker.addModule(getModule("b.bc", "foo", Linkage::Declaration));
+    linker.addModule(getModule("c.bc", "bar", Linkage::Declaration));
+    const SerializedPDG linked = linker.link();
+    PDG_CHECK(linked.getModules().size() == 3);
+    PDG_CHECK(linked.getNodes().size() == 5);
+    PDG_CHECK(linker.getNumResolved() == 1);
+    PDG_CHECK(linker.getUnresolvedSymbols() == std::vector<std::string>({"bar"}));
+    PDG_CHECK(linker.getMultipleDefinitions().empty());
+    // the call of b.bc now leads to the definition of a.bc
+    PDG_CHECK(isCallOf(linked, "a.bc foo"));
+}
+
+void testDefinitions()
+{
+    {
+        // a strong definition replaces a weak one wherever it comes
+        PDGLinker linker;
+        linker.addModule(getModule("a.bc", "foo", Linkage::WeakDefinition));
+        linker.addModule(getModule("b.bc", "foo", Linkage::Declaration));
+        linker.addModule(getModule("c.bc", "foo", Linkage::Definition));
+        linker.addModule(getModule("d.bc", "foo", Linkage::WeakDefinition));
+        const SerializedPDG linked = linker.link();
+        PDG_CHECK(isCallOf(linked, "c.bc foo"));
+        PDG_CHECK(linker.getMultipleDefinitions().empty());
+        PDG_CHECK(linker.getUnresolvedSymbols().empty());
+    }
+    {
+        PDGLinker linker;
+        linker.addModule(getModule("a.bc", "foo", Linkage::Definition));
+        linker.addModule(getModule("b.bc", "foo", Linkage::Declaration));
+        linker.addModule(getModule("c.bc", "foo", Linkage::Definition));
+        const SerializedPDG linked = linker.link();
+        PDG_CHECK(isCallOf(linked, "a.bc foo"));
+        PDG_CHECK(linker.getMultipleDefinitions() == std::vector<std::string>({"foo"}));
+    }
+}
+
+/// Definition of foo whose body returns its formal argument and calls foo
+/// with it again
+SerializedPDG getRecursiveModule(const std::string& moduleName, Linkage linkage)
+{
+    SerializedPDG pdg;
+    pdg.addModule(moduleName);
+    auto addNode = [&] (unsigned type, Linkage nodeLinkage, const std::string& symbol, int argIdx,
+                        const std::string& label) {
+        return pdg.addNode(SerializedPDG::Node{0, type, nodeLinkage, symbol, argIdx, "foo",
+                                               moduleName + " " + label, 0, ""});
+    };
+    const unsigned function = addNode(PDGLLVMNode::FunctionNode, linkage, "foo", -1, "foo");
+    const unsigned formal = addNode(PDGLLVMNode::FormalArgumentNode, linkage, "foo", 0, "formal");
+    const unsigned value = addNode(PDGLLVMNode::InstructionNode, Linkage::None, "", -1, "value");
+    const unsigned actual = addNode(PDGLLVMNode::ActualArgumentNode, Linkage::None, "", 0, "actual");
+    const unsigned call = addNode(PDGLLVMNode::InstructionNode, Linkage::None, "", -1, "call");
+    pdg.addEdge(formal, value, EdgeKind::Data);
+    pdg.addEdge(value, function, EdgeKind::Data);
+    pdg.addEdge(value, actual, EdgeKind::Data);
+    pdg.addEdge(actual, formal, EdgeKind::Data);
+    pdg.addEdge(actual, call, EdgeKind::Data);
+    pdg.addEdge(call, function, EdgeKind::Control);
+    pdg.addEdge(function, call, EdgeKind::Data);
+    return pdg;
+}
+
+void testDiscardedBodies()
+{
+    PDGLinker linker;
+    linker.addModule(getRecursiveModule("a.bc", Linkage::WeakDefinition));
+    linker.addModule(getModule("b.bc", "foo", Linkage::Declaration));
+    linker.addModule(getRecursiveModule("c.bc", Linkage::Definition));
+    linker.addModule(getRecursiveModule("d.bc", Linkage::WeakDefinition));
+    const SerializedPDG linked = linker.link();
+    // the body of c.bc and the call of b.bc
+    PDG_CHECK(linked.getNodes().size() == 6);
+    PDG_CHECK(linker.getNumDiscarded() == 6);
+    PDG_CHECK(linker.getNumResolved() == 5);
+    PDG_CHECK(isCallOf(linked, "c.bc foo"));
+    for (const auto& node : linked.getNodes()) {
+        PDG_CHECK(node.label.compare(0, 4, "a.bc") != 0 && node.label.compare(0, 4, "d.bc") != 0);
+    }
+    for (const auto& edge : linked.getEdges()) {
+        const auto& source = linked.getNodes()[edge.source];
+        const auto& dest = linked.getNodes()[edge.dest];
+        if (dest.type == PDGLLVMNode::FormalArgumentNode) {
+            PDG_CHECK(source.label == "c.bc actual");
+        }
+        PDG_CHECK(edge.source != edge.dest);
+    }
+    PDG_CHECK(linked.getEdges().size() == 8);
+}
+
+void testLocals()
+{
+    {
+        // separate inputs keep their local helpers apart, even of the same module name
+        PDGLinker linker;
+        linker.addModule(getModule("x.bc", "helper", Linkage::Local));
+        linker.addModule(getModule("x.bc", "helper", Linkage::LocalDeclaration));
+        const SerializedPDG linked = linker.link();
+        PDG_CHECK(linked.getNodes().size() == 4);
+        PDG_CHECK(linker.getNumResolved() == 0);
+        const SerializedPDG::Node* callee = getCallee(linked);
+        PDG_CHECK(callee && callee->linkage == Linkage::LocalDeclaration);
+    }
+    {
+        // shards of one module share them
+        PDGLinker linker;
+        linker.addShard(getModule("x.bc", "helper", Linkage::Local));
+        linker.addShard(getModule("x.bc", "helper", Linkage::LocalDeclaration));
+        linker.addShard(getModule("y.bc", "helper", Linkage::LocalDeclaration));
+        const SerializedPDG linked = linker.link();
+        PDG_CHECK(linked.getModules().size() == 2);
+        PDG_CHECK(linked.getNodes().size() == 5);
+        PDG_CHECK(linker.getNumResolved() == 1);
+        PDG_CHECK(linker.getMultipleDefinitions().empty());
+        const SerializedPDG::Node* callee = getCallee(linked);
+        PDG_CHECK(callee && callee->linkage == Linkage::Local);
+        // the helper of y.bc is another one
+        PDG_CHECK(linker.getUnresolvedSymbols() == std::vector<std::string>({"helper"}));
+    }
+}
+
+/// Graph of one module with a function and a global that refers to it, whose
+/// edge coincides with those of other modules once linked
+SerializedPDG getSymbolModule(const std::string& moduleName, Linkage linkage)
+{
+    SerializedPDG pdg;
+    pdg.addModule(moduleName);
+    const unsigned function = pdg.addNode(SerializedPDG::Node{0, PDGLLVMNode::FunctionNode, linkage, "foo", -1,
+                                                              "", moduleName + " foo", 0, ""});
+    const unsigned global = pdg.addNode(SerializedPDG::Node{0, PDGLLVMNode::GlobalVariableNode, linkage, "table", -1,
+                                                            "", moduleName + " table", 0, ""});
+    pdg.addEdge(function, global, EdgeKind::Data);
+    return pdg;
+}
+
+/// Nodes of a frozen graph and its edges between node labels, sorted
+std::vector<std::string> describe(const FrozenPDG& frozen)
+{
+    std::vector<std::string> nodes;
+    std::vector<std::string> edges;
+    for (FrozenPDG::NodeId node = 0; node < frozen.getNumNodes(); ++node) {
+        nodes.push_back(frozen.getModules()[frozen.getModule(node)] + " " + frozen.getLabel(node).str()
+                        + " " + std::to_string(static_cast<unsigned>(frozen.getLinkage(node))));
+        for (const auto& edge : frozen.getOutEdges(node)) {
+            edges.push_back(frozen.getLabel(node).str() + " -> " + frozen.getLabel(edge.node).str()
+                            + " " + std::to_string(edge.kind));
+        }
+    }
+    std::sort(nodes.begin(), nodes.end());
+    std::sort(edges.begin(), edges.end());
+    nodes.insert(nodes.end(), edges.begin(), edges.end());
+    return nodes;
+}
+
+/// Links the graphs in memory and streamed from files, which must agree
+void checkStreamedLink(const std::vector<SerializedPDG>& pdgs, bool shards)
+{
+    FrozenFixture fixture;
+    PDGLinker memoryLinker;
+    PDGLinker fileLinker;
+    for (unsigned i = 0; i < pdgs.size(); ++i) {
+        const std::string path = fixture.getPath("input" + std::to_string(i) + ".pdg");
+        PDG_CHECK(pdgs[i].save(path));
+        if (shards) {
+            memoryLinker.addShard(pdgs[i]);
+            PDG_CHECK(fileLinker.addShardFile(path));
+        } else {
+            memoryLinker.addModule(pdgs[i]);
+            PDG_CHECK(fileLinker.addModuleFile(path));
+        }
+    }
+
+    const SerializedPDG linked = memoryLinker.link();
+    {
+        FrozenPDGWriter writer(fixture.getPath("memory"), uint64_t(1) << 20);
+        for (const auto& module : linked.getModules()) {
+            writer.addModule(module);
+        }
+        for (const auto& node : linked.getNodes()) {
+            writer.addNode(node);
+        }
+        for (const auto& edge : linked.getEdges()) {
+            writer.addEdge(edge.source, edge.dest, edge.kind);
+        }
+        PDG_CHECK(writer.finish());
+    }
+    {
+        FrozenPDGWriter writer(fixture.getPath("streamed"), uint64_t(1) << 20);
+        PDG_CHECK(fileLinker.link(writer));
+        PDG_CHECK(writer.finish());
+    }
+    auto memory = FrozenPDG::open(fixture.getPath("memory"));
+    auto streamed = FrozenPDG::open(fixture.getPath("streamed"));
+    PDG_CHECK(memory && streamed);
+    if (!memory || !streamed) {
+        return;
+    }
+    PDG_CHECK(streamed->getModules() == memory->getModules());
+    PDG_CHECK(streamed->getNumEdges() == memory->getNumEdges());
+    PDG_CHECK(describe(*streamed) == describe(*memory));
+    PDG_CHECK(fileLinker.getNumResolved() == memoryLinker.getNumResolved());
+    PDG_CHECK(fileLinker.getNumDiscarded() == memoryLinker.getNumDiscarded());
+    PDG_CHECK(fileLinker.getUnresolvedSymbols() == memoryLinker.getUnresolvedSymbols());
+    PDG_CHECK(fileLinker.getMultipleDefinitions() == memoryLinker.getMultipleDefinitions());
+}
+
+void testStreamedLink()
+{
+    {
+        std::vector<SerializedPDG> pdgs;
+        pdgs.push_back(getRecursiveModule("a.bc", Linkage::WeakDefinition));
+        pdgs.push_back(getModule("b.bc", "foo", Linkage::Declaration));
+        pdgs.push_back(getRecursiveModule("c.bc", Linkage::Definition));
+        pdgs.push_back(getRecursiveModule("d.bc", Linkage::WeakDefinition));
+        pdgs.push_back(getModule("e.bc", "bar", Linkage::Declaration));
+        checkStreamedLink(pdgs, false);
+    }
+    {
+        std::vector<SerializedPDG> pdgs;
+        pdgs.push_back(getSymbolModule("a.bc", Linkage::Declaration));
+        pdgs.push_back(getSymbolModule("b.bc", Linkage::Definition));
+        pdgs.push_back(getSymbolModule("c.bc", Linkage::Declaration));
+        checkStreamedLink(pdgs, false);
+    }
+    {
+        std::vector<SerializedPDG> pdgs;
+        pdgs.push_back(getModule("x.bc", "helper", Linkage::Local));
+        pdgs.push_back(getModule("x.bc", "helper", Linkage::LocalDeclaration));
+        pdgs.push_back(getModule("y.bc", "helper", Linkage::LocalDeclaration));
+        checkStreamedLink(pdgs, true);
+        checkStreamedLink(pdgs, false);
+    }
+    {
+        // a file that cannot be read fails before the link
+        FrozenFixture fixture;
+        PDGLinker linker;
+        PDG_CHECK(!linker.addModuleFile(fixture.getPath("missing.pdg")));
+    }
+}
+
+} // unnamed namespace
+
+int main()
+{
+    testResolve();
+    testDefinitions();
+    testDiscardedBodies();
+    testLocals();
+    testStreamedLink();
+    return getResult();
+}
@@ -0,0 +1,109 @@
+#include "FrozenFixture.h"
+
+#include "PDG/PDGQuery.h"
+#include "PDG/PDGSlicer.h"
+
+#include "llvm/IR/Instruction.h"
+
+using namespace pdg;
+using namespace pdg::test;
+
+namespace {
+
+using EdgeKind = SerializedPDG::EdgeKind;
+
+std::unique_ptr<PDGQuery> parseValid(llvm::StringRef text)
+{
+    auto query = PDGQuery::parse(text);
+    if (!query) {
+        llvm::report_fatal_error("Could not parse a test query");
+    }
+    return query;
+}
+
+void testParse()
+{
+    auto query = PDGQuery::parse("(c: callee=getenv) -[data|summary+]-> (s: opcode=store, function=\"cold \\\"path\\\"\");"
+                                 "(s) <-[control]- (: type=ActualArgumentNode)");
+    PDG_CHECK(query != nullptr);
+    if (!query) {
+        return;
+    }
+    PDG_CHECK(query->getVariables().size() == 3);
+    PDG_CHECK(query->getOutputs() == std::vector<unsigned>({0, 1}));
+    const auto& predicates = query->getVariables()[1].predicates;
+    PDG_CHECK(predicates.size() == 2);
+    PDG_CHECK(predicates.size() == 2 && predicates[1].value == "cold \"path\"");
+    const auto& type = query->getVariables()[2].predicates;
+    PDG_CHECK(type.size() == 1 && type[0].number == PDGLLVMNode::ActualArgumentNode);
+
+    const auto& constraints = query->getConstraints();
+    PDG_CHECK(constraints.size() == 2);
+    PDG_CHECK(constraints[0].edges == (DataEdges | SummaryEdges) && constraints[0].transitive
+              && constraints[0].minLength == 1);
+    PDG_CHECK(constraints[1].from == 2 && constraints[1].to == 1 && !constraints[1].transitive);
+
+    PDG_CHECK(!PDGQuery::parse("(: function=\"main)"));
+    PDG_CHECK(!PDGQuery::parse("(: type=Bogus)"));
+    PDG_CHECK(!PDGQuery::parse("(: opcode=bogus)"));
+    PDG_CHECK(!PDGQuery::parse("(a) -[data]-"));
+}
+
+/// f: c = getenv() -> l = load -> s1 = store, b = br -control-> s1, s2
+/// "cold path": s3 = store
+void testRun()
+{
+    FrozenFixture fixture;
+    const auto getenv = fixture.addNode(PDGLLVMNode::FunctionNode, "", 0, "getenv");
+    const auto c = fixture.addInstruction("f", llvm::Instruction::Call);
+    const auto l = fixture.addInstruction("f", llvm::Instruction::Load);
+    const auto s1 = fixture.addInstruction("f", llvm::Instruction::Store);
+    const auto s2 = fixture.addInstruction("f", llvm::Instruction::Store);
+    const auto b = fixture.addInstruction("f", llvm::Instruction::Br);
+    const auto s3 = fixture.addInstruction("cold path", llvm::Instruction::Store);
+    fixture.addEdge(c, getenv, EdgeKind::Control);
+    fixture.addEdge(getenv, c);
+    fixture.addEdge(c, l);
+    fixture.addEdge(l, s1);
+    fixture.addEdge(b, s1, EdgeKind::Control);
+    fixture.addEdge(b, s2, EdgeKind::Control);
+    const FrozenPDG& pdg = fixture.freeze();
+    QueryEngine engine(pdg);
+
+    auto flows = parseValid("(c: callee=getenv) -[data*]-> (s: opcode=store)");
+    PDG_CHECK(engine.run(*flows) == std::vector<QueryMatch>({QueryMatch({c, s1})}));
+    PDG_CHECK(engine.explain(*flows) == "scan c of 1 candidates\n"
+                                        "expand s along -[data*]-> from c\n");
+
+    // the variable with fewer candidates is scanned regardless of order
+    auto reversed = parseValid("(s: opcode=store) <-[data*]- (c: callee=getenv)");
+    PDG_CHECK(engine.run(*reversed) == std::vector<QueryMatch>({QueryMatch({s1, c})}));
+    PDG_CHECK(engine.explain(*reversed) == "scan c of 1 candidates\n"
+                                           "expand s along -[data*]-> from c\n");
+
+    auto joined = parseValid("(c: callee=getenv) -[data*]-> (s: opcode=store); (b: opcode=br) -[control]-> (s);"
+                                  "(b) -[any*]-> (s)");
+    PDG_CHECK(engine.run(*joined, 2) == std::vector<QueryMatch>({QueryMatch({c, s1, b})}));
+    PDG_CHECK(engine.explain(*joined) == "scan c of 1 candidates\n"
+                                         "expand s along -[data*]-> from c\n"
+                                         "expand b against -[control]-> from s\n"
+                                         "check b -[any*]-> s\n");
+
+    auto controlled = parseValid("(: opcode=br) -[control]-> (s: opcode=store)");
+    PDG_CHECK(engine.run(*controlled) == std::vector<QueryMatch>({QueryMatch({s1}), QueryMatch({s2})}));
+
+    auto cold = parseValid("(s: opcode=store, function=\"cold path\")");
+    PDG_CHECK(engine.run(*cold) == std::vector<QueryMatch>({QueryMatch({s3})}));
+    auto functions = parseValid("(n: type=FunctionNode)");
+    PDG_CHECK(engine.run(*functions) == std::vector<QueryMatch>({QueryMatch({getenv})}));
+    PDG_CHECK(engine.explain(*functions) == "scan n of 1 candidates\n");
+}
+
+} // unnamed namespace
+
+int main()
+{
+    testParse();
+    testRun();
+    return getResult();
+}
@@ -0,0 +1,60 @@
+#include "FrozenFixture.h"
+
+#include "PDG/PDGSlicer.h"
+
+using namespace pdg;
+using namespace pdg::test;
+
+namespace {
+
+using EdgeKind = SerializedPDG::EdgeKind;
+
+/// f:  a -> b -> c -control-> d
+///     b -> formal p of g -> e in g
+///     x -> c
+void testSlices()
+{
+    FrozenFixture fixture;
+    const auto a = fixture.addInstruction("f");
+    const auto b = fixture.addInstruction("f");
+    const auto c = fixture.addInstruction("f");
+    const auto d = fixture.addInstruction("f");
+    const auto x = fixture.addInstruction("f");
+    const auto p = fixture.addNode(PDGLLVMNode::FormalArgumentNode, "g", 0, "g", 0);
+    const auto e = fixture.addInstruction("g");
+    fixture.addEdge(a, b);
+    fixture.addEdge(b, c);
+    fixture.addEdge(c, d, EdgeKind::Control);
+    fixture.addEdge(b, p);
+    fixture.addEdge(p, e);
+    fixture.addEdge(x, c);
+    const FrozenPDG& pdg = fixture.freeze();
+    PDGSlicer slicer(pdg);
+
+    PDG_CHECK(slicer.forwardSlice(a).getNodes() == getNodeIds({a, b, c, d, p, e}));
+    PDG_CHECK(slicer.forwardSlice(a, DataEdges).getNodes() == getNodeIds({a, b, c, p, e}));
+    PDG_CHECK(slicer.backwardSlice(d).getNodes() == getNodeIds({a, b, c, d, x}));
+    PDG_CHECK(slicer.backwardSlice(d, DataEdges).getNodes() == getNodeIds({d}));
+    PDG_CHECK(slicer.backwardSlice(getNodeIds({e, x})).getNodes() == getNodeIds({a, b, x, p, e}));
+
+    SliceOptions options;
+    options.direction = SliceDirection::Forward;
+    options.interprocedural = false;
+    PDG_CHECK(slicer.slice(a, options).getNodes() == getNodeIds({a, b, c, d}));
+
+    // the visitor stops the traversal at b
+    const Slice stopped = slicer.slice(a, options, [b] (FrozenPDG::NodeId node) { return node != b; });
+    PDG_CHECK(!stopped.isComplete());
+    PDG_CHECK(stopped.contains(b));
+    PDG_CHECK(!stopped.contains(c));
+    // the visited set is cleared after a stopped slice
+    PDG_CHECK(slicer.forwardSlice(a).size() == 6);
+}
+
+} // unnamed namespace
+
+int main()
+{
+    testSlices();
+    return getResult();
+}
@@ -0,0 +1,105 @@
+#include "FrozenFixture.h"
+
+#include "PDG/PDGSnapshot.h"
+
+#include <atomic>
+#include <thread>
+
+using namespace pdg;
+using namespace pdg::test;
+
+namespace {
+
+/// Chain of numNodes instructions
+void addChain(FrozenFixture& fixture, unsigned numNodes)
+{
+    for (unsigned i = 0; i < numNodes; ++i) {
+        fixture.addInstruction("f");
+        if (i != 0) {
+            fixture.addEdge(i - 1, i);
+        }
+    }
+}
+
+void testPublish()
+{
+    FrozenFixture oldFixture;
+    addChain(oldFixture, 3);
+    oldFixture.freeze();
+    FrozenFixture newFixture;
+    addChain(newFixture, 5);
+    newFixture.freeze();
+
+    SnapshotPublisher snapshots(PDGSnapshot::open(oldFixture.getFrozenDirectory(), true, 1));
+    auto reader = snapshots.acquire();
+    PDG_CHECK(reader && reader->getVersion() == 1);
+    std::weak_ptr<const PDGSnapshot> oldSnapshot = reader;
+
+    auto replaced = snapshots.publish(PDGSnapshot::open(newFixture.getFrozenDirectory(), true, 2));
+    PDG_CHECK(replaced == reader);
+    replaced.reset();
+    // the reader keeps its graph, index and version
+    PDG_CHECK(reader->getVersion() == 1);
+    PDG_CHECK(reader->getPDG().getNumNodes() == 3);
+    PDG_CHECK(reader->getIndex() && reader->getIndex()->reaches(0, 2));
+    // later acquires see the new snapshot
+    auto later = snapshots.acquire();
+    PDG_CHECK(later->getVersion() == 2);
+    PDG_CHECK(later->getPDG().getNumNodes() == 5);
+    PDG_CHECK(later->getIndex()->reaches(0, 4));
+
+    // the old snapshot lives as long as its last holder
+    auto otherReader = reader;
+    reader.reset();
+    PDG_CHECK(!oldSnapshot.expired());
+    otherReader.reset();
+    PDG_CHECK(oldSnapshot.expired());
+    PDG_CHECK(snapshots.acquire() == later);
+}
+
+/// Readers acquiring while snapshots are published see consistent
+/// snapshots of increasing versions
+void testConcurrentReaders()
+{
+    FrozenFixture fixtures[2];
+    addChain(fixtures[0], 3);
+    addChain(fixtures[1], 5);
+    fixtures[0].freeze();
+    fixtures[1].freeze();
+    const unsigned numVersions = 200;
+    SnapshotPublisher publisher(std::make_shared<PDGSnapshot>(FrozenPDG::open(fixtures[0].getFrozenDirectory()),
+                                                              false, 0));
+    std::atomic<bool> done(false);
+    std::atomic<unsigned> numInconsistent(0);
+    auto read = [&] () {
+        uint64_t lastVersion = 0;
+        while (!done) {
+            const auto snapshot = publisher.acquire();
+            const uint64_t version = snapshot->getVersion();
+            if (version < lastVersion || snapshot->getPDG().getNumNodes() != (version % 2 == 0 ? 3u : 5u)) {
+                ++numInconsistent;
+            }
+            lastVersion = version;
+        }
+    };
+    std::thread readers[] = {std::thread(read), std::thread(read)};
+    for (unsigned version = 1; version <= numVersions; ++version) {
+        publisher.publish(std::make_shared<PDGSnapshot>(FrozenPDG::open(fixtures[version % 2].getFrozenDirectory()),
+                                                        false, version));
+    }
+    done = true;
+    for (auto& reader : readers) {
+        reader.join();
+    }
+    PDG_CHECK(numInconsistent == 0);
+    PDG_CHECK(publisher.acquire()->getVersion() == numVersions);
+}
+
+} // unnamed namespace
+
+int main()
+{
+    testPublish();
+    testConcurrentReaders();
+    return getResult();
+}
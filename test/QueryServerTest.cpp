@@ -0,0 +1,198 @@
+#include "FrozenFixture.h"
+
+#include "PDG/PDGSnapshot.h"
+#include "PDG/QueryServer.h"
+
+#include <cstring>
+#include <thread>
+
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+using namespace pdg;
+using namespace pdg::test;
+
+namespace {
+
+using EdgeKind = SerializedPDG::EdgeKind;
+
+/// f: 0 -> 1 -> 2 -control-> 3
+void addGraph(FrozenFixture& fixture)
+{
+    const auto a = fixture.addInstruction("f");
+    const auto b = fixture.addInstruction("f");
+    const auto c = fixture.addInstruction("f");
+    const auto d = fixture.addInstruction("f");
+    fixture.addEdge(a, b);
+    fixture.addEdge(b, c);
+    fixture.addEdge(c, d, EdgeKind::Control);
+}
+
+bool isError(const std::string& response)
+{
+    return response.compare(0, 6, "error ") == 0;
+}
+
+void testAnswers()
+{
+    FrozenFixture fixture;
+    addGraph(fixture);
+    fixture.freeze();
+    for (uint64_t sliceCacheSize : {uint64_t(0), uint64_t(1) << 20}) {
+        SnapshotPublisher snapshots(PDGSnapshot::open(fixture.getFrozenDirectory(), sliceCacheSize != 0, 1,
+                                                      sliceCacheSize));
+        QueryServer server(snapshots);
+        QueryServer::Session session;
+        auto answer = [&] (llvm::StringRef request) { return server.answer(request, session); };
+
+        PDG_CHECK(answer("slice backward all 2") == "ok 3 0 1 2");
+        PDG_CHECK(answer("slice forward all 1 2") == "ok 3 1 2 3");
+        PDG_CHECK(answer("slice forward data 0") == "ok 3 0 1 2");
+        PDG_CHECK(answer("slice backward control,summary 3") == "ok 2 2 3");
+        PDG_CHECK(answer("path all 0 3") == "ok 3 0 data 1 data 2 control 3");
+        PDG_CHECK(answer("path data 0 3") == "ok 0");
+        PDG_CHECK(answer("reaches 0 3") == "ok 1");
+        PDG_CHECK(answer("reaches 3 0") == "ok 0");
+        PDG_CHECK(answer("out 2") == "ok 1 3 control");
+        PDG_CHECK(answer("in 1") == "ok 1 0 data");
+        PDG_CHECK(answer("out 3") == "ok 0");
+        PDG_CHECK(answer("node 1") == "ok 0\tf\t\tnode 1");
+        PDG_CHECK(answer("stats") == "ok 4 3 1");
+        PDG_CHECK(answer("version") == "ok 1");
+        if (sliceCacheSize == 0) {
+            PDG_CHECK(answer("cache") == "error no slice cache");
+        } else {
+            PDG_CHECK(answer("cache").compare(0, 3, "ok ") == 0);
+        }
+
+        for (const char* request : {"", "bogus", "slice", "slice sideways all 1", "slice backward most 1",
+                                    "slice backward all", "slice backward all 4", "slice backward all x",
+                                    "path all 0", "path all 0 1 2", "reaches 0", "reaches -1 0", "out",
+                                    "in 1 2", "node 9", "reload"}) {
+            PDG_CHECK(isError(answer(request)));
+        }
+    }
+}
+
+void testReload()
+{
+    FrozenFixture fixture;
+    addGraph(fixture);
+    fixture.freeze();
+    llvm::sys::fs::create_directory(fixture.getPath("other"));
+    SnapshotPublisher snapshots(PDGSnapshot::open(fixture.getFrozenDirectory(), true, 1));
+    QueryServer server(snapshots);
+    QueryServer::Session session;
+
+    // refused without a reload root
+    PDG_CHECK(isError(server.answer("reload " + fixture.getFrozenDirectory(), session)));
+    server.setReloadRoot(fixture.getPath("other"));
+    PDG_CHECK(isError(server.answer("reload " + fixture.getFrozenDirectory(), session)));
+    PDG_CHECK(isError(server.answer("reload " + fixture.getPath("other") + "/../frozen", session)));
+    PDG_CHECK(server.answer("version", session) == "ok 1");
+
+    server.setReloadRoot(fixture.getDirectory());
+    PDG_CHECK(isError(server.answer("reload " + fixture.getPath("missing"), session)));
+    PDG_CHECK(server.answer("reload " + fixture.getFrozenDirectory(), session) == "ok 2");
+    PDG_CHECK(server.answer("version", session) == "ok 2");
+    PDG_CHECK(server.answer("reaches 0 3", session) == "ok 1");
+}
+
+int connectTo(const std::string& path)
+{
+    sockaddr_un address;
+    std::memset(&address, 0, sizeof(address));
+    address.sun_family = AF_UNIX;
+    std::strncpy(address.sun_path, path.c_str(), sizeof(address.sun_path) - 1);
+    const int fd = ::socket(AF_UNIX, SOCK_STREAM, 0);
+    if (fd != -1 && ::connect(fd, reinterpret_cast<sockaddr*>(&address), sizeof(address)) != 0) {
+        ::close(fd);
+        return -1;
+    }
+    return fd;
+}
+
+bool sendRequest(int fd, const std::string& request)
+{
+    const uint32_t size = request.size();
+    const unsigned char header[4] = {static_cast<unsigned char>(size),
+                                     static_cast<unsigned char>(size >> 8),
+                                     static_cast<unsigned char>(size >> 16),
+                                     static_cast<unsigned char>(size >> 24)};
+    std::string frame(reinterpret_cast<const char*>(header), sizeof(header));
+    frame += request;
+    return ::send(fd, frame.data(), frame.size(), MSG_NOSIGNAL) == static_cast<ssize_t>(frame.size());
+}
+
+/// Empty if no response arrives within the timeout in milliseconds
+std::string receiveResponse(int fd, int timeout)
+{
+    std::string data;
+    uint64_t size = 0;
+    while (data.size() < 4 || data.size() < 4 + size) {
+        pollfd pending{fd, POLLIN, 0};
+        if (::poll(&pending, 1, timeout) != 1) {
+            return "";
+        }
+        char buffer[256];
+        const ssize_t count = ::recv(fd, buffer, sizeof(buffer), 0);
+        if (count <= 0) {
+            return "";
+        }
+        data.append(buffer, count);
+        if (data.size() >= 4) {
+            const auto* header = reinterpret_cast<const unsigned char*>(data.data());
+            size = header[0] | (header[1] << 8) | (header[2] << 16) | (uint64_t(header[3]) << 24);
+        }
+    }
+    return data.substr(4);
+}
+
+/// Requests over the socket, with one connection served at a time
+void testSocket()
+{
+    FrozenFixture fixture;
+    addGraph(fixture);
+    fixture.freeze();
+    SnapshotPublisher snapshots(PDGSnapshot::open(fixture.getFrozenDirectory(), true, 1));
+    QueryServer server(snapshots);
+    server.setMaxConnections(1);
+    const std::string path = fixture.getPath("server.sock");
+    PDG_CHECK(server.listen(path));
+    std::thread serving(&QueryServer::serve, &server);
+
+    const int first = connectTo(path);
+    PDG_CHECK(first != -1);
+    PDG_CHECK(sendRequest(first, "stats"));
+    PDG_CHECK(receiveResponse(first, 5000) == "ok 4 3 1");
+
+    // the second client waits in the backlog until the first is closed
+    const int second = connectTo(path);
+    PDG_CHECK(second != -1);
+    PDG_CHECK(sendRequest(second, "reaches 0 3"));
+    PDG_CHECK(receiveResponse(second, 300).empty());
+    ::close(first);
+    PDG_CHECK(receiveResponse(second, 5000) == "ok 1");
+    PDG_CHECK(sendRequest(second, "version"));
+    PDG_CHECK(receiveResponse(second, 5000) == "ok 1");
+
+    // a second server does not take over the socket
+    QueryServer other(snapshots);
+    PDG_CHECK(!other.listen(path));
+
+    server.stop();
+    serving.join();
+    ::close(second);
+}
+
+} // unnamed namespace
+
+int main()
+{
+    testAnswers();
+    testReload();
+    testSocket();
+    return getResult();
+}
@@ -0,0 +1,94 @@
+#include "FrozenFixture.h"
+
+#include "PDG/PDGSlicer.h"
+#include "PDG/ReachabilityIndex.h"
+
+#include <random>
+
+using namespace pdg;
+using namespace pdg::test;
+
+namespace {
+
+using EdgeKind = SerializedPDG::EdgeKind;
+
+/// a -> b -> c -> a, c -> d -control-> f, e -> d
+void testComponents()
+{
+    FrozenFixture fixture;
+    const auto a = fixture.addInstruction("f");
+    const auto b = fixture.addInstruction("f");
+    const auto c = fixture.addInstruction("f");
+    const auto d = fixture.addInstruction("f");
+    const auto e = fixture.addInstruction("f");
+    const auto f = fixture.addInstruction("f");
+    fixture.addEdge(a, b);
+    fixture.addEdge(b, c);
+    fixture.addEdge(c, a);
+    fixture.addEdge(c, d);
+    fixture.addEdge(d, f, EdgeKind::Control);
+    fixture.addEdge(e, d);
+    const FrozenPDG& pdg = fixture.freeze();
+
+    std::vector<ReachabilityIndex::ComponentId> components;
+    PDG_CHECK(ReachabilityIndex::findComponents(pdg, AllEdges, components) == 4);
+    PDG_CHECK(components.size() == pdg.getNumNodes());
+    PDG_CHECK(components[a] == components[b] && components[b] == components[c]);
+    // reverse topological order
+    PDG_CHECK(components[f] < components[d]);
+    PDG_CHECK(components[d] < components[a]);
+    PDG_CHECK(components[d] < components[e]);
+
+    ReachabilityIndex index(pdg);
+    PDG_CHECK(index.getNumComponents() == 4);
+    PDG_CHECK(index.getNumDAGEdges() == 3);
+    PDG_CHECK(index.reaches(b, a));
+    PDG_CHECK(index.reaches(a, f));
+    PDG_CHECK(index.reaches(e, f));
+    PDG_CHECK(index.reaches(d, d));
+    PDG_CHECK(!index.reaches(f, d));
+    PDG_CHECK(!index.reaches(e, a));
+    PDG_CHECK(!index.reaches(a, e));
+    PDG_CHECK(index.dependsOn(f, e));
+    PDG_CHECK(!index.dependsOn(e, f));
+
+    ReachabilityIndex dataIndex(pdg, DataEdges);
+    PDG_CHECK(dataIndex.getNumComponents() == 4);
+    PDG_CHECK(dataIndex.reaches(a, d));
+    PDG_CHECK(!dataIndex.reaches(a, f));
+    PDG_CHECK(index.getStats().queries == 9);
+}
+
+/// Answers from the labels and the pruned search agree with forward slices
+void testAgainstSlicer()
+{
+    const unsigned numNodes = 300;
+    FrozenFixture fixture;
+    std::mt19937 random(5);
+    for (unsigned i = 0; i < numNodes; ++i) {
+        fixture.addInstruction("f");
+    }
+    for (unsigned i = 0; i < numNodes + numNodes / 2; ++i) {
+        fixture.addEdge(random() % numNodes, random() % numNodes, static_cast<EdgeKind>(random() % 3));
+    }
+    const FrozenPDG& pdg = fixture.freeze();
+    PDGSlicer slicer(pdg);
+    for (unsigned edges : {unsigned(AllEdges), unsigned(DataEdges)}) {
+        ReachabilityIndex index(pdg, edges, 2, 3);
+        for (FrozenPDG::NodeId source = 0; source < numNodes; source += 7) {
+            const Slice slice = slicer.forwardSlice(source, edges);
+            for (FrozenPDG::NodeId dest = 0; dest < numNodes; ++dest) {
+                PDG_CHECK(index.reaches(source, dest) == slice.contains(dest));
+            }
+        }
+    }
+}
+
+} // unnamed namespace
+
+int main()
+{
+    testComponents();
+    testAgainstSlicer();
+    return getResult();
+}
@@ -0,0 +1,94 @@
+#include "FrozenFixture.h"
+
+#include "PDG/RoaringBitmap.h"
+
+#include <random>
+#include <set>
+
+using namespace pdg;
+using namespace pdg::test;
+
+namespace {
+
+bool isEqual(const RoaringBitmap& bitmap, const std::set<uint32_t>& expected)
+{
+    return bitmap.size() == expected.size()
+        && bitmap.toVector() == std::vector<uint32_t>(expected.begin(), expected.end());
+}
+
+/// A container turns from an array into a bitmap beyond 4096 values
+void testContainers()
+{
+    RoaringBitmap bitmap;
+    std::set<uint32_t> expected;
+    PDG_CHECK(bitmap.empty());
+    for (uint32_t value = 0; value < 4096; ++value) {
+        const uint32_t spread = value * 13 % 65536;
+        PDG_CHECK(bitmap.add(spread) == expected.insert(spread).second);
+    }
+    PDG_CHECK(!bitmap.add(13));
+    PDG_CHECK(isEqual(bitmap, expected));
+    const uint64_t arrayUsage = bitmap.getMemoryUsage();
+    PDG_CHECK(arrayUsage >= 4096 * sizeof(uint16_t));
+
+    PDG_CHECK(bitmap.add(1));
+    expected.insert(1);
+    PDG_CHECK(isEqual(bitmap, expected));
+    PDG_CHECK(bitmap.getMemoryUsage() >= 65536 / 8);
+    PDG_CHECK(bitmap.contains(1) && bitmap.contains(13) && !bitmap.contains(2));
+    PDG_CHECK(!bitmap.add(1));
+    PDG_CHECK(bitmap.size() == 4097);
+
+    // values of other containers, before and after the first
+    PDG_CHECK(bitmap.add(0x30000));
+    PDG_CHECK(bitmap.add(0xffffffff));
+    PDG_CHECK(bitmap.add(0x10005));
+    expected.insert({0x30000, 0xffffffff, 0x10005});
+    PDG_CHECK(isEqual(bitmap, expected));
+    PDG_CHECK(!bitmap.contains(0x10004) && !bitmap.contains(0x20000));
+}
+
+/// Unions of array and bitmap containers in all combinations
+void testUnion()
+{
+    std::mt19937 random(3);
+    for (unsigned sizes : {0x0101u, 0x0a0au, 0x0a32u, 0x320au, 0x3232u}) {
+        RoaringBitmap left;
+        RoaringBitmap right;
+        std::set<uint32_t> expected;
+        // hundreds of values per unit, overlapping in the first container
+        for (unsigned i = 0; i < (sizes >> 8) * 100; ++i) {
+            const uint32_t value = random() % 0x18000;
+            left.add(value);
+            expected.insert(value);
+        }
+        for (unsigned i = 0; i < (sizes & 0xff) * 100; ++i) {
+            const uint32_t value = random() % 0x28000;
+            right.add(value);
+            expected.insert(value);
+        }
+        left.unionWith(right);
+        PDG_CHECK(isEqual(left, expected));
+        for (uint32_t value = 0; value < 0x28000; value += 97) {
+            PDG_CHECK(left.contains(value) == (expected.count(value) != 0));
+        }
+    }
+
+    // union into and with an empty set
+    RoaringBitmap bitmap;
+    RoaringBitmap other;
+    other.add(7);
+    other.add(0x50007);
+    bitmap.unionWith(other);
+    bitmap.unionWith(RoaringBitmap());
+    PDG_CHECK(isEqual(bitmap, {7, 0x50007}));
+}
+
+} // unnamed namespace
+
+int main()
+{
+    testContainers();
+    testUnion();
+    return getResult();
+}
@@ -0,0 +1,98 @@
+#include "FrozenFixture.h"
+
+#include "PDG/PDGLinker.h"
+#include "PDG/SerializedPDG.h"
+
+#include <fstream>
+
+using namespace pdg;
+using namespace pdg::test;
+
+namespace {
+
+using Linkage = SerializedPDG::Linkage;
+using EdgeKind = SerializedPDG::EdgeKind;
+
+bool isEqual(const SerializedPDG::Node& first, const SerializedPDG::Node& second)
+{
+    return first.module == second.module && first.type == second.type && first.linkage == second.linkage
+        && first.symbol == second.symbol && first.argIdx == second.argIdx && first.function == second.function
+        && first.label == second.label && first.opcode == second.opcode
+        && first.metadataLabel == second.metadataLabel;
+}
+
+/// Names with tabs, newlines and backslashes survive a save and load
+void testRoundTrip()
+{
+    FrozenFixture fixture;
+    const std::string symbol = "quoted\tname\nwith \\t and \\";
+    SerializedPDG pdg;
+    pdg.addModule("dir\\with\ttab.bc");
+    const unsigned function = pdg.addNode(SerializedPDG::Node{0, PDGLLVMNode::FunctionNode, Linkage::Definition,
+                                                              symbol, -1, "", "function", 0, ""});
+    const unsigned formal = pdg.addNode(SerializedPDG::Node{0, PDGLLVMNode::FormalArgumentNode, Linkage::Definition,
+                                                            symbol, 0, symbol, "formal\\n", 0, "oh\thash"});
+    pdg.addEdge(formal, function, EdgeKind::Data);
+    const std::string path = fixture.getPath("escaped.pdg");
+    PDG_CHECK(pdg.save(path));
+
+    SerializedPDG loaded;
+    PDG_CHECK(loaded.load(path));
+    PDG_CHECK(loaded.getModules() == pdg.getModules());
+    PDG_CHECK(loaded.getNodes().size() == 2);
+    for (unsigned i = 0; i < loaded.getNodes().size() && i < pdg.getNodes().size(); ++i) {
+        PDG_CHECK(isEqual(loaded.getNodes()[i], pdg.getNodes()[i]));
+    }
+    PDG_CHECK(loaded.getEdges().size() == 1);
+
+    // the declaration of another module still resolves to the definition
+    SerializedPDG caller;
+    caller.addModule("caller.bc");
+    caller.addNode(SerializedPDG::Node{0, PDGLLVMNode::FunctionNode, Linkage::Declaration, symbol, -1, "", "", 0, ""});
+    PDGLinker linker;
+    linker.addModule(loaded);
+    linker.addModule(caller);
+    linker.link();
+    PDG_CHECK(linker.getNumResolved() == 1);
+    PDG_CHECK(linker.getUnresolvedSymbols().empty());
+}
+
+bool loadText(const FrozenFixture& fixture, const std::string& text, SerializedPDG& pdg)
+{
+    const std::string path = fixture.getPath("text.pdg");
+    {
+        std::ofstream out(path);
+        out << text;
+    }
+    return pdg.load(path);
+}
+
+void testFormats()
+{
+    FrozenFixture fixture;
+    // string fields of version 2 are taken as they are
+    SerializedPDG version2;
+    PDG_CHECK(loadText(fixture, "pdg-serialized 2\nmodule\ta\\b.bc\nnode\t0\t8\t3\t-1\tf\\n\t\tf\t0\t\n", version2));
+    PDG_CHECK(version2.getModules() == SerializedPDG::Modules({"a\\b.bc"}));
+    PDG_CHECK(version2.getNodes().size() == 1 && version2.getNodes()[0].symbol == "f\\n");
+
+    SerializedPDG version3;
+    PDG_CHECK(loadText(fixture, "pdg-serialized 3\nmodule\ta\\\\b.bc\nnode\t0\t8\t3\t-1\tf\\n\t\tf\t0\t\n", version3));
+    PDG_CHECK(version3.getModules() == SerializedPDG::Modules({"a\\b.bc"}));
+    PDG_CHECK(version3.getNodes().size() == 1 && version3.getNodes()[0].symbol == "f\n");
+
+    for (const char* malformed : {"pdg-serialized 3\nmodule\ta\\b.bc\n", "pdg-serialized 3\nmodule\ta\\\n",
+                                  "pdg-serialized 3\nmodule\ta.bc\nnode\t0\t8\t3\t-1\tf\\x\t\tf\t0\t\n"}) {
+        SerializedPDG pdg;
+        PDG_CHECK(!loadText(fixture, malformed, pdg));
+    }
+}
+
+} // unnamed namespace
+
+int main()
+{
+    testRoundTrip();
+    testFormats();
+    return getResult();
+}
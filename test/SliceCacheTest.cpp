@@ -0,0 +1,104 @@
+#include "FrozenFixture.h"
+
+#include "PDG/PDGSlicer.h"
+#include "PDG/ReachabilityIndex.h"
+#include "PDG/SliceCache.h"
+
+#include <random>
+
+using namespace pdg;
+using namespace pdg::test;
+
+namespace {
+
+using EdgeKind = SerializedPDG::EdgeKind;
+
+/// Random graph of instructions, formal arguments and globals, whose
+/// slices meet in shared nodes and cycles
+void addRandomGraph(FrozenFixture& fixture, unsigned numNodes, unsigned seed)
+{
+    std::mt19937 random(seed);
+    for (unsigned i = 0; i < numNodes; ++i) {
+        const std::string function = "f" + std::to_string(i % 7);
+        switch (random() % 8) {
+        case 0:
+            fixture.addNode(PDGLLVMNode::FormalArgumentNode, function, 0, function, i % 3);
+            break;
+        case 1:
+            fixture.addNode(PDGLLVMNode::GlobalVariableNode, "", 0, "g" + std::to_string(i));
+            break;
+        default:
+            fixture.addInstruction(function);
+            break;
+        }
+    }
+    for (unsigned i = 0; i < numNodes + numNodes / 2; ++i) {
+        fixture.addEdge(random() % numNodes, random() % numNodes, static_cast<EdgeKind>(random() % 3));
+    }
+}
+
+/// Cached slices agree with PDGSlicer, with and without an index, whether
+/// the budget holds all slices or evicts most of them
+void testAgainstSlicer()
+{
+    const unsigned numNodes = 400;
+    FrozenFixture fixture;
+    addRandomGraph(fixture, numNodes, 23);
+    const FrozenPDG& pdg = fixture.freeze();
+    PDGSlicer slicer(pdg);
+    ReachabilityIndex index(pdg);
+    const ReachabilityIndex* indexes[] = {nullptr, &index};
+    for (const ReachabilityIndex* cacheIndex : indexes) {
+        for (uint64_t budget : {uint64_t(1) << 30, uint64_t(2048)}) {
+            SliceCache cache(pdg, cacheIndex, budget);
+            for (unsigned pass = 0; pass < 2; ++pass) {
+                for (auto direction : {SliceDirection::Backward, SliceDirection::Forward}) {
+                    for (unsigned edges : {unsigned(AllEdges), unsigned(DataEdges)}) {
+                        SliceOptions options;
+                        options.direction = direction;
+                        options.edges = edges;
+                        for (FrozenPDG::NodeId node = 0; node < numNodes; node += 3) {
+                            const auto cached = cache.slice(node, direction, edges);
+                            PDG_CHECK(cached->toVector() == slicer.slice(node, options).getNodes());
+                        }
+                    }
+                }
+            }
+            const SliceCache::Stats stats = cache.getStats();
+            PDG_CHECK(stats.entries > 0);
+            PDG_CHECK(stats.bytes <= budget);
+            if (budget == uint64_t(1) << 30) {
+                // the second pass finds every criterion
+                PDG_CHECK(stats.hits >= 4 * ((numNodes + 2) / 3));
+            }
+        }
+    }
+}
+
+void testUnion()
+{
+    FrozenFixture fixture;
+    const auto a = fixture.addInstruction("f");
+    const auto b = fixture.addInstruction("f");
+    const auto c = fixture.addInstruction("f");
+    const auto d = fixture.addInstruction("f");
+    fixture.addEdge(a, b);
+    fixture.addEdge(c, d);
+    const FrozenPDG& pdg = fixture.freeze();
+    SliceCache cache(pdg, nullptr, uint64_t(1) << 20);
+    PDG_CHECK(cache.slice(getNodeIds({a, c}), SliceDirection::Forward).getNodes() == getNodeIds({a, b, c, d}));
+    PDG_CHECK(cache.slice(getNodeIds({b, d}), SliceDirection::Backward, ControlEdges).getNodes()
+              == getNodeIds({b, d}));
+    PDG_CHECK(cache.getStats().misses == 4);
+    PDG_CHECK(cache.slice(a, SliceDirection::Forward)->size() == 2);
+    PDG_CHECK(cache.getStats().hits == 1);
+}
+
+} // unnamed namespace
+
+int main()
+{
+    testAgainstSlicer();
+    testUnion();
+    return getResult();
+}
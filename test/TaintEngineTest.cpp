@@ -0,0 +1,177 @@
+#include "FrozenFixture.h"
+
+#include "PDG/TaintEngine.h"
+
+using namespace pdg;
+using namespace pdg::test;
+
+namespace {
+
+using EdgeKind = SerializedPDG::EdgeKind;
+using Rule = TaintSpec::Rule;
+
+bool isRule(const Rule& rule, TaintSpec::Role role, const std::string& function, TaintSpec::Position position,
+            unsigned index)
+{
+    return rule.role == role && rule.function == function && rule.position == position && rule.index == index;
+}
+
+void testParse()
+{
+    TaintSpec spec;
+    PDG_CHECK(spec.parse("# sources\n"
+                         "source recv arg1\n"
+                         "\n"
+                         "  sink system arg0  \n"
+                         "sanitizer escape ret\n"
+                         "source handler param2\n",
+                         "spec"));
+    const auto& rules = spec.getRules();
+    PDG_CHECK(rules.size() == 4);
+    if (rules.size() == 4) {
+        PDG_CHECK(isRule(rules[0], TaintSpec::Role::Source, "recv", TaintSpec::Position::Argument, 1));
+        PDG_CHECK(isRule(rules[1], TaintSpec::Role::Sink, "system", TaintSpec::Position::Argument, 0));
+        PDG_CHECK(isRule(rules[2], TaintSpec::Role::Sanitizer, "escape", TaintSpec::Position::Return, 0));
+        PDG_CHECK(isRule(rules[3], TaintSpec::Role::Source, "handler", TaintSpec::Position::Parameter, 2));
+    }
+    for (const char* line : {"source recv", "source recv arg1 extra", "origin recv ret", "sink system argx",
+                             "sink system arg", "sink system result"}) {
+        TaintSpec malformed;
+        PDG_CHECK(!malformed.parse(line, "malformed"));
+    }
+}
+
+/// main: g = getenv() -> v -> system(v)
+///       recv(_, buf), buf -> escape(buf) -> system(escaped)
+/// handler(p): p -summary-> q -> system(q)
+class TaintFixture
+{
+public:
+    TaintFixture()
+    {
+        const auto getenv = addFunction("getenv");
+        const auto system = addFunction("system");
+        const auto recv = addFunction("recv");
+        const auto escape = addFunction("escape");
+
+        g = addCall("main", getenv, {});
+        v = m_fixture.addInstruction("main");
+        s0 = m_fixture.addNode(PDGLLVMNode::ActualArgumentNode, "main", 0, "", 0);
+        m_fixture.addEdge(g, v);
+        m_fixture.addEdge(v, s0);
+        addCall("main", system, {s0});
+
+        buf = m_fixture.addNode(PDGLLVMNode::ActualArgumentNode, "main", 0, "", 1);
+        addCall("main", recv, {buf});
+        const auto e0 = m_fixture.addNode(PDGLLVMNode::ActualArgumentNode, "main", 0, "", 0);
+        m_fixture.addEdge(buf, e0);
+        escaped = addCall("main", escape, {e0});
+        s1 = m_fixture.addNode(PDGLLVMNode::ActualArgumentNode, "main", 0, "", 0);
+        m_fixture.addEdge(escaped, s1);
+        addCall("main", system, {s1});
+
+        p = m_fixture.addNode(PDGLLVMNode::FormalArgumentNode, "handler", 0, "handler", 0);
+        q = m_fixture.addInstruction("handler");
+        s2 = m_fixture.addNode(PDGLLVMNode::ActualArgumentNode, "handler", 0, "", 0);
+        m_fixture.addEdge(p, q, EdgeKind::Summary);
+        m_fixture.addEdge(q, s2);
+        addCall("handler", system, {s2});
+    }
+
+    const FrozenPDG& freeze()
+    {
+        return m_fixture.freeze();
+    }
+
+private:
+    FrozenFixture::NodeId addFunction(const std::string& name)
+    {
+        return m_fixture.addNode(PDGLLVMNode::FunctionNode, "", 0, name);
+    }
+
+    FrozenFixture::NodeId addCall(const std::string& caller,
+                                  FrozenFixture::NodeId function,
+                                  const std::vector<FrozenFixture::NodeId>& actuals)
+    {
+        const auto call = m_fixture.addInstruction(caller);
+        for (auto actual : actuals) {
+            m_fixture.addEdge(actual, call);
+        }
+        m_fixture.addEdge(call, function, EdgeKind::Control);
+        m_fixture.addEdge(function, call);
+        return call;
+    }
+
+public:
+    FrozenFixture::NodeId g, v, s0, buf, escaped, s1, p, q, s2;
+
+private:
+    FrozenFixture m_fixture;
+}; // class TaintFixture
+
+bool isEqual(const std::vector<TaintFinding>& first, const std::vector<TaintFinding>& second)
+{
+    if (first.size() != second.size()) {
+        return false;
+    }
+    for (size_t i = 0; i < first.size(); ++i) {
+        if (first[i].source != second[i].source || first[i].sink != second[i].sink
+                || first[i].sourceRule != second[i].sourceRule || first[i].sinkRule != second[i].sinkRule
+                || first[i].path.nodes != second[i].path.nodes || first[i].path.edges != second[i].path.edges) {
+            return false;
+        }
+    }
+    return true;
+}
+
+void testFindings()
+{
+    TaintFixture fixture;
+    const FrozenPDG& pdg = fixture.freeze();
+    TaintSpec spec;
+    PDG_CHECK(spec.parse("source getenv ret\n"
+                         "source recv arg1\n"
+                         "source handler param0\n"
+                         "sink system arg0\n"
+                         "sanitizer escape ret\n",
+                         "spec"));
+    TaintEngine engine(pdg, spec);
+    using Source = std::pair<FrozenPDG::NodeId, unsigned>;
+    PDG_CHECK(engine.getSources() == std::vector<Source>({Source(fixture.g, 0), Source(fixture.buf, 1),
+                                                          Source(fixture.p, 2)}));
+    PDG_CHECK(engine.getNumSinks() == 3);
+
+    const auto findings = engine.run(1);
+    PDG_CHECK(findings.size() == 2);
+    if (findings.size() == 2) {
+        PDG_CHECK(findings[0].source == fixture.g && findings[0].sink == fixture.s0);
+        PDG_CHECK(findings[0].sourceRule == 0 && findings[0].sinkRule == 3);
+        PDG_CHECK(findings[0].path.nodes == getNodeIds({fixture.g, fixture.v, fixture.s0}));
+        PDG_CHECK(findings[0].path.edges == std::vector<EdgeKind>({EdgeKind::Data, EdgeKind::Data}));
+        PDG_CHECK(findings[1].source == fixture.p && findings[1].sink == fixture.s2);
+        PDG_CHECK(findings[1].path.nodes == getNodeIds({fixture.p, fixture.q, fixture.s2}));
+        PDG_CHECK(findings[1].path.edges == std::vector<EdgeKind>({EdgeKind::Summary, EdgeKind::Data}));
+    }
+    PDG_CHECK(isEqual(engine.run(4), findings));
+
+    // without the sanitizer the taint of recv passes escape
+    TaintSpec unsanitized;
+    PDG_CHECK(unsanitized.parse("source recv arg1\nsink system arg0\n", "unsanitized"));
+    TaintEngine unsanitizedEngine(pdg, unsanitized);
+    const auto passed = unsanitizedEngine.run(1);
+    PDG_CHECK(passed.size() == 1);
+    if (passed.size() == 1) {
+        PDG_CHECK(passed[0].source == fixture.buf && passed[0].sink == fixture.s1);
+        PDG_CHECK(passed[0].path.nodes.size() == 4 && passed[0].path.nodes[2] == fixture.escaped);
+    }
+    PDG_CHECK(isEqual(unsanitizedEngine.run(4), passed));
+}
+
+} // unnamed namespace
+
+int main()
+{
+    testParse();
+    testFindings();
+    return getResult();
+}
@@ -0,0 +1,164 @@
+#include "PDG/CondensedPDG.h"
+#include "PDG/ContextSensitiveSlicer.h"
+#include "PDG/FrozenPDG.h"
+#include "PDG/PDGSlicer.h"
+#include "PDG/ReachabilityIndex.h"
+
+#include "llvm/Support/CommandLine.h"
+#include "llvm/Support/Format.h"
+#include "llvm/Support/InitLLVM.h"
+#include "llvm/Support/raw_ostream.h"
+
+#include <algorithm>
+#include <chrono>
+#include <random>
+#include <string>
+
+#include <sys/resource.h>
+
+static llvm::cl::opt<std::string> FrozenDirectory(llvm::cl::Positional,
+                                                  llvm::cl::Required,
+                                                  llvm::cl::desc("<frozen PDG directory>"));
+
+static llvm::cl::opt<unsigned> NumQueries(
+    "queries",
+    llvm::cl::desc("Number of random queries per benchmark"),
+    llvm::cl::init(100000));
+
+static llvm::cl::opt<unsigned> NumLabels(
+    "labels",
+    llvm::cl::desc("Number of GRAIL labels of the reachability index"),
+    llvm::cl::init(3));
+
+static llvm::cl::opt<unsigned> Seed(
+    "seed",
+    llvm::cl::desc("Seed of the random queries"),
+    llvm::cl::init(0));
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+double getSeconds(Clock::time_point start)
+{
+    return std::chrono::duration<double>(Clock::now() - start).count();
+}
+
+long getMaxResidentMB()
+{
+    struct rusage usage;
+    getrusage(RUSAGE_SELF, &usage);
+    return usage.ru_maxrss / 1024;
+}
+
+void benchReachability(const pdg::FrozenPDG& pdg, std::mt19937& random)
+{
+    auto start = Clock::now();
+    pdg::ReachabilityIndex index(pdg, pdg::AllEdges, NumLabels, Seed);
+    llvm::outs() << "reachability index: " << llvm::format("%.3f s, %.1f MB, ", getSeconds(start),
+                                                           index.getMemoryUsage() / double(1 << 20))
+                 << index.getNumComponents() << " components, "
+                 << index.getNumDAGEdges() << " DAG edges\n";
+
+    std::uniform_int_distribution<pdg::FrozenPDG::NodeId> node(0, pdg.getNumNodes() - 1);
+    unsigned numReached = 0;
+    start = Clock::now();
+    for (unsigned i = 0; i < NumQueries; ++i) {
+        numReached += index.reaches(node(random), node(random));
+    }
+    const double seconds = getSeconds(start);
+    const auto stats = index.getStats();
+    llvm::outs() << "reachability queries: " << llvm::format("%.0f", NumQueries / seconds) << " per s, "
+                 << numReached << " reached, " << stats.searches << " of " << stats.queries
+                 << " needed a search\n";
+}
+
+void benchSlicing(const pdg::FrozenPDG& pdg, std::mt19937& random)
+{
+    std::uniform_int_distribution<pdg::FrozenPDG::NodeId> node(0, pdg.getNumNodes() - 1);
+    pdg::PDGSlicer slicer(pdg);
+    // slices are far more expensive than reachability queries
+    const unsigned numSlices = std::max(NumQueries / 1000, 1u);
+    uint64_t numNodes = 0;
+    auto start = Clock::now();
+    for (unsigned i = 0; i < numSlices; ++i) {
+        const pdg::FrozenPDG::NodeId criterion[] = {node(random)};
+        numNodes += slicer.backwardSlice(criterion).size();
+    }
+    const double seconds = getSeconds(start);
+    llvm::outs() << "backward slices: " << llvm::format("%.1f", numSlices / seconds) << " per s, "
+                 << numNodes / numSlices << " nodes on average\n";
+
+    pdg::ContextSensitiveSlicer contextSlicer(pdg);
+    start = Clock::now();
+    // the first query tabulates the summaries of all functions
+    contextSlicer.reachesResult(0);
+    llvm::outs() << "summary tabulation: " << llvm::format("%.3f", getSeconds(start)) << " s, "
+                 << contextSlicer.getNumEvaluations() << " function evaluations\n";
+    numNodes = 0;
+    start = Clock::now();
+    for (unsigned i = 0; i < numSlices; ++i) {
+        const pdg::FrozenPDG::NodeId criterion[] = {node(random)};
+        numNodes += contextSlicer.backwardSlice(criterion).size();
+    }
+    const double contextSeconds = getSeconds(start);
+    llvm::outs() << "context sensitive backward slices: " << llvm::format("%.1f", numSlices / contextSeconds)
+                 << " per s, " << numNodes / numSlices << " nodes on average\n";
+}
+
+void benchCondensed(const pdg::FrozenPDG& pdg, std::mt19937& random)
+{
+    auto start = Clock::now();
+    pdg::CondensedPDG condensed(pdg);
+    llvm::outs() << "condensed view: " << llvm::format("%.3f s, %.1f MB, ", getSeconds(start),
+                                                       condensed.getMemoryUsage() / double(1 << 20))
+                 << condensed.getNumComponents() << " components, " << condensed.getNumNodes() << " nodes, "
+                 << condensed.getNumEdges() << " edges\n";
+
+    std::uniform_int_distribution<pdg::FrozenPDG::NodeId> node(0, pdg.getNumNodes() - 1);
+    pdg::CondensedSlicer slicer(condensed);
+    unsigned numReached = 0;
+    start = Clock::now();
+    for (unsigned i = 0; i < NumQueries; ++i) {
+        numReached += slicer.reaches(node(random), node(random));
+    }
+    const double seconds = getSeconds(start);
+    llvm::outs() << "condensed reachability queries: " << llvm::format("%.0f", NumQueries / seconds) << " per s, "
+                 << numReached << " reached\n";
+
+    const unsigned numSlices = std::max(NumQueries / 1000, 1u);
+    uint64_t numNodes = 0;
+    start = Clock::now();
+    for (unsigned i = 0; i < numSlices; ++i) {
+        const pdg::FrozenPDG::NodeId criterion[] = {node(random)};
+        numNodes += slicer.backwardSlice(criterion).size();
+    }
+    const double sliceSeconds = getSeconds(start);
+    llvm::outs() << "condensed backward slices: " << llvm::format("%.1f", numSlices / sliceSeconds) << " per s, "
+                 << numNodes / numSlices << " nodes on average\n";
+}
+
+} // unnamed namespace
+
+int main(int argc, char** argv)
+{
+    llvm::InitLLVM X(argc, argv);
+    llvm::cl::ParseCommandLineOptions(argc, argv, "Query benchmarks on a frozen PDG\n");
+
+    auto start = Clock::now();
+    auto pdg = pdg::FrozenPDG::open(FrozenDirectory);
+    if (!pdg) {
+        return 1;
+    }
+    llvm::outs() << "open: " << llvm::format("%.3f", getSeconds(start)) << " s, " << pdg->getNumNodes() << " nodes, "
+                 << pdg->getNumEdges() << " edges\n";
+    if (pdg->getNumNodes() == 0) {
+        return 0;
+    }
+    std::mt19937 random(Seed);
+    benchReachability(*pdg, random);
+    benchSlicing(*pdg, random);
+    benchCondensed(*pdg, random);
+    llvm::outs() << "max resident: " << getMaxResidentMB() << " MB\n";
+    return 0;
+}
@@ -0,0 +1,75 @@
+#include "PDG/FrozenPDG.h"
+#include "PDG/PDGQuery.h"
+
+#include "llvm/Support/CommandLine.h"
+#include "llvm/Support/InitLLVM.h"
+#include "llvm/Support/MemoryBuffer.h"
+#include "llvm/Support/raw_ostream.h"
+
+#include <string>
+#include <thread>
+
+static llvm::cl::opt<std::string> FrozenDirectory(llvm::cl::Positional,
+                                                  llvm::cl::Required,
+                                                  llvm::cl::desc("<frozen PDG directory>"));
+
+static llvm::cl::opt<std::string> QueryText(llvm::cl::Positional,
+                                            llvm::cl::desc("<query>"));
+
+static llvm::cl::opt<std::string> QueryFile(
+    "f",
+    llvm::cl::desc("Read the query from a file"),
+    llvm::cl::value_desc("file"));
+
+static llvm::cl::opt<bool> Explain(
+    "explain",
+    llvm::cl::desc("Print the plan of the query instead of running it"),
+    llvm::cl::init(false));
+
+static llvm::cl::opt<unsigned> NumThreads(
+    "j",
+    llvm::cl::desc("Number of threads evaluating the query, defaults to the number of cores"),
+    llvm::cl::init(0));
+
+int main(int argc, char** argv)
+{
+    llvm::InitLLVM X(argc, argv);
+    llvm::cl::ParseCommandLineOptions(argc, argv, "Pattern queries over a frozen PDG\n");
+
+    std::string text = QueryText;
+    if (!QueryFile.empty()) {
+        auto buffer = llvm::MemoryBuffer::getFile(QueryFile);
+        if (!buffer) {
+            llvm::errs() << "Could not read " << QueryFile << ": " << buffer.getError().message() << "\n";
+            return 1;
+        }
+        text = (*buffer)->getBuffer().str();
+    }
+    auto query = pdg::PDGQuery::parse(text);
+    if (!query) {
+        return 1;
+    }
+    auto pdg = pdg::FrozenPDG::open(FrozenDirectory);
+    if (!pdg) {
+        return 1;
+    }
+    pdg::QueryEngine engine(*pdg);
+    if (Explain) {
+        llvm::outs() << engine.explain(*query);
+        return 0;
+    }
+    const unsigned numThreads = NumThreads != 0 ? NumThreads.getValue() : std::thread::hardware_concurrency();
+    const auto matches = engine.run(*query, numThreads);
+    for (auto output : query->getOutputs()) {
+        llvm::outs() << query->getVariables()[output].name << "\t";
+    }
+    llvm::outs() << "\n";
+    for (const auto& match : matches) {
+        for (auto node : match) {
+            llvm::outs() << node << "\t";
+        }
+        llvm::outs() << "\n";
+    }
+    llvm::errs() << matches.size() << " matches\n";
+    return 0;
+}
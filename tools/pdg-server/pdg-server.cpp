@@ -0,0 +1,78 @@
+#include "PDG/PDGSnapshot.h"
+#include "PDG/QueryServer.h"
+
+#include "llvm/Support/CommandLine.h"
+#include "llvm/Support/InitLLVM.h"
+#include "llvm/Support/raw_ostream.h"
+
+#include <string>
+
+#include <signal.h>
+
+static llvm::cl::opt<std::string> FrozenDirectory(llvm::cl::Positional,
+                                                  llvm::cl::Required,
+                                                  llvm::cl::desc("<frozen PDG directory>"));
+
+static llvm::cl::opt<std::string> SocketPath(
+    "socket",
+    llvm::cl::Required,
+    llvm::cl::desc("Path of the Unix domain socket to listen on"),
+    llvm::cl::value_desc("path"));
+
+static llvm::cl::opt<bool> NoIndex(
+    "no-index",
+    llvm::cl::desc("Answer reachability queries by search instead of building a reachability index"),
+    llvm::cl::init(false));
+
+static llvm::cl::opt<unsigned> SliceCacheSize(
+    "slice-cache",
+    llvm::cl::desc("Memory budget of the slice cache in MB, 0 slices every request anew"),
+    llvm::cl::init(256));
+
+static llvm::cl::opt<std::string> ReloadRoot(
+    "reload-root",
+    llvm::cl::desc("Directory under which reload may open frozen PDGs, reload is refused without it"),
+    llvm::cl::value_desc("directory"));
+
+static llvm::cl::opt<unsigned> MaxConnections(
+    "max-connections",
+    llvm::cl::desc("Number of connections served at once, further clients wait"),
+    llvm::cl::init(64));
+
+namespace {
+
+pdg::QueryServer* RunningServer = nullptr;
+
+void stopServer(int)
+{
+    if (RunningServer) {
+        RunningServer->stop();
+    }
+}
+
+} // unnamed namespace
+
+int main(int argc, char** argv)
+{
+    llvm::InitLLVM X(argc, argv);
+    llvm::cl::ParseCommandLineOptions(argc, argv, "Serves dependence queries on a frozen PDG\n");
+
+    auto snapshot = pdg::PDGSnapshot::open(FrozenDirectory, !NoIndex, 1, uint64_t(SliceCacheSize) << 20);
+    if (!snapshot) {
+        return 1;
+    }
+    const unsigned numNodes = snapshot->getPDG().getNumNodes();
+    pdg::SnapshotPublisher snapshots(std::move(snapshot));
+    pdg::QueryServer server(snapshots);
+    server.setReloadRoot(ReloadRoot);
+    server.setMaxConnections(MaxConnections);
+    if (!server.listen(SocketPath)) {
+        return 1;
+    }
+    RunningServer = &server;
+    signal(SIGINT, stopServer);
+    signal(SIGTERM, stopServer);
+    llvm::errs() << "serving " << numNodes << " nodes on " << SocketPath << "\n";
+    server.serve();
+    return 0;
+}
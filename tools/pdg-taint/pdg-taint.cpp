@@ -0,0 +1,79 @@
+#include "PDG/FrozenPDG.h"
+#include "PDG/TaintEngine.h"
+
+#include "llvm/Support/CommandLine.h"
+#include "llvm/Support/InitLLVM.h"
+#include "llvm/Support/raw_ostream.h"
+
+#include <string>
+#include <thread>
+
+static llvm::cl::opt<std::string> FrozenDirectory(llvm::cl::Positional,
+                                                  llvm::cl::Required,
+                                                  llvm::cl::desc("<frozen PDG directory>"));
+
+static llvm::cl::opt<std::string> SpecFile(
+    "spec",
+    llvm::cl::Required,
+    llvm::cl::desc("Taint spec with source, sink and sanitizer rules"),
+    llvm::cl::value_desc("file"));
+
+static llvm::cl::opt<unsigned> NumThreads(
+    "j",
+    llvm::cl::desc("Number of threads propagating sources, defaults to the number of cores"),
+    llvm::cl::init(0));
+
+namespace {
+
+const char* getEdgeKindName(pdg::SerializedPDG::EdgeKind kind)
+{
+    switch (kind) {
+    case pdg::SerializedPDG::EdgeKind::Data:
+        return "data";
+    case pdg::SerializedPDG::EdgeKind::Control:
+        return "control";
+    case pdg::SerializedPDG::EdgeKind::Summary:
+        return "summary";
+    }
+    return "";
+}
+
+void printFinding(const pdg::FrozenPDG& pdg, const pdg::TaintSpec& spec, const pdg::TaintFinding& finding)
+{
+    llvm::outs() << spec.getRules()[finding.sourceRule].function << " -> "
+                 << spec.getRules()[finding.sinkRule].function << ": "
+                 << finding.path.edges.size() << " edges\n";
+    for (unsigned i = 0; i < finding.path.nodes.size(); ++i) {
+        const auto node = finding.path.nodes[i];
+        llvm::outs() << "  " << node << " " << pdg.getLabel(node) << "\n";
+        if (i < finding.path.edges.size()) {
+            llvm::outs() << "    " << getEdgeKindName(finding.path.edges[i]) << "\n";
+        }
+    }
+}
+
+} // unnamed namespace
+
+int main(int argc, char** argv)
+{
+    llvm::InitLLVM X(argc, argv);
+    llvm::cl::ParseCommandLineOptions(argc, argv, "Taint flows from sources to sinks of a frozen PDG\n");
+
+    pdg::TaintSpec spec;
+    if (!spec.read(SpecFile)) {
+        return 1;
+    }
+    auto pdg = pdg::FrozenPDG::open(FrozenDirectory);
+    if (!pdg) {
+        return 1;
+    }
+    pdg::TaintEngine engine(*pdg, spec);
+    const unsigned numThreads = NumThreads != 0 ? NumThreads.getValue() : std::thread::hardware_concurrency();
+    const auto findings = engine.run(numThreads);
+    for (const auto& finding : findings) {
+        printFinding(*pdg, spec, finding);
+    }
+    llvm::errs() << engine.getSources().size() << " sources, " << engine.getNumSinks() << " sinks, "
+                 << findings.size() << " findings\n";
+    return 0;
+}
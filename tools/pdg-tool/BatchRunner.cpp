@@ -0,0 +1,180 @@
+#include "BatchRunner.h"
+
+#include "llvm/Support/raw_ostream.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <csignal>
+#include <cstdio>
+#include <deque>
+#include <fstream>
+#include <numeric>
+#include <thread>
+
+#include <sys/wait.h>
+#include <unistd.h>
+
+namespace pdg {
+
+namespace {
+
+const auto BudgetCheckInterval = std::chrono::milliseconds(100);
+
+uint64_t getResidentSetSize(pid_t pid)
+{
+    std::ifstream statm("/proc/" + std::to_string(pid) + "/statm");
+    uint64_t size = 0;
+    uint64_t resident = 0;
+    if (!(statm >> size >> resident)) {
+        return 0;
+    }
+    return resident * sysconf(_SC_PAGESIZE);
+}
+
+} // unnamed namespace
+
+BatchRunner::BatchRunner(unsigned numWorkers)
+    : m_numWorkers(numWorkers == 0 ? 1 : numWorkers)
+{
+}
+
+bool BatchRunner::run(const std::vector<std::string>& inputs, const Task& task)
+{
+    std::deque<Job> pending;
+    for (size_t idx : getSchedule(inputs)) {
+        pending.push_back(Job{inputs[idx], false});
+    }
+    Workers running;
+    while (!pending.empty() || !running.empty()) {
+        while (running.size() < m_numWorkers && !pending.empty()) {
+            Job job = std::move(pending.front());
+            pending.pop_front();
+            pid_t pid = startWorker(job.fallback ? m_fallbackTask : task, job.input);
+            if (pid < 0) {
+                llvm::errs() << "Could not fork worker for " << job.input << "\n";
+                complete(job.input, false);
+                continue;
+            }
+            running.emplace(pid, Worker{std::move(job), std::chrono::steady_clock::now(), nullptr});
+        }
+        if (running.empty()) {
+            break;
+        }
+        int status = 0;
+        pid_t pid = waitpid(-1, &status, hasBudget() ? WNOHANG : 0);
+        if (pid == 0) {
+            enforceBudget(running);
+            std::this_thread::sleep_for(BudgetCheckInterval);
+            continue;
+        }
+        if (pid < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            llvm::errs() << "Lost track of worker processes\n";
+            return false;
+        }
+        auto pos = running.find(pid);
+        if (pos == running.end()) {
+            continue;
+        }
+        Worker worker = std::move(pos->second);
+        running.erase(pos);
+        const std::string& input = worker.job.input;
+        if (worker.exceededBudget && !worker.job.fallback && m_fallbackTask) {
+            llvm::errs() << input << " exceeded its " << worker.exceededBudget
+                         << " budget, retrying with the fallback pipeline\n";
+            if (m_downgradeCallback) {
+                m_downgradeCallback(input, worker.exceededBudget);
+            }
+            // it has waited long enough already
+            pending.push_front(Job{input, true});
+            continue;
+        }
+        const bool success = WIFEXITED(status) && WEXITSTATUS(status) == 0;
+        if (!success) {
+            llvm::errs() << "Failed to process " << input;
+            if (worker.exceededBudget) {
+                llvm::errs() << ", exceeded its " << worker.exceededBudget << " budget";
+            }
+            llvm::errs() << "\n";
+        }
+        complete(input, success);
+    }
+    return m_failedInputs.empty();
+}
+
+std::vector<size_t> BatchRunner::getSchedule(const std::vector<std::string>& inputs) const
+{
+    std::vector<size_t> schedule(inputs.size());
+    std::iota(schedule.begin(), schedule.end(), 0);
+    if (!m_costEstimator) {
+        return schedule;
+    }
+    // Largest first, so that a huge module is not the last one to start
+    std::vector<uint64_t> costs;
+    costs.reserve(inputs.size());
+    for (const auto& input : inputs) {
+        costs.push_back(m_costEstimator(input));
+    }
+    std::stable_sort(schedule.begin(), schedule.end(), [&costs] (size_t idx1, size_t idx2) {
+        return costs[idx1] > costs[idx2];
+    });
+    return schedule;
+}
+
+pid_t BatchRunner::startWorker(const Task& task, const std::string& input)
+{
+    // buffered output would otherwise be written by the child as well
+    llvm::outs().flush();
+    llvm::errs().flush();
+    fflush(nullptr);
+    pid_t pid = fork();
+    if (pid == 0) {
+        const bool success = task(input);
+        llvm::outs().flush();
+        llvm::errs().flush();
+        fflush(nullptr);
+        _exit(success ? 0 : 1);
+    }
+    return pid;
+}
+
+bool BatchRunner::hasBudget() const
+{
+    return m_budget.seconds != 0 || m_budget.residentMB != 0;
+}
+
+void BatchRunner::enforceBudget(Workers& workers)
+{
+    const auto now = std::chrono::steady_clock::now();
+    for (auto& entry : workers) {
+        Worker& worker = entry.second;
+        if (worker.exceededBudget) {
+            continue;
+        }
+        if (m_budget.seconds != 0
+                && now - worker.start >= std::chrono::seconds(m_budget.seconds)) {
+            worker.exceededBudget = "time";
+        } else if (m_budget.residentMB != 0
+                && getResidentSetSize(entry.first) > m_budget.residentMB * 1024 * 1024) {
+            worker.exceededBudget = "memory";
+        }
+        if (worker.exceededBudget) {
+            kill(entry.first, SIGKILL);
+        }
+    }
+}
+
+void BatchRunner::complete(const std::string& input, bool success)
+{
+    if (!success) {
+        m_failedInputs.push_back(input);
+    }
+    if (m_completionCallback) {
+        m_completionCallback(input, success);
+    }
+}
+
+} // namespace pdg
+
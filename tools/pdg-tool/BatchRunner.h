@@ -0,0 +1,114 @@
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include <sys/types.h>
+
+namespace pdg {
+
+/// Runs a task for many input modules in a pool of worker processes.
+/// SVF keeps its analysis state in global singletons, so every module is
+/// processed in a child forked from the already initialized driver.
+/// Inputs are handed out from one queue ordered by decreasing cost to
+/// whichever worker becomes idle first. Workers exceeding the time or memory
+/// budget are killed and their input is retried with the fallback task.
+class BatchRunner
+{
+public:
+    using Task = std::function<bool (const std::string& input)>;
+    using CostEstimator = std::function<uint64_t (const std::string& input)>;
+    using CompletionCallback = std::function<void (const std::string& input, bool success)>;
+    using DowngradeCallback = std::function<void (const std::string& input, const std::string& reason)>;
+
+    /// Limits for a single task, 0 means unlimited
+    struct Budget
+    {
+        unsigned seconds = 0;
+        uint64_t residentMB = 0;
+    };
+
+public:
+    explicit BatchRunner(unsigned numWorkers);
+
+    BatchRunner(const BatchRunner& ) = delete;
+    BatchRunner(BatchRunner&& ) = delete;
+    BatchRunner& operator =(const BatchRunner& ) = delete;
+    BatchRunner& operator =(BatchRunner&& ) = delete;
+
+public:
+    void setCostEstimator(const CostEstimator& estimator)
+    {
+        m_costEstimator = estimator;
+    }
+
+    /// Called in the driver process once the task for an input has finished
+    void setCompletionCallback(const CompletionCallback& callback)
+    {
+        m_completionCallback = callback;
+    }
+
+    void setBudget(const Budget& budget)
+    {
+        m_budget = budget;
+    }
+
+    /// Cheaper task rerun for inputs whose task exceeded the budget
+    void setFallbackTask(const Task& task)
+    {
+        m_fallbackTask = task;
+    }
+
+    /// Called in the driver process when an input is retried with the fallback task
+    void setDowngradeCallback(const DowngradeCallback& callback)
+    {
+        m_downgradeCallback = callback;
+    }
+
+    /// Returns false if the task failed for any of the inputs
+    bool run(const std::vector<std::string>& inputs, const Task& task);
+
+    const std::vector<std::string>& getFailedInputs() const
+    {
+        return m_failedInputs;
+    }
+
+private:
+    struct Job
+    {
+        std::string input;
+        bool fallback;
+    };
+
+    struct Worker
+    {
+        Job job;
+        std::chrono::steady_clock::time_point start;
+        const char* exceededBudget;
+    };
+
+    using Workers = std::unordered_map<pid_t, Worker>;
+
+private:
+    std::vector<size_t> getSchedule(const std::vector<std::string>& inputs) const;
+    pid_t startWorker(const Task& task, const std::string& input);
+    bool hasBudget() const;
+    void enforceBudget(Workers& workers);
+    void complete(const std::string& input, bool success);
+
+private:
+    unsigned m_numWorkers;
+    CostEstimator m_costEstimator;
+    CompletionCallback m_completionCallback;
+    Budget m_budget;
+    Task m_fallbackTask;
+    DowngradeCallback m_downgradeCallback;
+    std::vector<std::string> m_failedInputs;
+}; // class BatchRunner
+
+} // namespace pdg
+
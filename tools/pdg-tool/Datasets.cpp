@@ -0,0 +1,97 @@
+#include "Datasets.h"
+
+#include "llvm/ADT/SmallString.h"
+#include "llvm/Support/FileSystem.h"
+#include "llvm/Support/Path.h"
+#include "llvm/Support/raw_ostream.h"
+
+#include <algorithm>
+
+#include <fcntl.h>
+#include <sys/file.h>
+#include <unistd.h>
+
+namespace pdg {
+
+namespace {
+
+const char* LockFileName = ".pdg-tool.lock";
+
+bool collectModules(const std::string& directory, std::vector<std::string>& modules)
+{
+    std::error_code EC;
+    for (llvm::sys::fs::directory_iterator file_it(directory, EC), end;
+            file_it != end && !EC;
+            file_it.increment(EC)) {
+        if (llvm::sys::path::extension(file_it->path()) == ".bc") {
+            modules.push_back(file_it->path());
+        }
+    }
+    if (EC) {
+        llvm::errs() << "Could not read " << directory << ": " << EC.message() << "\n";
+        return false;
+    }
+    std::sort(modules.begin(), modules.end());
+    return true;
+}
+
+} // unnamed namespace
+
+bool collectDatasets(const std::string& root, std::vector<Dataset>& datasets)
+{
+    std::error_code EC;
+    for (llvm::sys::fs::directory_iterator dir_it(root, EC), end;
+            dir_it != end && !EC;
+            dir_it.increment(EC)) {
+        if (!llvm::sys::fs::is_directory(dir_it->path())) {
+            continue;
+        }
+        Dataset dataset;
+        dataset.directory = dir_it->path();
+        if (!collectModules(dataset.directory, dataset.modules)) {
+            return false;
+        }
+        if (!dataset.modules.empty()) {
+            datasets.push_back(std::move(dataset));
+        }
+    }
+    if (EC) {
+        llvm::errs() << "Could not read " << root << ": " << EC.message() << "\n";
+        return false;
+    }
+    std::sort(datasets.begin(), datasets.end(), [] (const Dataset& ds1, const Dataset& ds2) {
+        return ds1.directory < ds2.directory;
+    });
+    return true;
+}
+
+bool lockDataset(Dataset& dataset)
+{
+    llvm::SmallString<256> lockFile(dataset.directory);
+    llvm::sys::path::append(lockFile, LockFileName);
+    int fd = open(lockFile.c_str(), O_RDWR | O_CREAT, 0644);
+    if (fd < 0) {
+        llvm::errs() << "Could not create " << lockFile << "\n";
+        return false;
+    }
+    if (flock(fd, LOCK_EX | LOCK_NB) != 0) {
+        close(fd);
+        return false;
+    }
+    dataset.lockFd = fd;
+    return true;
+}
+
+void unlockDataset(Dataset& dataset)
+{
+    if (dataset.lockFd < 0) {
+        return;
+    }
+    // forked workers share the lock, so release it explicitly before closing
+    flock(dataset.lockFd, LOCK_UN);
+    close(dataset.lockFd);
+    dataset.lockFd = -1;
+}
+
+} // namespace pdg
+
@@ -0,0 +1,27 @@
+#pragma once
+
+#include <string>
+#include <vector>
+
+namespace pdg {
+
+/// Directory of bitcode modules whose PDG features are appended to the same
+/// relations and blocks files
+struct Dataset
+{
+    std::string directory;
+    std::vector<std::string> modules;
+    unsigned numPendingModules = 0;
+    int lockFd = -1;
+}; // struct Dataset
+
+/// Collects every direct sub-directory of root holding bitcode files
+bool collectDatasets(const std::string& root, std::vector<Dataset>& datasets);
+
+/// Takes an exclusive lock on the dataset, so that concurrent runs over the
+/// same datasets do not process it twice. Returns false if it is held elsewhere.
+bool lockDataset(Dataset& dataset);
+void unlockDataset(Dataset& dataset);
+
+} // namespace pdg
+
@@ -0,0 +1,56 @@
+#include "ModuleCost.h"
+
+#include "llvm/IR/LLVMContext.h"
+#include "llvm/IR/Module.h"
+#include "llvm/IRReader/IRReader.h"
+#include "llvm/Support/FileSystem.h"
+#include "llvm/Support/SourceMgr.h"
+
+#include <memory>
+
+namespace pdg {
+
+namespace {
+
+uint64_t getBitcodeSize(const std::string& bitcodeFile)
+{
+    uint64_t size = 0;
+    if (llvm::sys::fs::file_size(bitcodeFile, size)) {
+        return 0;
+    }
+    return size;
+}
+
+uint64_t getNumDefinedFunctions(const std::string& bitcodeFile)
+{
+    // function bodies are not needed to tell definitions from declarations
+    llvm::LLVMContext context;
+    llvm::SMDiagnostic err;
+    std::unique_ptr<llvm::Module> M = llvm::getLazyIRFileModule(bitcodeFile, err, context);
+    if (!M) {
+        return 0;
+    }
+    uint64_t numFunctions = 0;
+    for (auto& F : *M) {
+        if (!F.isDeclaration()) {
+            ++numFunctions;
+        }
+    }
+    return numFunctions;
+}
+
+} // unnamed namespace
+
+uint64_t estimateModuleCost(const std::string& bitcodeFile, CostModel model)
+{
+    switch (model) {
+    case CostModel::BitcodeSize:
+        return getBitcodeSize(bitcodeFile);
+    case CostModel::FunctionCount:
+        return getNumDefinedFunctions(bitcodeFile);
+    }
+    return 0;
+}
+
+} // namespace pdg
+
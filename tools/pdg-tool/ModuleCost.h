@@ -0,0 +1,19 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+
+namespace pdg {
+
+enum class CostModel
+{
+    BitcodeSize,
+    FunctionCount
+};
+
+/// Relative cost of building the PDG of a module, used to start expensive
+/// modules first
+uint64_t estimateModuleCost(const std::string& bitcodeFile, CostModel model);
+
+} // namespace pdg
+
@@ -0,0 +1,352 @@
+#include "ModulePipeline.h"
+
+#include "PDG/FunctionPDG.h"
+#include "PDG/IndirectCallSitesAnalysis.h"
+#include "PDG/LLVMDominanceTree.h"
+#include "PDG/LLVMMemorySSADefUseAnalysisResults.h"
+#include "PDG/PDG.h"
+#include "PDG/PDGBuilder.h"
+#include "PDG/PDGGraphTraits.h"
+#include "PDG/SerializedPDG.h"
+#include "Passes/PDGBuildPasses.h"
+#include "Passes/PDGCSVPass.h"
+
+#include "llvm/ADT/Hashing.h"
+#include "llvm/ADT/SmallString.h"
+#include "llvm/Analysis/AliasAnalysis.h"
+#include "llvm/Analysis/MemorySSA.h"
+#include "llvm/Analysis/PostDominators.h"
+#include "llvm/IR/Dominators.h"
+#include "llvm/IR/LLVMContext.h"
+#include "llvm/IR/LegacyPassManager.h"
+#include "llvm/IR/Module.h"
+#include "llvm/IR/PassManager.h"
+#include "llvm/IR/Verifier.h"
+#include "llvm/IRReader/IRReader.h"
+#include "llvm/Passes/PassBuilder.h"
+#include "llvm/Support/Debug.h"
+#include "llvm/Support/Error.h"
+#include "llvm/Support/FileSystem.h"
+#include "llvm/Support/GraphWriter.h"
+#include "llvm/Support/MemoryBuffer.h"
+#include "llvm/Support/Path.h"
+#include "llvm/Support/SourceMgr.h"
+#include "llvm/Support/raw_ostream.h"
+#include "llvm/Transforms/Scalar.h"
+
+#include <cerrno>
+#include <functional>
+#include <memory>
+#include <unordered_set>
+
+#include <fcntl.h>
+#include <sys/file.h>
+#include <unistd.h>
+
+namespace pdg {
+
+namespace {
+
+void registerAnalyses(llvm::PassBuilder& PB,
+                      llvm::LoopAnalysisManager& LAM,
+                      llvm::FunctionAnalysisManager& FAM,
+                      llvm::CGSCCAnalysisManager& CGAM,
+                      llvm::ModuleAnalysisManager& MAM)
+{
+    // registered first so that it takes precedence over the empty default
+    FAM.registerPass([&PB] { return PB.buildDefaultAAPipeline(); });
+    PB.registerModuleAnalyses(MAM);
+    PB.registerCGSCCAnalyses(CGAM);
+    PB.registerFunctionAnalyses(FAM);
+    PB.registerLoopAnalyses(LAM);
+    PB.crossRegisterProxies(LAM, FAM, CGAM, MAM);
+}
+
+void demoteRegistersToMemory(llvm::Module& M)
+{
+    llvm::legacy::PassManager PM;
+    PM.add(llvm::createDemoteRegisterToMemoryPass());
+    PM.run(M);
+}
+
+bool writeSerializedPDG(const PDG& pdg, const std::string& bitcodeFile, const ModulePipelineOptions& options)
+{
+    llvm::SmallString<256> filename;
+    if (options.outputsInModuleDirectory && !llvm::sys::path::is_absolute(options.serializedPDGDirectory)) {
+        filename = llvm::sys::path::parent_path(bitcodeFile);
+    }
+    llvm::sys::path::append(filename, options.serializedPDGDirectory,
+                            llvm::sys::path::stem(bitcodeFile) + ".pdg");
+    return SerializedPDG::fromPDG(pdg, bitcodeFile).save(filename.str().str());
+}
+
+std::string getPartialOutputSuffix(const std::string& bitcodeFile)
+{
+    return "." + std::to_string(llvm::hash_value(bitcodeFile)) + ".part";
+}
+
+PDGCSVPass getCSVPass(const std::string& bitcodeFile, const ModulePipelineOptions& options)
+{
+    PDGCSVPass csvPass;
+    if (options.outputsInModuleDirectory) {
+        csvPass.setOutputDirectory(llvm::sys::path::parent_path(bitcodeFile));
+    }
+    if (options.partialOutputs && csvPass.isAppending()) {
+        csvPass.setPartialOutputSuffix(getPartialOutputSuffix(bitcodeFile));
+    }
+    return csvPass;
+}
+
+bool appendFile(const std::string& part, const std::string& file)
+{
+    auto buffer = llvm::MemoryBuffer::getFile(part);
+    if (!buffer) {
+        llvm::errs() << "Could not read " << part << ": " << buffer.getError().message() << "\n";
+        return false;
+    }
+    int fd = open(file.c_str(), O_WRONLY | O_APPEND | O_CREAT, 0644);
+    if (fd < 0) {
+        llvm::errs() << "Could not open " << file << "\n";
+        return false;
+    }
+    // other runs may append to the same file, the lock is released by close
+    flock(fd, LOCK_EX);
+    const char* data = (*buffer)->getBufferStart();
+    size_t size = (*buffer)->getBufferSize();
+    while (size != 0) {
+        const ssize_t written = write(fd, data, size);
+        if (written < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            break;
+        }
+        data += written;
+        size -= written;
+    }
+    close(fd);
+    if (size != 0) {
+        llvm::errs() << "Could not append " << part << " to " << file << "\n";
+        return false;
+    }
+    return true;
+}
+
+bool exportPDG(llvm::Module& M, const std::string& bitcodeFile, const ModulePipelineOptions& options)
+{
+    llvm::PassBuilder PB;
+    llvm::LoopAnalysisManager LAM;
+    llvm::FunctionAnalysisManager FAM;
+    llvm::CGSCCAnalysisManager CGAM;
+    llvm::ModuleAnalysisManager MAM;
+    registerAnalyses(PB, LAM, FAM, CGAM, MAM);
+    MAM.registerPass([] { return PDGAnalysis(); });
+    MAM.registerPass([] { return MemorySSAPDGAnalysis(); });
+
+    PDGCSVPass csvPass = getCSVPass(bitcodeFile, options);
+    csvPass.setUseSVF(options.usePointerAnalysis);
+    // the serialized PDG needs the bodies a streamed build frees
+    if (!options.serializedPDGDirectory.empty()) {
+        csvPass.setStreaming(false);
+    }
+    llvm::ModulePassManager MPM;
+    MPM.addPass(std::move(csvPass));
+    MPM.run(M, MAM);
+    if (options.serializedPDGDirectory.empty()) {
+        return true;
+    }
+    // cached by the analysis manager, the CSV export preserves everything
+    auto pdg = options.usePointerAnalysis ? MAM.getResult<PDGAnalysis>(M).pdg
+                                          : MAM.getResult<MemorySSAPDGAnalysis>(M).pdg;
+    return writeSerializedPDG(*pdg, bitcodeFile, options);
+}
+
+void writeDotFiles(PDG& pdg, const std::string& directory)
+{
+    for (auto& entry : pdg.getFunctionPDGs()) {
+        llvm::Function* F = entry.first;
+        if (F->isDeclaration() || F->isMaterializable()) {
+            continue;
+        }
+        FunctionPDG* graph = entry.second.get();
+        llvm::SmallString<256> filename(directory);
+        llvm::sys::path::append(filename, "pdg." + F->getName().str() + ".dot");
+        std::error_code EC;
+        llvm::raw_fd_ostream file(filename, EC, llvm::sys::fs::F_Text);
+        if (EC) {
+            llvm::errs() << "Could not open " << filename << ": " << EC.message() << "\n";
+            continue;
+        }
+        std::string title = llvm::DOTGraphTraits<FunctionPDG*>::getGraphName(graph)
+                          + " for '" + F->getName().str() + "' function";
+        llvm::WriteGraph(file, graph, false, title);
+    }
+}
+
+using FunctionFilter = std::function<bool (llvm::Function*)>;
+
+bool getFunctions(llvm::Module& M,
+                  const std::string& bitcodeFile,
+                  const std::vector<std::string>& names,
+                  std::vector<llvm::Function*>& functions)
+{
+    for (const auto& name : names) {
+        llvm::Function* F = M.getFunction(name);
+        if (!F) {
+            llvm::errs() << bitcodeFile << ": no function " << name << "\n";
+            return false;
+        }
+        functions.push_back(F);
+    }
+    return true;
+}
+
+/// Builds the PDG of the entries and their callees in a lazily loaded module.
+/// Bodies of callees rejected by the filter stay unread and get stub PDGs.
+PDGBuilder::PDGType buildLazyPDG(llvm::Module& M,
+                                 const std::vector<llvm::Function*>& entries,
+                                 const FunctionFilter& shouldMaterialize,
+                                 unsigned& numMaterialized)
+{
+    llvm::PassBuilder PB;
+    llvm::LoopAnalysisManager LAM;
+    llvm::FunctionAnalysisManager FAM;
+    llvm::CGSCCAnalysisManager CGAM;
+    llvm::ModuleAnalysisManager MAM;
+    registerAnalyses(PB, LAM, FAM, CGAM, MAM);
+
+    llvm::legacy::FunctionPassManager FPM(&M);
+    FPM.add(llvm::createDemoteRegisterToMemoryPass());
+    FPM.doInitialization();
+    auto materializer = [&FPM, &numMaterialized, &shouldMaterialize] (llvm::Function* F) {
+        if (shouldMaterialize && !shouldMaterialize(F)) {
+            return false;
+        }
+        if (auto materializeErr = F->materialize()) {
+            llvm::errs() << "Could not materialize " << F->getName() << ": "
+                         << llvm::toString(std::move(materializeErr)) << "\n";
+            return false;
+        }
+        FPM.run(*F);
+        ++numMaterialized;
+        return true;
+    };
+
+    // SVF needs every function body, so lazily loaded modules use the per
+    // function MemorySSA def-use results and type based indirect callees
+    auto memSSAGetter = [&FAM] (llvm::Function* F) -> llvm::MemorySSA* {
+        return &FAM.getResult<llvm::MemorySSAAnalysis>(*F).getMSSA();
+    };
+    auto aarGetter = [&FAM] (llvm::Function* F) -> llvm::AAResults* {
+        return &FAM.getResult<llvm::AAManager>(*F);
+    };
+    auto domTreeGetter = [&FAM] (llvm::Function* F) -> const llvm::DominatorTree* {
+        return &FAM.getResult<llvm::DominatorTreeAnalysis>(*F);
+    };
+    auto postdomTreeGetter = [&FAM] (llvm::Function* F) -> const llvm::PostDominatorTree* {
+        return &FAM.getResult<llvm::PostDominatorTreeAnalysis>(*F);
+    };
+
+    PDGBuilder pdgBuilder(&M);
+    pdgBuilder.setDesUseResults(std::make_shared<LLVMMemorySSADefUseAnalysisResults>(memSSAGetter, aarGetter));
+    pdgBuilder.setIndirectCallSitesResults(std::make_shared<TypeBasedIndirectCallSiteResults>(M));
+    pdgBuilder.setDominanceResults(std::make_shared<LLVMDominanceTree>(domTreeGetter, postdomTreeGetter));
+    pdgBuilder.setFunctionMaterializer(materializer);
+    pdgBuilder.buildFromEntries(entries);
+    FPM.doFinalization();
+    return pdgBuilder.getPDG();
+}
+
+std::unique_ptr<llvm::Module> loadLazily(const std::string& bitcodeFile, llvm::LLVMContext& context)
+{
+    llvm::SMDiagnostic err;
+    // function bodies stay in the bitcode until the builder reaches them
+    std::unique_ptr<llvm::Module> M = llvm::getLazyIRFileModule(bitcodeFile, err, context);
+    if (!M) {
+        err.print("pdg-tool", llvm::errs());
+    }
+    return M;
+}
+
+bool runTargetedPipeline(const std::string& bitcodeFile, const ModulePipelineOptions& options)
+{
+    llvm::LLVMContext context;
+    std::unique_ptr<llvm::Module> M = loadLazily(bitcodeFile, context);
+    std::vector<llvm::Function*> entries;
+    if (!M || !getFunctions(*M, bitcodeFile, options.entryFunctions, entries)) {
+        return false;
+    }
+    unsigned numMaterialized = 0;
+    auto pdg = buildLazyPDG(*M, entries, FunctionFilter(), numMaterialized);
+    llvm::dbgs() << bitcodeFile << ": materialized " << numMaterialized << " of "
+                 << M->size() << " functions\n";
+    writeDotFiles(*pdg, options.dotDirectory);
+    if (!options.serializedPDGDirectory.empty()) {
+        return writeSerializedPDG(*pdg, bitcodeFile, options);
+    }
+    return true;
+}
+
+} // unnamed namespace
+
+bool commitPartialOutputs(const std::string& bitcodeFile, const ModulePipelineOptions& options, bool success)
+{
+    PDGCSVPass csvPass = getCSVPass(bitcodeFile, options);
+    if (!options.partialOutputs || !csvPass.isAppending() || !options.entryFunctions.empty()) {
+        return true;
+    }
+    const std::string suffix = getPartialOutputSuffix(bitcodeFile);
+    bool committed = true;
+    for (const auto& file : {csvPass.getRelationsFile(), csvPass.getBlocksFile()}) {
+        const std::string part = file + suffix;
+        if (success && !appendFile(part, file)) {
+            committed = false;
+        }
+        llvm::sys::fs::remove(part);
+    }
+    return committed;
+}
+
+bool runShardPipeline(const std::string& bitcodeFile,
+                      const std::vector<std::string>& shardFunctions,
+                      const std::string& outputFile)
+{
+    llvm::LLVMContext context;
+    std::unique_ptr<llvm::Module> M = loadLazily(bitcodeFile, context);
+    std::vector<llvm::Function*> entries;
+    if (!M || !getFunctions(*M, bitcodeFile, shardFunctions, entries)) {
+        return false;
+    }
+    // functions of other shards are left as declarations to be resolved by the merge
+    std::unordered_set<llvm::Function*> shard(entries.begin(), entries.end());
+    unsigned numMaterialized = 0;
+    auto pdg = buildLazyPDG(*M, entries, [&shard] (llvm::Function* F) {
+        return shard.find(F) != shard.end();
+    }, numMaterialized);
+    llvm::dbgs() << outputFile << ": built " << numMaterialized << " of "
+                 << M->size() << " functions\n";
+    return SerializedPDG::fromPDG(*pdg, bitcodeFile).save(outputFile);
+}
+
+bool runModulePipeline(const std::string& bitcodeFile, const ModulePipelineOptions& options)
+{
+    if (!options.entryFunctions.empty()) {
+        return runTargetedPipeline(bitcodeFile, options);
+    }
+    llvm::LLVMContext context;
+    llvm::SMDiagnostic err;
+    std::unique_ptr<llvm::Module> M = llvm::parseIRFile(bitcodeFile, err, context);
+    if (!M) {
+        err.print("pdg-tool", llvm::errs());
+        return false;
+    }
+    if (llvm::verifyModule(*M, &llvm::errs())) {
+        llvm::errs() << bitcodeFile << ": input module is broken\n";
+        return false;
+    }
+    demoteRegistersToMemory(*M);
+    return exportPDG(*M, bitcodeFile, options);
+}
+
+} // namespace pdg
+
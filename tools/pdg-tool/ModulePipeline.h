@@ -0,0 +1,44 @@
+#pragma once
+
+#include <string>
+#include <vector>
+
+namespace pdg {
+
+struct ModulePipelineOptions
+{
+    /// Write -relations and -blocks next to each module instead of the working directory
+    bool outputsInModuleDirectory = false;
+    /// When set, only PDGs of these functions and their callees are built and
+    /// function bodies are read from bitcode on demand
+    std::vector<std::string> entryFunctions;
+    /// Directory receiving DOT files of targeted PDGs
+    std::string dotDirectory = ".";
+    /// Build the PDG from SVF pointer analysis, otherwise from MemorySSA only
+    bool usePointerAnalysis = true;
+    /// Directory receiving the serialized PDG of each module for linking,
+    /// nothing is written when empty
+    std::string serializedPDGDirectory;
+    /// With -append, write the CSV of each module to its own partial files,
+    /// which commitPartialOutputs appends to -relations and -blocks
+    bool partialOutputs = false;
+}; // struct ModulePipelineOptions
+
+/// Parses one bitcode file into its own context, demotes registers to memory
+/// and exports the module PDG in CSV, or dumps the PDG reachable from the
+/// entry functions in DOT
+bool runModulePipeline(const std::string& bitcodeFile, const ModulePipelineOptions& options);
+
+/// Appends the partial CSV files of a module to -relations and -blocks if it
+/// succeeded, and removes them. A worker killed while writing them leaves
+/// nothing behind in the shared files.
+bool commitPartialOutputs(const std::string& bitcodeFile, const ModulePipelineOptions& options, bool success);
+
+/// Builds the PDG of one shard of a module, the given functions, with
+/// functions of other shards as declarations and saves it serialized
+bool runShardPipeline(const std::string& bitcodeFile,
+                      const std::vector<std::string>& shardFunctions,
+                      const std::string& outputFile);
+
+} // namespace pdg
+
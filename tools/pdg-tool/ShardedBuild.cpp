@@ -0,0 +1,118 @@
+#include "ShardedBuild.h"
+
+#include "PDG/PDGLinker.h"
+#include "PDG/SerializedPDG.h"
+
+#include "llvm/ADT/SmallString.h"
+#include "llvm/ADT/StringRef.h"
+#include "llvm/IR/LLVMContext.h"
+#include "llvm/IR/Module.h"
+#include "llvm/IRReader/IRReader.h"
+#include "llvm/Support/Debug.h"
+#include "llvm/Support/LineIterator.h"
+#include "llvm/Support/MemoryBuffer.h"
+#include "llvm/Support/Path.h"
+#include "llvm/Support/SourceMgr.h"
+#include "llvm/Support/raw_ostream.h"
+
+#include <unordered_map>
+
+namespace pdg {
+
+namespace {
+
+using FunctionShards = std::unordered_map<std::string, unsigned>;
+
+bool readShardManifest(const std::string& manifestFile, unsigned numShards, FunctionShards& functionShards)
+{
+    auto buffer = llvm::MemoryBuffer::getFile(manifestFile);
+    if (!buffer) {
+        llvm::errs() << "Could not read shard manifest " << manifestFile << ": "
+                     << buffer.getError().message() << "\n";
+        return false;
+    }
+    for (llvm::line_iterator line(**buffer, true, '#'); !line.is_at_end(); ++line) {
+        auto fields = line->trim().split(' ');
+        unsigned shard = 0;
+        llvm::StringRef function = fields.second.trim();
+        if (fields.first.getAsInteger(10, shard) || shard >= numShards || function.empty()) {
+            llvm::errs() << manifestFile << ":" << line.line_number()
+                         << ": expected '<shard> <function>' with shard below " << numShards << "\n";
+            return false;
+        }
+        functionShards[function.str()] = shard;
+    }
+    return true;
+}
+
+std::string getOutputFile(const std::string& bitcodeFile, const std::string& directory, const std::string& suffix)
+{
+    llvm::SmallString<256> filename(directory);
+    llvm::sys::path::append(filename, llvm::sys::path::stem(bitcodeFile) + suffix);
+    return filename.str().str();
+}
+
+} // unnamed namespace
+
+bool partitionFunctions(const std::string& bitcodeFile,
+                        unsigned numShards,
+                        const std::string& manifestFile,
+                        ShardFunctions& shards)
+{
+    FunctionShards functionShards;
+    if (!manifestFile.empty() && !readShardManifest(manifestFile, numShards, functionShards)) {
+        return false;
+    }
+    llvm::LLVMContext context;
+    llvm::SMDiagnostic err;
+    // only the function list is needed, bodies are left to the shards
+    std::unique_ptr<llvm::Module> M = llvm::getLazyIRFileModule(bitcodeFile, err, context);
+    if (!M) {
+        err.print("pdg-tool", llvm::errs());
+        return false;
+    }
+    shards.assign(numShards, std::vector<std::string>());
+    unsigned nextShard = 0;
+    for (auto& F : *M) {
+        if (F.isDeclaration()) {
+            continue;
+        }
+        auto pos = functionShards.find(F.getName().str());
+        if (pos != functionShards.end()) {
+            shards[pos->second].push_back(F.getName().str());
+            functionShards.erase(pos);
+            continue;
+        }
+        shards[nextShard].push_back(F.getName().str());
+        nextShard = (nextShard + 1) % numShards;
+    }
+    for (const auto& entry : functionShards) {
+        llvm::errs() << manifestFile << ": " << bitcodeFile << " defines no function " << entry.first << "\n";
+    }
+    return functionShards.empty();
+}
+
+std::string getShardFile(const std::string& bitcodeFile, const std::string& directory, unsigned shard)
+{
+    return getOutputFile(bitcodeFile, directory, ".shard" + std::to_string(shard) + ".pdg");
+}
+
+bool mergeShards(const std::string& bitcodeFile, const std::string& directory, unsigned numShards)
+{
+    PDGLinker linker;
+    for (unsigned shard = 0; shard < numShards; ++shard) {
+        SerializedPDG pdg;
+        if (!pdg.load(getShardFile(bitcodeFile, directory, shard))) {
+            return false;
+        }
+        linker.addShard(pdg);
+    }
+    SerializedPDG merged = linker.link();
+    llvm::dbgs() << bitcodeFile << ": merged " << numShards << " shards into "
+                 << merged.getNodes().size() << " nodes, "
+                 << linker.getUnresolvedSymbols().size() << " external symbols\n";
+    return merged.save(getOutputFile(bitcodeFile, directory, ".pdg"));
+}
+
+} // namespace pdg
+
@@ -0,0 +1,26 @@
+#pragma once
+
+#include <string>
+#include <vector>
+
+namespace pdg {
+
+/// Names of the functions built by each shard
+using ShardFunctions = std::vector<std::vector<std::string>>;
+
+/// Assigns the defined functions of a module to shards. The manifest lists
+/// "<shard> <function>" lines, functions it does not list are dealt out
+/// round robin in module order.
+bool partitionFunctions(const std::string& bitcodeFile,
+                        unsigned numShards,
+                        const std::string& manifestFile,
+                        ShardFunctions& shards);
+
+/// Serialized partial PDG of a shard, <module>.shard<N>.pdg in the directory
+std::string getShardFile(const std::string& bitcodeFile, const std::string& directory, unsigned shard);
+
+/// Links the partial PDGs of all shards into <module>.pdg in the directory
+bool mergeShards(const std::string& bitcodeFile, const std::string& directory, unsigned numShards);
+
+} // namespace pdg
+
@@ -0,0 +1,409 @@
+#include "BatchRunner.h"
+#include "Datasets.h"
+#include "ModuleCost.h"
+#include "ModulePipeline.h"
+#include "ShardedBuild.h"
+
+#include "PDG/FrozenPDG.h"
+#include "PDG/FrozenPDGWriter.h"
+#include "PDG/PDGLinker.h"
+#include "PDG/SerializedPDG.h"
+#include "Passes/PDGCSVPass.h"
+
+#include "llvm/ADT/SmallString.h"
+#include "llvm/ADT/StringRef.h"
+#include "llvm/InitializePasses.h"
+#include "llvm/PassRegistry.h"
+#include "llvm/Support/CommandLine.h"
+#include "llvm/Support/Debug.h"
+#include "llvm/Support/FileSystem.h"
+#include "llvm/Support/InitLLVM.h"
+#include "llvm/Support/LineIterator.h"
+#include "llvm/Support/MemoryBuffer.h"
+#include "llvm/Support/Path.h"
+#include "llvm/Support/raw_ostream.h"
+
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+static llvm::cl::list<std::string> InputFiles(llvm::cl::Positional,
+                                              llvm::cl::ZeroOrMore,
+                                              llvm::cl::desc("<bitcode files, or serialized PDGs with -link and -freeze>"));
+
+static llvm::cl::opt<std::string> ManifestFile(
+    "manifest",
+    llvm::cl::desc("File listing bitcode files to process, one per line"),
+    llvm::cl::value_desc("file"));
+
+static llvm::cl::opt<unsigned> NumJobs(
+    "j",
+    llvm::cl::desc("Number of modules processed in parallel (0 uses all cores)"),
+    llvm::cl::init(0));
+
+static llvm::cl::opt<bool> OutputsInModuleDirectory(
+    "outputs-in-module-dir",
+    llvm::cl::desc("Resolve relative -relations and -blocks against the directory of each module"));
+
+static llvm::cl::list<std::string> EntryFunctions(
+    "entry",
+    llvm::cl::desc("Build PDG only for functions reachable from these entries and dump it in DOT"),
+    llvm::cl::CommaSeparated,
+    llvm::cl::ZeroOrMore);
+
+static llvm::cl::opt<std::string> DotDirectory(
+    "dot-dir",
+    llvm::cl::desc("Directory for DOT files written with -entry"),
+    llvm::cl::init("."));
+
+static llvm::cl::opt<std::string> DatasetsRoot(
+    "datasets",
+    llvm::cl::desc("Process every sub-directory with bitcode files as a dataset, writing outputs into it"),
+    llvm::cl::value_desc("directory"));
+
+static llvm::cl::opt<bool> SkipExisting(
+    "skip-existing",
+    llvm::cl::desc("Skip datasets whose blocks file already exists instead of failing"));
+
+static llvm::cl::opt<pdg::CostModel> ScheduleBy(
+    "schedule-by",
+    llvm::cl::desc("Estimate module cost for largest-first scheduling by"),
+    llvm::cl::values(clEnumValN(pdg::CostModel::BitcodeSize, "size", "bitcode file size"),
+                     clEnumValN(pdg::CostModel::FunctionCount, "functions", "number of defined functions")),
+    llvm::cl::init(pdg::CostModel::BitcodeSize));
+
+static llvm::cl::opt<unsigned> TimeBudget(
+    "time-budget",
+    llvm::cl::desc("Seconds a module may take before it is rebuilt without pointer analysis (0 for no limit)"),
+    llvm::cl::init(0));
+
+static llvm::cl::opt<unsigned> MemoryBudget(
+    "memory-budget",
+    llvm::cl::desc("Resident MB a module may take before it is rebuilt without pointer analysis (0 for no limit)"),
+    llvm::cl::init(0));
+
+static llvm::cl::opt<std::string> DowngradesFile(
+    "downgrades",
+    llvm::cl::desc("File recording modules rebuilt without pointer analysis"),
+    llvm::cl::init("downgrades.csv"));
+
+static llvm::cl::opt<std::string> SerializedPDGDirectory(
+    "pdg-dir",
+    llvm::cl::desc("Also write the PDG of each module serialized as <module>.pdg into this directory"),
+    llvm::cl::value_desc("directory"));
+
+static llvm::cl::opt<std::string> LinkOutput(
+    "link",
+    llvm::cl::desc("Link the serialized PDGs given as inputs into one whole program PDG"),
+    llvm::cl::value_desc("output file"));
+
+static llvm::cl::opt<bool> LinkShards(
+    "link-shards",
+    llvm::cl::desc("The inputs of -link or -freeze are shards of one module and share its local symbols"),
+    llvm::cl::init(false));
+
+static llvm::cl::opt<std::string> FreezeDirectory(
+    "freeze",
+    llvm::cl::desc("Convert the serialized PDG given as input, or several linked on the fly, into memory mapped adjacency arrays in this directory"),
+    llvm::cl::value_desc("directory"));
+
+static llvm::cl::opt<unsigned> FreezeMemory(
+    "freeze-memory",
+    llvm::cl::desc("MB of edges sorted in memory by -freeze before spilling them to disk"),
+    llvm::cl::init(1024));
+
+static llvm::cl::opt<unsigned> NumShards(
+    "shards",
+    llvm::cl::desc("Split the PDG build of one module across this many worker processes and merge the partial PDGs"),
+    llvm::cl::init(0));
+
+static llvm::cl::opt<std::string> ShardManifest(
+    "shard-manifest",
+    llvm::cl::desc("File assigning functions to shards, one '<shard> <function>' per line"),
+    llvm::cl::value_desc("file"));
+
+static llvm::cl::opt<int> ShardIndex(
+    "shard",
+    llvm::cl::desc("Only build this shard of -shards, e.g. on another machine, and leave the merge to -link"),
+    llvm::cl::init(-1));
+
+namespace {
+
+using ModuleDatasets = std::unordered_map<std::string, pdg::Dataset*>;
+
+bool readManifest(const std::string& manifestFile, std::vector<std::string>& inputs)
+{
+    auto buffer = llvm::MemoryBuffer::getFile(manifestFile);
+    if (!buffer) {
+        llvm::errs() << "Could not read manifest " << manifestFile << ": "
+                     << buffer.getError().message() << "\n";
+        return false;
+    }
+    // skips blank lines and lines starting with #
+    for (llvm::line_iterator line(**buffer, true, '#'); !line.is_at_end(); ++line) {
+        llvm::StringRef input = line->trim();
+        if (!input.empty()) {
+            inputs.push_back(input.str());
+        }
+    }
+    return true;
+}
+
+bool prepareDatasets(std::vector<pdg::Dataset>& datasets,
+                     std::vector<std::string>& inputs,
+                     ModuleDatasets& moduleDatasets)
+{
+    if (!pdg::collectDatasets(DatasetsRoot, datasets)) {
+        return false;
+    }
+    bool success = true;
+    for (auto& dataset : datasets) {
+        pdg::PDGCSVPass csvPass;
+        csvPass.setOutputDirectory(dataset.directory);
+        if (llvm::sys::fs::exists(csvPass.getBlocksFile())) {
+            if (!SkipExisting) {
+                llvm::errs() << csvPass.getBlocksFile() << " already exists\n";
+                success = false;
+            }
+            continue;
+        }
+        if (!pdg::lockDataset(dataset)) {
+            llvm::dbgs() << "Skipping " << dataset.directory << " locked by another run\n";
+            continue;
+        }
+        dataset.numPendingModules = dataset.modules.size();
+        for (const auto& module : dataset.modules) {
+            inputs.push_back(module);
+            moduleDatasets[module] = &dataset;
+        }
+    }
+    return success;
+}
+
+void recordDowngrade(const std::string& input, const std::string& reason, bool inModuleDirectory)
+{
+    llvm::SmallString<256> reportFile;
+    if (inModuleDirectory && !llvm::sys::path::is_absolute(DowngradesFile)) {
+        reportFile = llvm::sys::path::parent_path(input);
+    }
+    llvm::sys::path::append(reportFile, DowngradesFile);
+    std::error_code EC;
+    llvm::raw_fd_ostream report(reportFile, EC, llvm::sys::fs::F_Append | llvm::sys::fs::F_Text);
+    if (EC) {
+        llvm::errs() << "Could not open " << reportFile << ": " << EC.message() << "\n";
+        return;
+    }
+    report << llvm::sys::path::filename(input) << ";" << reason << ";memoryssa\n";
+}
+
+bool linkSerializedPDGs(const std::vector<std::string>& inputs, const std::string& output)
+{
+    pdg::PDGLinker linker;
+    for (const auto& input : inputs) {
+        pdg::SerializedPDG pdg;
+        if (!pdg.load(input)) {
+            return false;
+        }
+        if (LinkShards) {
+            linker.addShard(pdg);
+        } else {
+            linker.addModule(pdg);
+        }
+    }
+    pdg::SerializedPDG linked = linker.link();
+    llvm::dbgs() << "Linked " << inputs.size() << " modules into " << linked.getNodes().size()
+                 << " nodes, resolved " << linker.getNumResolved() << " declaration nodes, dropped "
+                 << linker.getNumDiscarded() << " nodes of replaced definitions\n";
+    for (const auto& symbol : linker.getUnresolvedSymbols()) {
+        llvm::dbgs() << "Unresolved " << symbol << "\n";
+    }
+    for (const auto& symbol : linker.getMultipleDefinitions()) {
+        llvm::errs() << "multiple definition of `" << symbol << "'\n";
+    }
+    if (!linker.getMultipleDefinitions().empty()) {
+        return false;
+    }
+    return linked.save(output);
+}
+
+/// Links the serialized PDGs into the writer in two passes over the files,
+/// so the whole program graph is never held in memory
+bool linkFrozenPDGs(const std::vector<std::string>& inputs, pdg::FrozenPDGWriter& writer)
+{
+    pdg::PDGLinker linker;
+    for (const auto& input : inputs) {
+        if (!(LinkShards ? linker.addShardFile(input) : linker.addModuleFile(input))) {
+            return false;
+        }
+    }
+    if (!linker.link(writer)) {
+        return false;
+    }
+    llvm::dbgs() << "Linked " << inputs.size() << " modules, resolved " << linker.getNumResolved()
+                 << " declaration nodes, dropped " << linker.getNumDiscarded()
+                 << " nodes of replaced definitions\n";
+    for (const auto& symbol : linker.getUnresolvedSymbols()) {
+        llvm::dbgs() << "Unresolved " << symbol << "\n";
+    }
+    for (const auto& symbol : linker.getMultipleDefinitions()) {
+        llvm::errs() << "multiple definition of `" << symbol << "'\n";
+    }
+    return linker.getMultipleDefinitions().empty();
+}
+
+bool freezeSerializedPDG(const std::vector<std::string>& inputs, const std::string& directory)
+{
+    if (inputs.empty()) {
+        llvm::errs() << "-freeze takes serialized PDGs\n";
+        return false;
+    }
+    // the serialized graph is streamed, it may be larger than memory
+    {
+        pdg::FrozenPDGWriter writer(directory, static_cast<uint64_t>(FreezeMemory) << 20);
+        if (inputs.size() == 1 && !LinkShards) {
+            if (!pdg::SerializedPDG::read(inputs.front(), writer)) {
+                return false;
+            }
+        } else if (!linkFrozenPDGs(inputs, writer)) {
+            return false;
+        }
+        if (!writer.finish()) {
+            return false;
+        }
+    }
+    auto frozen = pdg::FrozenPDG::open(directory);
+    if (!frozen) {
+        return false;
+    }
+    llvm::dbgs() << "Froze " << frozen->getNumNodes() << " nodes, " << frozen->getNumEdges()
+                 << " edges and " << frozen->getNumFunctions() << " functions into " << directory << "\n";
+    return true;
+}
+
+bool runShardedBuild(const std::vector<std::string>& inputs, unsigned numJobs)
+{
+    if (inputs.size() != 1) {
+        llvm::errs() << "-shards takes a single module\n";
+        return false;
+    }
+    const std::string& input = inputs.front();
+    pdg::ShardFunctions shards;
+    if (!pdg::partitionFunctions(input, NumShards, ShardManifest, shards)) {
+        return false;
+    }
+    const std::string directory = SerializedPDGDirectory.empty() ? "." : SerializedPDGDirectory.getValue();
+    auto buildShard = [&] (unsigned shard) {
+        return pdg::runShardPipeline(input, shards[shard], pdg::getShardFile(input, directory, shard));
+    };
+    if (ShardIndex >= 0) {
+        if (static_cast<unsigned>(ShardIndex) >= NumShards) {
+            llvm::errs() << "-shard must be below -shards\n";
+            return false;
+        }
+        return buildShard(ShardIndex);
+    }
+    std::vector<std::string> shardIds;
+    for (unsigned shard = 0; shard < NumShards; ++shard) {
+        shardIds.push_back(std::to_string(shard));
+    }
+    // every shard is a worker process, the driver only merges
+    pdg::BatchRunner runner(numJobs);
+    if (!runner.run(shardIds, [&buildShard] (const std::string& shardId) {
+            return buildShard(std::stoul(shardId));
+        })) {
+        llvm::errs() << runner.getFailedInputs().size() << " of " << NumShards << " shards failed\n";
+        return false;
+    }
+    return pdg::mergeShards(input, directory, NumShards);
+}
+
+void initializePasses()
+{
+    llvm::PassRegistry& registry = *llvm::PassRegistry::getPassRegistry();
+    llvm::initializeCore(registry);
+    llvm::initializeAnalysis(registry);
+    llvm::initializeTransformUtils(registry);
+    llvm::initializeScalarOpts(registry);
+}
+
+} // unnamed namespace
+
+int main(int argc, char** argv)
+{
+    llvm::InitLLVM X(argc, argv);
+    llvm::cl::ParseCommandLineOptions(argc, argv, "Batch PDG construction and CSV export\n");
+
+    std::vector<std::string> inputs(InputFiles.begin(), InputFiles.end());
+    if (!ManifestFile.empty() && !readManifest(ManifestFile, inputs)) {
+        return 1;
+    }
+    std::vector<pdg::Dataset> datasets;
+    ModuleDatasets moduleDatasets;
+    if (!DatasetsRoot.empty() && !prepareDatasets(datasets, inputs, moduleDatasets)) {
+        return 1;
+    }
+    if (!LinkOutput.empty()) {
+        return linkSerializedPDGs(inputs, LinkOutput) ? 0 : 1;
+    }
+    if (!FreezeDirectory.empty()) {
+        return freezeSerializedPDG(inputs, FreezeDirectory) ? 0 : 1;
+    }
+    if (inputs.empty()) {
+        if (!DatasetsRoot.empty()) {
+            llvm::dbgs() << "No datasets left to process\n";
+            return 0;
+        }
+        llvm::errs() << "No input modules given\n";
+        return 1;
+    }
+    initializePasses();
+
+    const unsigned numJobs = NumJobs != 0 ? NumJobs.getValue() : std::thread::hardware_concurrency();
+    if (NumShards != 0) {
+        return runShardedBuild(inputs, numJobs) ? 0 : 1;
+    }
+    pdg::ModulePipelineOptions options;
+    options.outputsInModuleDirectory = OutputsInModuleDirectory || !DatasetsRoot.empty();
+    options.entryFunctions.assign(EntryFunctions.begin(), EntryFunctions.end());
+    options.dotDirectory = DotDirectory;
+    options.serializedPDGDirectory = SerializedPDGDirectory;
+    // a worker killed over budget must not leave rows the fallback appends again
+    options.partialOutputs = true;
+    pdg::BatchRunner runner(numJobs);
+    runner.setCostEstimator([] (const std::string& input) {
+        return pdg::estimateModuleCost(input, ScheduleBy);
+    });
+    // a dataset is released as soon as its last module is done
+    runner.setCompletionCallback([&moduleDatasets, &options] (const std::string& input, bool success) {
+        if (!pdg::commitPartialOutputs(input, options, success)) {
+            llvm::errs() << "Could not write the output of " << input << "\n";
+        }
+        auto pos = moduleDatasets.find(input);
+        if (pos != moduleDatasets.end() && --pos->second->numPendingModules == 0) {
+            pdg::unlockDataset(*pos->second);
+        }
+    });
+    pdg::BatchRunner::Budget budget;
+    budget.seconds = TimeBudget;
+    budget.residentMB = MemoryBudget;
+    runner.setBudget(budget);
+    pdg::ModulePipelineOptions fallbackOptions = options;
+    fallbackOptions.usePointerAnalysis = false;
+    runner.setFallbackTask([&fallbackOptions] (const std::string& input) {
+        return pdg::runModulePipeline(input, fallbackOptions);
+    });
+    runner.setDowngradeCallback([&options] (const std::string& input, const std::string& reason) {
+        recordDowngrade(input, reason, options.outputsInModuleDirectory);
+    });
+    const bool success = runner.run(inputs, [&options] (const std::string& input) {
+        return pdg::runModulePipeline(input, options);
+    });
+    if (!success) {
+        llvm::errs() << runner.getFailedInputs().size() << " of " << inputs.size()
+                     << " modules failed\n";
+        return 1;
+    }
+    return 0;
+}
+